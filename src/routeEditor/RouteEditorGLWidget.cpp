@@ -28,6 +28,9 @@
 
 #include <tsre/world/TerrainLib.h>
 #include <tsre/texture/Brush.h>
+#include <tsre/texture/TexLib.h>
+#include <tsre/texture/TexLoader.h>
+#include <tsre/renderer/FrameScheduler.h>
 #include <tsre/geo/GeoCoordinates.h>
 #include <tsre/geo/MapWindow.h>
 #include "TerrainTreeWindow.h"
@@ -49,6 +52,7 @@
 #include <QDebug>
 #include <routeEditor/RouteEditorClient.h>
 #include <tsre/world/RouteClient.h>
+#include <tsre/world/TileStreamer.h>
 #include <tsre/ClientInfo.h>
 
 RouteEditorGLWidget::RouteEditorGLWidget(QWidget *parent)
@@ -123,12 +127,10 @@ void RouteEditorGLWidget::timerEvent(QTimerEvent * event) {
     }
 
     route->updateSim(camera->pozT, (float) (timeNow - lastTime) / 1000.0);
+    TileStreamer::update(route, camera->pozT, camera->getPos());
 
     lastTime = timeNow;
 
-    if (Game::allowObjLag < Game::maxObjLag)
-        Game::allowObjLag += 2;
-
     camera->update(fps);
     
     update();
@@ -337,6 +339,13 @@ void RouteEditorGLWidget::paintGL(){
     Game::currentShapeLib = currentShapeLib;
     if (route == NULL) return;
     if (!route->loaded) return;
+    TexLib::nextFrame(camera->getPos());
+    FrameScheduler::nextFrame();
+    if(TexLoader::Frame % 60 == 0){
+        // Shapes first, they release their textures.
+        currentShapeLib->unloadUnused();
+        TexLib::unloadUnused();
+    }
     
     // Render Shadows
     //if (Game::shadowsEnabled > 0)
@@ -454,6 +463,13 @@ void RouteEditorGLWidget::paintGL2() {
     Game::currentShapeLib = currentShapeLib;
     if (route == NULL) return;
     if (!route->loaded) return;
+    TexLib::nextFrame(camera->getPos());
+    FrameScheduler::nextFrame();
+    if(TexLoader::Frame % 60 == 0){
+        // Shapes first, they release their textures.
+        currentShapeLib->unloadUnused();
+        TexLib::unloadUnused();
+    }
 
     // Render Shadows
     if (Game::shadowsEnabled > 0)
@@ -662,40 +678,7 @@ void RouteEditorGLWidget::handleSelection() {
             if (ww == 3 || ww == 6 || ww == 9) wz = camera->pozT[1] + 1;
             qDebug() << "color data: " << cdata;
             qDebug() << wx << " " << wz << " " << UiD;
-            WorldObj *selectedWorldObj = (WorldObj*) selectedObj;
-            if (keyControlEnabled) {
-                if (selectedWorldObj == NULL){
-                    setSelectedObj(groupObj);
-                    selectedWorldObj = (WorldObj*) selectedObj;
-                } else if (selectedWorldObj->typeObj != GameObj::worldobj){
-                    selectedWorldObj->unselect();
-                    setSelectedObj(groupObj);
-                } else if (selectedWorldObj->typeObj == GameObj::worldobj) {
-                    groupObj->addObject(selectedWorldObj);
-                    setSelectedObj(groupObj);
-                }
-                groupObj->addObject(route->getObj(wx, wz, UiD));
-                if (groupObj->count() == 0) {
-                    qDebug() << "brak obiektu";
-                    groupObj->unselect();
-                    setSelectedObj(NULL);
-                }
-            } else { 
-                WorldObj* twobj = route->getObj(wx, wz, UiD); 
-                if (selectedWorldObj != NULL && twobj != selectedWorldObj) {
-                    selectedWorldObj->unselect();
-                    if (autoAddToTDB) {
-                        route->addToTDBIfNotExist(selectedWorldObj);
-                    }
-                }
-                lastSelectedObj = selectedObj;
-                setSelectedObj(twobj);
-                if (selectedObj == NULL) {
-                    qDebug() << "brak obiektu";
-                } else {
-                    selectedObj->select(cdata);
-                } 
-            }
+            selectWorldObj(route->getObj(wx, wz, UiD), cdata);
         } else if( ww == 10 ){
             int wx = camera->pozT[0] - 1 + ((colorHash >> 10) & 0x3);
             int wz = camera->pozT[1] - 1 + ((colorHash >> 8) & 0x3);
@@ -789,6 +772,74 @@ void RouteEditorGLWidget::handleSelection() {
     }
 }
 
+void RouteEditorGLWidget::selectWorldObj(WorldObj* twobj, int cdata) {
+    WorldObj *selectedWorldObj = (WorldObj*) selectedObj;
+    if (keyControlEnabled) {
+        if (selectedWorldObj == NULL){
+            setSelectedObj(groupObj);
+            selectedWorldObj = (WorldObj*) selectedObj;
+        } else if (selectedWorldObj->typeObj != GameObj::worldobj){
+            selectedWorldObj->unselect();
+            setSelectedObj(groupObj);
+        } else if (selectedWorldObj->typeObj == GameObj::worldobj) {
+            groupObj->addObject(selectedWorldObj);
+            setSelectedObj(groupObj);
+        }
+        groupObj->addObject(twobj);
+        if (groupObj->count() == 0) {
+            qDebug() << "brak obiektu";
+            groupObj->unselect();
+            setSelectedObj(NULL);
+        }
+    } else { 
+        if (selectedWorldObj != NULL && twobj != selectedWorldObj) {
+            selectedWorldObj->unselect();
+            if (autoAddToTDB) {
+                route->addToTDBIfNotExist(selectedWorldObj);
+            }
+        }
+        setLastSelectedObj(selectedObj);
+        setSelectedObj(twobj);
+        if (selectedObj == NULL) {
+            qDebug() << "brak obiektu";
+        } else {
+            selectedObj->select(cdata);
+        } 
+    }
+}
+
+/*
+ * Selects the nearest world object hit by the ray under the cursor,
+ * without the selection render pass. False if the ray hits no object,
+ * the selection pass then picks terrain, track items and activity objects.
+ */
+bool RouteEditorGLWidget::pickWorldObj() {
+    if (!Game::cpuPicking)
+        return false;
+    float projection[16];
+    float modelview[16];
+    Mat4::perspective(projection, Game::cameraFov * M_PI / 180, float(this->width()) / this->height(), 0.2f, Game::objectLod);
+    Mat4::multiply(projection, projection, camera->getMatrix());
+    Mat4::identity(modelview);
+    int viewport[4] = {0, 0, (int)(this->width() * Game::PixelRatio), (int)(this->height() * Game::PixelRatio)};
+    int realy = viewport[3] - (int) mousey - 1;
+    float origin[3];
+    float dir[3];
+    if (!GLH::glhUnProjectf((float) mousex, (float) realy, 0, modelview, projection, viewport, origin))
+        return false;
+    if (!GLH::glhUnProjectf((float) mousex, (float) realy, 1, modelview, projection, viewport, dir))
+        return false;
+    Vec3::sub(dir, dir, origin);
+    Vec3::normalize(dir, dir);
+
+    float t;
+    WorldObj* obj = route->pickObject(camera->pozT, origin, dir, Game::objectLod, t);
+    if (obj == NULL)
+        return false;
+    selectWorldObj(obj, 0);
+    return true;
+}
+
 void RouteEditorGLWidget::pushRenderPointer() {
     
     int x = mousex;
@@ -1108,7 +1159,7 @@ void RouteEditorGLWidget::keyPressEvent(QKeyEvent * event) {
                         emit sendMsg("refreshActivityTools");
                     }
                     setSelectedObj(NULL);
-                    lastSelectedObj = NULL;
+                    setLastSelectedObj(NULL);
                 }
                 break;
             case Qt::Key_C:
@@ -1140,7 +1191,7 @@ void RouteEditorGLWidget::keyPressEvent(QKeyEvent * event) {
                 route->toggleToTDB((WorldObj*)selectedObj);
                 Undo::StateEnd();
                 if (selectedObj != NULL) selectedObj->unselect();
-                lastSelectedObj = selectedObj;
+                setLastSelectedObj(selectedObj);
                 setSelectedObj(NULL);
                 break;
             case Qt::Key_X:
@@ -1246,7 +1297,8 @@ void RouteEditorGLWidget::mousePressEvent(QMouseEvent *event) {
         }
         if (toolEnabled == "selectTool") {
             if (!translateTool && !rotateTool && !resizeTool)
-                selection = true;
+                if (!pickWorldObj())
+                    selection = true;
             if (selectedObj != NULL) {
                 mouseLPressed = true;
                 if (translateTool) {
@@ -1574,6 +1626,18 @@ void RouteEditorGLWidget::setSelectedObj(GameObj* o) {
            emit sendMsg("showShape", ((WorldObj*) o)->getShapePath());
 }
 
+/*
+ * The tile of the last selected object is kept loaded,
+ * setTerrainToObj() uses the object after it was unselected.
+ */
+void RouteEditorGLWidget::setLastSelectedObj(GameObj* o) {
+    lastSelectedObj = o;
+    if (o != NULL && o->typeObj == GameObj::worldobj)
+        TileStreamer::pinObjectTiles((WorldObj*) o, TileStreamer::LastSelected);
+    else
+        TileStreamer::pinObjectTiles(NULL, TileStreamer::LastSelected);
+}
+
 void RouteEditorGLWidget::editCopy() {
     if (toolEnabled == "selectTool" || toolEnabled == "placeTool") {
         if (selectedObj != NULL) {
@@ -1586,6 +1650,7 @@ void RouteEditorGLWidget::editCopy() {
                 } else {
                     copyPasteObj = selectedWorldObj;
                 }
+                TileStreamer::pinObjectTiles(copyPasteObj);
             }
         }
     }
@@ -2055,6 +2120,7 @@ void RouteEditorGLWidget::showContextMenu(const QPoint & point) {
 
 void RouteEditorGLWidget::createNewTiles(QMap<int, QPair<int, int>*> list){
     int x, z;
+    QVector<QPair<int, int>> geoTiles;
     QMapIterator<int, QPair<int, int>*> i2(list);
     while (i2.hasNext()) {
         i2.next();
@@ -2063,14 +2129,20 @@ void RouteEditorGLWidget::createNewTiles(QMap<int, QPair<int, int>*> list){
         x = i2.value()->first;
         z = i2.value()->second;
         qDebug() << x << z;
-        route->newTile(x, -z);
+        if(route->newTile(x, -z, false, false) == 2)
+            geoTiles.push_back(QPair<int, int>(x, -z));
     }
+    // All new tiles at once, DEM resampling runs in parallel.
+    if(Game::autoGeoTerrain)
+        Game::terrainLib->setHeightFromGeo(geoTiles);
 }
 
 void RouteEditorGLWidget::createNewLoTiles(QMap<int, QPair<int, int>*> list){
     int x, z;
+    QVector<QPair<int, int>> geoTiles;
     QMapIterator<int, QPair<int, int>*> i2(list);
     if (!Game::writeEnabled) return;
+    Game::terrainLib->setLowTerrainAsCurrent();
     while (i2.hasNext()) {
         i2.next();
         if(i2.value() == NULL)
@@ -2078,16 +2150,13 @@ void RouteEditorGLWidget::createNewLoTiles(QMap<int, QPair<int, int>*> list){
         x = i2.value()->first;
         z = i2.value()->second;
         qDebug() << x << z;
-        Game::terrainLib->setLowTerrainAsCurrent();
         Game::terrainLib->saveEmpty(x, z);
         Game::terrainLib->reload(x, -z);
-        if(Game::autoGeoTerrain){
-            float pos[3];
-            Vec3::set(pos, 0, 0, 0);
-            Game::terrainLib->setHeightFromGeo(x, -z, (float*)&pos);
-        }
-        Game::terrainLib->setDetailedTerrainAsCurrent();
+        geoTiles.push_back(QPair<int, int>(x, -z));
     }
+    if(Game::autoGeoTerrain)
+        Game::terrainLib->setHeightFromGeo(geoTiles);
+    Game::terrainLib->setDetailedTerrainAsCurrent();
 }
 
 void RouteEditorGLWidget::getUnsavedInfo(QVector<QString> &items) {
@@ -2104,7 +2173,7 @@ void RouteEditorGLWidget::msg(QString text) {
     }
     if (text == "unselect") {
         setSelectedObj(NULL);
-        lastSelectedObj = NULL;
+        setLastSelectedObj(NULL);
         return;
     }
     if (text == "createPaths") {
@@ -148,6 +148,8 @@ protected:
     void paintGL2();
     void renderShadowMaps();
     void handleSelection();
+    void selectWorldObj(WorldObj* twobj, int cdata);
+    bool pickWorldObj();
     void resizeGL(int width, int height) Q_DECL_OVERRIDE;
     void mousePressEvent(QMouseEvent *event) Q_DECL_OVERRIDE;
     void mouseReleaseEvent(QMouseEvent* event) Q_DECL_OVERRIDE;
@@ -161,6 +163,7 @@ protected:
 private:
     void setupVertexAttribs();
     void setSelectedObj(GameObj* o);
+    void setLastSelectedObj(GameObj* o);
     QBasicTimer timer;
     unsigned long long int lastTime;
     unsigned long long int timeNow;
@@ -60,6 +60,8 @@
 #include <routeEditor/activity/ActivityTimetableWindow.h>
 #include <routeEditor/activity/ActivityTimetableProperties.h>
 #include <routeEditor/RouteEditorClient.h>
+#include <tsre/fileFunctions/SaveQueue.h>
+#include <tsre/renderer/FrameScheduler.h>
 
 RouteEditorWindow::RouteEditorWindow() {
 
@@ -181,6 +183,7 @@ RouteEditorWindow::RouteEditorWindow() {
     
     this->setCentralWidget(main);
     setWindowTitle(Game::AppName+" "+Game::AppVersion+" Route Editor");
+    QObject::connect(SaveQueue::Instance(), SIGNAL(progress(int, int)), this, SLOT(saveProgress(int, int)));
     
     // MENUBAR
     // Route
@@ -214,6 +217,9 @@ RouteEditorWindow::RouteEditorWindow() {
         undoAction->setShortcut(QKeySequence("Ctrl+Z"));
         QObject::connect(undoAction, SIGNAL(triggered()), glWidget, SLOT(editUndo()));
         editMenu->addAction(undoAction);
+        undoStatsAction = new QAction(tr("Undo &Statistics"), this); 
+        QObject::connect(undoStatsAction, SIGNAL(triggered()), this, SLOT(undoStatistics()));
+        editMenu->addAction(undoStatsAction);
     }
     copyAction = new QAction(tr("&Copy"), this); 
     copyAction->setShortcut(QKeySequence("Ctrl+C"));
@@ -338,6 +344,9 @@ RouteEditorWindow::RouteEditorWindow() {
     QObject::connect(aboutAction, SIGNAL(triggered()), this, SLOT(about()));
     helpMenu = menuBar()->addMenu(tr("&Help"));
     helpMenu->addAction(aboutAction);
+    frameStatsAction = new QAction(tr("&Frame Statistics"), this);
+    QObject::connect(frameStatsAction, SIGNAL(triggered()), this, SLOT(frameStatistics()));
+    helpMenu->addAction(frameStatsAction);
     
     hideAllTools();
     objTools->show();
@@ -572,6 +581,7 @@ void RouteEditorWindow::keyPressEvent(QKeyEvent *e) {
 }
 
 void RouteEditorWindow::closeEvent(QCloseEvent * event ){
+    SaveQueue::WaitForDone();
     QVector<QString> unsavedItems;
     glWidget->getUnsavedInfo(unsavedItems);
     if(unsavedItems.size() == 0){
@@ -603,6 +613,7 @@ void RouteEditorWindow::closeEvent(QCloseEvent * event ){
     }
     
     save();
+    SaveQueue::WaitForDone();
 
     emit exitNow();
     event->accept();
@@ -615,6 +626,13 @@ void RouteEditorWindow::save(){
     emit sendMsg(QString("save"));
 }
 
+void RouteEditorWindow::saveProgress(int done, int total){
+    if(total == 0)
+        setWindowTitle(Game::AppName+" "+Game::AppVersion+" Route Editor");
+    else
+        setWindowTitle(Game::AppName+" "+Game::AppVersion+" Route Editor - Saving "+QString::number(done)+"/"+QString::number(total));
+}
+
 void RouteEditorWindow::reloadRef(){
     emit reloadRefFile();
 }
@@ -655,6 +673,20 @@ void RouteEditorWindow::about(){
     aboutWindow->show();
 }
 
+void RouteEditorWindow::undoStatistics(){
+    QMessageBox msgBox;
+    msgBox.setWindowTitle("Undo Statistics");
+    msgBox.setText(Undo::GetStatistics());
+    msgBox.exec();
+}
+
+void RouteEditorWindow::frameStatistics(){
+    QMessageBox msgBox;
+    msgBox.setWindowTitle("Frame Statistics");
+    msgBox.setText(FrameScheduler::GetStatistics());
+    msgBox.exec();
+}
+
 void RouteEditorWindow::showTerrainTreeEditr(){
     emit sendMsg(QString("showTerrainTreeEditr"));
 }
@@ -44,11 +44,14 @@ public:
     
 public slots:
     void save();
+    void saveProgress(int done, int total);
     void showRoute();
     void show();
     void createPaths();
     void reloadRef();
     void about();
+    void undoStatistics();
+    void frameStatistics();
     void terrainCamera(bool val);
     void mstsShadows(bool val);
     void detailedTerrainEnabled();
@@ -125,9 +128,11 @@ private:
     QAction *exitAction;
     QAction *copyAction;
     QAction *undoAction;
+    QAction *undoStatsAction;
     QAction *pasteAction;
     QAction *selectAction;
     QAction *aboutAction;
+    QAction *frameStatsAction;
     QAction *terrainCameraAction;
     QAction *mstsShadowsAction;
     QAction *propertiesAction;
@@ -48,7 +48,7 @@ void PropertiesAbstract::resetRotEnabled(){
     if(worldObj == NULL)
         return;
     worldObj->setNewQdirection();
-    worldObj->modified = true;
+    worldObj->setModified();
     worldObj->setMartix();
 }
 /*
@@ -96,7 +96,7 @@ void PropertiesAbstract::rotYEnabled(){
     
     Undo::SinglePushWorldObjData(worldObj);
     worldObj->rotate(0,M_PI/2,0);
-    worldObj->modified = true;
+    worldObj->setModified();
     worldObj->setMartix();
 }
 
@@ -134,7 +134,7 @@ void PropertiesAbstract::pastePEnabled(){
     
     Undo::SinglePushWorldObjData(worldObj);
     worldObj->setPosition((float*)&nq);
-    worldObj->modified = true;
+    worldObj->setModified();
     worldObj->setMartix();
     this->posX.setText(args[0]);
     this->posY.setText(args[1]);
@@ -186,12 +186,12 @@ void PropertiesAbstract::transformEnabled(){
                 Vec3::transformQuat((float*)pos, (float*)pos, (float*)worldObj->qDirection);
             }
             worldObj->translate(pos[0], pos[1], pos[2]);
-            worldObj->modified = true;
+            worldObj->setModified();
             worldObj->setMartix();
         }
         if(transformWindow.rx != 0 || transformWindow.ry != 0 || + transformWindow.rz != 0){
             worldObj->rotate(transformWindow.rx*M_PI/180.0, transformWindow.ry*M_PI/180.0, transformWindow.rz*M_PI/180.0);
-            worldObj->modified = true;
+            worldObj->setModified();
             worldObj->setMartix();
         }
     }
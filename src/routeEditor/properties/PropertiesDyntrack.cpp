@@ -328,7 +328,7 @@ void PropertiesDyntrack::chSectEnabled(int idx){
         this->wSect[idx].hide();
         dobj->sections[idx].sectIdx = 4294967295;
     }
-    dobj->modified = true;
+    dobj->setModified();
     dobj->deleteVBO();
 }
 
@@ -344,7 +344,7 @@ void PropertiesDyntrack::sSectEnabled(int idx){
     dobj->sections[idx].a = this->sSectA[idx].value();
     if(idx%2 == 1)
         dobj->sections[idx].r = this->sSectR[idx].value();
-    dobj->modified = true;
+    dobj->setModified();
     dobj->box.loaded = false;
     dobj->deleteVBO();
 }
@@ -395,6 +395,6 @@ void PropertiesSignal::editPositionEnabled(QString val){
     
     Undo::SinglePushWorldObjData(worldObj);
     signalObj->setPosition((float*)pos);
-    signalObj->modified = true;
+    signalObj->setModified();
     signalObj->setMartix();
 }
\ No newline at end of file
@@ -107,7 +107,7 @@ void PropertiesSoundRegion::sourcesListSelected(QString val){
     Undo::PushTrackDB(Game::trackDB);
     sobj->set("update_type", Game::soundList->regions[val]->id);
     Undo::StateEnd();
-    sobj->modified = true;
+    sobj->setModified();
     this->sName.setText(val);
 }
 
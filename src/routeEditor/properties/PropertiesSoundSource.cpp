@@ -64,7 +64,7 @@ void PropertiesSoundSource::sourcesListSelected(QString val){
         return;
     Undo::SinglePushWorldObjData(worldObj);
     sobj->set("filename", Game::soundList->sources[val]->file1);
-    sobj->modified = true;
+    sobj->setModified();
     this->sName.setText(val);
 }
 
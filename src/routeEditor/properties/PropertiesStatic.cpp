@@ -329,7 +329,7 @@ void PropertiesStatic::editPositionEnabled(QString val){
     
     Undo::SinglePushWorldObjData(worldObj);
     staticObj->setPosition((float*)pos);
-    staticObj->modified = true;
+    staticObj->setModified();
     staticObj->setMartix();
 }
 
@@ -429,6 +429,6 @@ void PropertiesStatic::editFileNameEnabled(){
         worldObj->position[2] = -worldObj->position[2];
         worldObj->qDirection[2] = -worldObj->qDirection[2];
         worldObj->load(worldObj->x, worldObj->y);
-        worldObj->modified = true;
+        worldObj->setModified();
     }
 }
\ No newline at end of file
@@ -707,7 +707,7 @@ void PropertiesTrackObj::editFileNameEnabled(){
         worldObj->position[2] = -worldObj->position[2];
         worldObj->qDirection[2] = -worldObj->qDirection[2];
         worldObj->load(worldObj->x, worldObj->y);
-        worldObj->modified = true;
+        worldObj->setModified();
     }
 }
 
@@ -194,7 +194,7 @@ void PropertiesTransfer::sizeEnabled(QString val){
     Undo::SinglePushWorldObjData(worldObj);
     transferObj->set("width", sizeX.text().toFloat());
     transferObj->set("height", sizeY.text().toFloat());
-    transferObj->modified = true;
+    transferObj->setModified();
     transferObj->deleteVBO();
 }
 
@@ -30,6 +30,8 @@
 #include <tsre/trains/ConLib.h>
 #include <tsre/trains/Consist.h> 
 #include <tsre/shape/ShapeLib.h>
+#include <tsre/texture/TexLib.h>
+#include <tsre/renderer/FrameScheduler.h>
 #include <tsre/trains/EngLib.h>
 #include <tsre/trains/ActLib.h>
 #include <tsre/trains/Activity.h>
@@ -73,10 +75,6 @@ void ShapeViewerGLWidget::timerEvent(QTimerEvent * event) {
     if (fps < 10) fps = 10;
     lastTime = timeNow;
 
-
-    if (Game::allowObjLag < Game::maxObjLag)
-        Game::allowObjLag += 2;
-
     camera->update(fps);
     update();
     
@@ -181,6 +179,8 @@ void ShapeViewerGLWidget::fillCurrentContentHierarchyInfo(QVector<ContentHierarc
 
 void ShapeViewerGLWidget::paintGL() {
     Game::currentShapeLib = currentShapeLib;
+    TexLib::nextFrame();
+    FrameScheduler::nextFrame();
     //Game::currentEngLib = currentEngLib;
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -32,6 +32,16 @@ QString ErrorMessagesLib::PushErrorMessage(ErrorMessage* e){
     return reply;
 }
 
+/*
+ * Messages keep their location, but not the objects released by TileStreamer.
+ */
+void ErrorMessagesLib::ForgetObjects(const QSet<GameObj*> &objects){
+    for(int i = 0; i < ErrorMessages.size(); i++){
+        if(ErrorMessages[i]->obj != NULL && objects.contains(ErrorMessages[i]->obj))
+            ErrorMessages[i]->obj = NULL;
+    }
+}
+
 ErrorMessagesLib::ErrorMessagesLib() {
 }
 
@@ -12,9 +12,11 @@
 #define ERRORMESSAGESLIB_H
 
 #include <QHash>
+#include <QSet>
 #include <QString>
 
 class QWidget;
+class GameObj;
 class ErrorMessage;
 class ErrorMessagesWindow;
 
@@ -24,6 +26,7 @@ public:
     static QVector<ErrorMessage*> ErrorMessages;
     static ErrorMessagesWindow* GetWindow(QWidget *w);
     static QString PushErrorMessage(ErrorMessage* e);
+    static void ForgetObjects(const QSet<GameObj*> &objects);
     
     ErrorMessagesLib();
     virtual ~ErrorMessagesLib();
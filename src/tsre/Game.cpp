@@ -61,9 +61,28 @@ bool Game::playerMode = false;
 bool Game::useNetworkEng = false;
 bool Game::useQuadTree = true;
 bool Game::useTdbEmptyItems = true;
-int Game::allowObjLag = 1000;
-int Game::maxObjLag = 10;
 bool Game::ignoreLoadLimits = false;
+int Game::textureLoaderThreads = 0;
+int Game::textureUploadBudget = 4096;
+int Game::shapeLoaderThreads = 0;
+int Game::frameWorkBudget = 4000;
+bool Game::useTileCache = false;
+bool Game::useProceduralCache = true;
+bool Game::textureCompression = true;
+bool Game::useTextureCache = false;
+bool Game::useSimdKernels = true;
+bool Game::saveBinaryWorld = false;
+bool Game::instancedDrawing = false;
+bool Game::frustumCulling = true;
+bool Game::cpuPicking = true;
+int Game::undoLimit = 50;
+int Game::undoMemoryLimit = 256;
+bool Game::tileStreaming = true;
+int Game::tileLoaderThreads = 2;
+int Game::tileKeepRadius = 0;
+int Game::tileMemoryLimit = 256;
+int Game::textureMemoryLimit = 1024;
+int Game::shapeMemoryLimit = 512;
 int Game::startTileX = 0;
 int Game::startTileY = 0;
 float Game::objectLod = 3000;
@@ -128,6 +147,8 @@ bool Game::autoFix = false;
 bool Game::gui = true;
 
 QString Game::geoPath = "hgst";
+int Game::geoCacheFiles = 8;
+QString Game::osmFile = "";
 
 //RouteEditorWindow* Game::window = NULL;
 //LodWindow* Game::loadWindow = NULL;
@@ -154,6 +175,7 @@ bool Game::autoGeoTerrain = false;
 bool Game::useSuperelevation = false;
 
 bool Game::soundEnabled = false;
+int Game::soundVoices = 32;
 
 int Game::AASamples = 0;
 bool Game::AARemoveBorder = false;
@@ -339,11 +361,98 @@ void Game::load() {
         if(val == "objectLod"){
             objectLod = args[1].trimmed().toInt();
         }
-        if(val == "maxObjLag"){
-            maxObjLag = args[1].trimmed().toInt();
+        if(val == "textureLoaderThreads"){
+            textureLoaderThreads = args[1].trimmed().toInt();
         }
-        if(val == "allowObjLag"){
-            allowObjLag = args[1].trimmed().toInt();
+        if(val == "textureUploadBudget"){
+            textureUploadBudget = args[1].trimmed().toInt();
+        }
+        if(val == "shapeLoaderThreads"){
+            shapeLoaderThreads = args[1].trimmed().toInt();
+        }
+        if(val == "frameWorkBudget"){
+            frameWorkBudget = args[1].trimmed().toInt();
+        }
+        if(val == "useTileCache"){
+            if(args[1].trimmed().toLower() == "true")
+                useTileCache = true;
+            else
+                useTileCache = false; 
+        }
+        if(val == "useProceduralCache"){
+            if(args[1].trimmed().toLower() == "true")
+                useProceduralCache = true;
+            else
+                useProceduralCache = false; 
+        }
+        if(val == "textureCompression"){
+            if(args[1].trimmed().toLower() == "true")
+                textureCompression = true;
+            else
+                textureCompression = false; 
+        }
+        if(val == "useTextureCache"){
+            if(args[1].trimmed().toLower() == "true")
+                useTextureCache = true;
+            else
+                useTextureCache = false; 
+        }
+        if(val == "useSimdKernels"){
+            if(args[1].trimmed().toLower() == "true")
+                useSimdKernels = true;
+            else
+                useSimdKernels = false; 
+        }
+        if(val == "saveBinaryWorld"){
+            if(args[1].trimmed().toLower() == "true")
+                saveBinaryWorld = true;
+            else
+                saveBinaryWorld = false; 
+        }
+        if(val == "instancedDrawing"){
+            if(args[1].trimmed().toLower() == "true")
+                instancedDrawing = true;
+            else
+                instancedDrawing = false; 
+        }
+        if(val == "frustumCulling"){
+            if(args[1].trimmed().toLower() == "true")
+                frustumCulling = true;
+            else
+                frustumCulling = false; 
+        }
+        if(val == "cpuPicking"){
+            if(args[1].trimmed().toLower() == "true")
+                cpuPicking = true;
+            else
+                cpuPicking = false; 
+        }
+        if(val == "undoLimit"){
+            undoLimit = args[1].trimmed().toInt();
+        }
+        if(val == "undoMemoryLimit"){
+            undoMemoryLimit = args[1].trimmed().toInt();
+        }
+        if(val == "tileStreaming"){
+            if(args[1].trimmed().toLower() == "true")
+                tileStreaming = true;
+            else
+                tileStreaming = false; 
+        }
+        if(val == "tileLoaderThreads"){
+            tileLoaderThreads = args[1].trimmed().toInt();
+        }
+        if(val == "tileKeepRadius"){
+            tileKeepRadius = args[1].trimmed().toInt();
+        }
+        if(val == "tileMemoryLimit"){
+            tileMemoryLimit = args[1].trimmed().toInt();
+        }
+        if(val == "textureMemoryLimit"){
+            textureMemoryLimit = args[1].trimmed().toInt();
+        }
+        if(val == "shapeMemoryLimit"){
+            shapeMemoryLimit = args[1].trimmed().toInt();
         }
         if(val == "fpsLimit"){
             fpsLimit = args[1].trimmed().toInt();
@@ -371,6 +480,10 @@ void Game::load() {
         }
         if(val == "geoPath")
             geoPath = args[1].trimmed();
+        if(val == "geoCacheFiles")
+            geoCacheFiles = args[1].trimmed().toInt();
+        if(val == "osmFile")
+            osmFile = args[1].trimmed();
         if(val == "colorConView")
             colorConView = new QColor(args[1].trimmed());
         if(val == "colorShapeView")
@@ -459,6 +572,9 @@ void Game::load() {
             else
                 soundEnabled = false; 
         }
+        if(val == "soundVoices"){
+            soundVoices = args[1].trimmed().toInt();
+        }
         
         if(val == "cameraSpeedMin"){
             cameraSpeedMin = args[1].trimmed().toFloat();
@@ -806,8 +922,9 @@ void Game::CreateNewSettingsFile(){
     out << "usenNumPad = true\n";
     out << "tileLod = 2\n";
     out << "objectLod = 4000\n";
-    out << "maxObjLag = 10\n";
-    out << "allowObjLag = 1000\n";
+    out << "frameWorkBudget = 4000\n";
+    out << "#useTileCache = true\n";
+    out << "#instancedDrawing = true\n";
     out << "#cameraFov = 20.0\n";
     out << "leaveTrackShapeAfterDelete = false\n";
     out << "#renderTrItems = true\n";
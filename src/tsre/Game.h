@@ -67,9 +67,28 @@ public:
     static float objectLod;
     static float distantLod;
     static int tileLod;
-    static int allowObjLag;
-    static int maxObjLag;
     static bool ignoreLoadLimits;
+    static int textureLoaderThreads;
+    static int textureUploadBudget;
+    static int shapeLoaderThreads;
+    static int frameWorkBudget;
+    static bool useTileCache;
+    static bool useProceduralCache;
+    static bool textureCompression;
+    static bool useTextureCache;
+    static bool useSimdKernels;
+    static bool saveBinaryWorld;
+    static bool instancedDrawing;
+    static bool frustumCulling;
+    static bool cpuPicking;
+    static int undoLimit;
+    static int undoMemoryLimit;
+    static bool tileStreaming;
+    static int tileLoaderThreads;
+    static int tileKeepRadius;
+    static int tileMemoryLimit;
+    static int textureMemoryLimit;
+    static int shapeMemoryLimit;
     static void load();
     static void InitAssets();
     //static bool loadRouteEditor();
@@ -118,6 +137,8 @@ public:
     static int newRouteX;
     static int newRouteZ;
     static QString geoPath;
+    static int geoCacheFiles;
+    static QString osmFile;
     static ShapeLib *currentShapeLib;
     static EngLib *currentEngLib;
     static Route *currentRoute;
@@ -151,6 +172,7 @@ public:
     static bool autoGeoTerrain;
     static bool useSuperelevation;
     static bool soundEnabled;
+    static int soundVoices;
     static bool fullscreen;
     
     static float fogDensity;// = 0.7;
@@ -19,11 +19,38 @@
 #include <tsre/Game.h>
 #include <tsre/world/Route.h>
 #include <tsre/world/objects/GroupObj.h>
+#include <tsre/tdb/TRnode.h>
+#include <tsre/tdb/TRitem.h>
 
 bool Undo::UndoEnabled = true;
 UndoState* Undo::currentState = NULL;
 QVector<UndoState*> Undo::undoStates;
 unsigned long long int Undo::undoTime;
+unsigned long long int Undo::undoMemory = 0;
+Undo::TDBShadow Undo::tdbShadow[2];
+
+static unsigned long long NodeMemory(TRnode* n){
+    if(n == NULL)
+        return 0;
+    return sizeof(TRnode) + n->iTrv*sizeof(TRnode::TRSect) + n->iTri*sizeof(int);
+}
+
+static unsigned long long ItemMemory(TRitem* n){
+    if(n == NULL)
+        return 0;
+    return sizeof(TRitem) + n->trSignalDirs*10*sizeof(float) + 64;
+}
+
+UndoState::TDBData::~TDBData(){
+    for(auto it = nodes.begin(); it != nodes.end(); ++it)
+        delete it->second;
+    for(auto it = items.begin(); it != items.end(); ++it)
+        delete it->second;
+}
+
+unsigned long long UndoState::memory(){
+    return terrainMemory + texMemory + objMemory + tdbMemory;
+}
 
 UndoState::~UndoState(){
     QMapIterator<int, UndoState::TerrainData*> i(terrainData);
@@ -61,11 +88,188 @@ UndoState::~UndoState(){
 }
 
 void Undo::Clear(){
+    if(currentState != NULL)
+        delete currentState;
     currentState = NULL;
     for(int i = 0; i < undoStates.size();){
         delete undoStates.last();
         undoStates.removeLast();
     }
+    undoMemory = 0;
+    ClearTDBShadow(tdbShadow[0]);
+    ClearTDBShadow(tdbShadow[1]);
+}
+
+void Undo::ClearTDBShadow(TDBShadow &shadow){
+    for(auto it = shadow.nodes.begin(); it != shadow.nodes.end(); ++it)
+        delete it->second;
+    for(auto it = shadow.items.begin(); it != shadow.items.end(); ++it)
+        delete it->second;
+    shadow.nodes.clear();
+    shadow.items.clear();
+    shadow.tdb = NULL;
+}
+
+/*
+ * Brings the shadow copy up to date with the TDB. Previous versions of
+ * changed nodes and items are moved to 'changes' if given, or freed.
+ */
+void Undo::SyncTDBShadow(TDBShadow &shadow, TDB* tdb, UndoState::TDBData* changes){
+    if(shadow.tdb != tdb){
+        ClearTDBShadow(shadow);
+        shadow.tdb = tdb;
+        changes = NULL;
+    }
+    
+    for(auto it = tdb->trackNodes.begin(); it != tdb->trackNodes.end(); ++it){
+        if(it->second == NULL)
+            continue;
+        TRnode* &old = shadow.nodes[it->first];
+        if(old != NULL && old->sameData(it->second))
+            continue;
+        if(changes != NULL && changes->nodes.find(it->first) == changes->nodes.end())
+            changes->nodes[it->first] = old;
+        else
+            delete old;
+        old = new TRnode(*(it->second));
+    }
+    for(auto it = shadow.nodes.begin(); it != shadow.nodes.end();){
+        auto live = tdb->trackNodes.find(it->first);
+        if(live != tdb->trackNodes.end() && live->second != NULL){
+            ++it;
+            continue;
+        }
+        if(changes != NULL && changes->nodes.find(it->first) == changes->nodes.end())
+            changes->nodes[it->first] = it->second;
+        else
+            delete it->second;
+        it = shadow.nodes.erase(it);
+    }
+    
+    for(auto it = tdb->trackItems.begin(); it != tdb->trackItems.end(); ++it){
+        if(it->second == NULL)
+            continue;
+        TRitem* &old = shadow.items[it->first];
+        if(old != NULL && old->sameData(it->second))
+            continue;
+        if(changes != NULL && changes->items.find(it->first) == changes->items.end())
+            changes->items[it->first] = old;
+        else
+            delete old;
+        old = new TRitem(*(it->second));
+    }
+    for(auto it = shadow.items.begin(); it != shadow.items.end();){
+        auto live = tdb->trackItems.find(it->first);
+        if(live != tdb->trackItems.end() && live->second != NULL){
+            ++it;
+            continue;
+        }
+        if(changes != NULL && changes->items.find(it->first) == changes->items.end())
+            changes->items[it->first] = it->second;
+        else
+            delete it->second;
+        it = shadow.items.erase(it);
+    }
+}
+
+/*
+ * Puts previous versions back into the TDB. They become the new shadow
+ * entries, so the shadow still matches the TDB afterwards.
+ */
+void Undo::RestoreTDB(TDBShadow &shadow, UndoState::TDBData* changes){
+    TDB* tdb = changes->tdb;
+    bool useShadow = (shadow.tdb == tdb);
+    
+    for(auto it = changes->nodes.begin(); it != changes->nodes.end(); ++it){
+        auto live = tdb->trackNodes.find(it->first);
+        if(live != tdb->trackNodes.end())
+            delete live->second;
+        tdb->trackNodes[it->first] = it->second == NULL ? NULL : new TRnode(*(it->second));
+        if(!useShadow)
+            continue;
+        auto old = shadow.nodes.find(it->first);
+        if(old != shadow.nodes.end()){
+            delete old->second;
+            shadow.nodes.erase(old);
+        }
+        if(it->second != NULL)
+            shadow.nodes[it->first] = it->second;
+        it->second = NULL;
+    }
+    for(auto it = changes->items.begin(); it != changes->items.end(); ++it){
+        auto live = tdb->trackItems.find(it->first);
+        if(live != tdb->trackItems.end())
+            delete live->second;
+        tdb->trackItems[it->first] = it->second == NULL ? NULL : new TRitem(*(it->second));
+        if(!useShadow)
+            continue;
+        auto old = shadow.items.find(it->first);
+        if(old != shadow.items.end()){
+            delete old->second;
+            shadow.items.erase(old);
+        }
+        if(it->second != NULL)
+            shadow.items[it->first] = it->second;
+        it->second = NULL;
+    }
+    
+    tdb->iTRnodes = changes->iTRnodes;
+    tdb->iTRitems = changes->iTRitems;
+    tdb->markIndexDirty();
+    for(auto it = changes->nodes.begin(); it != changes->nodes.end(); ++it)
+        if(tdb->trackNodes[it->first] != NULL)
+            tdb->updateTrNode(it->first);
+    for(auto it = changes->items.begin(); it != changes->items.end(); ++it)
+        if(tdb->trackItems[it->first] != NULL)
+            tdb->updateTrItem(it->first);
+    tdb->refresh();
+}
+
+unsigned long long Undo::TDBDataMemory(UndoState::TDBData* changes){
+    if(changes == NULL)
+        return 0;
+    unsigned long long size = sizeof(UndoState::TDBData);
+    for(auto it = changes->nodes.begin(); it != changes->nodes.end(); ++it)
+        size += NodeMemory(it->second) + 16;
+    for(auto it = changes->items.begin(); it != changes->items.end(); ++it)
+        size += ItemMemory(it->second) + 16;
+    return size;
+}
+
+/*
+ * Collects TDB changes made since the state began and sums up its memory.
+ */
+void Undo::FinishState(UndoState* state){
+    UndoState::TDBData** changes[2] = { &state->trackDB, &state->roadDB };
+    for(int i = 0; i < 2; i++){
+        UndoState::TDBData* c = *changes[i];
+        if(c == NULL)
+            continue;
+        if(tdbShadow[i].tdb == c->tdb)
+            SyncTDBShadow(tdbShadow[i], c->tdb, c);
+        if(c->nodes.size() == 0 && c->items.size() == 0){
+            delete c;
+            *changes[i] = NULL;
+            continue;
+        }
+        state->modified = true;
+    }
+    
+    state->terrainMemory = 0;
+    QMapIterator<int, UndoState::TerrainData*> i(state->terrainData);
+    while (i.hasNext()) {
+        i.next();
+        if(i.value() != NULL)
+            state->terrainMemory += sizeof(UndoState::TerrainData) + i.value()->data.size();
+    }
+    state->texMemory = 0;
+    QMapIterator<int, unsigned int> i1(state->texSize);
+    while (i1.hasNext()) {
+        i1.next();
+        state->texMemory += i1.value();
+    }
+    state->objMemory = state->objData.size()*(sizeof(UndoState::WorldObjInfo) + sizeof(WorldObj));
+    state->tdbMemory = TDBDataMemory(state->trackDB) + TDBDataMemory(state->roadDB);
 }
 
 void Undo::UndoLast(){
@@ -87,8 +291,23 @@ void Undo::UndoLast(){
     while (i.hasNext()) {
         i.next();
         UndoState::TerrainData* tdata = i.value();
-        if(tdata != NULL)
-            Game::terrainLib->fillHeightMap(tdata->x, tdata->z, tdata->data);
+        if(tdata == NULL)
+            continue;
+        QByteArray raw = qUncompress(tdata->data);
+        int count = tdata->samples*tdata->samples;
+        if(raw.size() != count*(int)sizeof(unsigned int))
+            continue;
+        const unsigned int* in = (const unsigned int*)raw.constData();
+        float* heights = new float[count];
+        for (int y = 0; y < tdata->samples; y++) {
+            unsigned int prev = 0;
+            for (int x = 0; x < tdata->samples; x++) {
+                prev ^= in[y*tdata->samples+x];
+                memcpy(&heights[y*tdata->samples+x], &prev, sizeof(float));
+            }
+        }
+        Game::terrainLib->fillHeightMap(tdata->x, tdata->z, heights);
+        delete[] heights;
     }
     QMapIterator<int, unsigned char *> i1(state->texData);
     while (i1.hasNext()) {
@@ -126,20 +345,13 @@ void Undo::UndoLast(){
         }
     }
     
-    if(state->trackDB != NULL){
-        if(Game::currentRoute != NULL){
-            Game::currentRoute->setTDB(state->trackDB, false);
-            state->trackDB = NULL;
-        }
-    }
+    if(state->trackDB != NULL && state->trackDB->tdb == Game::trackDB)
+        RestoreTDB(tdbShadow[0], state->trackDB);
     
-    if(state->roadDB != NULL){
-        if(Game::currentRoute != NULL){
-            Game::currentRoute->setTDB(state->roadDB, true);
-            state->roadDB = NULL;
-        }
-    }
+    if(state->roadDB != NULL && state->roadDB->tdb == Game::roadDB)
+        RestoreTDB(tdbShadow[1], state->roadDB);
     
+    undoMemory -= state->memory();
     delete state;
     undoStates.removeLast();
 }
@@ -180,9 +392,17 @@ void Undo::StateEndIfLongTime(){
 
 void Undo::StateEnd(){
     if(currentState != NULL){
+        FinishState(currentState);
         if(currentState->modified == true){
             undoStates.push_back(currentState);
-            if(undoStates.size() > 50){
+            undoMemory += currentState->memory();
+            // Drop the oldest states, but always keep the last one.
+            unsigned long long memoryLimit = (unsigned long long)Game::undoMemoryLimit*1024*1024;
+            while(undoStates.size() > 1){
+                if((Game::undoLimit <= 0 || undoStates.size() <= Game::undoLimit)
+                        && (Game::undoMemoryLimit <= 0 || undoMemory <= memoryLimit))
+                    break;
+                undoMemory -= undoStates.first()->memory();
                 delete undoStates.first();
                 undoStates.removeFirst();
             }
@@ -206,10 +426,21 @@ void Undo::PushTerrainHeightMap(int x, int z, float** data, int samples){
         tdata = currentState->terrainData[x*10000+z];
         tdata->x = x;
         tdata->z = z;
-        for (int i = 0; i < samples; i++)
+        tdata->samples = samples;
+        // Neighbouring heights share most bits, edited areas are usually
+        // flat or smooth, so the XORed rows compress well.
+        QByteArray raw(samples*samples*sizeof(unsigned int), 0);
+        unsigned int* out = (unsigned int*)raw.data();
+        for (int i = 0; i < samples; i++) {
+            unsigned int prev = 0;
             for (int j = 0; j < samples; j++) {
-                    tdata->data[i*samples+j] = data[i][j];
+                unsigned int v;
+                memcpy(&v, &data[i][j], sizeof(float));
+                out[i*samples+j] = v ^ prev;
+                prev = v;
             }
+        }
+        tdata->data = qCompress(raw);
         currentState->modified = true;
     }
     return;
@@ -222,6 +453,7 @@ void Undo::PushTextureData(int id, unsigned char* data, unsigned int size){
     unsigned char * tdata = currentState->texData[id];
     if(tdata == NULL){
         currentState->texData[id] = new unsigned char[size];
+        currentState->texSize[id] = size;
         tdata = currentState->texData[id];
         memcpy(tdata, data, size);
         currentState->modified = true;
@@ -320,12 +552,75 @@ void Undo::PushWorldObjPlaced(WorldObj* obj){
 void Undo::PushTrackDB(TDB* tdb, bool road){
     if(currentState == NULL)
         return;
+    if(tdb == NULL)
+        return;
     
-    if(road && currentState->roadDB == NULL ){
-        currentState->roadDB = new TDB(*tdb);
-        currentState->modified = true;
-    } else if(currentState->trackDB == NULL) {
-        currentState->trackDB = new TDB(*tdb);
-        currentState->modified = true;
+    UndoState::TDBData* &changes = road ? currentState->roadDB : currentState->trackDB;
+    if(changes != NULL)
+        return;
+    
+    // Changes made outside of undo states are not recorded.
+    TDBShadow &shadow = tdbShadow[road ? 1 : 0];
+    SyncTDBShadow(shadow, tdb, NULL);
+    
+    changes = new UndoState::TDBData();
+    changes->tdb = tdb;
+    changes->iTRnodes = tdb->iTRnodes;
+    changes->iTRitems = tdb->iTRitems;
+}
+
+/*
+ * True if some undo state keeps objects of the tile,
+ * TileStreamer doesn't release such tiles.
+ */
+bool Undo::ReferencesTile(int x, int z){
+    QVector<UndoState*> states = undoStates;
+    if(currentState != NULL)
+        states.push_back(currentState);
+    for(int i = 0; i < states.size(); i++){
+        foreach(UndoState::WorldObjInfo* info, states[i]->objData){
+            if(info == NULL)
+                continue;
+            WorldObj* obj = info->data != NULL ? info->data : info->obj;
+            if(obj != NULL && obj->x == x && obj->y == z)
+                return true;
+        }
     }
+    return false;
+}
+
+QString Undo::GetStatistics(){
+    unsigned long long terrain = 0, tex = 0, obj = 0, tdb = 0;
+    int nodes = 0, items = 0;
+    for(int i = 0; i < undoStates.size(); i++){
+        terrain += undoStates[i]->terrainMemory;
+        tex += undoStates[i]->texMemory;
+        obj += undoStates[i]->objMemory;
+        tdb += undoStates[i]->tdbMemory;
+        UndoState::TDBData* changes[2] = { undoStates[i]->trackDB, undoStates[i]->roadDB };
+        for(int j = 0; j < 2; j++){
+            if(changes[j] == NULL)
+                continue;
+            nodes += changes[j]->nodes.size();
+            items += changes[j]->items.size();
+        }
+    }
+    unsigned long long shadow = 0;
+    for(int i = 0; i < 2; i++){
+        for(auto it = tdbShadow[i].nodes.begin(); it != tdbShadow[i].nodes.end(); ++it)
+            shadow += NodeMemory(it->second);
+        for(auto it = tdbShadow[i].items.begin(); it != tdbShadow[i].items.end(); ++it)
+            shadow += ItemMemory(it->second);
+    }
+    
+    const double mb = 1024.0*1024.0;
+    QString out;
+    out += QString("Undo states: %1 / %2\n").arg(undoStates.size()).arg(Game::undoLimit);
+    out += QString("Memory used: %1 MB / %2 MB\n").arg(undoMemory/mb, 0, 'f', 2).arg(Game::undoMemoryLimit);
+    out += QString("  terrain heights: %1 MB\n").arg(terrain/mb, 0, 'f', 2);
+    out += QString("  textures: %1 MB\n").arg(tex/mb, 0, 'f', 2);
+    out += QString("  world objects: %1 MB\n").arg(obj/mb, 0, 'f', 2);
+    out += QString("  track database: %1 MB (%2 nodes, %3 items)\n").arg(tdb/mb, 0, 'f', 2).arg(nodes).arg(items);
+    out += QString("Track database copy: %1 MB\n").arg(shadow/mb, 0, 'f', 2);
+    return out;
 }
\ No newline at end of file
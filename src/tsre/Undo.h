@@ -12,8 +12,12 @@
 #define	UNDO_H
 #include <QMap>
 #include <QVector>
+#include <QByteArray>
+#include <unordered_map>
 
 class TDB;
+class TRnode;
+class TRitem;
 class WorldObj;
 class GameObj;
 
@@ -22,7 +26,9 @@ struct UndoState {
     struct TerrainData {
         int x;
         int z;
-        float data[257*257];
+        int samples;
+        // Each height XORed with the previous one in the row, then compressed.
+        QByteArray data;
     };
     struct WorldObjInfo {
         WorldObj * obj;
@@ -31,13 +37,29 @@ struct UndoState {
         int x;
         int z;
     };
+    // Previous versions of the nodes and items changed in this state,
+    // NULL if the node or item was added.
+    struct TDBData {
+        ~TDBData();
+        TDB* tdb;
+        int iTRnodes;
+        int iTRitems;
+        std::unordered_map<int, TRnode*> nodes;
+        std::unordered_map<int, TRitem*> items;
+    };
     unsigned long long id;
     bool modified = false;
     QMap<int, TerrainData*> terrainData;
     QMap<int, unsigned char*> texData;
+    QMap<int, unsigned int> texSize;
     QMap<long long int, WorldObjInfo*> objData;
-    TDB* trackDB = NULL;
-    TDB* roadDB = NULL;
+    TDBData* trackDB = NULL;
+    TDBData* roadDB = NULL;
+    unsigned long long terrainMemory = 0;
+    unsigned long long texMemory = 0;
+    unsigned long long objMemory = 0;
+    unsigned long long tdbMemory = 0;
+    unsigned long long memory();
 };
 
 class Undo {
@@ -59,13 +81,29 @@ public:
     static void SinglePushWorldObjData(WorldObj* obj);
     static void PushTrackDB(TDB *tdb, bool road = false);
     //static void PushTerrainTexture(int x, int z, int uu, unsigned char* data);
+    static QString GetStatistics();
+    static bool ReferencesTile(int x, int z);
     
 private:
+    // Copy of the TDB as it was at the last sync. Undo states keep
+    // only the nodes and items that differ from it.
+    struct TDBShadow {
+        TDB* tdb = NULL;
+        std::unordered_map<int, TRnode*> nodes;
+        std::unordered_map<int, TRitem*> items;
+    };
     static QVector<UndoState*> undoStates;
     static UndoState* currentState;
     static unsigned long long int undoTime;
+    static unsigned long long int undoMemory;
+    static TDBShadow tdbShadow[2];
     
     static void PushWorldObjDataInfo(WorldObj* obj);
+    static void ClearTDBShadow(TDBShadow &shadow);
+    static void SyncTDBShadow(TDBShadow &shadow, TDB* tdb, UndoState::TDBData* changes);
+    static void RestoreTDB(TDBShadow &shadow, UndoState::TDBData* changes);
+    static unsigned long long TDBDataMemory(UndoState::TDBData* changes);
+    static void FinishState(UndoState* state);
 };
 
 #endif	/* UNDO_H */
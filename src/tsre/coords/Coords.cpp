@@ -40,6 +40,23 @@ Coords::Coords(QString path) {
 Coords::~Coords() {
 }
 
+/*
+ * Terrain heights of the given marker points in one TerrainLib call.
+ */
+static void getMarkerHeights(const Coords::Marker &marker, const std::vector<int> &ids, std::vector<float> &heights){
+    int count = ids.size();
+    std::vector<int> tileX(count), tileZ(count);
+    std::vector<float> posX(count), posZ(count);
+    for(int k = 0; k < count; k++){
+        tileX[k] = marker.tileX[ids[k]];
+        tileZ[k] = -marker.tileZ[ids[k]];
+        posX[k] = marker.x[ids[k]];
+        posZ[k] = marker.z[ids[k]];
+    }
+    heights.resize(count);
+    Game::terrainLib->getHeights(count, tileX.data(), tileZ.data(), posX.data(), posZ.data(), heights.data());
+}
+
 void Coords::render(GLUU* gluu, float * playerT, float* playerW, float playerRot) {
     if (!loaded) return;
 
@@ -81,11 +98,16 @@ void Coords::render(GLUU* gluu, float * playerT, float* playerW, float playerRot
                 //qDebug() << markerList[i].x.size();
                 float *punkty = new float[markerList[i].x.size()*12]; 
                 int ptr = 0;
+                std::vector<int> ids;
+                std::vector<float> heights;
+                for(int j = 0; j < markerList[i].x.size() - 1; j++)
+                    ids.push_back(j);
+                getMarkerHeights(markerList[i], ids, heights);
 
                 for(int j = 0; j < markerList[i].x.size() - 1; j++){
                     if(markerList[i].segmentPtr[j+1] > 0)
                         continue;
-                    float h = Game::terrainLib->getHeight(markerList[i].tileX[j], -markerList[i].tileZ[j], markerList[i].x[j], markerList[i].z[j]);
+                    float h = heights[j];
                     punkty[ptr++] = markerList[i].x[j] + 2048 * ( markerList[i].tileX[j] - markerList[i].tileX[0] );
                     punkty[ptr++] = markerList[i].y[j] + h;
                     punkty[ptr++] = markerList[i].z[j] - 2048 * ( markerList[i].tileZ[j] - markerList[i].tileZ[0] );
@@ -103,13 +125,20 @@ void Coords::render(GLUU* gluu, float * playerT, float* playerW, float playerRot
             gluu->mvPopMatrix();
             /////
         } else {
+            std::vector<int> ids;
+            std::vector<float> heights;
             for(int j = 0; j < markerList[i].tileX.size(); j++ ){
                 if (fabs(markerList[i].tileX[j] - playerT[0]) + fabs(-markerList[i].tileZ[j] - playerT[1]) > 2) {
                     continue;
                 }
+                ids.push_back(j);
+            }
+            getMarkerHeights(markerList[i], ids, heights);
+            for(unsigned int k = 0; k < ids.size(); k++ ){
+                int j = ids[k];
                 gluu->mvPushMatrix();
                 //if(pos == NULL) return;
-                float h = Game::terrainLib->getHeight(markerList[i].tileX[j], -markerList[i].tileZ[j], markerList[i].x[j], markerList[i].z[j]);
+                float h = heights[k];
                 Mat4::translate(gluu->mvMatrix, gluu->mvMatrix, markerList[i].x[j] + 2048 * (markerList[i].tileX[j] - playerT[0]), h, markerList[i].z[j] + 2048 * (-markerList[i].tileZ[j] - playerT[1]));
                 //Mat4::translate(gluu->mvMatrix, gluu->mvMatrix, this->trItemRData[0] + 2048*(this->trItemRData[3] - playerT[0] ), this->trItemRData[1]+2, -this->trItemRData[2] + 2048*(-this->trItemRData[4] - playerT[1]));
                 //Mat4::translate(gluu->mvMatrix, gluu->mvMatrix, this->trItemRData[0] + 0, this->trItemRData[1]+0, -this->trItemRData[2] + 0);
@@ -32,7 +32,41 @@ FileBuffer::FileBuffer(const FileBuffer* orig) {
 }
 
 FileBuffer::~FileBuffer() {
-    delete[] this->data;
+    freeData();
+}
+
+/*
+ * Private (copy on write) mapping of the whole file,
+ * NULL if the file can't be mapped.
+ */
+FileBuffer* FileBuffer::map(QFile* file) {
+    QFile* mFile = new QFile(file->fileName());
+    if (!mFile->open(QIODevice::ReadOnly)){
+        delete mFile;
+        return NULL;
+    }
+    int size = mFile->size();
+    unsigned char* mData = NULL;
+    if(size > 0)
+        mData = mFile->map(0, size, QFileDevice::MapPrivateOption);
+    if(mData == NULL){
+        delete mFile;
+        return NULL;
+    }
+    FileBuffer* buffer = new FileBuffer(mData, size);
+    buffer->mapFile = mFile;
+    return buffer;
+}
+
+void FileBuffer::freeData() {
+    if(mapFile != NULL){
+        mapFile->unmap(data);
+        delete mapFile;
+        mapFile = NULL;
+    } else {
+        delete[] data;
+    }
+    data = NULL;
 }
 
 int FileBuffer::getInt() {
@@ -124,7 +158,7 @@ void FileBuffer::toUtf16(){
         newData[i*2+1] = 0;
     }
     length = length * 2;
-    delete[] data;
+    freeData();
     data = newData;
 }
 
@@ -159,7 +193,7 @@ bool FileBuffer::insertFile(QString incPath, QString alternativePath, QString* l
     unsigned char * newData = new unsigned char[incData->length + remaining ];
     memcpy(newData, incData->data, incData->length);
     memcpy(newData+incData->length, data+off, remaining);
-    delete[] data;
+    freeData();
     data = newData;
     length = incData->length + remaining;
     off = 0;
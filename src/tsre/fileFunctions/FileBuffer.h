@@ -13,12 +13,15 @@
 
 #include <QString>
 
+class QFile;
+
 class FileBuffer {
 public:
     FileBuffer();
     FileBuffer(unsigned char * data, int nLength);
     FileBuffer(const FileBuffer* orig);
     virtual ~FileBuffer();
+    static FileBuffer* map(QFile* file);
     
     int getInt();
     unsigned short int getShort();
@@ -40,7 +43,8 @@ public:
     int tokenOffset = 0;
     unsigned char * data = NULL;
 private:
-    
+    QFile* mapFile = NULL;
+    void freeData();
 };
 
 #endif	/* FILEBUFFER_H */
@@ -13,6 +13,81 @@
 #include <QDebug>
 #include <math.h>
 
+bool ParserX::Token::equals(const char* keyword, int keywordLength) const {
+    if(length != keywordLength)
+        return false;
+    unsigned short c;
+    for(int i = 0; i < length; i++){
+        c = text[i];
+        if(c >= 'A' && c <= 'Z')
+            c += 32;
+        if(c != (unsigned char)keyword[i])
+            return false;
+    }
+    return true;
+}
+
+QString ParserX::Token::toString() const {
+    if(length == 0)
+        return "";
+    return QString::fromUtf16((const char16_t*)text, length).toLower();
+}
+
+ParserX::Keywords::Keywords(std::initializer_list<const char*> list){
+    for(const char* word : list){
+        words.push_back(word);
+        lengths.push_back(strlen(word));
+    }
+    // Search for a table size and seed without collisions.
+    unsigned int size = 4;
+    while(size < (unsigned int)words.size()*2)
+        size *= 2;
+    for(;;){
+        for(seed = 1; seed < 256; seed++){
+            table.fill(-1, size);
+            mask = size - 1;
+            int i = 0;
+            for(; i < words.size(); i++){
+                unsigned int slot = hash(seed, words[i], lengths[i]) & mask;
+                if(table[slot] >= 0)
+                    break;
+                table[slot] = i;
+            }
+            if(i == words.size())
+                return;
+        }
+        size *= 2;
+    }
+}
+
+unsigned int ParserX::Keywords::hash(unsigned int seed, const char* word, int length){
+    unsigned int h = 2166136261u ^ seed ^ length;
+    for(int i = 0; i < length; i++)
+        h = (h ^ (unsigned char)word[i]) * 16777619u;
+    return h ^ (h >> 15);
+}
+
+unsigned int ParserX::Keywords::hash(unsigned int seed, const Token& token){
+    unsigned int h = 2166136261u ^ seed ^ token.length;
+    unsigned short c;
+    for(int i = 0; i < token.length; i++){
+        c = token.text[i];
+        if(c >= 'A' && c <= 'Z')
+            c += 32;
+        h = (h ^ c) * 16777619u;
+    }
+    return h ^ (h >> 15);
+}
+
+int ParserX::Keywords::find(const Token& token) const {
+    if(token.length == 0 || words.size() == 0)
+        return -1;
+    int i = table[hash(seed, token) & mask];
+    if(i < 0 || !token.equals(words[i], lengths[i]))
+        return -1;
+    return i;
+}
+
 QString ParserX::AddComIfReq(QString n){
     if(n.length() == 0)
         return "\""+n+"\"";
@@ -232,6 +307,57 @@ QString ParserX::NextTokenInside(FileBuffer* bufor){
     return "";
 }
 //-----------------------------------
+// Szukanie sekcji, bez kopiowania nazwy
+//-----------------------------------
+ParserX::Token ParserX::NextTokenView(FileBuffer* bufor){
+    unsigned short int b;
+    int czytam = 0;
+    int poziom = 0;
+    int start = 0;
+    Token token;
+
+    while (bufor->length >= bufor->off + 2) {
+        b = bufor->getShort();
+        if (b == 40 && czytam == 0) {
+            poziom++;
+        }
+
+        if (b == 41 && czytam == 0) {
+            poziom--;
+        }
+        if (poziom > 0) continue;
+        if (poziom < 0) {
+            bufor->off -= 2;
+            return token;
+        }
+        if ((b > 63) || (b>47 && b<58 && czytam == 1) ) {
+            if (czytam == 0)
+                start = bufor->off - 2;
+            czytam = 1;
+        } else {
+            if (czytam == 1) {
+                int end = bufor->off - 2;
+                if (b == 40) bufor->off -= 2;
+
+                for (;;) {
+                    if(bufor->length <= bufor->off + 2)
+                        return token;
+                    b = bufor->getShort();
+                    if (b > 63 || b == 40) {
+                        if (b > 63)
+                            bufor->off-=2;
+                        token.text = (const unsigned short*)(bufor->data + start);
+                        token.length = (end - start)/2;
+                        return token;
+                    }
+                }
+            }
+        }
+    }
+    bufor->off -= 2;
+    return token;
+}
+//-----------------------------------
 // Parsowanie stringa
 //-----------------------------------
 QString ParserX::GetString(FileBuffer* bufor){
@@ -375,9 +501,7 @@ QString ParserX::GetAlternativeTokenName(FileBuffer* bufor){
 //-----------------------------------
 float ParserX::GetNumber(FileBuffer* bufor){
     unsigned short int b = 0;
-    int j;
-    float x, t;
-    int liczba = 1, ujemna = 0;
+    float x;
 
     while (b < 45 || (b > 46 && b < 48) || b > 57) {
         b = bufor->getShort();
@@ -391,57 +515,7 @@ float ParserX::GetNumber(FileBuffer* bufor){
             }
         }
     }
-    x = 0;
-    liczba = 1;
-    ujemna = 0;
-    if (b == 45) {
-        ujemna = 1;
-        b = bufor->getShort();
-        //bufor->off++;
-    }
-    if (b != 46) {
-        while (b > 47 && b < 58) {
-            x = x * 10.0 + b - 48;
-            b = bufor->getShort();
-            //bufor->off++;
-        }
-    }
-    if (b == 46 || b == 44) {
-        b = bufor->getShort();
-        //bufor->off++;
-        while (b > 47 && b < 58) {
-            liczba = liczba * 10;
-            t = b;
-            x = x + (t - 48) / liczba;
-            b = bufor->getShort();
-            //bufor->off++;
-        }
-    }
-    if (ujemna == 1) x = -x;
-    if (b == 69 || b == 101) {
-        b = bufor->getShort();
-        //bufor->off++;
-        if (b == 45) {
-            ujemna = 1;
-            b = bufor->getShort();
-            //bufor->off++;
-        } else ujemna = 0;
-        liczba = 0;
-        while (b > 47 && b < 58) {
-            liczba = liczba * 10.0 + b - 48;
-            b = bufor->getShort();
-            //bufor->off++;
-        }
-        if (ujemna == 1) {
-            for (j = 0; j < liczba; j++) {
-                x = x / 10.0;
-            }
-        } else {
-            for (j = 0; j < liczba; j++) {
-                x = x * 10.0;
-            }
-        }
-    }
+    x = ParseNumber(b, bufor);
     x = NumberUnit(x, b, bufor);
     if(b == '+')
         x += GetNumberInside(bufor);
@@ -454,9 +528,7 @@ float ParserX::GetNumber(FileBuffer* bufor){
 //-----------------------------------
 float ParserX::GetNumberInside(FileBuffer* bufor, bool *ok){
     unsigned short int b = 0;
-    int j;
-    float x, t;
-    int liczba = 1, ujemna = 0;
+    float x;
     while (b < 45 || (b > 46 && b < 48) || b > 57) {
         b = bufor->getShort();
         //ufor->off++;
@@ -466,64 +538,83 @@ float ParserX::GetNumberInside(FileBuffer* bufor, bool *ok){
             return 0;
         }
     }
-    x = 0;
-    liczba = 1;
-    ujemna = 0;
+    x = ParseNumber(b, bufor);
+    x = NumberUnit(x, b, bufor);
+    if(b == '+')
+        x += GetNumberInside(bufor);
+    else 
+        bufor->off -= 2;
+    if(ok != NULL) *ok = true;
+    return x;
+}
+
+//-----------------------------------
+// Mantysa w liczbie calkowitej, jedno
+// skalowanie potega 10 na koncu
+//-----------------------------------
+float ParserX::ParseNumber(unsigned short int &b, FileBuffer* bufor){
+    static const double pow10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    unsigned long long mantissa = 0;
+    int exponent = 0;
+    bool negative = false;
+
     if (b == 45) {
-        ujemna = 1;
+        negative = true;
         b = bufor->getShort();
-        //bufor->off++;
     }
     if (b != 46) {
         while (b > 47 && b < 58) {
-            x = x * 10.0 + b - 48;
+            if (mantissa < 100000000000000000ull)
+                mantissa = mantissa * 10 + b - 48;
+            else
+                exponent++;
             b = bufor->getShort();
-            //bufor->off++;
         }
     }
     if (b == 46 || b == 44) {
         b = bufor->getShort();
-        //bufor->off++;
         while (b > 47 && b < 58) {
-            liczba = liczba * 10;
-            t = b;
-            x = x + (t - 48) / liczba;
+            if (mantissa < 100000000000000000ull) {
+                mantissa = mantissa * 10 + b - 48;
+                exponent--;
+            }
             b = bufor->getShort();
-            //bufor->off++;
         }
     }
-    if (ujemna == 1) x = -x;
     if (b == 69 || b == 101) {
         b = bufor->getShort();
-        //bufor->off++;
+        bool negativeExp = false;
         if (b == 45) {
-            ujemna = 1;
+            negativeExp = true;
             b = bufor->getShort();
-            //bufor->off++;
-        } else ujemna = 0;
-        liczba = 0;
+        }
+        int e = 0;
         while (b > 47 && b < 58) {
-            liczba = liczba * 10.0 + b - 48;
+            if (e < 10000)
+                e = e * 10 + b - 48;
             b = bufor->getShort();
-            //bufor->off++;
-        }
-        if (ujemna == 1) {
-            for (j = 0; j < liczba; j++) {
-                x = x / 10.0;
-            }
-        } else {
-            for (j = 0; j < liczba; j++) {
-                x = x * 10.0;
-            }
         }
-    }    
-    x = NumberUnit(x, b, bufor);
-    if(b == '+')
-        x += GetNumberInside(bufor);
-    else 
-        bufor->off -= 2;
-    if(ok != NULL) *ok = true;
-    return x;
+        exponent += negativeExp ? -e : e;
+    }
+    double x = mantissa;
+    if (mantissa != 0) {
+        while (exponent > 22) {
+            x *= 1e22;
+            exponent -= 22;
+        }
+        while (exponent < -22) {
+            x /= 1e22;
+            exponent += 22;
+        }
+        if (exponent > 0)
+            x *= pow10[exponent];
+        else if (exponent < 0)
+            x /= pow10[-exponent];
+    }
+    return negative ? -x : x;
 }
 
 float ParserX::NumberUnit(float x, unsigned short int &b, FileBuffer* bufor){
@@ -13,9 +13,46 @@
 
 #include <tsre/fileFunctions/FileBuffer.h>
 #include <QString>
+#include <QVector>
+#include <QDebug>
+#include <initializer_list>
 
 class ParserX {
 public:
+    /*
+     * Token name as a view into the UTF-16 buffer, nothing is copied.
+     * Compared case-insensitive with lower case keywords: sh == "shape".
+     * Valid until the buffer is changed (insertFile, toUtf16).
+     */
+    struct Token {
+        const unsigned short* text = NULL;
+        int length = 0;
+
+        bool isEmpty() const { return length == 0; }
+        bool equals(const char* keyword, int keywordLength) const;
+        template<int N> bool operator==(const char (&keyword)[N]) const { return equals(keyword, N - 1); }
+        template<int N> bool operator!=(const char (&keyword)[N]) const { return !equals(keyword, N - 1); }
+        QString toString() const;
+    };
+
+    /*
+     * Fixed set of lower case keywords with a collision free hash table,
+     * find() returns the keyword index or -1.
+     */
+    class Keywords {
+    public:
+        Keywords(std::initializer_list<const char*> list);
+        int find(const Token& token) const;
+    private:
+        QVector<const char*> words;
+        QVector<int> lengths;
+        QVector<int> table;
+        unsigned int mask = 0;
+        unsigned int seed = 0;
+        static unsigned int hash(unsigned int seed, const char* word, int length);
+        static unsigned int hash(unsigned int seed, const Token& token);
+    };
+
     ParserX();
     ParserX(const ParserX& orig);
     virtual ~ParserX();
@@ -24,6 +61,7 @@ public:
     static int FindTokenDomIgnore(QString sh, FileBuffer* bufor);
     static QString NextTokenDomIgnore(FileBuffer* bufor);
     static QString NextTokenInside(FileBuffer* bufor);
+    static Token NextTokenView(FileBuffer* bufor);
     static QString GetAlternativeTokenName(FileBuffer* bufor);
     static QString GetString(FileBuffer* bufor);
     static QString GetStringInside(FileBuffer* bufor);
@@ -38,7 +76,12 @@ public:
 
 private:
     static float NumberUnit(float x, unsigned short int &b, FileBuffer* bufor);
+    static float ParseNumber(unsigned short int &b, FileBuffer* bufor);
 };
 
+inline QDebug operator<<(QDebug debug, const ParserX::Token &token){
+    return debug << token.toString();
+}
+
 #endif	/* PARSERX_H */
 
@@ -9,56 +9,91 @@
  */
 
 #include "ReadFile.h"
+#define MINIZ_NO_ZLIB_COMPATIBLE_NAMES
+#include <mzip/miniz/miniz.h>
 //#include "zlib.h"
 
-//unsigned char* ReadFile::out = new unsigned char[10000000];
+int ReadFile::MapMinSize = 65536;
 
 FileBuffer* ReadFile::read(QFile* file) {
     int size = file->size();
-    unsigned char* in = new unsigned char[size];
-    file->read((char*)in, size);
-    //QByteArray fileData = file->readAll();
-    //unsigned char* in = (unsigned char*)fileData.data();
-    //unsigned char* out = NULL;
-    unsigned char* data = NULL;
-    //int maxSize = 25000000;
-    int nLength = 0;
-    unsigned short bom = *((unsigned short int*) & in[0]);
+    FileBuffer* in = NULL;
+    // Big files are mapped instead of copied, compressed ones are
+    // inflated from the mapping straight into the final buffer.
+    if (size >= MapMinSize)
+        in = FileBuffer::map(file);
+    if (in == NULL) {
+        unsigned char* inData = new unsigned char[size];
+        file->read((char*)inData, size);
+        in = new FileBuffer(inData, size);
+    }
+    if (size < 34)
+        return in;
+    unsigned char* d = in->data;
+    FileBuffer* out = NULL;
+    unsigned short bom = *((unsigned short int*) & d[0]);
     //for (int i = 0; i < 100; i++)
-    //   qDebug() << ":" << (char)in[i];
+    //   qDebug() << ":" << (char)d[i];
     
-    if (bom != 65279 && in[7] == 'F') {
-        in[12] = in[11];
-        in[13] = in[10];
-        in[14] = in[9];
-        in[15] = in[8];
-        QByteArray out = qUncompress(QByteArray::fromRawData((const char*)(in+12), size-12));
-        nLength = out.length() + 16;
-        data = new unsigned char[nLength];
-        std::copy(in, in + 16, data);
-        std::copy(out.data(), out.data() + nLength - 16, data + 16);
-        delete[] in;
-    } else if (bom == 65279 && in[16] == 'F') {
-        in[30] = in[19];
-        in[31] = in[18];
-        in[32] = in[17];
-        in[33] = in[13];
-        QByteArray out = qUncompress(QByteArray::fromRawData((const char*)(in+30), size-30));
-        nLength = out.length() + 34;
-        data = new unsigned char[nLength];
-        std::copy(in, in + 34, data);
-        std::copy(out.data(), out.data() + nLength - 34, data + 34);
-        delete[] in;
+    if (bom != 65279 && d[7] == 'F') {
+        out = inflateData(d, size, 16, *((unsigned int*) & d[8]));
+        out->data[12] = d[11];
+        out->data[13] = d[10];
+        out->data[14] = d[9];
+        out->data[15] = d[8];
+    } else if (bom == 65279 && d[16] == 'F') {
+        out = inflateData(d, size, 34, (d[19] << 24) | (d[18] << 16) | (d[17] << 8) | d[13]);
+        out->data[30] = d[19];
+        out->data[31] = d[18];
+        out->data[32] = d[17];
+        out->data[33] = d[13];
     } else {
-        //data = in + 16;// new unsigned char[fileData.length() - 16];
-        nLength = size;
-        data = in;//new unsigned char[nLength];
-        //std::copy(in + 16, in + size, data);
-        //std::copy(in + 16, in + nLength + 16, data);
-        //delete[] in;
+        return in;
     }
-    //delete[] in;
-    return new FileBuffer(data,nLength);
+    delete in;
+    return out;
+}
+
+/*
+ * Inflates the zlib stream that follows the header into one buffer,
+ * the header is copied in front of the data.
+ */
+FileBuffer* ReadFile::inflateData(const unsigned char* in, int size, int headerLength, unsigned int expectedLength) {
+    unsigned int capacity = expectedLength;
+    if (capacity == 0 || capacity > 0x10000000)
+        capacity = (size - headerLength) * 4;
+    capacity += headerLength;
+    unsigned char* data = new unsigned char[capacity];
+    std::copy(in, in + headerLength, data);
+
+    mz_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    stream.next_in = in + headerLength;
+    stream.avail_in = size - headerLength;
+    stream.next_out = data + headerLength;
+    stream.avail_out = capacity - headerLength;
+    int status = mz_inflateInit(&stream);
+    while (status == MZ_OK) {
+        status = mz_inflate(&stream, MZ_NO_FLUSH);
+        if (status == MZ_STREAM_END)
+            break;
+        if (stream.avail_out > 0)
+            continue;
+        // Size in the header was too small.
+        unsigned char* newData = new unsigned char[capacity * 2];
+        std::copy(data, data + capacity, newData);
+        delete[] data;
+        data = newData;
+        stream.next_out = data + capacity;
+        stream.avail_out = capacity;
+        capacity *= 2;
+        status = MZ_OK;
+    }
+    if (status != MZ_STREAM_END)
+        qDebug() << "ReadFile: inflate error" << status;
+    int nLength = headerLength + stream.total_out;
+    mz_inflateEnd(&stream);
+    return new FileBuffer(data, nLength);
 }
 
 FileBuffer* ReadFile::readRAW(QFile* file) {
@@ -16,10 +16,10 @@
 
 class ReadFile {
 public:
+    static int MapMinSize;
     static FileBuffer* read(QFile* file);
     static FileBuffer* readRAW(QFile* file);
-private:
-    
+    static FileBuffer* inflateData(const unsigned char* in, int size, int headerLength, unsigned int expectedLength);
 };
 
 #endif	/* READFILE_H */
@@ -0,0 +1,121 @@
+/*  This file is part of TSRE5.
+ *
+ *  TSRE5 - train sim game engine and MSTS/OR Editors. 
+ *  Copyright (C) 2016 Piotr Gadecki <pgadecki@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later. 
+ *
+ *  See LICENSE.md or https://www.gnu.org/licenses/gpl.html
+ */
+
+#include <tsre/fileFunctions/SaveQueue.h>
+#include <QThreadPool>
+#include <QSaveFile>
+#include <QFile>
+#include <QMutexLocker>
+#include <QDebug>
+
+SaveQueue* SaveQueue::Queue = NULL;
+QThreadPool* SaveQueue::Pool = NULL;
+QThreadPool* SaveQueue::SerializePool = NULL;
+QMutex SaveQueue::Mutex;
+QHash<QString, unsigned int> SaveQueue::Latest;
+unsigned int SaveQueue::Generation = 0;
+int SaveQueue::Total = 0;
+int SaveQueue::Done = 0;
+int SaveQueue::Failed = 0;
+
+SaveQueue* SaveQueue::Instance(){
+    if(Queue == NULL)
+        Queue = new SaveQueue();
+    return Queue;
+}
+
+void SaveQueue::Write(QString path, QByteArray data){
+    Add(path, data, false);
+}
+
+void SaveQueue::Remove(QString path){
+    Add(path, QByteArray(), true);
+}
+
+/*
+ * Returns when all jobs are done. The caller doesn't change anything
+ * meanwhile, so each job may read the state of its own tile without locks.
+ * Jobs hand their data to Write().
+ */
+void SaveQueue::Serialize(const QVector<std::function<void()>> &jobs){
+    if(jobs.size() < 2){
+        for(int i = 0; i < jobs.size(); i++)
+            jobs[i]();
+        return;
+    }
+    if(SerializePool == NULL)
+        SerializePool = new QThreadPool();
+    for(int i = 0; i < jobs.size(); i++)
+        SerializePool->start(jobs[i]);
+    SerializePool->waitForDone();
+}
+
+void SaveQueue::Add(QString path, QByteArray data, bool remove){
+    path.replace("//", "/");
+    Instance();
+    unsigned int generation;
+    {
+        QMutexLocker locker(&Mutex);
+        if(Pool == NULL){
+            Pool = new QThreadPool();
+            Pool->setMaxThreadCount(4);
+        }
+        generation = ++Generation;
+        Latest[path] = generation;
+        Total++;
+    }
+    Pool->start([path, data, remove, generation](){
+        Run(path, data, remove, generation);
+    });
+}
+
+void SaveQueue::Run(QString path, QByteArray data, bool remove, unsigned int generation){
+    bool ok = true;
+    QSaveFile file(path);
+    if(!remove){
+        ok = file.open(QIODevice::WriteOnly) && file.write(data) == data.size();
+    }
+    
+    {
+        // Commit under the lock, so an older write can't replace a newer one.
+        QMutexLocker locker(&Mutex);
+        if(Latest.value(path) != generation){
+            if(!remove)
+                file.cancelWriting();
+        } else {
+            if(remove)
+                QFile::remove(path);
+            else
+                ok = ok && file.commit();
+            Latest.remove(path);
+        }
+        if(!ok){
+            qDebug() << "Error saving file " << path;
+            Failed++;
+        }
+        Done++;
+        if(Done == Total){
+            if(Failed > 0)
+                qDebug() << "SaveQueue: failed" << Failed << "files";
+            Total = Done = Failed = 0;
+        }
+        emit Queue->progress(Done, Total);
+    }
+}
+
+void SaveQueue::WaitForDone(){
+    if(Pool != NULL)
+        Pool->waitForDone();
+}
+
+int SaveQueue::Pending(){
+    QMutexLocker locker(&Mutex);
+    return Total - Done;
+}
@@ -0,0 +1,59 @@
+/*  This file is part of TSRE5.
+ *
+ *  TSRE5 - train sim game engine and MSTS/OR Editors. 
+ *  Copyright (C) 2016 Piotr Gadecki <pgadecki@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later. 
+ *
+ *  See LICENSE.md or https://www.gnu.org/licenses/gpl.html
+ */
+
+#ifndef SAVEQUEUE_H
+#define	SAVEQUEUE_H
+
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QVector>
+#include <functional>
+
+class QThreadPool;
+
+/*
+ * Writes route files on a thread pool.
+ * Workers write the data to a temporary file and rename it over the old
+ * one (QSaveFile), so a crash never leaves a half written file. If the
+ * same path is queued again before the first write is done, only the
+ * newest data is kept. Serialize() runs the jobs that build the data of
+ * many tiles on a second pool, while the main thread waits for them.
+ */
+class SaveQueue : public QObject {
+    Q_OBJECT
+public:
+    static SaveQueue* Instance();
+    static void Write(QString path, QByteArray data);
+    static void Remove(QString path);
+    static void Serialize(const QVector<std::function<void()>> &jobs);
+    static void WaitForDone();
+    static int Pending();
+    
+signals:
+    void progress(int done, int total);
+    
+private:
+    static SaveQueue* Queue;
+    static QThreadPool* Pool;
+    static QThreadPool* SerializePool;
+    static QMutex Mutex;
+    static QHash<QString, unsigned int> Latest;
+    static unsigned int Generation;
+    static int Total;
+    static int Done;
+    static int Failed;
+    static void Add(QString path, QByteArray data, bool remove);
+    static void Run(QString path, QByteArray data, bool remove, unsigned int generation);
+};
+
+#endif	/* SAVEQUEUE_H */
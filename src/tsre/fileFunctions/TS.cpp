@@ -1463,5 +1463,8 @@ std::unordered_map< int, const char* > TS::IdName = {
     { TSRE_Terrain_RawFile, "TSRE_Terrain_RawFile"},
     { TSRE_Terrain_FtFile, "TSRE_Terrain_FtFile"},
     { TSRE_Requested_TD_File, "TSRE_Requested_TD_File"},
-    { TSRE_Requested_TD_Lo_File, "TSRE_Requested_TD_Lo_File"}
+    { TSRE_Requested_TD_Lo_File, "TSRE_Requested_TD_Lo_File"},
+    { TSRE_ShapeTemplate, "TSRE_ShapeTemplate"},
+    { TSRE_ORTSListName, "TSRE_ORTSListName"},
+    { TSRE_ORTSSoundFileName, "TSRE_ORTSSoundFileName"}
 };       
\ No newline at end of file
@@ -1469,7 +1469,10 @@ public:
         TSRE_Terrain_RawFile = 100005,
         TSRE_Terrain_FtFile = 100006,
         TSRE_Requested_TD_File = 100007,
-        TSRE_Requested_TD_Lo_File = 100008
+        TSRE_Requested_TD_Lo_File = 100008,
+        TSRE_ShapeTemplate = 100009,
+        TSRE_ORTSListName = 100010,
+        TSRE_ORTSSoundFileName = 100011
     };
     static std::unordered_map< int, const char* > IdName;
 };
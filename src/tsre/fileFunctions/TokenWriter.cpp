@@ -0,0 +1,108 @@
+/*  This file is part of TSRE5.
+ *
+ *  TSRE5 - train sim game engine and MSTS/OR Editors. 
+ *  Copyright (C) 2016 Piotr Gadecki <pgadecki@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later. 
+ *
+ *  See LICENSE.md or https://www.gnu.org/licenses/gpl.html
+ */
+
+#include "TokenWriter.h"
+#include <tsre/fileFunctions/TS.h>
+#include <QDebug>
+#include <string.h>
+#include <mzip/miniz/miniz.h>
+
+TokenWriter::TokenWriter(int tokenOffset) {
+    this->tokenOffset = tokenOffset;
+}
+
+void TokenWriter::begin(int token){
+    if(stockTokensOnly && token >= TS::TSRE_Requested_Terrain_tFile)
+        fail(QString(TS::IdName[token]) + ", TSRE token");
+    putInt(token + tokenOffset);
+    blocks.push_back(data.size());
+    putInt(0);
+    put(0);
+}
+
+void TokenWriter::end(){
+    if(blocks.size() == 0){
+        fail("end without begin");
+        return;
+    }
+    int start = blocks.back();
+    blocks.pop_back();
+    int length = data.size() - start - 4;
+    memcpy(data.data() + start, &length, 4);
+}
+
+void TokenWriter::putInt(int val){
+    data.append((const char*)&val, 4);
+}
+
+void TokenWriter::putUint(unsigned int val){
+    data.append((const char*)&val, 4);
+}
+
+void TokenWriter::putFloat(float val){
+    data.append((const char*)&val, 4);
+}
+
+void TokenWriter::putShort(unsigned short int val){
+    data.append((const char*)&val, 2);
+}
+
+void TokenWriter::put(unsigned char val){
+    data.append((char)val);
+}
+
+void TokenWriter::putString(const QString &val){
+    putShort(val.length());
+    data.append((const char*)val.utf16(), val.length()*2);
+}
+
+void TokenWriter::putUint(int token, unsigned int val){
+    begin(token);
+    putUint(val);
+    end();
+}
+
+void TokenWriter::putFloat(int token, float val){
+    begin(token);
+    putFloat(val);
+    end();
+}
+
+void TokenWriter::putString(int token, const QString &val){
+    begin(token);
+    putString(val);
+    end();
+}
+
+/*
+ * Whole compressed file, as read by ReadFile::read():
+ * SIMISA@F, inflated length, @@@@, then zlib stream of header and data.
+ */
+QByteArray TokenWriter::compressed(const QByteArray &header) const{
+    QByteArray body = header + data;
+    mz_ulong length = mz_compressBound(body.size());
+    QByteArray out(16 + length, 0);
+    unsigned int size = body.size();
+    memcpy(out.data(), "SIMISA@F", 8);
+    memcpy(out.data() + 8, &size, 4);
+    memcpy(out.data() + 12, "@@@@", 4);
+    if(mz_compress2((unsigned char*)out.data() + 16, &length, (const unsigned char*)body.constData(), body.size(), MZ_DEFAULT_COMPRESSION) != MZ_OK){
+        qDebug() << "TokenWriter: compression failed";
+        return QByteArray();
+    }
+    out.resize(16 + length);
+    return out;
+}
+
+void TokenWriter::fail(const QString &reason){
+    if(ok)
+        qDebug() << "TokenWriter: can't write" << reason;
+    ok = false;
+}
@@ -0,0 +1,53 @@
+/*  This file is part of TSRE5.
+ *
+ *  TSRE5 - train sim game engine and MSTS/OR Editors. 
+ *  Copyright (C) 2016 Piotr Gadecki <pgadecki@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later. 
+ *
+ *  See LICENSE.md or https://www.gnu.org/licenses/gpl.html
+ */
+
+#ifndef TOKENWRITER_H
+#define	TOKENWRITER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+/*
+ * Writes binary token blocks in the layout read by FileBuffer::getToken()
+ * and the set(int sh, FileBuffer* data) functions:
+ * token id, block length, empty name, then block data.
+ * ok is cleared when something can't be written in binary form.
+ * With stockTokensOnly, TSRE's own token ids also clear it, files for
+ * MSTS and Open Rails must not have them.
+ */
+class TokenWriter {
+public:
+    QByteArray data;
+    bool ok = true;
+    bool stockTokensOnly = false;
+
+    TokenWriter(int tokenOffset = 0);
+    void begin(int token);
+    void end();
+    void putInt(int val);
+    void putUint(unsigned int val);
+    void putFloat(float val);
+    void putShort(unsigned short int val);
+    void put(unsigned char val);
+    void putString(const QString &val);
+    void putUint(int token, unsigned int val);
+    void putFloat(int token, float val);
+    void putString(int token, const QString &val);
+    QByteArray compressed(const QByteArray &header) const;
+    void fail(const QString &reason);
+
+private:
+    int tokenOffset;
+    QVector<int> blocks;
+};
+
+#endif	/* TOKENWRITER_H */
+
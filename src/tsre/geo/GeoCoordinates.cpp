@@ -41,6 +41,20 @@ IghCoordinate* GeoWorldCoordinateConverter::ConvertToInternal(double lat, double
     return NULL;
 }
 
+void GeoWorldCoordinateConverter::ConvertToLatLon(int tilex, int tilez, int count, const double* x, const double* z, double* lat, double* lon){
+    IghCoordinate igh;
+    LatitudeLongitudeCoordinate latlon;
+    for(int i = 0; i < count; i++){
+        if(ConvertToInternal(tilex, tilez, x[i], z[i], &igh) == NULL 
+                || ConvertToLatLon(&igh, &latlon) == NULL){
+            lat[i] = lon[i] = NAN;
+            continue;
+        }
+        lat[i] = latlon.Latitude;
+        lon[i] = latlon.Longitude;
+    }
+}
+
 IghCoordinate* GeoMstsCoordinateConverter::ConvertToInternal(PreciseTileCoordinate* coordinates, IghCoordinate* out) {
     return ConvertToInternal(coordinates->TileX, coordinates->TileZ, coordinates->X, coordinates->Z, out);
 }
@@ -328,6 +342,16 @@ LatitudeLongitudeCoordinate* GeoTsreCoordinateConverter::ConvertToLatLon(IghCoor
     return out;
 }
 
+void GeoTsreCoordinateConverter::ConvertToLatLon(int tilex, int tilez, int count, const double* x, const double* z, double* lat, double* lon){
+    // Same math as ConvertToInternal + ConvertToLatLon, the projection is linear.
+    for(int i = 0; i < count; i++){
+        double line = 2048.0 * (tilez + (1.0 - z[i])) - centerZ;
+        double sample = 2048.0 * (tilex + x[i]) - centerX;
+        lat[i] = centerLat + line / stepLat;
+        lon[i] = centerLon + sample / stepLon;
+    }
+}
+
 IghCoordinate* GeoTsreCoordinateConverter::ConvertToInternal(LatitudeLongitudeCoordinate* coordinates, IghCoordinate* out){
     return ConvertToInternal(coordinates->Latitude, coordinates->Longitude, out);
 }
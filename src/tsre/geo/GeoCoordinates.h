@@ -187,6 +187,9 @@ public:
     virtual LatitudeLongitudeCoordinate* ConvertToLatLon(IghCoordinate* coordinates, LatitudeLongitudeCoordinate* out = 0);
     virtual IghCoordinate* ConvertToInternal(LatitudeLongitudeCoordinate* coordinates, IghCoordinate* out = 0);
     virtual IghCoordinate* ConvertToInternal(double lat, double lon, IghCoordinate* out = 0);
+    // MSTS Tile -> Lat/Lon for a whole row of points, without allocating.
+    // Points that can't be converted get NAN.
+    virtual void ConvertToLatLon(int tilex, int tilez, int count, const double* x, const double* z, double* lat, double* lon);
 };
 
 class GeoMstsCoordinateConverter : public GeoWorldCoordinateConverter {
@@ -246,6 +249,7 @@ public:
     LatitudeLongitudeCoordinate* ConvertToLatLon(IghCoordinate* coordinates, LatitudeLongitudeCoordinate* out = 0);
     IghCoordinate* ConvertToInternal(LatitudeLongitudeCoordinate* coordinates, IghCoordinate* out = 0);
     IghCoordinate* ConvertToInternal(double lat, double lon, IghCoordinate* out = 0);
+    void ConvertToLatLon(int tilex, int tilez, int count, const double* x, const double* z, double* lat, double* lon);
 private:
     double centerLat;
     double centerLon;
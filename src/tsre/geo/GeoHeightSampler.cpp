@@ -0,0 +1,201 @@
+/*  This file is part of TSRE5.
+ *
+ *  TSRE5 - train sim game engine and MSTS/OR Editors. 
+ *  Copyright (C) 2016 Piotr Gadecki <pgadecki@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later. 
+ *
+ *  See LICENSE.md or https://www.gnu.org/licenses/gpl.html
+ */
+
+#include <tsre/geo/GeoHeightSampler.h>
+#include <tsre/geo/GeoCoordinates.h>
+#include <tsre/geo/GeoHgtFile.h>
+#include <tsre/Game.h>
+#include <QMutexLocker>
+#include <QDebug>
+#include <math.h>
+
+QThreadPool *GeoHeightSampler::Pool = NULL;
+QMutex GeoHeightSampler::FilesMutex;
+QWaitCondition GeoHeightSampler::FileLoaded;
+std::unordered_map<int, GeoHeightSampler::CachedFile> GeoHeightSampler::Files;
+unsigned int GeoHeightSampler::UseCounter = 0;
+
+bool GeoHeightSampler::run(QVector<Tile> &tiles, std::function<bool(int, int)> progress){
+    struct Band {
+        Tile* tile;
+        int from;
+        int to;
+    };
+    
+    canceled = false;
+    finished = 0;
+    
+    std::vector<Band> bands;
+    Tile* tileData = tiles.data();
+    for(int i = 0; i < tiles.size(); i++){
+        Tile &tile = tileData[i];
+        tile.ok = false;
+        tile.missingFile = "";
+        if(tile.resolution <= 0)
+            continue;
+        tile.heights.assign(tile.resolution*tile.resolution, 0);
+        for(int j = 0; j < tile.resolution; j += BandRows)
+            bands.push_back({&tile, j, std::min(j + BandRows, tile.resolution)});
+    }
+    int total = bands.size();
+    std::vector<char> bandOk(total, 0);
+    std::vector<QString> bandMissing(total);
+    
+    if(Pool == NULL)
+        Pool = new QThreadPool();
+    for(int i = 0; i < total; i++){
+        Pool->start([this, &bands, &bandOk, &bandMissing, i](){
+            if(!canceled)
+                bandOk[i] = sampleRows(*bands[i].tile, bands[i].from, bands[i].to, bandMissing[i]);
+            finished++;
+        });
+    }
+    while(!Pool->waitForDone(50)){
+        if(progress && !progress(finished, total))
+            canceled = true;
+    }
+    if(progress)
+        progress(total, total);
+    
+    for(int i = 0; i < tiles.size(); i++)
+        tileData[i].ok = !canceled && tileData[i].resolution > 0;
+    for(int i = 0; i < total; i++){
+        if(bandOk[i])
+            continue;
+        bands[i].tile->ok = false;
+        if(bands[i].tile->missingFile.length() == 0)
+            bands[i].tile->missingFile = bandMissing[i];
+    }
+    return !canceled;
+}
+
+void GeoHeightSampler::cancel(){
+    canceled = true;
+}
+
+bool GeoHeightSampler::isCanceled(){
+    return canceled;
+}
+
+bool GeoHeightSampler::sampleRows(Tile &tile, int from, int to, QString &missing){
+    struct UsedFile {
+        int lat;
+        int lon;
+        GeoTerrainFile* file;
+    };
+    std::vector<UsedFile> used;
+    
+    int res = tile.resolution;
+    int step = tile.size/res;
+    std::vector<double> x(res), z(res), lat(res), lon(res);
+    // Same as PreciseTileCoordinate::setWxyzU.
+    for(int j = 0; j < res; j++)
+        z[j] = (float)(j*step)/2048.0;
+    
+    bool ok = true;
+    for(int i = from; i < to && ok; i++){
+        if(canceled){
+            ok = false;
+            break;
+        }
+        std::fill(x.begin(), x.end(), (float)(i*step)/2048.0);
+        Game::GeoCoordConverter->ConvertToLatLon(tile.tileX, tile.tileZ, res, x.data(), z.data(), lat.data(), lon.data());
+        
+        float* out = tile.heights.data() + i*res;
+        int a = 0;
+        while(a < res){
+            if(std::isnan(lat[a])){
+                out[a++] = tile.yOffset;
+                continue;
+            }
+            // Run of samples in the same DEM file.
+            int flat = floor(lat[a]);
+            int flon = floor(lon[a]);
+            int b = a + 1;
+            while(b < res && !std::isnan(lat[b]) && (int)floor(lat[b]) == flat && (int)floor(lon[b]) == flon)
+                b++;
+            
+            GeoTerrainFile* file = NULL;
+            for(unsigned int k = 0; k < used.size(); k++)
+                if(used[k].lat == flat && used[k].lon == flon)
+                    file = used[k].file;
+            if(file == NULL){
+                file = AcquireFile(flat, flon);
+                used.push_back({flat, flon, file});
+            }
+            if(!file->isLoaded()){
+                missing = file->pathid;
+                ok = false;
+                break;
+            }
+            
+            file->getHeights(b - a, lat.data() + a, lon.data() + a, out + a);
+            for(int k = a; k < b; k++)
+                out[k] += tile.yOffset;
+            a = b;
+        }
+    }
+    
+    for(unsigned int k = 0; k < used.size(); k++)
+        ReleaseFile(used[k].lat, used[k].lon);
+    return ok;
+}
+
+GeoTerrainFile* GeoHeightSampler::AcquireFile(int lat, int lon){
+    QMutexLocker locker(&FilesMutex);
+    CachedFile &f = Files[lat*1000 + lon];
+    f.users++;
+    f.lastUse = ++UseCounter;
+    if(f.file == NULL){
+        f.file = new GeoHgtFile();
+        //f.file = new GeoTiffFile();
+        f.loading = true;
+        locker.unlock();
+        f.file->load(lat, lon);
+        locker.relock();
+        f.loading = false;
+        FileLoaded.wakeAll();
+        EvictFiles();
+    }
+    while(f.loading)
+        FileLoaded.wait(&FilesMutex);
+    return f.file;
+}
+
+void GeoHeightSampler::ReleaseFile(int lat, int lon){
+    QMutexLocker locker(&FilesMutex);
+    auto it = Files.find(lat*1000 + lon);
+    if(it == Files.end())
+        return;
+    it->second.users--;
+    EvictFiles();
+}
+
+void GeoHeightSampler::EvictFiles(){
+    // Missing files stay cached so they are not opened again, they hold no data.
+    for(;;){
+        int loaded = 0;
+        auto oldest = Files.end();
+        for(auto it = Files.begin(); it != Files.end(); ++it){
+            if(it->second.loading || !it->second.file->isLoaded())
+                continue;
+            loaded++;
+            if(it->second.users > 0)
+                continue;
+            if(oldest == Files.end() || it->second.lastUse < oldest->second.lastUse)
+                oldest = it;
+        }
+        if(loaded <= Game::geoCacheFiles || oldest == Files.end())
+            return;
+        qDebug() << "DEM unload" << oldest->second.file->pathid;
+        delete oldest->second.file;
+        Files.erase(oldest);
+    }
+}
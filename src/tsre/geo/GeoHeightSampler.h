@@ -0,0 +1,74 @@
+/*  This file is part of TSRE5.
+ *
+ *  TSRE5 - train sim game engine and MSTS/OR Editors. 
+ *  Copyright (C) 2016 Piotr Gadecki <pgadecki@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later. 
+ *
+ *  See LICENSE.md or https://www.gnu.org/licenses/gpl.html
+ */
+
+#ifndef GEOHEIGHTSAMPLER_H
+#define	GEOHEIGHTSAMPLER_H
+
+#include <QString>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QThreadPool>
+#include <atomic>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+class GeoTerrainFile;
+
+/*
+ * Resamples DEM files (HGT) into terrain tiles.
+ * Rows of a tile are converted to lat/lon in one call and sampled per DEM
+ * file, bands of rows run on a thread pool, so many tiles fill at once.
+ * Loaded DEM files are shared and kept in a LRU of Game::geoCacheFiles.
+ */
+class GeoHeightSampler {
+public:
+    struct Tile {
+        int tileX = 0;
+        int tileZ = 0;
+        int resolution = 0;
+        int size = 0;
+        float yOffset = 0;
+        // heights[i*resolution + j], i along X, j along Z.
+        std::vector<float> heights;
+        bool ok = false;
+        QString missingFile;
+    };
+    
+    // progress(done, total) is called on the calling thread, return false to cancel.
+    bool run(QVector<Tile> &tiles, std::function<bool(int, int)> progress = nullptr);
+    void cancel();
+    bool isCanceled();
+    
+    static GeoTerrainFile* AcquireFile(int lat, int lon);
+    static void ReleaseFile(int lat, int lon);
+    
+private:
+    static const int BandRows = 16;
+    std::atomic<bool> canceled{false};
+    std::atomic<int> finished{0};
+    
+    bool sampleRows(Tile &tile, int from, int to, QString &missing);
+    
+    struct CachedFile {
+        GeoTerrainFile* file = NULL;
+        int users = 0;
+        unsigned int lastUse = 0;
+        bool loading = false;
+    };
+    static QThreadPool *Pool;
+    static QMutex FilesMutex;
+    static QWaitCondition FileLoaded;
+    static std::unordered_map<int, CachedFile> Files;
+    static unsigned int UseCounter;
+    static void EvictFiles();
+};
+
+#endif	/* GEOHEIGHTSAMPLER_H */
@@ -22,6 +22,11 @@ GeoHgtFile::GeoHgtFile() {
 }
 
 GeoHgtFile::~GeoHgtFile() {
+    if(terrainData == NULL)
+        return;
+    for (int i = 0; i < rowSize; i++)
+        delete[] terrainData[i];
+    delete[] terrainData;
 }
 
 bool GeoHgtFile::load(int lat, int lon){
@@ -121,4 +126,10 @@ float GeoHgtFile::getHeight(float lat, float lon){
             this->terrainData[rowSize-latI][lonI]*(1.0 - tx)*(1.0 - tz) +
                 0;
     //}
+}
+
+void GeoHgtFile::getHeights(int count, const double* lat, const double* lon, float* out){
+    // Non-virtual call, so the sampling loop gets inlined.
+    for(int i = 0; i < count; i++)
+        out[i] = GeoHgtFile::getHeight(lat[i], lon[i]);
 }
\ No newline at end of file
@@ -21,9 +21,10 @@ public:
     void draw(QImage* &image);
     bool isLoaded();
     float getHeight(float lat, float lon);
+    void getHeights(int count, const double* lat, const double* lon, float* out);
 private:
-    short int** terrainData;
-    int rowSize;
+    short int** terrainData = NULL;
+    int rowSize = 0;
     bool loaded = false;
 };
 
@@ -31,4 +31,9 @@ void GeoTerrainFile::draw(QImage* &image){
 
 float GeoTerrainFile::getHeight(float lat, float lon){
     return 0;
+}
+
+void GeoTerrainFile::getHeights(int count, const double* lat, const double* lon, float* out){
+    for(int i = 0; i < count; i++)
+        out[i] = getHeight(lat[i], lon[i]);
 }
\ No newline at end of file
@@ -24,6 +24,7 @@ public:
     virtual void draw(QImage* &image);
     virtual bool isLoaded();
     virtual float getHeight(float lat, float lon);
+    virtual void getHeights(int count, const double* lat, const double* lon, float* out);
     QString pathid;
 private:
 
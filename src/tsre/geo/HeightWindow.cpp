@@ -22,12 +22,9 @@
 #include <QUrlQuery>
 #include <tsre/coords/CoordsMkr.h>
 #include <tsre/geo/GeoCoordinates.h>
-#include <tsre/geo/GeoHgtFile.h>
-#include <tsre/geo/GeoTiffFile.h>
+#include <tsre/geo/GeoTerrainFile.h>
 #include <tsre/gui/UnsavedDialog.h>
 
-std::unordered_map<int, GeoTerrainFile*> HeightWindow::hqtFiles;
-
 HeightWindow::HeightWindow() : QDialog() {
     QPushButton *loadButton = new QPushButton("Load", this);
     QImage myImage(800, 800, QImage::Format_RGB888);
@@ -62,9 +59,6 @@ HeightWindow::HeightWindow() : QDialog() {
     
     QObject::connect(hOffsetEdit, SIGNAL(textEdited(QString)),
                       this, SLOT(hOffsetEnabled(QString)));
-    
-    igh = new IghCoordinate();
-    mLatlon = new LatitudeLongitudeCoordinate();
 }
 
 int HeightWindow::exec() {
@@ -73,37 +67,30 @@ int HeightWindow::exec() {
 } 
 
 void HeightWindow::CheckForMissingGeodataFiles(QMap<int,QPair<int,int>*>& tileList){
-    PreciseTileCoordinate *tCoords = new PreciseTileCoordinate();
-    IghCoordinate *tigh = new IghCoordinate();
-    LatitudeLongitudeCoordinate *tLatlon = new LatitudeLongitudeCoordinate();
+    PreciseTileCoordinate tCoords;
+    IghCoordinate tigh;
+    LatitudeLongitudeCoordinate tLatlon;
     QMapIterator<int, QPair<int, int>*> i(tileList);
     
     QMap<QString, bool> missingFiles;
-    bool fail = false;
     
     while (i.hasNext()) {
         i.next();
         if(i.value() == NULL)
             continue;
 
-        tCoords->TileX = i.value()->first;
-        tCoords->TileZ = i.value()->second;
-        tCoords->setWxyz(0, 0, 0);
-        tigh = Game::GeoCoordConverter->ConvertToInternal(tCoords, tigh);
-        tLatlon = Game::GeoCoordConverter->ConvertToLatLon(tigh, tLatlon);
+        tCoords.TileX = i.value()->first;
+        tCoords.TileZ = i.value()->second;
+        tCoords.setWxyz(0, 0, 0);
+        Game::GeoCoordConverter->ConvertToInternal(&tCoords, &tigh);
+        Game::GeoCoordConverter->ConvertToLatLon(&tigh, &tLatlon);
 
-        //qDebug() << "lat " << itlat->first << " lon " << itlon->first;
-        if(hqtFiles[(int)floor(tLatlon->Latitude)*1000+(int)floor(tLatlon->Longitude)] == NULL){
-            hqtFiles[(int)floor(tLatlon->Latitude)*1000+(int)floor(tLatlon->Longitude)] = new GeoHgtFile();
-            //hqtFiles[tLatlon->Latitude*1000+tLatlon->Longitude] = new GeoTiffFile();
-            fail = hqtFiles[(int)floor(tLatlon->Latitude)*1000+(int)floor(tLatlon->Longitude)]->load((int)floor(tLatlon->Latitude), (int)floor(tLatlon->Longitude));
-        }
-        if(!hqtFiles[(int)floor(tLatlon->Latitude)*1000+(int)floor(tLatlon->Longitude)]->isLoaded())
-            fail = false;
-        //qDebug() << hqtFiles[tLatlon->Latitude*1000+tLatlon->Longitude]->pathid;
-        if(!fail) {
-            missingFiles[hqtFiles[(int)floor(tLatlon->Latitude)*1000+(int)floor(tLatlon->Longitude)]->pathid] = true;
-        }
+        int lat = (int)floor(tLatlon.Latitude);
+        int lon = (int)floor(tLatlon.Longitude);
+        GeoTerrainFile* file = GeoHeightSampler::AcquireFile(lat, lon);
+        if(!file->isLoaded())
+            missingFiles[file->pathid] = true;
+        GeoHeightSampler::ReleaseFile(lat, lon);
     }
     
     if(missingFiles.count() > 0){
@@ -132,65 +119,38 @@ void HeightWindow::hOffsetEnabled(QString val){
 }
 
 void HeightWindow::load(bool gui){
-    if(aCoords == NULL) 
-        aCoords = new PreciseTileCoordinate();
-    aCoords->TileX = this->tileX;
-    aCoords->TileZ = this->tileZ;
     qDebug() << this->tileX << " " << this->tileZ;;
-    minlat = minlon = 9999;
-    maxlat = maxlon = -9999;
     
-    std::unordered_map<int, bool> fileLat;
-    std::unordered_map<int, bool> fileLon;
-    
-    for(int i = 0; i <= terrainSize; i+= 0.5*terrainSize)
-        for(int j = 0; j <=terrainSize; j+= 0.5*terrainSize){
-            aCoords->setWxyzU(i, 0, j);
-            igh = Game::GeoCoordConverter->ConvertToInternal(aCoords, igh);
-            mLatlon = Game::GeoCoordConverter->ConvertToLatLon(igh, mLatlon);
-            fileLat[(int)floor(mLatlon->Latitude)] = true;
-            fileLon[(int)floor(mLatlon->Longitude)] = true;
-        }
-    
-    QImage* image = NULL;
-    bool fail;
-    for (auto itlat = fileLat.begin(); itlat != fileLat.end(); ++itlat ){
-        for (auto itlon = fileLon.begin(); itlon != fileLon.end(); ++itlon ){
-            qDebug() << "lat " << itlat->first << " lon " << itlon->first;
-            if(this->hqtFiles[itlat->first*1000+itlon->first] == NULL){
-                this->hqtFiles[itlat->first*1000+itlon->first] = new GeoHgtFile();
-                //this->hqtFiles[itlat->first*1000+itlon->first] = new GeoTiffFile();
-                fail = this->hqtFiles[itlat->first*1000+itlon->first]->load(itlat->first, itlon->first);
-            }
-            if(!this->hqtFiles[itlat->first*1000+itlon->first]->isLoaded())
-                fail = false;
-            if(!fail) {
-                if(gui){
-                    QMessageBox msgBox;
-                    msgBox.setText("Failed to load "+this->hqtFiles[itlat->first*1000+itlon->first]->pathid);
-                    msgBox.exec();
-                }
-                return;
-            }
+    QVector<GeoHeightSampler::Tile> tiles(1);
+    tiles[0].tileX = this->tileX;
+    tiles[0].tileZ = this->tileZ;
+    tiles[0].resolution = terrainResolution;
+    tiles[0].size = terrainSize;
+    tiles[0].yOffset = yOffset;
+    GeoHeightSampler sampler;
+    sampler.run(tiles);
+    if(!tiles[0].ok){
+        if(gui){
+            QMessageBox msgBox;
+            msgBox.setText("Failed to load "+tiles[0].missingFile);
+            msgBox.exec();
         }
+        return;
     }
     
-    drawTile(image, gui);
+    QImage* image = NULL;
+    drawTile(tiles[0], image, gui);
     
     if(gui){
         imageLabel->setPixmap(QPixmap::fromImage(*image).scaled(800,800,Qt::KeepAspectRatio,Qt::SmoothTransformation));
     }
     delete image;
-
-    //qDebug() << "lat " << minLatlon->Latitude << " " << maxLatlon->Latitude;
-    //qDebug() << "lon " << minLatlon->Longitude << " " << maxLatlon->Longitude;
 }
 
-void HeightWindow::drawTile(QImage* &image, bool gui){
+void HeightWindow::drawTile(GeoHeightSampler::Tile &tile, QImage* &image, bool gui){
     qDebug() << "draw tile";
     if(gui)
         image = new QImage(terrainResolution, terrainResolution, QImage::Format_RGB888);
-    int step = (terrainSize)/terrainResolution;
     
     if(terrainData != NULL){
         for (int i = 0; i < terrainResolution; i++) {
@@ -198,12 +158,6 @@ void HeightWindow::drawTile(QImage* &image, bool gui){
         }
         delete[] terrainData;
     }
-    /*if(terrainData == NULL){
-        terrainData = new float*[terrainResolution];
-        for (int i = 0; i < terrainResolution; i++) {
-            terrainData[i] = new float[terrainResolution];
-        }
-    }*/
     
     terrainData = new float*[terrainResolution];
     minVal = 999;
@@ -211,14 +165,7 @@ void HeightWindow::drawTile(QImage* &image, bool gui){
     for (int i = 0; i < terrainResolution; i++) {
         terrainData[i] = new float[terrainResolution];
         for (int j = 0; j < terrainResolution; j++) {
-            aCoords->setWxyzU(i*step, 0, j*step);
-            igh = Game::GeoCoordConverter->ConvertToInternal(aCoords, igh);
-            mLatlon = Game::GeoCoordConverter->ConvertToLatLon(igh, mLatlon);
-            if(hqtFiles[(int)floor(mLatlon->Latitude)*1000+(int)floor(mLatlon->Longitude)] == NULL){
-                qDebug() << "fail";
-                continue;
-            }
-            terrainData[i][j] = hqtFiles[(int)floor(mLatlon->Latitude)*1000+(int)floor(mLatlon->Longitude)]->getHeight(mLatlon->Latitude, mLatlon->Longitude) + yOffset;
+            terrainData[i][j] = tile.heights[i*terrainResolution + j];
             if(terrainData[i][j] < minVal)
                 minVal = terrainData[i][j];
             if(terrainData[i][j] > maxVal)
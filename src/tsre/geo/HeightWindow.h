@@ -15,13 +15,10 @@
 #include <unordered_map>
 #include <QMap>
 #include <QPair>
+#include <tsre/geo/GeoHeightSampler.h>
 
 class QNetworkReply;
 class QImage;
-class IghCoordinate;
-class LatitudeLongitudeCoordinate;
-class PreciseTileCoordinate;
-class GeoTerrainFile;
 
 class HeightWindow : public QDialog {
     Q_OBJECT
@@ -36,7 +33,6 @@ public:
     float** terrainData = NULL;
     
     static void CheckForMissingGeodataFiles(QMap<int, QPair<int, int>*> &tileList);
-    static std::unordered_map<int, GeoTerrainFile*> hqtFiles;
     int exec();
     
 public slots:
@@ -51,11 +47,7 @@ private:
     float maxVal = -999;
     float yOffset = 0;
     
-    IghCoordinate* igh = NULL;
-    LatitudeLongitudeCoordinate* mLatlon = NULL;
-    PreciseTileCoordinate* aCoords = NULL;
-    
-    void drawTile(QImage* &image, bool gui);
+    void drawTile(GeoHeightSampler::Tile &tile, QImage* &image, bool gui);
 };
 
 #endif	/* HEIGHTWINDOW_H */
@@ -11,7 +11,6 @@
 #include <tsre/geo/MapDataOSM.h>
 #include <QDebug>
 #include <QFile>
-#include <QXmlStreamReader>
 #include <QString>
 #include <QImage>
 #include <QPainter>
@@ -29,6 +28,8 @@
 #include <QTime>
 #include <tsre/geo/MapWindow.h>
 
+OSMStore* MapDataOSM::FileStore = NULL;
+
 MapDataOSM::MapDataOSM() {
 }
 
@@ -54,11 +55,16 @@ void MapDataOSM::setPenSettings(QPen* pen){
 }
 
 bool MapDataOSM::draw(QImage* myImage) {
-    if(nodes.size() == 0) return false;
+    OSMStore* data = &store;
+    if(Game::osmFile.length() > 0)
+        data = FileStore;
+    if(data == NULL || data->nodeId.size() == 0) return false;
     
-    igh = new IghCoordinate();
-    latlon = new LatitudeLongitudeCoordinate();
-    aCoords = new PreciseTileCoordinate();
+    if(igh == NULL){
+        igh = new IghCoordinate();
+        latlon = new LatitudeLongitudeCoordinate();
+        aCoords = new PreciseTileCoordinate();
+    }
     
     gg = new QPainter();
     gg->begin(myImage);
@@ -97,144 +103,150 @@ bool MapDataOSM::draw(QImage* myImage) {
     gg->fillRect(0, 0, (int)width, (int)height, QColor::fromRgb(241, 238, 232));
     int fail = 0, tf = 0;
 
-    Way* w;
     QVector<QPoint> ww;//, wy;
     QPolygon poly;
     QPainterPath path;
     int drawX, drawY;
     
-    for(int layer = 0; layer < 10; layer++)
-    for (int i = 0; i < this->ways[layer].size(); i++) {
-        w = this->ways[layer][i];
+    // Only ways near the tile, sorted by layer.
+    std::vector<int> visible;
+    float mlat = (maxlat - minlat)*0.1;
+    float mlon = (maxlon - minlon)*0.1;
+    data->query(minlat - mlat, minlon - mlon, maxlat + mlat, maxlon + mlon, visible);
+    
+    for (unsigned int v = 0; v < visible.size(); v++) {
+        int w = visible[v];
+        unsigned short wtype = data->wayType[w];
+        unsigned char wval2 = data->wayVal2[w];
         ww.clear();
         poly.clear();
         path = QPainterPath();
 
-        if (w->val2 == 7) roadBorder->setRgb(0, 0, 0);
+        if (wval2 == 7) roadBorder->setRgb(0, 0, 0);
         else roadBorder->setRgb(180, 180, 180);
 
-        for (int i = 0; i < w->ref.size(); i++) {
-            if (nodes[w->ref[i]] == NULL) {
+        for (unsigned int i = data->wayRefStart[w]; i < data->wayRefStart[w+1]; i++) {
+            int n = data->wayNode[i];
+            if (n < 0) {
                 fail++;
                 break;
             }
-            r(drawX, drawY, nodes[w->ref[i]]->lat, nodes[w->ref[i]]->lon);
+            r(drawX, drawY, data->nodeLat[n], data->nodeLon[n]);
             ww.push_back(QPoint(drawX, drawY));
             poly.push_back(QPoint(drawX, drawY));
-            //ww.push_back(QPoint(rX(nodes[w->ref[i]]->lon), rY(nodes[w->ref[i]]->lat)));
         }
         path.addPolygon(poly);
         
         ///gg->drawPolyline(ww);
         //typ rysowania:
-        if (w->type > 129 && w->type < 163) {
+        if (wtype > 129 && wtype < 163) {
             (setColor(190, 173, 173));
             gg->fillPath(path, *brush);
             (setColor(169, 148, 165));
             gg->drawPolyline(ww);
-        } else if (w->type > 459 && w->type < 548) {
+        } else if (wtype > 459 && wtype < 548) {
             (setColor(200, 170, 170));
             gg->fillPath(path, *brush);
             (setColor(169, 148, 165));
             gg->drawPolyline(ww);
-        } else if (w->type == 381) {
+        } else if (wtype == 381) {
             (setColor(141, 196, 108));
             gg->fillPath(path, *brush);
-        } else if (w->type == 287) {
+        } else if (wtype == 287) {
             (setColor(133, 193, 133));
             gg->fillPath(path, *brush);
-        } else if (w->type == 442) {
+        } else if (wtype == 442) {
             (setColor(212, 170, 170));
             gg->fillPath(path, *brush);
-        } else if (w->type == 289 || w->type == 305 || w->type == 300) {
+        } else if (wtype == 289 || wtype == 305 || wtype == 300) {
             (setColor(207, 236, 168));
             gg->fillPath(path, *brush);
-        } else if (w->type == 321 || w->type == 322 || w->type == 317) {
+        } else if (wtype == 321 || wtype == 322 || wtype == 317) {
             (setColor(206, 246, 202));
             gg->fillPath(path, *brush);
-        } else if (w->type == 318) {
+        } else if (wtype == 318) {
             (setColor(137, 210, 174));
             gg->fillPath(path, *brush);
             (setColor(180, 180, 180));
             gg->drawPath(path);
-        } else if (w->type == 324) {
+        } else if (wtype == 324) {
             (setColor(116, 219, 185));
             gg->fillPath(path, *brush);
             (setColor(180, 180, 180));
             gg->drawPath(path);
-        } else if (w->type == 374) {
+        } else if (wtype == 374) {
             (setColor(181, 226, 181));
             gg->fillPath(path, *brush);
-        } else if (w->type == 380) {
+        } else if (wtype == 380) {
             (setColor(95, 180, 160));
             gg->fillPath(path, *brush);
-        } else if (w->type == 379 || w->type == 633 || w->type == 301 || w->type == 279) {
+        } else if (wtype == 379 || wtype == 633 || wtype == 301 || wtype == 279) {
             (setColor(181, 208, 208));
             gg->fillPath(path, *brush);
-        } else if (w->type == 61) {
+        } else if (wtype == 61) {
             (setColor(246, 238, 182));
             gg->fillPath(path, *brush);
-        } else if (w->type == 284) {
+        } else if (wtype == 284) {
             (setColor(234, 216, 184));
             gg->fillPath(path, *brush);
-        } else if (w->type == 298) {
+        } else if (wtype == 298) {
             (setColor(195, 195, 195));
             gg->fillPath(path, *brush);
-        } else if (w->type == 288) {
+        } else if (wtype == 288) {
             (setColor(224, 224, 206));
             gg->fillPath(path, *brush);
-        } else if (w->type == 282) {
+        } else if (wtype == 282) {
             (setColor(238, 200, 200));
             gg->fillPath(path, *brush);
-        } else if (w->type == 281) {
+        } else if (wtype == 281) {
             (setColor(151, 191, 164));
             gg->fillPath(path, *brush);
-        } else if (w->type == 299) {
+        } else if (wtype == 299) {
             (setColor(222, 208, 213));
             gg->fillPath(path, *brush);
-        } else if (w->type == 292) {
+        } else if (wtype == 292) {
             (setColor(222, 208, 213));
             gg->fillPath(path, *brush);
-        } else if (w->type == 303) {
+        } else if (wtype == 303) {
             (setColor(234, 214, 214));
             gg->fillPath(path, *brush);
-        } else if (w->type == 291) {
+        } else if (wtype == 291) {
             (setColor(231, 241, 222));
             gg->fillPath(path, *brush);
-        } else if (w->type == 297 || w->type == 278) {
+        } else if (wtype == 297 || wtype == 278) {
             (setColor(204, 220, 112));
             gg->fillPath(path, *brush);
-        } else if (w->type == 239) {
+        } else if (wtype == 239) {
             (setColor(157, 256, 108));
             gg->fillPath(path, *brush);
-        } else if (w->type == 624) {
+        } else if (wtype == 624) {
             (setColor(164, 242, 161));
             gg->fillPath(path, *brush);
-        } else if (w->type == 367) {
+        } else if (wtype == 367) {
             (setColor(213, 216, 159));
             gg->fillPath(path, *brush);
-        } else if (w->type == 360) {
+        } else if (wtype == 360) {
             (setColor(254, 240, 186));
             gg->fillPath(path, *brush);
-        } else if (w->type == 293 || w->type == 283 || w->type == 290 || w->type == 280) {
+        } else if (wtype == 293 || wtype == 283 || wtype == 290 || wtype == 280) {
             (setColor(176, 176, 142));
             gg->fillPath(path, *brush);
-        } else if (w->type == 319) {
+        } else if (wtype == 319) {
             (setColor(204, 254, 254));
             gg->fillPath(path, *brush);
             (setColor(180, 180, 180));
             gg->drawPath(path);
-        } else if (w->type == 307 || w->type == 311 || w->type == 312) {
+        } else if (wtype == 307 || wtype == 311 || wtype == 312) {
             (setColor(199, 241, 163));
             gg->fillPath(path, *brush);
             (setColor(148, 214, 151));
             gg->drawPath(path);
-        } else if (w->type > 624 && w->type < 637) {
+        } else if (wtype > 624 && wtype < 637) {
             (setColor(181, 208, 208));
             setPenSettings(&slinia10);
             gg->drawPolyline(ww);
             setPenSettings(&basicStroke);
-        } else if (w->type == 246 || w->type == 227) {
+        } else if (wtype == 246 || wtype == 227) {
             setColor(roadBorder);
             setPenSettings(&olinia12);
             gg->drawPolyline(ww);
@@ -242,7 +254,7 @@ bool MapDataOSM::draw(QImage* myImage) {
             setPenSettings(&slinia10);
             gg->drawPolyline(ww);
             setPenSettings(&basicStroke);
-        } else if (w->type == 264) {
+        } else if (wtype == 264) {
             setColor(roadBorder);
             setPenSettings(&olinia8);
             gg->drawPolyline(ww);
@@ -250,7 +262,7 @@ bool MapDataOSM::draw(QImage* myImage) {
             setPenSettings(&slinia6);
             gg->drawPolyline(ww);
             setPenSettings(&basicStroke);
-        } else if (w->type == 251) {
+        } else if (wtype == 251) {
             setColor(roadBorder);
             setPenSettings(&olinia6);
             gg->drawPolyline(ww);
@@ -258,7 +270,7 @@ bool MapDataOSM::draw(QImage* myImage) {
             setPenSettings(&slinia4);
             gg->drawPolyline(ww);
             setPenSettings(&basicStroke);
-        } else if (w->type == 257) {
+        } else if (wtype == 257) {
             setColor(roadBorder);
             setPenSettings(&olinia12);
             gg->drawPolyline(ww);
@@ -266,7 +278,7 @@ bool MapDataOSM::draw(QImage* myImage) {
             setPenSettings(&slinia10);
             gg->drawPolyline(ww);
             setPenSettings(&basicStroke);
-        } else if (w->type == 258) {
+        } else if (wtype == 258) {
             setColor(roadBorder);
             setPenSettings(&olinia10);
             gg->drawPolyline(ww);
@@ -274,7 +286,7 @@ bool MapDataOSM::draw(QImage* myImage) {
             setPenSettings(&slinia8);
             gg->drawPolyline(ww);
             setPenSettings(&basicStroke);
-        } else if (w->type == 240 || w->type == 226) {
+        } else if (wtype == 240 || wtype == 226) {
             setColor(roadBorder);
             setPenSettings(&olinia4);
             gg->drawPolyline(ww);
@@ -282,7 +294,7 @@ bool MapDataOSM::draw(QImage* myImage) {
             setPenSettings(&slinia2);
             gg->drawPolyline(ww);
             setPenSettings(&basicStroke);
-        } else if (w->type == 241 || w->type == 234) {
+        } else if (wtype == 241 || wtype == 234) {
             setColor(roadBorder);
             setPenSettings(&olinia4);
             gg->drawPolyline(ww);
@@ -290,10 +302,10 @@ bool MapDataOSM::draw(QImage* myImage) {
             setPenSettings(&slinia2);
             gg->drawPolyline(ww);
             setPenSettings(&basicStroke);
-        } else if (w->type == 302) {
+        } else if (wtype == 302) {
             (setColor(220, 220, 220));
             gg->fillPath(path, *brush);
-        } else if (w->type == 249) {
+        } else if (wtype == 249) {
             setColor(roadBorder);
             setPenSettings(&olinia12);
             gg->drawPolyline(ww);
@@ -301,7 +313,7 @@ bool MapDataOSM::draw(QImage* myImage) {
             setPenSettings(&slinia10);
             gg->drawPolyline(ww);
             setPenSettings(&basicStroke);
-        } else if (w->type == 250) {
+        } else if (wtype == 250) {
             setColor(roadBorder);
             setPenSettings(&olinia10);
             gg->drawPolyline(ww);
@@ -309,7 +321,7 @@ bool MapDataOSM::draw(QImage* myImage) {
             setPenSettings(&slinia8);
             gg->drawPolyline(ww);
             setPenSettings(&basicStroke);
-        } else if (w->type == 231) {
+        } else if (wtype == 231) {
             setColor(roadBorder);
             setPenSettings(&olinia4);
             gg->drawPolyline(ww);
@@ -317,7 +329,7 @@ bool MapDataOSM::draw(QImage* myImage) {
             setPenSettings(&slinia2);
             gg->drawPolyline(ww);
             setPenSettings(&basicStroke);
-        } else if (w->type == 223) {
+        } else if (wtype == 223) {
             setColor(roadBorder);
             setPenSettings(&olinia4);
             gg->drawPolyline(ww);
@@ -325,7 +337,7 @@ bool MapDataOSM::draw(QImage* myImage) {
             setPenSettings(&slinia2);
             gg->drawPolyline(ww);
             setPenSettings(&basicStroke);
-        } else if (w->type == 254) {
+        } else if (wtype == 254) {
             setColor(roadBorder);
             setPenSettings(&olinia4);
             gg->drawPolyline(ww);
@@ -333,7 +345,7 @@ bool MapDataOSM::draw(QImage* myImage) {
             setPenSettings(&slinia2);
             gg->drawPolyline(ww);
             setPenSettings(&basicStroke);
-        } else if (w->type == 229) {
+        } else if (wtype == 229) {
             setColor(roadBorder);
             setPenSettings(&olinia4);
             gg->drawPolyline(ww);
@@ -341,7 +353,7 @@ bool MapDataOSM::draw(QImage* myImage) {
             setPenSettings(&slinia2);
             gg->drawPolyline(ww);
             setPenSettings(&basicStroke);
-        } else if (w->type == 242) {
+        } else if (wtype == 242) {
             setColor(roadBorder);
             setPenSettings(&olinia12);
             gg->drawPolyline(ww);
@@ -349,7 +361,7 @@ bool MapDataOSM::draw(QImage* myImage) {
             setPenSettings(&slinia10);
             gg->drawPolyline(ww);
             setPenSettings(&basicStroke);
-        } else if (w->type == 243) {
+        } else if (wtype == 243) {
             setColor(roadBorder);
             setPenSettings(&olinia10);
             gg->drawPolyline(ww);
@@ -357,7 +369,7 @@ bool MapDataOSM::draw(QImage* myImage) {
             setPenSettings(&slinia8);
             gg->drawPolyline(ww);
             //setPenSettings(&basicStroke);
-        } else if (w->type == 236 || w->type == 261) {
+        } else if (wtype == 236 || wtype == 261) {
             setColor(roadBorder);
             setPenSettings(&olinia14);
             gg->drawPolyline(ww);
@@ -365,7 +377,7 @@ bool MapDataOSM::draw(QImage* myImage) {
             setPenSettings(&slinia12);
             gg->drawPolyline(ww);
             setPenSettings(&basicStroke);
-        } else if (w->type == 237 || w->type == 238 || w->type == 262) {
+        } else if (wtype == 237 || wtype == 238 || wtype == 262) {
             setColor(roadBorder);
             setPenSettings(&olinia10);
             gg->drawPolyline(ww);
@@ -373,7 +385,7 @@ bool MapDataOSM::draw(QImage* myImage) {
             setPenSettings(&slinia8);
             gg->drawPolyline(ww);
             setPenSettings(&basicStroke);
-        } else if (w->type == 259) {
+        } else if (wtype == 259) {
             setColor(roadBorder);
             setPenSettings(&olinia4);
             gg->drawPolyline(ww);
@@ -381,8 +393,8 @@ bool MapDataOSM::draw(QImage* myImage) {
             setPenSettings(&slinia2);
             gg->drawPolyline(ww);
             setPenSettings(&basicStroke);
-        } else if (w->type == 445) {
-            if (w->val2 == 7) {
+        } else if (wtype == 445) {
+            if (wval2 == 7) {
                 (setColor(0, 0, 0));
                 setPenSettings(&olinia6);
                 gg->drawPolyline(ww);
@@ -399,8 +411,8 @@ bool MapDataOSM::draw(QImage* myImage) {
                 gg->drawPolyline(ww);
                 setPenSettings(&basicStroke);
             }
-        } else if (w->type == 440) {
-            if (w->val2 == 7) {
+        } else if (wtype == 440) {
+            if (wval2 == 7) {
                 (setColor(0, 0, 0));
                 setPenSettings(&olinia8);
                 gg->drawPolyline(ww);
@@ -417,60 +429,60 @@ bool MapDataOSM::draw(QImage* myImage) {
                 gg->drawPolyline(ww);
                 setPenSettings(&basicStroke);
             }
-        } else if (w->type == 14) {
+        } else if (wtype == 14) {
             (setColor(204, 153, 254));
             gg->fillPath(path, *brush);
             (setColor(154, 117, 182));
             gg->drawPolyline(ww);
-        } else if (w->type == 75) {
+        } else if (wtype == 75) {
             (setColor(240, 240, 216));
             gg->fillPath(path, *brush);
             (setColor(210, 180, 160));
             gg->drawPolyline(ww);
-        } else if (w->type == 65) {
+        } else if (wtype == 65) {
             (setColor(220, 130, 110));
             gg->fillPath(path, *brush);
             (setColor(150, 150, 150));
             gg->drawPolyline(ww);
-        } else if (w->type == 12 || w->type == 13) {
+        } else if (wtype == 12 || wtype == 13) {
             (setColor(187, 187, 204));
             setPenSettings(&slinia10);
             gg->drawPolyline(ww);
             setPenSettings(&basicStroke);
-        } else if (w->type == 71) {
+        } else if (wtype == 71) {
             (setColor(190, 173, 173));
             gg->fillPath(path, *brush);
             (setColor(169, 148, 165));
             gg->drawPolyline(ww);
-        } else if (w->type == 268) {
+        } else if (wtype == 268) {
             (setColor(173, 173, 173));
             gg->fillPath(path, *brush);
             (setColor(169, 148, 165));
             gg->drawPolyline(ww);
-        } else if (w->type == 285) {
+        } else if (wtype == 285) {
             (setColor(233, 216, 189));
             gg->fillPath(path, *brush);
-        } else if (w->type == 286) {
+        } else if (wtype == 286) {
             (setColor(220, 190, 146));
             gg->fillPath(path, *brush);
-        } else if (w->type == 294) {
+        } else if (wtype == 294) {
             (setColor(207, 236, 168));
             gg->fillPath(path, *brush);
-        } else if (w->type == 296) {
+        } else if (wtype == 296) {
             (setColor(207, 255, 168));
             gg->fillPath(path, *brush);
-        } else if (w->type == 366) {
+        } else if (wtype == 366) {
             (setColor(198, 228, 180));
             gg->fillPath(path, *brush);
-        } else if (w->type == 407) {
+        } else if (wtype == 407) {
             (setColor(241, 238, 232));
             gg->fillPath(path, *brush);
-        } else if (w->type == 338) {
+        } else if (wtype == 338) {
             (setColor(241, 238, 232));
             setPenSettings(&slinia10);
             gg->drawPolyline(ww);
             setPenSettings(&basicStroke);
-        } else if (w->type == 363) {
+        } else if (wtype == 363) {
             (setColor(150, 150, 150));
             gg->drawPolyline(ww);
         } else {
@@ -504,6 +516,17 @@ int MapDataOSM::rY(float tlat) {
 }
 
 void MapDataOSM::load(){
+    if(Game::osmFile.length() > 0){
+        if(FileStore == NULL){
+            emit statusInfo(QString("Loading OSM file ..."));
+            QCoreApplication::processEvents();
+            FileStore = new OSMStore();
+            FileStore->loadFile(Game::osmFile);
+        }
+        emit statusInfo(QString("Load"));
+        emit loaded();
+        return;
+    }
 
     LatitudeLongitudeCoordinate p00;
     p00.Latitude = (maxlat + minlat)/2.0;
@@ -603,147 +626,7 @@ void MapDataOSM::isData(QNetworkReply* r){
 }
 
 void MapDataOSM::loadData(QByteArray* data){
-    if(data == NULL){
-        QFile file("F:/OSM/tczew.osm");
-        if (!file.open(QFile::ReadOnly | QFile::Text)) {
-            qDebug() << "no file" << file.errorString();
-            exit(0);
-        }
-        qDebug() <<  "file";
-        QByteArray data2 = file.readAll();
-        data = &data2;
-    } 
-    
-    int inode = 0;
-    int iway = 0;
-    bool node = true;
-    bool way = false;
-    bool bounds = false;
-    int iii = 0, uuu = 0;
-    
-    Node* tnode;
-    Way* tway;
-    
-    QXmlStreamReader reader((*data));
-    reader.readNext();
-    QString name;
-    QXmlStreamAttributes attr;
-    while (!reader.isEndDocument()) {
-        if (reader.isStartElement()) {
-            name = reader.name().toString();
-            attr = reader.attributes();
-            
-            if (name.toUpper() == ("NODE")) {
-                node = true;
-                if (inode++ % 100000 == 0) qDebug() << "n " << inode;
-                tnode = new Node(
-                        attr.value("id").toULongLong(),
-                        attr.value("lat").toFloat(),
-                        attr.value("lon").toFloat()
-                        );
-            } else if (name.toUpper() == ("WAY")) {
-                way = true;
-                if (iway++ % 100000 == 0) qDebug() << "w " << iway;
-                tway = new Way(attr.value("id").toULongLong());
-                tway->ref.clear();
-            } else if (name.toUpper() == ("ND") && way) {
-                tway->ref.push_back ((attr.value("ref").toLongLong()));
-            } else if (name.toUpper() == ("TAG")&&(way || node)) {
-                //adres
-                if (attr.value("k").startsWith(QString("ADDR"), Qt::CaseInsensitive)) {
-                }
-                //nazwa
-                else if (attr.value("k").startsWith(QString("NAME"), Qt::CaseInsensitive)) {
-                }
-                //drogi
-                else if (attr.value("k").startsWith(QString("ONEWAY"), Qt::CaseInsensitive)) {}
-                else if (attr.value("k").startsWith(QString("MAXSPEED"), Qt::CaseInsensitive)) {}
-                else if (attr.value("k").startsWith(QString("SURFACE"),Qt::CaseInsensitive))  {}
-                else if (attr.value("k").startsWith(QString("BRIDGE"), Qt::CaseInsensitive)) {
-                    if (way) tway->val2 = 7;
-                }
-                else if (attr.value("k").startsWith(QString("TUNNEL"), Qt::CaseInsensitive)) {
-                    if (way) tway->val2 = 6;
-                }
-                //miejsca
-                else if (attr.value("k").startsWith(QString("AMENITY"), Qt::CaseInsensitive)) {
-                    //System.out.println(attr.getValue("v").toUpperCase());
-                    //if(node) {
-                    //    uuu++;
-                    //    dane.miejsca.add(new Miejsce(tnode.lat, tnode.lon, attr.getValue("v").toUpperCase().replace("_", "")));
-                    //}
-                }
-                //bariery
-                else if (attr.value("k").startsWith(QString("BARRIER"), Qt::CaseInsensitive)) {}
-                //las
-                else if (attr.value("k").startsWith(QString("WOOD"), Qt::CaseInsensitive)) {}
-                //sport
-                else if (attr.value("k").startsWith(QString("SPORT"), Qt::CaseInsensitive)) {}
-                else {
-                    //inne budynki 
-                    if (attr.value("k").startsWith(QString("BUILDING"), Qt::CaseInsensitive)) {
-                        if (way) tway->type = (short) OSMFeatures::LIST["BUILDING_YES"];
-                        iii++;
-                    }
-                    //jakies gowna co nie chce
-                    //if(attr.getValue("k").toUpperCase().startsWith("SOURCE", 0)) return;
-                    //if(attr.getValue("k").toUpperCase().startsWith("CREATED", 0)) return;
-                    //if(attr.getValue("k").toUpperCase().startsWith("EWMAPA", 0)) return;
-                    //if(attr.getValue("k").toUpperCase().startsWith("BUILDING:", 0)) return;
-                    //if(attr.getValue("k").toUpperCase().startsWith("REF", 0)) return;
-                    //if(attr.getValue("k").toUpperCase().startsWith("WIKI", 0)) return;
-                    //if(attr.getValue("k").toUpperCase().startsWith("ACCESS", 0)) return;
-                    //if(attr.getValue("k").toUpperCase().startsWith("NOTE", 0)) return;
-                    //if(attr.getValue("k").toUpperCase().startsWith("TRACKTYPE", 0)) return;
-                    //inne -> enum
-                    QString fname = "";
-                    fname += attr.value("k").toString() + "_" + attr.value("v").toString();
-                    fname = fname.toUpper();
-                    if (OSMFeatures::LIST[fname.toStdString()] != 0) {
-                        if (way) tway->type = (short) OSMFeatures::LIST[fname.toStdString()];
-                        if (node) tnode->type = (short) OSMFeatures::LIST[fname.toStdString()];
-                        iii++; //System.out.println(fname);
-                    } else {
-                        //if(!fname.startsWith("source", Qt::CaseInsensitive)
-                        //    && !fname.startsWith("created", Qt::CaseInsensitive)
-                        //    )
-                        //    qDebug() << "fail: " << fname;
-                    }
-                }
-            } else if (name.toUpper() == ("BOUNDS")) {
-                bounds = true;
-                //minlat = attr.value("minlat").toFloat();
-                //minlon = attr.value("minlon").toFloat();
-                //maxlat = attr.value("maxlat").toFloat();
-                //maxlon = attr.value("maxlon").toFloat();
-                //qDebug() << "minmax";
-                //qDebug() << minlat << " " << maxlat;
-                ///qDebug() << minlon << " " << maxlon;
-            }
-        } else if (reader.isEndElement()) {
-            name = reader.name().toString();
-            if (name.toUpper() == ("NODE")) {
-                nodes[tnode->id] = tnode;
-                node = false;
-            }
-            if (name.toUpper() == ("WAY")) {
-                //qDebug() << Features::LAYER[tway->type];
-                int tlayer = OSMFeatures::LAYER[tway->type];
-                if(tlayer > 9) tlayer = 9;
-                if(tway->val2==7) 
-                    ways[9].push_back(tway);
-                else
-                    ways[9-tlayer].push_back(tway);
-                way = false;
-            }
-            if (name.toUpper() == ("BOUNDS")) {
-                bounds = false;
-            }
-        } else if (reader.isCharacters()) {
-
-        }
-        
-        reader.readNext();
-    }
-    qDebug() << "node/way: " << inode << "/" << iway;
-}
\ No newline at end of file
+    store.loadXml(*data);
+    store.finish();
+    qDebug() << "node/way: " << store.nodeId.size() << "/" << store.wayId.size();
+}
@@ -12,9 +12,8 @@
 #define	MAPDATAOSM_H
 
 #include <tsre/geo/MapData.h>
-#include <unordered_map>
+#include <tsre/geo/OSMStore.h>
 #include <vector>
-#include <QVector>
 
 class IghCoordinate;
 class LatitudeLongitudeCoordinate;
@@ -32,57 +31,6 @@ class MapDataOSM : public MapData {
     Q_OBJECT
 public:
     
-    struct Node {
-        int64_t id;
-        float lat;
-        float lon;
-        unsigned short type;
-        unsigned char val1;
-        unsigned char val2;
-
-        Node(){
-             //id = 0;
-             lon = 0;
-             lat = 0;
-             type = 0;
-             val1 = 0; 
-             val2 = 0;
-        }   
-
-        Node(int64_t id1, float lat1, float lon1){
-             id = id1;
-             lon = lon1;
-             lat = lat1;
-             type = 0;
-             val1 = 0; 
-             val2 = 0;
-        }
-    };
-
-    struct Way {
-        int64_t id;
-        unsigned short type;
-        unsigned char val1;
-        unsigned char val2;
-        QVector<int64_t> ref;
-        QVector<float> lat;
-        QVector<float> lon;
-
-        Way(int64_t id1){
-             id = id1;
-             type = 0;
-             val1 = 0;
-             val2 = 0;
-        }
-
-        Way(){
-             id = 0;
-             type = 0;
-             val1 = 0;
-             val2 = 0;
-        }    
-    };
-    
     MapDataOSM();
     virtual ~MapDataOSM();
     bool draw(QImage* myImage);
@@ -105,8 +53,9 @@ private:
     QPainter* gg;
     QBrush* brush;
     
-    std::unordered_map<int64_t,Node*> nodes;
-    QVector<Way*> ways[10];
+    OSMStore store;
+    // Local Game::osmFile, shared by all map windows.
+    static OSMStore* FileStore;
     float height, width;
     
     int loadCount;
@@ -114,7 +63,7 @@ private:
     int rX(float tlon);
     int rY(float tlat);
     void r(int &x, int &y, float lat, float lon);
-    void loadData(QByteArray* data = NULL);
+    void loadData(QByteArray* data);
     void setColor(int r, int g, int b);
     void setColor(QColor* color);
     void setPenSettings(QPen* pen);
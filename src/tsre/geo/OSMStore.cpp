@@ -0,0 +1,585 @@
+/*  This file is part of TSRE5.
+ *
+ *  TSRE5 - train sim game engine and MSTS/OR Editors. 
+ *  Copyright (C) 2016 Piotr Gadecki <pgadecki@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later. 
+ *
+ *  See LICENSE.md or https://www.gnu.org/licenses/gpl.html
+ */
+
+#include <tsre/geo/OSMStore.h>
+#include <tsre/geo/OSMFeatures.h>
+#include <tsre/fileFunctions/ReadFile.h>
+#include <tsre/fileFunctions/FileBuffer.h>
+#include <QXmlStreamReader>
+#include <QFile>
+#include <QtEndian>
+#include <QDebug>
+#include <algorithm>
+#include <math.h>
+
+namespace {
+    // Size limits of the .osm.pbf file format.
+    const int MaxPbfHeaderSize = 64*1024;
+    const int MaxPbfBlobSize = 32*1024*1024;
+
+    // Minimal protobuf reader for the .osm.pbf messages.
+    struct PbfReader {
+        const unsigned char* p;
+        const unsigned char* end;
+        // False after a varint, length or wire type that doesn't fit the data.
+        bool ok = true;
+
+        PbfReader(const unsigned char* data, int length){
+            p = data;
+            end = data + length;
+        }
+        void fail(){
+            ok = false;
+            p = end;
+        }
+        bool next(int &field, int &wire){
+            if(p >= end)
+                return false;
+            uint64_t key = varint();
+            field = key >> 3;
+            wire = key & 7;
+            return true;
+        }
+        uint64_t varint(){
+            uint64_t val = 0;
+            int shift = 0;
+            while(p < end && shift < 64){
+                unsigned char b = *p++;
+                val |= (uint64_t)(b & 0x7f) << shift;
+                if((b & 0x80) == 0)
+                    return val;
+                shift += 7;
+            }
+            fail();
+            return 0;
+        }
+        int64_t svarint(){
+            uint64_t val = varint();
+            return (int64_t)(val >> 1) ^ -(int64_t)(val & 1);
+        }
+        PbfReader bytes(){
+            int64_t length = varint();
+            if(length < 0 || length > end - p){
+                fail();
+                return PbfReader(p, 0);
+            }
+            PbfReader out(p, length);
+            p += length;
+            return out;
+        }
+        void advance(int length){
+            if(length > end - p)
+                fail();
+            else
+                p += length;
+        }
+        QByteArray string(){
+            PbfReader s = bytes();
+            return QByteArray((const char*)s.p, s.end - s.p);
+        }
+        void skip(int wire){
+            if(wire == 0)
+                varint();
+            else if(wire == 1)
+                advance(8);
+            else if(wire == 2)
+                bytes();
+            else if(wire == 5)
+                advance(4);
+            else
+                fail();
+        }
+    };
+}
+
+OSMStore::OSMStore() {
+    wayRefStart.push_back(0);
+}
+
+bool OSMStore::loadFile(QString path){
+    QFile file(path);
+    if (!file.open(QFile::ReadOnly)) {
+        qDebug() << "OSM file not found" << path;
+        return false;
+    }
+    qDebug() << "OSM file" << path;
+    bool ok;
+    if(path.endsWith(".pbf", Qt::CaseInsensitive))
+        ok = loadPbf(&file);
+    else
+        ok = loadXml(&file);
+    finish();
+    qDebug() << "node/way: " << nodeId.size() << "/" << wayId.size();
+    return ok;
+}
+
+bool OSMStore::loadXml(QIODevice* device){
+    QXmlStreamReader reader(device);
+    return loadXml(reader);
+}
+
+bool OSMStore::loadXml(const QByteArray &data){
+    QXmlStreamReader reader(data);
+    return loadXml(reader);
+}
+
+bool OSMStore::loadXml(QXmlStreamReader &reader){
+    finished = false;
+    bool node = false;
+    bool way = false;
+    
+    while (!reader.atEnd()) {
+        reader.readNext();
+        if (reader.isStartElement()) {
+            QStringView name = reader.name();
+            QXmlStreamAttributes attr = reader.attributes();
+            if (name == QLatin1String("node")) {
+                node = true;
+                addNode(attr.value("id").toLongLong(),
+                        attr.value("lat").toFloat(),
+                        attr.value("lon").toFloat());
+            } else if (name == QLatin1String("way")) {
+                way = true;
+                addWay(attr.value("id").toLongLong());
+            } else if (name == QLatin1String("nd") && way) {
+                wayRef.push_back(attr.value("ref").toLongLong());
+            } else if (name == QLatin1String("tag") && (way || node)) {
+                setTag(way, tag(attr.value("k").toUtf8(), attr.value("v").toUtf8()));
+            }
+        } else if (reader.isEndElement()) {
+            QStringView name = reader.name();
+            if (name == QLatin1String("node")) {
+                node = false;
+            } else if (name == QLatin1String("way")) {
+                endWay();
+                way = false;
+            }
+        }
+    }
+    if (reader.hasError()) {
+        qDebug() << "OSM xml error" << reader.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool OSMStore::loadPbf(QIODevice* device){
+    finished = false;
+    for(;;){
+        QByteArray sizeData = device->read(4);
+        if(sizeData.length() < 4)
+            break;
+        int headerSize = qFromBigEndian<qint32>(sizeData.constData());
+        if(headerSize < 0 || headerSize > MaxPbfHeaderSize){
+            qDebug() << "OSM pbf: bad blob header size" << headerSize;
+            return false;
+        }
+        QByteArray header = device->read(headerSize);
+        if(header.length() < headerSize)
+            return false;
+        
+        QByteArray type;
+        int64_t dataSize = 0;
+        PbfReader h((const unsigned char*)header.constData(), header.length());
+        int field, wire;
+        while(h.next(field, wire)){
+            if(field == 1 && wire == 2)
+                type = h.string();
+            else if(field == 3 && wire == 0)
+                dataSize = h.varint();
+            else
+                h.skip(wire);
+        }
+        if(!h.ok || dataSize < 0 || dataSize > MaxPbfBlobSize){
+            qDebug() << "OSM pbf: bad blob header";
+            return false;
+        }
+        QByteArray blob = device->read(dataSize);
+        if(blob.length() < dataSize)
+            return false;
+        if(type != "OSMData")
+            continue;
+        
+        PbfReader b((const unsigned char*)blob.constData(), blob.length());
+        PbfReader raw(NULL, 0);
+        PbfReader zlib(NULL, 0);
+        int64_t rawSize = 0;
+        while(b.next(field, wire)){
+            if(field == 1 && wire == 2)
+                raw = b.bytes();
+            else if(field == 2 && wire == 0)
+                rawSize = b.varint();
+            else if(field == 3 && wire == 2)
+                zlib = b.bytes();
+            else
+                b.skip(wire);
+        }
+        bool ok = b.ok;
+        if(ok && raw.p != NULL){
+            ok = readPbfBlock(raw.p, raw.end - raw.p);
+        } else if(ok && zlib.p != NULL){
+            ok = rawSize > 0 && rawSize <= MaxPbfBlobSize;
+            if(ok){
+                FileBuffer* data = ReadFile::inflateData(zlib.p, zlib.end - zlib.p, 0, rawSize);
+                ok = data->length == rawSize && readPbfBlock(data->data, data->length);
+                delete data;
+            }
+        } else if(ok) {
+            qDebug() << "OSM pbf: unsupported blob compression";
+        }
+        if(!ok){
+            qDebug() << "OSM pbf: corrupt blob";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool OSMStore::readPbfBlock(const unsigned char* data, int length){
+    std::vector<QByteArray> strings;
+    std::vector<PbfReader> groups;
+    int64_t granularity = 100;
+    int64_t latOffset = 0;
+    int64_t lonOffset = 0;
+    
+    PbfReader block(data, length);
+    int field, wire;
+    while(block.next(field, wire)){
+        if(field == 1 && wire == 2){
+            PbfReader st = block.bytes();
+            while(st.next(field, wire)){
+                if(field == 1 && wire == 2)
+                    strings.push_back(st.string());
+                else
+                    st.skip(wire);
+            }
+            if(!st.ok)
+                return false;
+        } else if(field == 2 && wire == 2){
+            groups.push_back(block.bytes());
+        } else if(field == 17 && wire == 0){
+            granularity = block.varint();
+        } else if(field == 19 && wire == 0){
+            latOffset = block.varint();
+        } else if(field == 20 && wire == 0){
+            lonOffset = block.varint();
+        } else {
+            block.skip(wire);
+        }
+    }
+    if(!block.ok)
+        return false;
+    int stringCount = strings.size();
+    auto coord = [granularity](int64_t offset, int64_t val){
+        return (float)(0.000000001 * (offset + granularity * val));
+    };
+    auto packed = [](PbfReader &r, int wire, std::vector<int64_t> &out, bool sint, bool delta){
+        int64_t last = 0;
+        if(wire != 2){
+            out.push_back(sint ? r.svarint() : r.varint());
+            return;
+        }
+        PbfReader p = r.bytes();
+        while(p.p < p.end){
+            int64_t val = sint ? p.svarint() : (int64_t)p.varint();
+            if(delta)
+                val = last = last + val;
+            out.push_back(val);
+        }
+        if(!p.ok)
+            r.fail();
+    };
+    std::vector<int64_t> ids, lats, lons, keys, vals;
+    
+    for(unsigned int g = 0; g < groups.size(); g++){
+        PbfReader group = groups[g];
+        while(group.next(field, wire)){
+            if(wire != 2){
+                group.skip(wire);
+                continue;
+            }
+            PbfReader msg = group.bytes();
+            ids.clear(); lats.clear(); lons.clear(); keys.clear(); vals.clear();
+            int64_t id = 0, lat = 0, lon = 0;
+            int f, w;
+            if(field == 1){
+                // Node
+                while(msg.next(f, w)){
+                    if(f == 1) id = msg.svarint();
+                    else if(f == 2) packed(msg, w, keys, false, false);
+                    else if(f == 3) packed(msg, w, vals, false, false);
+                    else if(f == 8) lat = msg.svarint();
+                    else if(f == 9) lon = msg.svarint();
+                    else msg.skip(w);
+                }
+                if(!msg.ok)
+                    return false;
+                addNode(id, coord(latOffset, lat), coord(lonOffset, lon));
+                for(unsigned int i = 0; i < keys.size() && i < vals.size(); i++)
+                    if(keys[i] < stringCount && vals[i] < stringCount)
+                        setTag(false, tag(strings[keys[i]], strings[vals[i]]));
+            } else if(field == 2){
+                // DenseNodes, keys_vals is a 0 separated list of key/value pairs.
+                while(msg.next(f, w)){
+                    if(f == 1) packed(msg, w, ids, true, true);
+                    else if(f == 8) packed(msg, w, lats, true, true);
+                    else if(f == 9) packed(msg, w, lons, true, true);
+                    else if(f == 10) packed(msg, w, keys, false, false);
+                    else msg.skip(w);
+                }
+                if(!msg.ok)
+                    return false;
+                unsigned int kv = 0;
+                for(unsigned int i = 0; i < ids.size() && i < lats.size() && i < lons.size(); i++){
+                    addNode(ids[i], coord(latOffset, lats[i]), coord(lonOffset, lons[i]));
+                    while(kv < keys.size() && keys[kv] != 0){
+                        if(kv + 1 < keys.size() && keys[kv] < stringCount && keys[kv+1] < stringCount)
+                            setTag(false, tag(strings[keys[kv]], strings[keys[kv+1]]));
+                        kv += 2;
+                    }
+                    kv++;
+                }
+            } else if(field == 3){
+                // Way
+                while(msg.next(f, w)){
+                    if(f == 1) id = msg.varint();
+                    else if(f == 2) packed(msg, w, keys, false, false);
+                    else if(f == 3) packed(msg, w, vals, false, false);
+                    else if(f == 8) packed(msg, w, ids, true, true);
+                    else msg.skip(w);
+                }
+                if(!msg.ok)
+                    return false;
+                addWay(id);
+                for(unsigned int i = 0; i < keys.size() && i < vals.size(); i++)
+                    if(keys[i] < stringCount && vals[i] < stringCount)
+                        setTag(true, tag(strings[keys[i]], strings[vals[i]]));
+                wayRef.insert(wayRef.end(), ids.begin(), ids.end());
+                endWay();
+            }
+            if(!msg.ok)
+                return false;
+        }
+        if(!group.ok)
+            return false;
+    }
+    return true;
+}
+
+OSMStore::TagInfo OSMStore::tag(const QByteArray &key, const QByteArray &value){
+    // Same rules the old per-element parser used, decided once per key.
+    auto kit = keys.constFind(key);
+    if(kit == keys.constEnd()){
+        int keyClass = KeyFeature;
+        QString k = QString::fromUtf8(key);
+        if (k.startsWith(QString("ADDR"), Qt::CaseInsensitive)) keyClass = KeyIgnored;
+        else if (k.startsWith(QString("NAME"), Qt::CaseInsensitive)) keyClass = KeyIgnored;
+        else if (k.startsWith(QString("ONEWAY"), Qt::CaseInsensitive)) keyClass = KeyIgnored;
+        else if (k.startsWith(QString("MAXSPEED"), Qt::CaseInsensitive)) keyClass = KeyIgnored;
+        else if (k.startsWith(QString("SURFACE"), Qt::CaseInsensitive)) keyClass = KeyIgnored;
+        else if (k.startsWith(QString("BRIDGE"), Qt::CaseInsensitive)) keyClass = KeyBridge;
+        else if (k.startsWith(QString("TUNNEL"), Qt::CaseInsensitive)) keyClass = KeyTunnel;
+        else if (k.startsWith(QString("AMENITY"), Qt::CaseInsensitive)) keyClass = KeyIgnored;
+        else if (k.startsWith(QString("BARRIER"), Qt::CaseInsensitive)) keyClass = KeyIgnored;
+        else if (k.startsWith(QString("WOOD"), Qt::CaseInsensitive)) keyClass = KeyIgnored;
+        else if (k.startsWith(QString("SPORT"), Qt::CaseInsensitive)) keyClass = KeyIgnored;
+        else if (k.startsWith(QString("BUILDING"), Qt::CaseInsensitive)) keyClass = KeyBuilding;
+        kit = keys.insert(key, keyClass);
+    }
+    
+    TagInfo info;
+    if(kit.value() == KeyIgnored)
+        return info;
+    if(kit.value() == KeyBridge){
+        info.val2 = 7;
+        return info;
+    }
+    if(kit.value() == KeyTunnel){
+        info.val2 = 6;
+        return info;
+    }
+    info.building = kit.value() == KeyBuilding;
+    
+    QByteArray id = key + '_' + value;
+    auto it = tags.constFind(id);
+    if(it != tags.constEnd()){
+        info.type = it.value();
+        return info;
+    }
+    QString fname = QString::fromUtf8(id).toUpper();
+    auto feature = OSMFeatures::LIST.find(fname.toStdString());
+    if (feature != OSMFeatures::LIST.end())
+        info.type = feature->second;
+    // Values like ref or height are mostly unique, don't keep them all.
+    if(tags.size() < MaxCachedTags || info.type != 0)
+        tags.insert(id, info.type);
+    return info;
+}
+
+void OSMStore::addNode(int64_t id, float lat, float lon){
+    nodeId.push_back(id);
+    nodeLat.push_back(lat);
+    nodeLon.push_back(lon);
+    nodeType.push_back(0);
+}
+
+void OSMStore::addWay(int64_t id){
+    wayId.push_back(id);
+    wayType.push_back(0);
+    wayVal2.push_back(0);
+    wayLayer.push_back(0);
+}
+
+void OSMStore::setTag(bool way, const TagInfo &info){
+    if(way){
+        if(info.val2 != 0)
+            wayVal2.back() = info.val2;
+        if(info.building)
+            wayType.back() = OSMFeatures::LIST["BUILDING_YES"];
+        if(info.type != 0)
+            wayType.back() = info.type;
+    } else if(nodeType.size() > 0){
+        if(info.type != 0)
+            nodeType.back() = info.type;
+    }
+}
+
+void OSMStore::endWay(){
+    int tlayer = OSMFeatures::LAYER[wayType.back()];
+    if(tlayer > 9) tlayer = 9;
+    if(wayVal2.back() == 7)
+        wayLayer.back() = 9;
+    else
+        wayLayer.back() = 9 - tlayer;
+    wayRefStart.push_back(wayRef.size());
+}
+
+int64_t OSMStore::cellKey(int x, int y){
+    return ((int64_t)y << 32) | (uint32_t)x;
+}
+
+void OSMStore::finish(){
+    if(finished)
+        return;
+    finished = true;
+    
+    // Sort nodes by id, a node loaded again replaces the old one.
+    std::vector<int> order(nodeId.size());
+    for(unsigned int i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [this](int a, int b){
+        return nodeId[a] < nodeId[b];
+    });
+    std::vector<int64_t> sId;
+    std::vector<float> sLat, sLon;
+    std::vector<unsigned short> sType;
+    sId.reserve(order.size());
+    sLat.reserve(order.size());
+    sLon.reserve(order.size());
+    sType.reserve(order.size());
+    for(unsigned int i = 0; i < order.size(); i++){
+        int n = order[i];
+        if(sId.size() > 0 && sId.back() == nodeId[n]){
+            sLat.back() = nodeLat[n];
+            sLon.back() = nodeLon[n];
+            sType.back() = nodeType[n];
+            continue;
+        }
+        sId.push_back(nodeId[n]);
+        sLat.push_back(nodeLat[n]);
+        sLon.push_back(nodeLon[n]);
+        sType.push_back(nodeType[n]);
+    }
+    nodeId.swap(sId);
+    nodeLat.swap(sLat);
+    nodeLon.swap(sLon);
+    nodeType.swap(sType);
+    
+    // Resolve refs and bounding boxes.
+    wayNode.resize(wayRef.size());
+    for(unsigned int i = 0; i < wayRef.size(); i++){
+        auto it = std::lower_bound(nodeId.begin(), nodeId.end(), wayRef[i]);
+        if(it == nodeId.end() || *it != wayRef[i])
+            wayNode[i] = -1;
+        else
+            wayNode[i] = it - nodeId.begin();
+    }
+    int wayCount = wayId.size();
+    wayBox.assign(wayCount*4, 0);
+    for(int i = 0; i < wayCount; i++){
+        float* box = &wayBox[i*4];
+        box[0] = box[1] = 999;
+        box[2] = box[3] = -999;
+        for(unsigned int j = wayRefStart[i]; j < wayRefStart[i+1]; j++){
+            int n = wayNode[j];
+            if(n < 0)
+                continue;
+            box[0] = std::min(box[0], nodeLat[n]);
+            box[1] = std::min(box[1], nodeLon[n]);
+            box[2] = std::max(box[2], nodeLat[n]);
+            box[3] = std::max(box[3], nodeLon[n]);
+        }
+    }
+    
+    // Grid index. Ways seen twice in API replies are indexed once.
+    cells.clear();
+    largeWays.clear();
+    std::unordered_map<int64_t, bool> indexed;
+    for(int i = 0; i < wayCount; i++){
+        float* box = &wayBox[i*4];
+        if(box[0] > box[2])
+            continue;
+        if(indexed[wayId[i]])
+            continue;
+        indexed[wayId[i]] = true;
+        int x0 = floor(box[1]/CellSize);
+        int y0 = floor(box[0]/CellSize);
+        int x1 = floor(box[3]/CellSize);
+        int y1 = floor(box[2]/CellSize);
+        if((int64_t)(x1 - x0 + 1)*(y1 - y0 + 1) > MaxWayCells){
+            largeWays.push_back(i);
+            continue;
+        }
+        for(int y = y0; y <= y1; y++)
+            for(int x = x0; x <= x1; x++)
+                cells[cellKey(x, y)].push_back(i);
+    }
+}
+
+void OSMStore::query(float minlat, float minlon, float maxlat, float maxlon, std::vector<int> &out){
+    finish();
+    out.clear();
+    int x0 = floor(minlon/CellSize);
+    int y0 = floor(minlat/CellSize);
+    int x1 = floor(maxlon/CellSize);
+    int y1 = floor(maxlat/CellSize);
+    for(int y = y0; y <= y1; y++)
+        for(int x = x0; x <= x1; x++){
+            auto it = cells.find(cellKey(x, y));
+            if(it != cells.end())
+                out.insert(out.end(), it->second.begin(), it->second.end());
+        }
+    out.insert(out.end(), largeWays.begin(), largeWays.end());
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+    
+    unsigned int count = 0;
+    for(unsigned int i = 0; i < out.size(); i++){
+        float* box = &wayBox[out[i]*4];
+        if(box[0] > maxlat || box[2] < minlat || box[1] > maxlon || box[3] < minlon)
+            continue;
+        out[count++] = out[i];
+    }
+    out.resize(count);
+    // Draw order: by layer, then in load order.
+    std::stable_sort(out.begin(), out.end(), [this](int a, int b){
+        return wayLayer[a] < wayLayer[b];
+    });
+}
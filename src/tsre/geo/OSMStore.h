@@ -0,0 +1,96 @@
+/*  This file is part of TSRE5.
+ *
+ *  TSRE5 - train sim game engine and MSTS/OR Editors. 
+ *  Copyright (C) 2016 Piotr Gadecki <pgadecki@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later. 
+ *
+ *  See LICENSE.md or https://www.gnu.org/licenses/gpl.html
+ */
+
+#ifndef OSMSTORE_H
+#define	OSMSTORE_H
+
+#include <QString>
+#include <QByteArray>
+#include <QHash>
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+
+class QIODevice;
+class QXmlStreamReader;
+
+/*
+ * OSM nodes and ways kept in flat arrays.
+ * Nodes are sorted by id after finish(), way refs are resolved to node
+ * indices and ways are put in a grid of CellSize degrees, so query()
+ * only returns ways that touch the bbox. Tags are classified once per
+ * key/value pair through OSMFeatures::LIST.
+ * Data can come from OSM API replies, .osm files and .osm.pbf files,
+ * files are read in a stream, never as a whole.
+ */
+class OSMStore {
+public:
+    std::vector<int64_t> nodeId;
+    std::vector<float> nodeLat;
+    std::vector<float> nodeLon;
+    std::vector<unsigned short> nodeType;
+    
+    std::vector<int64_t> wayId;
+    std::vector<unsigned short> wayType;
+    std::vector<unsigned char> wayVal2;
+    std::vector<unsigned char> wayLayer;
+    // Refs of way i are wayRef[wayRefStart[i] .. wayRefStart[i+1]).
+    std::vector<unsigned int> wayRefStart;
+    std::vector<int64_t> wayRef;
+    // Node index for each ref, -1 if the node is missing. Valid after finish().
+    std::vector<int> wayNode;
+    
+    OSMStore();
+    bool loadFile(QString path);
+    bool loadXml(QIODevice* device);
+    bool loadXml(const QByteArray &data);
+    bool loadPbf(QIODevice* device);
+    void finish();
+    void query(float minlat, float minlon, float maxlat, float maxlon, std::vector<int> &out);
+    int wayRefCount(int way) const {
+        return wayRefStart[way+1] - wayRefStart[way];
+    }
+    
+private:
+    static constexpr float CellSize = 0.01;
+    static const int MaxWayCells = 256;
+    
+    static const int MaxCachedTags = 100000;
+    enum KeyClass {
+        KeyFeature = 0,
+        KeyIgnored = 1,
+        KeyBridge = 2,
+        KeyTunnel = 3,
+        KeyBuilding = 4
+    };
+    struct TagInfo {
+        unsigned short type = 0;
+        unsigned char val2 = 0;
+        bool building = false;
+    };
+    QHash<QByteArray, int> keys;
+    QHash<QByteArray, unsigned short> tags;
+    bool finished = true;
+    
+    std::vector<float> wayBox;
+    std::unordered_map<int64_t, std::vector<int>> cells;
+    std::vector<int> largeWays;
+    
+    TagInfo tag(const QByteArray &key, const QByteArray &value);
+    void addNode(int64_t id, float lat, float lon);
+    void addWay(int64_t id);
+    void setTag(bool way, const TagInfo &info);
+    void endWay();
+    bool loadXml(QXmlStreamReader &reader);
+    bool readPbfBlock(const unsigned char* data, int length);
+    static int64_t cellKey(int x, int y);
+};
+
+#endif	/* OSMSTORE_H */
@@ -0,0 +1,201 @@
+/*  This file is part of TSRE5.
+ *
+ *  TSRE5 - train sim game engine and MSTS/OR Editors. 
+ *  Copyright (C) 2016 Piotr Gadecki <pgadecki@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later. 
+ *
+ *  See LICENSE.md or https://www.gnu.org/licenses/gpl.html
+ */
+
+#include <tsre/math3d/BVH.h>
+#include <algorithm>
+
+void BVH::setBox(float* out, const float* box){
+    for(int i = 0; i < 6; i++)
+        out[i] = box[i];
+}
+
+void BVH::addBox(float* out, const float* box){
+    for(int i = 0; i < 3; i++){
+        if(box[i] < out[i]) out[i] = box[i];
+        if(box[i+3] > out[i+3]) out[i+3] = box[i+3];
+    }
+}
+
+void BVH::build(const float* boxes, int count){
+    nodes.clear();
+    ids.resize(count);
+    itemBoxes.assign(boxes, boxes + count*6);
+    centers.resize(count*3);
+    if(count == 0)
+        return;
+    for(int i = 0; i < count; i++){
+        ids[i] = i;
+        for(int j = 0; j < 3; j++)
+            centers[i*3+j] = (boxes[i*6+j] + boxes[i*6+j+3])*0.5;
+    }
+    nodes.reserve(count*2);
+    nodes.push_back(Node());
+    buildNode(0, 0, count);
+}
+
+/*
+ * Median split on the longest axis of the box centers.
+ */
+void BVH::buildNode(int n, int first, int count){
+    const float* boxes = itemBoxes.data();
+    setBox(nodes[n].box, &boxes[ids[first]*6]);
+    float cmin[3], cmax[3];
+    for(int j = 0; j < 3; j++)
+        cmin[j] = cmax[j] = centers[ids[first]*3+j];
+    for(int i = first + 1; i < first + count; i++){
+        addBox(nodes[n].box, &boxes[ids[i]*6]);
+        for(int j = 0; j < 3; j++){
+            cmin[j] = std::min(cmin[j], centers[ids[i]*3+j]);
+            cmax[j] = std::max(cmax[j], centers[ids[i]*3+j]);
+        }
+    }
+    
+    int axis = 0;
+    for(int j = 1; j < 3; j++)
+        if(cmax[j] - cmin[j] > cmax[axis] - cmin[axis])
+            axis = j;
+    if(count <= LeafSize || cmax[axis] - cmin[axis] <= 0){
+        nodes[n].first = first;
+        nodes[n].count = count;
+        return;
+    }
+    
+    int mid = first + count/2;
+    const float* c = centers.data();
+    std::nth_element(ids.begin() + first, ids.begin() + mid, ids.begin() + first + count,
+            [c, axis](int a, int b){ return c[a*3+axis] < c[b*3+axis]; });
+    
+    int left = nodes.size();
+    nodes.push_back(Node());
+    nodes.push_back(Node());
+    nodes[n].first = left;
+    nodes[n].count = 0;
+    buildNode(left, first, mid - first);
+    buildNode(left + 1, mid, first + count - mid);
+}
+
+/*
+ * Children are always stored after their parent, so one backward pass
+ * updates the whole tree.
+ */
+void BVH::refit(const float* boxes){
+    itemBoxes.assign(boxes, boxes + ids.size()*6);
+    for(int n = nodes.size() - 1; n >= 0; n--){
+        Node &node = nodes[n];
+        if(node.count > 0){
+            setBox(node.box, &boxes[ids[node.first]*6]);
+            for(int i = node.first + 1; i < node.first + node.count; i++)
+                addBox(node.box, &boxes[ids[i]*6]);
+        } else {
+            setBox(node.box, nodes[node.first].box);
+            addBox(node.box, nodes[node.first + 1].box);
+        }
+    }
+}
+
+int BVH::size() const {
+    return ids.size();
+}
+
+bool BVH::rayBox(const float* origin, const float* invDir, const float* box, float maxT, float &t){
+    float t0 = 0;
+    float t1 = maxT;
+    for(int i = 0; i < 3; i++){
+        float tn = (box[i] - origin[i])*invDir[i];
+        float tf = (box[i+3] - origin[i])*invDir[i];
+        if(tn > tf)
+            std::swap(tn, tf);
+        if(tn > t0) t0 = tn;
+        if(tf < t1) t1 = tf;
+        if(t0 > t1)
+            return false;
+    }
+    t = t0;
+    return true;
+}
+
+bool BVH::boxBox(const float* a, const float* b){
+    for(int i = 0; i < 3; i++)
+        if(a[i] > b[i+3] || b[i] > a[i+3])
+            return false;
+    return true;
+}
+
+/*
+ * Boxes of count triangles, vertex position is the first 3 floats
+ * of every stride floats.
+ */
+void BVH::triangleBoxes(const float* vertices, int count, int stride, float* boxes){
+    for(int i = 0; i < count; i++){
+        const float* v = &vertices[i*3*stride];
+        float* box = &boxes[i*6];
+        for(int j = 0; j < 3; j++){
+            box[j] = std::min(v[j], std::min(v[j+stride], v[j+2*stride]));
+            box[j+3] = std::max(v[j], std::max(v[j+stride], v[j+2*stride]));
+        }
+    }
+}
+
+/*
+ * Returns ids of the boxes overlapping box, touching boxes included.
+ */
+void BVH::intersectBox(const float* box, std::vector<int>& out) const {
+    out.clear();
+    if(nodes.size() == 0)
+        return;
+    int stack[64];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+    while(stackSize > 0){
+        const Node &node = nodes[stack[--stackSize]];
+        if(!boxBox(box, node.box))
+            continue;
+        if(node.count > 0){
+            for(int i = node.first; i < node.first + node.count; i++)
+                if(boxBox(box, &itemBoxes[ids[i]*6]))
+                    out.push_back(ids[i]);
+            continue;
+        }
+        stack[stackSize++] = node.first;
+        stack[stackSize++] = node.first + 1;
+    }
+}
+
+/*
+ * Returns boxes hit by the ray, sorted by entry distance.
+ * t is in units of dir, 0 if the origin is inside the box.
+ */
+void BVH::intersectRay(const float* origin, const float* dir, float maxT, std::vector<Hit>& out) const {
+    out.clear();
+    if(nodes.size() == 0)
+        return;
+    float invDir[3];
+    for(int i = 0; i < 3; i++)
+        invDir[i] = 1.0/dir[i];
+    
+    int stack[64];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+    float t;
+    while(stackSize > 0){
+        const Node &node = nodes[stack[--stackSize]];
+        if(!rayBox(origin, invDir, node.box, maxT, t))
+            continue;
+        if(node.count > 0){
+            for(int i = node.first; i < node.first + node.count; i++)
+                if(rayBox(origin, invDir, &itemBoxes[ids[i]*6], maxT, t))
+                    out.push_back({ids[i], t});
+            continue;
+        }
+        stack[stackSize++] = node.first;
+        stack[stackSize++] = node.first + 1;
+    }
+    std::sort(out.begin(), out.end(), [](const Hit& a, const Hit& b){ return a.t < b.t; });
+}
@@ -0,0 +1,56 @@
+/*  This file is part of TSRE5.
+ *
+ *  TSRE5 - train sim game engine and MSTS/OR Editors. 
+ *  Copyright (C) 2016 Piotr Gadecki <pgadecki@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later. 
+ *
+ *  See LICENSE.md or https://www.gnu.org/licenses/gpl.html
+ */
+
+#ifndef BVH_H
+#define	BVH_H
+
+#include <vector>
+
+/*
+ * Bounding volume hierarchy over axis aligned boxes.
+ * A box is 6 floats: min x, y, z, max x, y, z. Ids are box indexes.
+ * refit() updates the boxes without changing the tree, 
+ * build() again when boxes are added or removed.
+ */
+class BVH {
+public:
+    struct Hit {
+        int id;
+        float t;
+    };
+    static const int LeafSize = 4;
+    
+    void build(const float* boxes, int count);
+    void refit(const float* boxes);
+    int size() const;
+    void intersectRay(const float* origin, const float* dir, float maxT, std::vector<Hit>& out) const;
+    void intersectBox(const float* box, std::vector<int>& out) const;
+    static bool rayBox(const float* origin, const float* invDir, const float* box, float maxT, float &t);
+    static bool boxBox(const float* a, const float* b);
+    static void triangleBoxes(const float* vertices, int count, int stride, float* boxes);
+    
+private:
+    struct Node {
+        float box[6];
+        // Leaf: first id and id count, inner: left child and 0, right child is left + 1.
+        int first;
+        int count;
+    };
+    std::vector<Node> nodes;
+    std::vector<int> ids;
+    std::vector<float> itemBoxes;
+    std::vector<float> centers;
+    void buildNode(int n, int first, int count);
+    static void setBox(float* out, const float* box);
+    static void addBox(float* out, const float* box);
+};
+
+#endif	/* BVH_H */
+
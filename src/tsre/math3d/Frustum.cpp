@@ -0,0 +1,71 @@
+/*  This file is part of TSRE5.
+ *
+ *  TSRE5 - train sim game engine and MSTS/OR Editors. 
+ *  Copyright (C) 2016 Piotr Gadecki <pgadecki@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later. 
+ *
+ *  See LICENSE.md or https://www.gnu.org/licenses/gpl.html
+ */
+
+#include <tsre/math3d/Frustum.h>
+#include <math.h>
+
+void Frustum::set(float* m) {
+    // Rows of the column-major matrix: left, right, bottom, top, near, far.
+    for(int i = 0; i < 3; i++){
+        for(int j = 0; j < 4; j++){
+            planes[i*8 + j] = m[j*4 + 3] + m[j*4 + i];
+            planes[i*8 + 4 + j] = m[j*4 + 3] - m[j*4 + i];
+        }
+    }
+    for(int i = 0; i < 6; i++){
+        float* p = &planes[i*4];
+        float len = sqrt(p[0]*p[0] + p[1]*p[1] + p[2]*p[2]);
+        if(len == 0)
+            continue;
+        p[0] /= len;
+        p[1] /= len;
+        p[2] /= len;
+        p[3] /= len;
+    }
+}
+
+bool Frustum::sphereVisible(float* center, float radius) const {
+    for(int i = 0; i < 24; i += 4)
+        if(planes[i]*center[0] + planes[i+1]*center[1] + planes[i+2]*center[2] + planes[i+3] < -radius)
+            return false;
+    return true;
+}
+
+/*
+ * Axis aligned box, tested with the corner furthest along each plane normal.
+ * Like the sphere test it may keep boxes near the frustum corners.
+ */
+bool Frustum::boxVisible(const float* min, const float* max) const {
+    for(int i = 0; i < 24; i += 4){
+        float x = planes[i] >= 0 ? max[0] : min[0];
+        float y = planes[i+1] >= 0 ? max[1] : min[1];
+        float z = planes[i+2] >= 0 ? max[2] : min[2];
+        if(planes[i]*x + planes[i+1]*y + planes[i+2]*z + planes[i+3] < 0)
+            return false;
+    }
+    return true;
+}
+
+/*
+ * Tests count spheres stored as separate x, y, z, r arrays.
+ * Plane by plane, so the inner loop has no branches and vectorizes.
+ */
+void Frustum::spheresVisible(const float* x, const float* y, const float* z, const float* r, int count, unsigned char* out) const {
+    for(int i = 0; i < count; i++)
+        out[i] = 1;
+    for(int j = 0; j < 24; j += 4){
+        const float a = planes[j];
+        const float b = planes[j+1];
+        const float c = planes[j+2];
+        const float d = planes[j+3];
+        for(int i = 0; i < count; i++)
+            out[i] &= (a*x[i] + b*y[i] + c*z[i] + d >= -r[i]);
+    }
+}
@@ -0,0 +1,28 @@
+/*  This file is part of TSRE5.
+ *
+ *  TSRE5 - train sim game engine and MSTS/OR Editors. 
+ *  Copyright (C) 2016 Piotr Gadecki <pgadecki@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later. 
+ *
+ *  See LICENSE.md or https://www.gnu.org/licenses/gpl.html
+ */
+
+#ifndef FRUSTUM_H
+#define	FRUSTUM_H
+
+/*
+ * Six view frustum planes taken from a projection * model-view matrix.
+ * Spheres and boxes are given in the space of that matrix.
+ */
+class Frustum {
+public:
+    float planes[24];
+    void set(float* m);
+    bool sphereVisible(float* center, float radius) const;
+    bool boxVisible(const float* min, const float* max) const;
+    void spheresVisible(const float* x, const float* y, const float* z, const float* r, int count, unsigned char* out) const;
+};
+
+#endif	/* FRUSTUM_H */
+
@@ -119,6 +119,7 @@ public:
     static float* copy(float *a, float *b);
     static float* create();
     static float* identity(float *out);
+    static float* invert(float *out, float *a);
     static float* fromQuat(float *out, float *q);
     static float* fromRotationTranslation(float* out, float* q, float* v);
     static float* lookAt(float *out, float *eye, float *center, float *up);
@@ -10,6 +10,9 @@
 
 #include <tsre/math3d/Intersections.h>
 #include <tsre/math3d/GLMatrix.h>
+#include <tsre/math3d/BVH.h>
+#include <vector>
+#include <algorithm>
 
 void Intersections::vector(float *a, float *b, float *c){
 	a[0] = b[0] - c[0];
@@ -121,7 +124,55 @@ bool Intersections::segmentIntersection(float &p0_x, float &p0_y, float &p1_x, f
     return false; // No collision
 }
 
+/*
+ * Counts edge crossings between the triangles of two shapes, shape2 moved by pos.
+ * Only triangle pairs with overlapping boxes can cross, they are found
+ * with a BVH over the triangles of shape1.
+ */
 int Intersections::shapeIntersectsShape(float *shape1, float *shape2, int count1, int count2, int size1, int size2, float *pos){
+        int n1 = count1/(3*size1);
+        int n2 = count2/(3*size2);
+        if(n1 == 0 || n2 == 0)
+            return 0;
+        
+        std::vector<float> boxes1(n1*6);
+        std::vector<float> boxes2(n2*6);
+        BVH::triangleBoxes(shape1, n1, size1, boxes1.data());
+        BVH::triangleBoxes(shape2, n2, size2, boxes2.data());
+        float bound1[6];
+        float bound2[6];
+        for(int k = 0; k < 6; k++){
+            bound1[k] = boxes1[k];
+            bound2[k] = boxes2[k];
+        }
+        for(int j = 0; j < n2; j++){
+            float *box = &boxes2[j*6];
+            for(int k = 0; k < 3; k++){
+                box[k] += pos[k];
+                box[k+3] += pos[k];
+            }
+        }
+        for(int k = 0; k < 3; k++){
+            bound2[k] += pos[k];
+            bound2[k+3] += pos[k];
+        }
+        for(int i = 1; i < n1; i++)
+            for(int k = 0; k < 3; k++){
+                bound1[k] = std::min(bound1[k], boxes1[i*6+k]);
+                bound1[k+3] = std::max(bound1[k+3], boxes1[i*6+k+3]);
+            }
+        for(int j = 1; j < n2; j++)
+            for(int k = 0; k < 3; k++){
+                bound2[k] = std::min(bound2[k], boxes2[j*6+k]);
+                bound2[k+3] = std::max(bound2[k+3], boxes2[j*6+k+3]);
+            }
+        if(!BVH::boxBox(bound1, bound2))
+            return 0;
+        
+        BVH bvh;
+        bvh.build(boxes1.data(), n1);
+        std::vector<int> hits;
+        
         float v0[3];
         float v1[3];
         float v2[3];
@@ -131,16 +182,20 @@ int Intersections::shapeIntersectsShape(float *shape1, float *shape2, int count1
         
         int tak = 0;
         
-        for(int i = 0; i < count1; i+=3*size1)
-            for(int j = 0; j < count2; j+=3*size2){
+        for(int jj = 0; jj < n2; jj++){
+            bvh.intersectBox(&boxes2[jj*6], hits);
+            if(hits.size() == 0)
+                continue;
+            int j = jj*3*size2;
+            p0[0] = shape2[j] +pos[0];          p0[1] = shape2[j+1] +pos[1];            p0[2] = shape2[j+2] +pos[2];
+            p1[0] = shape2[j+size2] +pos[0];    p1[1] = shape2[j+1+size2] +pos[1];      p1[2] = shape2[j+2+size2] +pos[2];
+            p2[0] = shape2[j+2*size2] +pos[0];  p2[1] = shape2[j+1+2*size2] +pos[1];    p2[2] = shape2[j+2+2*size2] +pos[2];
+            for(unsigned int h = 0; h < hits.size(); h++){
+                int i = hits[h]*3*size1;
                 v0[0] = shape1[i];          v0[1] = shape1[i+1];            v0[2] = shape1[i+2];
                 v1[0] = shape1[i+size1];    v1[1] = shape1[i+1+size1];      v1[2] = shape1[i+2+size1];
                 v2[0] = shape1[i+2*size1];  v2[1] = shape1[i+1+2*size1];    v2[2] = shape1[i+2+2*size1];
 
-                p0[0] = shape2[j] +pos[0];          p0[1] = shape2[j+1] +pos[1];            p0[2] = shape2[j+2] +pos[2];
-                p1[0] = shape2[j+size2] +pos[0];    p1[1] = shape2[j+1+size2] +pos[1];      p1[2] = shape2[j+2+size2] +pos[2];
-                p2[0] = shape2[j+2*size2] +pos[0];  p2[1] = shape2[j+1+2*size2] +pos[1];    p2[2] = shape2[j+2+2*size2] +pos[2];
-
                 tak += segmentIntersectsTriangle(p0, p1, v0, v1, v2);
                 tak += segmentIntersectsTriangle(p0, p2, v0, v1, v2);
                 tak += segmentIntersectsTriangle(p1, p2, v0, v1, v2);
@@ -149,6 +204,7 @@ int Intersections::shapeIntersectsShape(float *shape1, float *shape2, int count1
                 tak += segmentIntersectsTriangle(v0, v2, p0, p1, p2);
                 tak += segmentIntersectsTriangle(v1, v2, p0, p1, p2);
             }
+        }
         return tak;
 };
 
@@ -193,4 +249,33 @@ int Intersections::segmentIntersectsTriangle(float *p, float *p2, float *v0, flo
         }
            
         return 0;
+}
+
+/*
+ * Ray p + t*d against a triangle, both faces. t is in units of d.
+ */
+bool Intersections::rayIntersectsTriangle(float *p, float *d, float *v0, float *v1, float *v2, float &t) {
+        float e1[3];
+        float e2[3];
+        float h[3];
+        float q[3];
+        float s[3];
+        vector(e1,v1,v0);
+        vector(e2,v2,v0);
+        cross(h,d,e2);
+
+        float a = dot(e1, h);
+        if (a > -0.0000001 && a < 0.0000001)
+            return false;
+        float f = 1/a;
+        vector(s,p,v0);
+        float u = f * dot(s, h);
+        if (u < 0.0 || u > 1.0)
+            return false;
+        cross(q,s,e1);
+        float v = f * dot(d, q);
+        if (v < 0.0 || u + v > 1.0)
+            return false;
+        t = f * dot(e2, q);
+        return t > 0;
 };
\ No newline at end of file
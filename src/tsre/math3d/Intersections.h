@@ -18,6 +18,7 @@ public:
     static bool segmentIntersection(float &p0_x, float &p0_y, float &p1_x, float &p1_y, 
                 float &p2_x, float &p2_y, float &p3_x, float &p3_y, float &i_x, float &i_y);
     static int segmentIntersectsTriangle(float *p, float *p2, float *v0, float *v1, float *v2);
+    static bool rayIntersectsTriangle(float *p, float *d, float *v0, float *v1, float *v2, float &t);
     static int shapeIntersectsShape(float *shape1, float *shape2, int count1, int count2, int size1, int size2, float *pos);
 private:
     static void vector(float *a, float *b, float *c);
@@ -78,6 +78,8 @@ void GLUU::initShader() {
         currentShader->bindAttributeLocation("aTextureCoord", 1);
         currentShader->bindAttributeLocation("normal", 2);
         currentShader->bindAttributeLocation("alpha", 3);
+        // mat4, uses locations 4-7
+        currentShader->bindAttributeLocation("instanceMVMatrix", 4);
         if(!currentShader->link()){
             qDebug() << "Shader link failed.";
         }
@@ -112,6 +114,8 @@ void GLUU::initShader() {
         currentShader->shadow1Bias = currentShader->uniformLocation("shadow1Bias");
         currentShader->shadow2Res = currentShader->uniformLocation("shadow2Res");
         currentShader->shadow2Bias = currentShader->uniformLocation("shadow2Bias");
+        currentShader->shaderInstanced = currentShader->uniformLocation("instanced");
+        currentShader->instanceMVMatrixAttribute = currentShader->attributeLocation("instanceMVMatrix");
 
         unsigned int tex1 = currentShader->uniformLocation("uSampler");
         currentShader->setUniformValue(tex1, 0);
@@ -10,6 +10,7 @@
 
 #include "OglObj.h"
 #include <tsre/texture/TexLib.h>
+#include <tsre/texture/TexLoader.h>
 #include <tsre/Game.h>
 #include <tsre/math3d/GLMatrix.h>
 #include <tsre/renderer/RenderItem.h>
@@ -113,6 +114,16 @@ void OglObj::init(float* punkty, int ptr, enum RenderItem::VertexAttr v, int typ
     VBO.release();
     length = ptr / v;
     loaded = true;
+    
+    // Box of the positions, the first three floats of every vertex.
+    for(int i = 0; i < 6; i++)
+        bound[i] = 0;
+    for(int i = 0; i + 2 < ptr && v > 0; i += v){
+        for(int j = 0; j < 3; j++){
+            if(i == 0 || punkty[i+j] > bound[j*2]) bound[j*2] = punkty[i+j];
+            if(i == 0 || punkty[i+j] < bound[j*2+1]) bound[j*2+1] = punkty[i+j];
+        }
+    }
 }
 
 void OglObj::setLineWidth(int val){
@@ -156,8 +167,13 @@ void OglObj::pushRenderItem(int selectionColor, float lod){
         if (TexLib::mtex[texId]->loaded) {
             if (!TexLib::mtex[texId]->glLoaded)
                 TexLib::mtex[texId]->GLTextures();
-            r->enableTextures(TexLib::mtex[texId]->tex[0]);
+            if (TexLib::mtex[texId]->glLoaded) {
+                r->enableTextures(TexLib::mtex[texId]->tex[0]);
+                TexLib::mtex[texId]->lastUsed = TexLoader::Frame;
+            } else
+                r->enableTextures(0);
         } else {
+            TexLib::touchTex(texId);
             r->enableTextures(0);
         }
 
@@ -209,9 +225,13 @@ void OglObj::render(int selectionColor, float lod) {
             if (TexLib::mtex[texId]->loaded) {
                 if (!TexLib::mtex[texId]->glLoaded)
                     TexLib::mtex[texId]->GLTextures();
-                gluu->bindTexture(f, TexLib::mtex[texId]->tex[0]);
+                if (TexLib::mtex[texId]->glLoaded) {
+                    gluu->bindTexture(f, TexLib::mtex[texId]->tex[0]);
+                    TexLib::mtex[texId]->lastUsed = TexLoader::Frame;
+                }
                 //f->glBindTexture(GL_TEXTURE_2D, TexLib::mtex[texId]->tex[0]);
             } else {
+                TexLib::touchTex(texId);
             }
         }
     } else if(materialType == COLOR){
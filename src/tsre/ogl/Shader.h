@@ -49,6 +49,8 @@ public:
     unsigned int shadow1Bias;
     unsigned int shadow2Res;
     unsigned int shadow2Bias;
+    unsigned int shaderInstanced;
+    int instanceMVMatrixAttribute = -1;
 private:
 
 };
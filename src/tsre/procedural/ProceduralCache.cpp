@@ -0,0 +1,208 @@
+/*  This file is part of TSRE5.
+ *
+ *  TSRE5 - train sim game engine and MSTS/OR Editors. 
+ *  Copyright (C) 2016 Piotr Gadecki <pgadecki@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later. 
+ *
+ *  See LICENSE.md or https://www.gnu.org/licenses/gpl.html
+ */
+
+#include <tsre/procedural/ProceduralCache.h>
+#include <tsre/procedural/ProceduralShape.h>
+#include <tsre/fileFunctions/FileBuffer.h>
+#include <tsre/fileFunctions/ReadFile.h>
+#include <tsre/ogl/OglObj.h>
+#include <tsre/Game.h>
+#include <QMutexLocker>
+#include <QCryptographicHash>
+#include <QSaveFile>
+#include <QDateTime>
+#include <QDir>
+#include <QDebug>
+#include <string.h>
+
+static const char CacheMagic[8] = { 'T', 'S', 'R', 'E', '_', 'P', 'C', 0 };
+
+QMutex ProceduralCache::mutex;
+QWaitCondition ProceduralCache::jobAdded;
+QQueue<ProceduralCache::Job> ProceduralCache::jobs;
+ProceduralCache* ProceduralCache::worker = NULL;
+QString ProceduralCache::stampRoute;
+quint64 ProceduralCache::stamp = 0;
+
+QString ProceduralCache::getPath(const QString &hash){
+    QString name = QCryptographicHash::hash(hash.toUtf8(), QCryptographicHash::Sha1).toHex();
+    QString path = Game::root + "/routes/" + Game::route + "/tsre_cache/procedural/" + name;
+    path.replace("//", "/");
+    return path;
+}
+
+// Computed once per route, the procedural directories differ between routes.
+quint64 ProceduralCache::getStamp(){
+    QMutexLocker locker(&mutex);
+    QString route = Game::root + "/routes/" + Game::route;
+    if(route == stampRoute)
+        return stamp;
+    QStringList dirs;
+    dirs.push_back(QString("appdata/") + Game::AppDataVersion + "/procedural/");
+    dirs.push_back(Game::root + "/routes/" + Game::route + "/procedural/");
+    
+    QCryptographicHash h(QCryptographicHash::Sha1);
+    for(int i = 0; i < dirs.size(); i++){
+        QFileInfoList files = QDir(dirs[i]).entryInfoList(QDir::Files, QDir::Name);
+        for(int j = 0; j < files.size(); j++){
+            h.addData(files[j].fileName().toUtf8());
+            h.addData(QByteArray::number(files[j].size()));
+            h.addData(QByteArray::number(files[j].lastModified().toMSecsSinceEpoch()));
+        }
+    }
+    memcpy(&stamp, h.result().constData(), 8);
+    stampRoute = route;
+    return stamp;
+}
+
+/*
+ * Checked cache file of the shape, at the first part, or NULL on a miss.
+ * Files with a wrong header, no parts or lengths that are negative or run
+ * past the end are a miss.
+ */
+FileBuffer* ProceduralCache::open(const QString &hash, int &partCount){
+    QFile file(getPath(hash));
+    if (!file.open(QIODevice::ReadOnly))
+        return NULL;
+    FileBuffer* data = FileBuffer::map(&file);
+    if(data == NULL)
+        data = ReadFile::readRAW(&file);
+    file.close();
+    
+    QByteArray key = hash.toUtf8();
+    partCount = 0;
+    bool valid = data->length >= HeaderLength
+            && memcmp(data->data, CacheMagic, 8) == 0;
+    if(valid){
+        data->off = 8;
+        quint64 fileStamp;
+        memcpy(&fileStamp, &data->data[16], 8);
+        valid = data->getUint() == Version
+                && data->getInt() == key.size()
+                && fileStamp == getStamp();
+        data->off = 24;
+        partCount = data->getInt();
+        valid = valid && partCount > 0
+                && data->length >= HeaderLength + key.size()
+                && memcmp(data->data + HeaderLength, key.constData(), key.size()) == 0;
+    }
+    
+    data->off = HeaderLength + key.size();
+    for(int i = 0; i < partCount && valid; i++){
+        if(data->off + 4 > data->length){
+            valid = false;
+            break;
+        }
+        int textureLength = data->getInt();
+        if(textureLength < 0 || textureLength > data->length - data->off - 12){
+            valid = false;
+            break;
+        }
+        data->off += textureLength + 8;
+        int count = data->getInt();
+        if(count < 0 || count > (data->length - data->off)/4){
+            valid = false;
+            break;
+        }
+        data->off += count*4;
+    }
+    if(!valid){
+        delete data;
+        return NULL;
+    }
+    data->off = HeaderLength + key.size();
+    return data;
+}
+
+bool ProceduralCache::read(const QString &hash, QVector<OglObj*> &shape){
+    if(!Game::useProceduralCache)
+        return false;
+    int partCount;
+    FileBuffer* data = open(hash, partCount);
+    if(data == NULL)
+        return false;
+    for(int i = 0; i < partCount; i++){
+        int textureLength = data->getInt();
+        QString *texture = new QString(QString::fromUtf8((const char*)data->data + data->off, textureLength));
+        data->off += textureLength;
+        float minDistance = data->getFloat();
+        float maxDistance = data->getFloat();
+        int count = data->getInt();
+        shape.push_back(new OglObj());
+        shape.back()->setMaterial(texture);
+        shape.back()->init((float*)(data->data + data->off), count, RenderItem::VNTA, GL_TRIANGLES);
+        shape.back()->setDistanceRange(minDistance, maxDistance);
+        data->off += count*4;
+    }
+    delete data;
+    return true;
+}
+
+void ProceduralCache::write(const QString &hash, const QVector<ProceduralPart> &parts){
+    if(parts.size() == 0)
+        return;
+    QByteArray key = hash.toUtf8();
+    int length = HeaderLength + key.size();
+    for(int i = 0; i < parts.size(); i++)
+        length += 16 + parts[i].texture.toUtf8().size() + parts[i].data.size()*4;
+    
+    QByteArray out;
+    out.reserve(length);
+    out.append(CacheMagic, 8);
+    unsigned int version = Version;
+    int keyLength = key.size();
+    quint64 s = getStamp();
+    int partCount = parts.size();
+    out.append((const char*)&version, 4);
+    out.append((const char*)&keyLength, 4);
+    out.append((const char*)&s, 8);
+    out.append((const char*)&partCount, 4);
+    out.append(key);
+    for(int i = 0; i < parts.size(); i++){
+        QByteArray texture = parts[i].texture.toUtf8();
+        int textureLength = texture.size();
+        int count = parts[i].data.size();
+        out.append((const char*)&textureLength, 4);
+        out.append(texture);
+        out.append((const char*)&parts[i].minDistance, 4);
+        out.append((const char*)&parts[i].maxDistance, 4);
+        out.append((const char*)&count, 4);
+        out.append((const char*)parts[i].data.constData(), count*4);
+    }
+
+    QMutexLocker locker(&mutex);
+    if(worker == NULL){
+        worker = new ProceduralCache();
+        worker->start(QThread::LowPriority);
+    }
+    jobs.enqueue({getPath(hash), out});
+    jobAdded.wakeOne();
+}
+
+void ProceduralCache::run(){
+    Job job;
+    for(;;){
+        mutex.lock();
+        while(jobs.size() == 0)
+            jobAdded.wait(&mutex);
+        job = jobs.dequeue();
+        mutex.unlock();
+
+        QDir().mkpath(QFileInfo(job.path).path());
+        QSaveFile file(job.path);
+        if (!file.open(QIODevice::WriteOnly)){
+            qDebug() << "ProceduralCache: can't write" << job.path;
+            continue;
+        }
+        file.write(job.data);
+        if(!file.commit())
+            qDebug() << "ProceduralCache: can't write" << job.path;
+    }
+}
@@ -0,0 +1,63 @@
+/*  This file is part of TSRE5.
+ *
+ *  TSRE5 - train sim game engine and MSTS/OR Editors. 
+ *  Copyright (C) 2016 Piotr Gadecki <pgadecki@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later. 
+ *
+ *  See LICENSE.md or https://www.gnu.org/licenses/gpl.html
+ */
+
+#ifndef PROCEDURALCACHE_H
+#define	PROCEDURALCACHE_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QByteArray>
+#include <QVector>
+#include <QString>
+
+class OglObj;
+class FileBuffer;
+struct ProceduralPart;
+
+/*
+ * Cache of generated procedural track shapes in
+ * routes/<route>/tsre_cache/procedural, one file per shape hash.
+ * The header keeps the version, the shape hash and a stamp of the
+ * template, .obj and texture files in the procedural directories;
+ * changing any of them makes the cache invalid. Vertex data is read
+ * from the mapped file straight into OglObj buffers. Files are written
+ * by a background thread.
+ */
+class ProceduralCache : public QThread {
+    Q_OBJECT
+public:
+    static const unsigned int Version = 1;
+    static const int HeaderLength = 28;
+
+    static FileBuffer* open(const QString &hash, int &partCount);
+    static bool read(const QString &hash, QVector<OglObj*> &shape);
+    static void write(const QString &hash, const QVector<ProceduralPart> &parts);
+
+protected:
+    void run();
+
+private:
+    struct Job {
+        QString path;
+        QByteArray data;
+    };
+    static QMutex mutex;
+    static QWaitCondition jobAdded;
+    static QQueue<Job> jobs;
+    static ProceduralCache* worker;
+    static QString stampRoute;
+    static quint64 stamp;
+    static quint64 getStamp();
+    static QString getPath(const QString &hash);
+};
+
+#endif	/* PROCEDURALCACHE_H */
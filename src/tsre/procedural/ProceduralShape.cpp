@@ -17,11 +17,14 @@
 #include <tsre/tdb/TSectionDAT.h>
 #include <QDateTime>
 #include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
 #include <math.h>
 #include <tsre/math3d/Intersections.h>
 
 #include <tsre/procedural/ComplexLine.h>
 #include <tsre/procedural/ShapeTemplates.h>
+#include <tsre/procedural/ProceduralCache.h>
 
 QHash<QString, QVector<OglObj*>> ProceduralShape::Shapes;
 ShapeTemplates *ProceduralShape::ShapeTemplateFile = NULL;
@@ -31,6 +34,9 @@ bool ProceduralShape::Loaded = false;
 QMap<QString, ObjFile*> ProceduralShape::Files;
 float ProceduralShape::Alpha = 0;
 unsigned int ProceduralShape::ShapeCount = 0;
+QThreadPool *ProceduralShape::GenPool = NULL;
+
+static QMutex FilesMutex;
 
 ObjFile* ProceduralShape::GetObjFile(QString name) {
     
@@ -43,6 +49,8 @@ ObjFile* ProceduralShape::GetObjFile(QString name) {
     if(file.exists())
         path = pathRoute;
 
+    // Called from generator threads.
+    QMutexLocker locker(&FilesMutex);
     if (Files[path] == NULL)
         Files[path] = new ObjFile(path);
     return Files[path];
@@ -97,14 +105,16 @@ QString ProceduralShape::GetShapeHash(QString templateName, ComplexLine &line, i
 
 void ProceduralShape::GetShape(QString templateName, QVector<OglObj*>& shape, TrackShape* tsh, QMap<int, float> &angles) {
     QString hash = ProceduralShape::GetShapeHash(templateName, tsh, angles, 0);
-    if(ProceduralShape::Shapes[hash].size() == 0){
+    if(ProceduralShape::Shapes[hash].size() == 0 && !ProceduralCache::read(hash, ProceduralShape::Shapes[hash])){
         qDebug() << "New Procedural Shape: "<< ShapeCount++ << hash;
-        ProceduralShape::GenShape(templateName, ProceduralShape::Shapes[hash], tsh, angles);
+        QVector<ProceduralPart> parts;
+        ProceduralShape::GenShape(templateName, parts, tsh, angles);
+        ProceduralShape::CreateShape(hash, parts, ProceduralShape::Shapes[hash]);
     }
     shape.append(ProceduralShape::Shapes[hash]);
 }
 
-void ProceduralShape::GenShape(QString templateName, QVector<OglObj*>& shape, TrackShape* tsh, QMap<int, float> &angles) {
+void ProceduralShape::GenShape(QString templateName, QVector<ProceduralPart>& shape, TrackShape* tsh, QMap<int, float> &angles) {
     if (!Loaded)
         Load();
 
@@ -137,32 +147,51 @@ void ProceduralShape::GenShape(QString templateName, QVector<OglObj*>& shape, Tr
         line[j].init(sections);
     }
     
+    // Every element and path is generated by its own job, each with
+    // its own copy of the line and angles.
+    QVector<std::function<void()>> jobs;
+    QVector<QVector<ProceduralPart>> results;
+    results.reserve(sTemplate->elements.size() * (tsh->numpaths + 1));
+    
     QHashIterator<QString, ShapeTemplateElement*> i(sTemplate->elements);
     while (i.hasNext()) {
         i.next();
-        if(i.value() == NULL)
+        ShapeTemplateElement* e = i.value();
+        if(e == NULL)
             continue;
-        if(i.value()->type == ShapeTemplateElement::TIE){
-            if(tsh->numpaths == 2 && tsh->xoverpts > 0){
-                GenAdvancedTie(i.value(), shape, tsh, angles);
-            } else if(tsh->numpaths == 2 && tsh->mainroute > -1){
-                GenAdvancedTie(i.value(), shape, tsh, angles);
-            } else {
-                for (int j = 0; j < tsh->numpaths; j++) {
-                    GenTie(i.value(), shape, line[j], tsh->path[j].pos, -tsh->path[j].rotDeg, angles[j * 2], angles[j * 2 + 1]);
-                }
+        if(e->type == ShapeTemplateElement::TIE){
+            if((tsh->numpaths == 2 && tsh->xoverpts > 0) || (tsh->numpaths == 2 && tsh->mainroute > -1)){
+                results.push_back(QVector<ProceduralPart>());
+                QVector<ProceduralPart> *out = &results.back();
+                jobs.push_back([e, out, tsh, angles]() mutable {
+                    GenAdvancedTie(e, *out, tsh, angles);
+                });
+                continue;
             }
         }
-
-        if(i.value()->type == ShapeTemplateElement::RAIL)
-            for (int j = 0; j < tsh->numpaths; j++)
-                GenRails(i.value(), shape, line[j], tsh->path[j].pos, -tsh->path[j].rotDeg, angles[j * 2], angles[j * 2 + 1]);
-
-        if(i.value()->type == ShapeTemplateElement::BALLAST)
-            for (int j = 0; j < tsh->numpaths; j++)
-                GenBallast(i.value(), shape, line[j], tsh->path[j].pos, -tsh->path[j].rotDeg, angles[j * 2], angles[j * 2 + 1]);
+        if(e->type != ShapeTemplateElement::TIE && e->type != ShapeTemplateElement::RAIL && e->type != ShapeTemplateElement::BALLAST)
+            continue;
+        for (int j = 0; j < tsh->numpaths; j++) {
+            results.push_back(QVector<ProceduralPart>());
+            QVector<ProceduralPart> *out = &results.back();
+            ComplexLine l = line[j];
+            float *pos = tsh->path[j].pos;
+            float rot = -tsh->path[j].rotDeg;
+            float angleB = angles[j * 2];
+            float angleE = angles[j * 2 + 1];
+            jobs.push_back([e, out, l, pos, rot, angleB, angleE]() mutable {
+                if(e->type == ShapeTemplateElement::TIE)
+                    GenTie(e, *out, l, pos, rot, angleB, angleE);
+                if(e->type == ShapeTemplateElement::RAIL)
+                    GenRails(e, *out, l, pos, rot, angleB, angleE);
+                if(e->type == ShapeTemplateElement::BALLAST)
+                    GenBallast(e, *out, l, pos, rot, angleB, angleE);
+            });
+        }
     }
-
+    RunJobs(jobs);
+    for(int j = 0; j < results.size(); j++)
+        shape.append(results[j]);
     
     delete[] line;
     
@@ -171,14 +200,16 @@ void ProceduralShape::GenShape(QString templateName, QVector<OglObj*>& shape, Tr
 
 void ProceduralShape::GetShape(QString templateName, QVector<OglObj*>& shape, QVector<TSection> &sections, int shapeOffset) {
     QString hash = ProceduralShape::GetShapeHash(templateName, sections, shapeOffset);
-    if(ProceduralShape::Shapes[hash].size() == 0){
+    if(ProceduralShape::Shapes[hash].size() == 0 && !ProceduralCache::read(hash, ProceduralShape::Shapes[hash])){
         qDebug() << "New Procedural Shape: "<< ShapeCount++ << hash;
-        ProceduralShape::GenShape(templateName, ProceduralShape::Shapes[hash], sections, shapeOffset);
+        QVector<ProceduralPart> parts;
+        ProceduralShape::GenShape(templateName, parts, sections, shapeOffset);
+        ProceduralShape::CreateShape(hash, parts, ProceduralShape::Shapes[hash]);
     }
     shape.append(ProceduralShape::Shapes[hash]);
 }
 
-void ProceduralShape::GenShape(QString templateName, QVector<OglObj*>& shape, QVector<TSection> &sections, int shapeOffset) {
+void ProceduralShape::GenShape(QString templateName, QVector<ProceduralPart>& shape, QVector<TSection> &sections, int shapeOffset) {
     if (!Loaded)
         Load();
 
@@ -191,14 +222,16 @@ void ProceduralShape::GenShape(QString templateName, QVector<OglObj*>& shape, QV
 
 void ProceduralShape::GetShape(QString templateName, QVector<OglObj*>& shape, ComplexLine& line, int shapeOffset) {
     QString hash = ProceduralShape::GetShapeHash(templateName, line, shapeOffset);
-    if(ProceduralShape::Shapes[hash].size() == 0){
+    if(ProceduralShape::Shapes[hash].size() == 0 && !ProceduralCache::read(hash, ProceduralShape::Shapes[hash])){
         qDebug() << "New Procedural Shape: "<< ShapeCount++ << hash;
-        ProceduralShape::GenShape(templateName, ProceduralShape::Shapes[hash], line, shapeOffset);
+        QVector<ProceduralPart> parts;
+        ProceduralShape::GenShape(templateName, parts, line, shapeOffset);
+        ProceduralShape::CreateShape(hash, parts, ProceduralShape::Shapes[hash]);
     }
     shape.append(ProceduralShape::Shapes[hash]);
 }
 
-void ProceduralShape::GenShape(QString templateName, QVector<OglObj*>& shape, ComplexLine& line, int shapeOffset){
+void ProceduralShape::GenShape(QString templateName, QVector<ProceduralPart>& shape, ComplexLine& line, int shapeOffset){
     //unsigned long long int timeNow = QDateTime::currentMSecsSinceEpoch();
     Alpha = -0.3;
     
@@ -210,32 +243,75 @@ void ProceduralShape::GenShape(QString templateName, QVector<OglObj*>& shape, Co
     
     ShapeTemplate *sTemplate = ShapeTemplateFile->templates[templateName];
     
+    QVector<std::function<void()>> jobs;
+    QVector<QVector<ProceduralPart>> results;
+    results.reserve(sTemplate->elements.size());
+    
     QHashIterator<QString, ShapeTemplateElement*> i(sTemplate->elements);
     while (i.hasNext()) {
         i.next();
-        if(i.value() == NULL)
+        ShapeTemplateElement* e = i.value();
+        if(e == NULL)
             continue;
-        if(i.value()->type == ShapeTemplateElement::NONE)
+        if(e->type == ShapeTemplateElement::NONE)
             continue;
-        if(i.value()->type == ShapeTemplateElement::TIE)
-            GenTie(i.value(), shape, line);
+        results.push_back(QVector<ProceduralPart>());
+        QVector<ProceduralPart> *out = &results.back();
+        ComplexLine l = line;
+        jobs.push_back([e, out, l, shapeOffset]() mutable {
+            if(e->type == ShapeTemplateElement::TIE)
+                GenTie(e, *out, l);
 
-        if(i.value()->type == ShapeTemplateElement::RAIL)
-            GenRails(i.value(), shape, line);
+            if(e->type == ShapeTemplateElement::RAIL)
+                GenRails(e, *out, l);
 
-        if(i.value()->type == ShapeTemplateElement::BALLAST)
-            GenBallast(i.value(), shape, line);
-        
-        if(i.value()->type == ShapeTemplateElement::STRETCH)
-            GenStretch(i.value(), shape, line, shapeOffset);
-        
-        if(i.value()->type == ShapeTemplateElement::POINT)
-            GenPointShape(i.value(), shape, line, shapeOffset);
+            if(e->type == ShapeTemplateElement::BALLAST)
+                GenBallast(e, *out, l);
+
+            if(e->type == ShapeTemplateElement::STRETCH)
+                GenStretch(e, *out, l, shapeOffset);
+
+            if(e->type == ShapeTemplateElement::POINT)
+                GenPointShape(e, *out, l, shapeOffset);
+        });
     }
+    RunJobs(jobs);
+    for(int j = 0; j < results.size(); j++)
+        shape.append(results[j]);
+}
+
+void ProceduralShape::RunJobs(QVector<std::function<void()>> &jobs){
+    if(jobs.size() == 1){
+        jobs[0]();
+        return;
+    }
+    if(GenPool == NULL)
+        GenPool = new QThreadPool();
+    for(int i = 0; i < jobs.size(); i++)
+        GenPool->start(jobs[i]);
+    GenPool->waitForDone();
+}
+
+void ProceduralShape::PushPart(QVector<ProceduralPart> &shape, ShapeTemplateElement *stemplate, float* p, int count){
+    shape.push_back(ProceduralPart());
+    shape.back().texture = ProceduralShape::GetTexturePath(stemplate->texture);
+    shape.back().minDistance = stemplate->minDistance;
+    shape.back().maxDistance = stemplate->maxDistance;
+    shape.back().data = QVector<float>(p, p + count);
+}
 
+void ProceduralShape::CreateShape(QString hash, QVector<ProceduralPart> &parts, QVector<OglObj*> &shape){
+    for(int i = 0; i < parts.size(); i++){
+        shape.push_back(new OglObj());
+        shape.back()->setMaterial(new QString(parts[i].texture));
+        shape.back()->init(parts[i].data.data(), parts[i].data.size(), RenderItem::VNTA, GL_TRIANGLES);
+        shape.back()->setDistanceRange(parts[i].minDistance, parts[i].maxDistance);
+    }
+    if(Game::useProceduralCache && parts.size() > 0)
+        ProceduralCache::write(hash, parts);
 }
 
-void ProceduralShape::GenRails(ShapeTemplateElement *stemplate, QVector<OglObj*> &shape, ComplexLine &line) {
+void ProceduralShape::GenRails(ShapeTemplateElement *stemplate, QVector<ProceduralPart> &shape, ComplexLine &line) {
     float* p = new float[2000000];
     float* ptr = p;
 
@@ -246,9 +322,8 @@ void ProceduralShape::GenRails(ShapeTemplateElement *stemplate, QVector<OglObj*>
     float vOffset[3];
     ObjFile *tFile;
 
-    QString* texturePath;
 
-    tFile = GetObjFile(stemplate->shape.first());
+    tFile = GetObjFile(stemplate->shape.constFirst());
     float step = 3;
     for (float i = 0; i < line.length; i += step) {
         line.getDrawPosition(posRot, i, stemplate->xOffset);
@@ -266,16 +341,12 @@ void ProceduralShape::GenRails(ShapeTemplateElement *stemplate, QVector<OglObj*>
         PushShapePartExpand(ptr, tFile, stemplate->yOffset, matrix1, matrix2, q, i, i + step);
     }
 
-    texturePath = new QString(ProceduralShape::GetTexturePath(stemplate->texture));
-    shape.push_back(new OglObj());
-    shape.back()->setMaterial(texturePath);
-    shape.back()->init(p, ptr - p, RenderItem::VNTA, GL_TRIANGLES);
-    shape.back()->setDistanceRange(stemplate->minDistance, stemplate->maxDistance);
+    PushPart(shape, stemplate, p, ptr - p);
     
     delete[] p;
 }
 
-void ProceduralShape::GenRails(ShapeTemplateElement *stemplate, QVector<OglObj*>& shape, ComplexLine& line, float* sPos, float sAngle, float angleB, float angleE) {
+void ProceduralShape::GenRails(ShapeTemplateElement *stemplate, QVector<ProceduralPart>& shape, ComplexLine& line, float* sPos, float sAngle, float angleB, float angleE) {
     float matrixS[16];
     float* p = new float[4000000];
     float* ptr = p;
@@ -287,8 +358,6 @@ void ProceduralShape::GenRails(ShapeTemplateElement *stemplate, QVector<OglObj*>
     float matrix2[16];
     ObjFile *tFile;
 
-    QString* texturePath;
-
 
     float pp[3];
     float zangle;
@@ -299,7 +368,7 @@ void ProceduralShape::GenRails(ShapeTemplateElement *stemplate, QVector<OglObj*>
     Vec3::set(pp, -sPos[0], sPos[1], sPos[2]);
     Mat4::fromRotationTranslation(matrixS, q, pp);
 
-    tFile = GetObjFile(stemplate->shape.first());
+    tFile = GetObjFile(stemplate->shape.constFirst());
     float step = 3;
     for (float i = 0; i < line.length; i += step) {
         line.getDrawPosition(posRot, i, stemplate->xOffset);
@@ -326,16 +395,12 @@ void ProceduralShape::GenRails(ShapeTemplateElement *stemplate, QVector<OglObj*>
         PushShapePartExpand(ptr, tFile, stemplate->yOffset, matrix1, matrix2, qr, i, i + step);
     }
 
-    texturePath = new QString(ProceduralShape::GetTexturePath(stemplate->texture));
-    shape.push_back(new OglObj());
-    shape.back()->setMaterial(texturePath);
-    shape.back()->init(p, ptr - p, RenderItem::VNTA, GL_TRIANGLES);
-    shape.back()->setDistanceRange(stemplate->minDistance, stemplate->maxDistance);
+    PushPart(shape, stemplate, p, ptr - p);
     
     delete[] p;
 }
 
-void ProceduralShape::GenPointShape(ShapeTemplateElement *stemplate, QVector<OglObj*> &shape, ComplexLine &line, int shapeOffset) {
+void ProceduralShape::GenPointShape(ShapeTemplateElement *stemplate, QVector<ProceduralPart> &shape, ComplexLine &line, int shapeOffset) {
     float* p = new float[2000000];
     float* ptr = p;
 
@@ -345,28 +410,23 @@ void ProceduralShape::GenPointShape(ShapeTemplateElement *stemplate, QVector<Ogl
     float matrix2[16];
     ObjFile *tFile;
 
-    QString* texturePath;
 
     shapeOffset = shapeOffset % stemplate->shape.size();
-    tFile = GetObjFile(stemplate->shape[shapeOffset]);
+    tFile = GetObjFile(stemplate->shape.at(shapeOffset));
 
     line.getDrawPosition(posRot, 0);
     Quat::fromRotationXYZ(q, (float*) (posRot + 3));
     Mat4::fromRotationTranslation(matrix1, q, posRot);
     //PushShapePart(ptr, tFile, 0.0, matrix1, q, line.length);
     PushShapePart(ptr, tFile, 0.0, matrix1, q);
-    texturePath = new QString(ProceduralShape::GetTexturePath(stemplate->texture));
-    shape.push_back(new OglObj());
-    shape.back()->setMaterial(texturePath);
-    shape.back()->init(p, ptr - p, RenderItem::VNTA, GL_TRIANGLES);
-    shape.back()->setDistanceRange(stemplate->minDistance, stemplate->maxDistance);
+    PushPart(shape, stemplate, p, ptr - p);
     
     ptr = p;
 
     delete[] p;
 }
 
-void ProceduralShape::GenStretch(ShapeTemplateElement *stemplate, QVector<OglObj*> &shape, ComplexLine &line, int shapeOffset) {
+void ProceduralShape::GenStretch(ShapeTemplateElement *stemplate, QVector<ProceduralPart> &shape, ComplexLine &line, int shapeOffset) {
     float* p = new float[2000000];
     float* ptr = p;
 
@@ -376,28 +436,23 @@ void ProceduralShape::GenStretch(ShapeTemplateElement *stemplate, QVector<OglObj
     float matrix2[16];
     ObjFile *tFile;
 
-    QString* texturePath;
 
     shapeOffset = shapeOffset % stemplate->shape.size();
-    tFile = GetObjFile(stemplate->shape[shapeOffset]);
+    tFile = GetObjFile(stemplate->shape.at(shapeOffset));
 
     line.getDrawPosition(posRot, 0);
     Quat::fromRotationXYZ(q, (float*) (posRot + 3));
     Mat4::fromRotationTranslation(matrix1, q, posRot);
     PushShapePartStretch(ptr, tFile, 0.0, matrix1, q, line.length);
 
-    texturePath = new QString(ProceduralShape::GetTexturePath(stemplate->texture));
-    shape.push_back(new OglObj());
-    shape.back()->setMaterial(texturePath);
-    shape.back()->init(p, ptr - p, RenderItem::VNTA, GL_TRIANGLES);
-    shape.back()->setDistanceRange(stemplate->minDistance, stemplate->maxDistance);
+    PushPart(shape, stemplate, p, ptr - p);
     
     ptr = p;
 
     delete[] p;
 }
 
-void ProceduralShape::GenBallast(ShapeTemplateElement *stemplate, QVector<OglObj*> &shape, ComplexLine &line) {
+void ProceduralShape::GenBallast(ShapeTemplateElement *stemplate, QVector<ProceduralPart> &shape, ComplexLine &line) {
     float* p = new float[2000000];
     float* ptr = p;
 
@@ -407,9 +462,8 @@ void ProceduralShape::GenBallast(ShapeTemplateElement *stemplate, QVector<OglObj
     float matrix2[16];
     ObjFile *tFile;
 
-    QString* texturePath;
 
-    tFile = GetObjFile(stemplate->shape.first());
+    tFile = GetObjFile(stemplate->shape.constFirst());
     float step = 4;
     for (float i = 0; i < line.length; i += step) {
         line.getDrawPosition(posRot, i);
@@ -421,18 +475,14 @@ void ProceduralShape::GenBallast(ShapeTemplateElement *stemplate, QVector<OglObj
         PushShapePartExpand(ptr, tFile, stemplate->yOffset, matrix1, matrix2, q, i, i + step);
     }
 
-    texturePath = new QString(ProceduralShape::GetTexturePath(stemplate->texture));
-    shape.push_back(new OglObj());
-    shape.back()->setMaterial(texturePath);
-    shape.back()->init(p, ptr - p, RenderItem::VNTA, GL_TRIANGLES);
-    shape.back()->setDistanceRange(stemplate->minDistance, stemplate->maxDistance);
+    PushPart(shape, stemplate, p, ptr - p);
 
     ptr = p;
 
     delete[] p;
 }
 
-void ProceduralShape::GenBallast(ShapeTemplateElement *stemplate, QVector<OglObj*>& shape, ComplexLine& line, float* sPos, float sAngle, float angleB, float angleE) {
+void ProceduralShape::GenBallast(ShapeTemplateElement *stemplate, QVector<ProceduralPart>& shape, ComplexLine& line, float* sPos, float sAngle, float angleB, float angleE) {
     float matrixS[16];
     float* p = new float[4000000];
     float* ptr = p;
@@ -444,7 +494,6 @@ void ProceduralShape::GenBallast(ShapeTemplateElement *stemplate, QVector<OglObj
     float matrix2[16];
     ObjFile *tFile;
 
-    QString* texturePath;
 
     float pp[3];
     float zangle;
@@ -454,7 +503,7 @@ void ProceduralShape::GenBallast(ShapeTemplateElement *stemplate, QVector<OglObj
     Vec3::set(pp, -sPos[0], sPos[1], sPos[2]);
     Mat4::fromRotationTranslation(matrixS, q, pp);
 
-    tFile = GetObjFile(stemplate->shape.first());
+    tFile = GetObjFile(stemplate->shape.constFirst());
     float step = 4;
     for (float i = 0; i < line.length; i += step) {
         line.getDrawPosition(posRot, i);
@@ -475,16 +524,12 @@ void ProceduralShape::GenBallast(ShapeTemplateElement *stemplate, QVector<OglObj
         PushShapePartExpand(ptr, tFile, stemplate->yOffset, matrix1, matrix2, qr, i, i + step);
     }
 
-    texturePath = new QString(ProceduralShape::GetTexturePath(stemplate->texture));
-    shape.push_back(new OglObj());
-    shape.back()->setMaterial(texturePath);
-    shape.back()->init(p, ptr - p, RenderItem::VNTA, GL_TRIANGLES);
-    shape.back()->setDistanceRange(stemplate->minDistance, stemplate->maxDistance);
+    PushPart(shape, stemplate, p, ptr - p);
 
     delete[] p;
 }
 
-void ProceduralShape::GenTie(ShapeTemplateElement *stemplate, QVector<OglObj*> &shape, ComplexLine &line) {
+void ProceduralShape::GenTie(ShapeTemplateElement *stemplate, QVector<ProceduralPart> &shape, ComplexLine &line) {
     float* p = new float[2000000];
     float* ptr = p;
 
@@ -494,9 +539,8 @@ void ProceduralShape::GenTie(ShapeTemplateElement *stemplate, QVector<OglObj*> &
     float matrix2[16];
     ObjFile *tFile;
 
-    QString* texturePath;
 
-    tFile = GetObjFile(stemplate->shape.first());
+    tFile = GetObjFile(stemplate->shape.constFirst());
     for (float i = 0; i < line.length; i += 0.65) {
         line.getDrawPosition(posRot, i);
         Quat::fromRotationXYZ(q, (float*) (posRot + 3));
@@ -504,16 +548,12 @@ void ProceduralShape::GenTie(ShapeTemplateElement *stemplate, QVector<OglObj*> &
         PushShapePart(ptr, tFile, 0.155, matrix1, q);
     }
 
-    texturePath = new QString(ProceduralShape::GetTexturePath(stemplate->texture));
-    shape.push_back(new OglObj());
-    shape.back()->setMaterial(texturePath);
-    shape.back()->init(p, ptr - p, RenderItem::VNTA, GL_TRIANGLES);
-    shape.back()->setDistanceRange(stemplate->minDistance, stemplate->maxDistance);
+    PushPart(shape, stemplate, p, ptr - p);
 
     delete[] p;
 }
 
-void ProceduralShape::GenTie(ShapeTemplateElement *stemplate, QVector<OglObj*> &shape, ComplexLine &line, float *sPos, float sAngle, float angleB, float angleE) {
+void ProceduralShape::GenTie(ShapeTemplateElement *stemplate, QVector<ProceduralPart> &shape, ComplexLine &line, float *sPos, float sAngle, float angleB, float angleE) {
     float matrixS[16];
     float* p = new float[4000000];
     float* ptr = p;
@@ -525,8 +565,6 @@ void ProceduralShape::GenTie(ShapeTemplateElement *stemplate, QVector<OglObj*> &
     float matrix2[16];
     ObjFile *tFile;
 
-    QString* texturePath;
-
 
     float pp[3];
     float zangle;
@@ -537,7 +575,7 @@ void ProceduralShape::GenTie(ShapeTemplateElement *stemplate, QVector<OglObj*> &
     Mat4::fromRotationTranslation(matrixS, q, pp);
 
 
-    tFile = GetObjFile(stemplate->shape.first());
+    tFile = GetObjFile(stemplate->shape.constFirst());
     for (float i = 0; i < line.length; i += 0.65) {
         line.getDrawPosition(posRot, i);
         Quat::fill(qr);
@@ -551,16 +589,12 @@ void ProceduralShape::GenTie(ShapeTemplateElement *stemplate, QVector<OglObj*> &
         PushShapePart(ptr, tFile, 0.155, matrix1, qr);
     }
 
-    texturePath = new QString(ProceduralShape::GetTexturePath(stemplate->texture));
-    shape.push_back(new OglObj());
-    shape.back()->setMaterial(texturePath);
-    shape.back()->init(p, ptr - p, RenderItem::VNTA, GL_TRIANGLES);
-    shape.back()->setDistanceRange(stemplate->minDistance, stemplate->maxDistance);
+    PushPart(shape, stemplate, p, ptr - p);
 
     delete[] p;
 }
 
-void ProceduralShape::GenAdvancedTie(ShapeTemplateElement *stemplate, QVector<OglObj*>& shape, TrackShape* tsh, QMap<int, float>& angles) {
+void ProceduralShape::GenAdvancedTie(ShapeTemplateElement *stemplate, QVector<ProceduralPart>& shape, TrackShape* tsh, QMap<int, float>& angles) {
 
     float matrixS[16];
     float matrixS1[16];
@@ -573,14 +607,18 @@ void ProceduralShape::GenAdvancedTie(ShapeTemplateElement *stemplate, QVector<Og
 
         QVector<TSection> sections1;
         QVector<TSection> sections2;
+        // Runs on generator threads, find() doesn't insert into the map.
+        std::unordered_map<int, TSection*> &sekcja = Game::currentRoute->tsection->sekcja;
         for (int i = 0; i < section->n; i++) {
-            if (Game::currentRoute->tsection->sekcja[(int) section->sect[i]] != NULL)
-                sections1.push_back(*Game::currentRoute->tsection->sekcja[(int) section->sect[i]]);
+            auto it = sekcja.find((int) section->sect[i]);
+            if (it != sekcja.end() && it->second != NULL)
+                sections1.push_back(*it->second);
         }
         section = &tsh->path[1];
         for (int i = 0; i < section->n; i++) {
-            if (Game::currentRoute->tsection->sekcja[(int) section->sect[i]] != NULL)
-                sections2.push_back(*Game::currentRoute->tsection->sekcja[(int) section->sect[i]]);
+            auto it = sekcja.find((int) section->sect[i]);
+            if (it != sekcja.end() && it->second != NULL)
+                sections2.push_back(*it->second);
         }
         //float* p = new float[4000000];
         //float* ptr = p;
@@ -621,7 +659,7 @@ void ProceduralShape::GenAdvancedTie(ShapeTemplateElement *stemplate, QVector<Og
             junct = true;
 
         primitives.push_back(QVector<ShapePrimitive>());
-        tFile = GetObjFile(stemplate->shape.first());
+        tFile = GetObjFile(stemplate->shape.constFirst());
         float length = line1.length;
         ComplexLine *line3 = &line2;
         int pathidx = 1;
@@ -825,7 +863,6 @@ void ProceduralShape::GenAdvancedTie(ShapeTemplateElement *stemplate, QVector<Og
 
     float* p = new float[4000000];
     float* ptr = p;
-    QString* texturePath;
 
     for (int i = 0; i < primitives.count(); i++) {
         for (int j = 0; j < (primitives[i]).count(); j++) {
@@ -836,11 +873,7 @@ void ProceduralShape::GenAdvancedTie(ShapeTemplateElement *stemplate, QVector<Og
         }
     }
 
-    texturePath = new QString(ProceduralShape::GetTexturePath(stemplate->texture));
-    shape.push_back(new OglObj());
-    shape.back()->setMaterial(texturePath);
-    shape.back()->init(p, ptr - p, RenderItem::VNTA, GL_TRIANGLES);
-    shape.back()->setDistanceRange(stemplate->minDistance, stemplate->maxDistance);
+    PushPart(shape, stemplate, p, ptr - p);
     
     delete[] p;
 }
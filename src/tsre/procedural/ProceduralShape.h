@@ -13,6 +13,8 @@
 
 #include <QMap>
 #include <QString>
+#include <QThreadPool>
+#include <functional>
 #include <tsre/ogl/OglObj.h>
 #include <tsre/tdb/TSection.h>
 
@@ -36,6 +38,17 @@ struct ShapePrimitive {
     float rotZ = 0;
 };
 
+/*
+ * Generated vertex data of one shape part, made on worker threads
+ * and turned into OglObj on the main thread.
+ */
+struct ProceduralPart {
+    QString texture;
+    float minDistance = 0;
+    float maxDistance = 2000;
+    QVector<float> data;
+};
+
 class ProceduralShape {
 public:
     static ShapeTemplates *ShapeTemplateFile;
@@ -54,6 +67,11 @@ public:
 private:
     static float Alpha;
     static unsigned int ShapeCount;
+    static QThreadPool *GenPool;
+    
+    static void RunJobs(QVector<std::function<void()>> &jobs);
+    static void CreateShape(QString hash, QVector<ProceduralPart> &parts, QVector<OglObj*> &shape);
+    static void PushPart(QVector<ProceduralPart> &shape, ShapeTemplateElement *stemplate, float* p, int count);
     
     static ObjFile* GetObjFile(QString name);
     static QString GetTexturePath(QString textureName);
@@ -61,23 +79,23 @@ private:
     static QString GetShapeHash(QString templateName, QVector<TSection> &sections, int shapeOffset);
     static QString GetShapeHash(QString templateName, ComplexLine &line, int shapeOffset);
     
-    static void GenShape(QString templateName, QVector<OglObj*> &shape, QVector<TSection> &sections, int shapeOffset);
-    static void GenShape(QString templateName, QVector<OglObj*> &shape, TrackShape* tsh, QMap<int, float> &angles);
-    static void GenShape(QString templateName, QVector<OglObj*> &shape, ComplexLine &line, int shapeOffset);
+    static void GenShape(QString templateName, QVector<ProceduralPart> &shape, QVector<TSection> &sections, int shapeOffset);
+    static void GenShape(QString templateName, QVector<ProceduralPart> &shape, TrackShape* tsh, QMap<int, float> &angles);
+    static void GenShape(QString templateName, QVector<ProceduralPart> &shape, ComplexLine &line, int shapeOffset);
     
-    static void GenRails(ShapeTemplateElement *stemplate, QVector<OglObj*> &shape, ComplexLine &line);
-    static void GenRails(ShapeTemplateElement *stemplate, QVector<OglObj*> &shape, ComplexLine &line, float *sPos, float sAngle, float angleB, float angleE);
+    static void GenRails(ShapeTemplateElement *stemplate, QVector<ProceduralPart> &shape, ComplexLine &line);
+    static void GenRails(ShapeTemplateElement *stemplate, QVector<ProceduralPart> &shape, ComplexLine &line, float *sPos, float sAngle, float angleB, float angleE);
     
-    static void GenBallast(ShapeTemplateElement *stemplate, QVector<OglObj*> &shape, ComplexLine &line);
-    static void GenBallast(ShapeTemplateElement *stemplate, QVector<OglObj*> &shape, ComplexLine &line, float *sPos, float sAngle, float angleB, float angleE);
+    static void GenBallast(ShapeTemplateElement *stemplate, QVector<ProceduralPart> &shape, ComplexLine &line);
+    static void GenBallast(ShapeTemplateElement *stemplate, QVector<ProceduralPart> &shape, ComplexLine &line, float *sPos, float sAngle, float angleB, float angleE);
     
-    static void GenTie(ShapeTemplateElement *stemplate, QVector<OglObj*> &shape, ComplexLine &line);
-    static void GenTie(ShapeTemplateElement *stemplate, QVector<OglObj*> &shape, ComplexLine &line, float *sPos, float sAngle, float angleB, float angleE);
+    static void GenTie(ShapeTemplateElement *stemplate, QVector<ProceduralPart> &shape, ComplexLine &line);
+    static void GenTie(ShapeTemplateElement *stemplate, QVector<ProceduralPart> &shape, ComplexLine &line, float *sPos, float sAngle, float angleB, float angleE);
     
-    static void GenStretch(ShapeTemplateElement *stemplate, QVector<OglObj*> &shape, ComplexLine &line, int shapeOffset = 0);
-    static void GenPointShape(ShapeTemplateElement *stemplate, QVector<OglObj*> &shape, ComplexLine &line, int shapeOffset = 0);
+    static void GenStretch(ShapeTemplateElement *stemplate, QVector<ProceduralPart> &shape, ComplexLine &line, int shapeOffset = 0);
+    static void GenPointShape(ShapeTemplateElement *stemplate, QVector<ProceduralPart> &shape, ComplexLine &line, int shapeOffset = 0);
     
-    static void GenAdvancedTie(ShapeTemplateElement *stemplate, QVector<OglObj*> &shape, TrackShape* tsh, QMap<int, float> &angles);
+    static void GenAdvancedTie(ShapeTemplateElement *stemplate, QVector<ProceduralPart> &shape, TrackShape* tsh, QMap<int, float> &angles);
     
     static void PushShapePart(float* &ptr, ObjFile* tFile, float offsetY, float* matrix, float* qrot, float distance = 0);
     static void PushShapePartExpand(float* &ptr, ObjFile* tFile, float offsetY, float* matrix1, float* matrix2, float* qrot, float dist1, float dist2);
@@ -0,0 +1,45 @@
+/*  This file is part of TSRE5.
+ *
+ *  TSRE5 - train sim game engine and MSTS/OR Editors. 
+ *  Copyright (C) 2016 Piotr Gadecki <pgadecki@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later. 
+ *
+ *  See LICENSE.md or https://www.gnu.org/licenses/gpl.html
+ */
+
+#include <tsre/renderer/FrameArena.h>
+#include <cstddef>
+
+FrameArena::FrameArena() {
+}
+
+FrameArena::~FrameArena() {
+    for(unsigned int i = 0; i < blocks.size(); i++)
+        delete[] blocks[i];
+}
+
+float* FrameArena::alloc(int count) {
+    if(count <= 0 || count > BlockSize)
+        return NULL;
+    if(blocks.size() == 0)
+        blocks.push_back(new float[BlockSize]);
+    if(used + count > BlockSize){
+        block++;
+        used = 0;
+        if(block >= (int)blocks.size())
+            blocks.push_back(new float[BlockSize]);
+    }
+    float* out = blocks[block] + used;
+    used += count;
+    return out;
+}
+
+void FrameArena::reset() {
+    block = 0;
+    used = 0;
+}
+
+int FrameArena::blockCount() const {
+    return blocks.size();
+}
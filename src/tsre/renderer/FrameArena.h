@@ -0,0 +1,40 @@
+/*  This file is part of TSRE5.
+ *
+ *  TSRE5 - train sim game engine and MSTS/OR Editors. 
+ *  Copyright (C) 2016 Piotr Gadecki <pgadecki@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later. 
+ *
+ *  See LICENSE.md or https://www.gnu.org/licenses/gpl.html
+ */
+
+#ifndef FRAMEARENA_H
+#define	FRAMEARENA_H
+
+#include <vector>
+
+/*
+ * Linear float allocator for data that lives until the end of a frame.
+ * Memory is taken from fixed size blocks, so returned pointers stay valid
+ * until reset(). reset() only rewinds, blocks are reused next frame.
+ */
+class FrameArena {
+public:
+    static const int BlockSize = 16*4096;
+
+    FrameArena();
+    FrameArena(const FrameArena& orig) = delete;
+    FrameArena& operator=(const FrameArena& orig) = delete;
+    virtual ~FrameArena();
+    float* alloc(int count);
+    void reset();
+    int blockCount() const;
+
+private:
+    std::vector<float*> blocks;
+    int block = 0;
+    int used = 0;
+};
+
+#endif	/* FRAMEARENA_H */
+
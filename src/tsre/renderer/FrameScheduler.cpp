@@ -0,0 +1,123 @@
+/*  This file is part of TSRE5.
+ *
+ *  TSRE5 - train sim game engine and MSTS/OR Editors. 
+ *  Copyright (C) 2016 Piotr Gadecki <pgadecki@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later. 
+ *
+ *  See LICENSE.md or https://www.gnu.org/licenses/gpl.html
+ */
+
+
+#include <tsre/renderer/FrameScheduler.h>
+#include <tsre/shape/ShapeLoader.h>
+#include <tsre/shape/ShapeLib.h>
+#include <tsre/texture/TexLib.h>
+#include <tsre/texture/TexLoader.h>
+#include <tsre/texture/PixelKernels.h>
+#include <tsre/world/TileStreamer.h>
+#include <tsre/Game.h>
+
+// Percent of Game::frameWorkBudget each priority may use.
+const int FrameScheduler::Share[FrameScheduler::PriorityCount] = { 100, 75, 50 };
+QElapsedTimer FrameScheduler::Clock;
+qint64 FrameScheduler::used = 0;
+int FrameScheduler::ran[FrameScheduler::PriorityCount] = { 0, 0, 0 };
+int FrameScheduler::waiting[FrameScheduler::PriorityCount] = { 0, 0, 0 };
+QHash<const void*, unsigned long long> FrameScheduler::deferred[FrameScheduler::PriorityCount];
+
+unsigned long long FrameScheduler::frames = 0;
+unsigned long long FrameScheduler::overrunFrames = 0;
+qint64 FrameScheduler::overrunTime = 0;
+qint64 FrameScheduler::maxOverrun = 0;
+qint64 FrameScheduler::totalUsed[FrameScheduler::PriorityCount] = { 0, 0, 0 };
+unsigned long long FrameScheduler::totalRan[FrameScheduler::PriorityCount] = { 0, 0, 0 };
+unsigned long long FrameScheduler::totalWaiting[FrameScheduler::PriorityCount] = { 0, 0, 0 };
+int FrameScheduler::maxWaiting[FrameScheduler::PriorityCount] = { 0, 0, 0 };
+
+void FrameScheduler::nextFrame(){
+    frames++;
+    qint64 budget = (qint64)Game::frameWorkBudget*1000;
+    if(budget > 0 && used > budget){
+        overrunFrames++;
+        overrunTime += used - budget;
+        if(used - budget > maxOverrun)
+            maxOverrun = used - budget;
+    }
+    for(int i = 0; i < PriorityCount; i++){
+        totalRan[i] += ran[i];
+        if(waiting[i] > maxWaiting[i])
+            maxWaiting[i] = waiting[i];
+        ran[i] = 0;
+        waiting[i] = 0;
+        // Jobs that did not ask in the last frame are gone or not needed,
+        // if they ask again they count as deferred again.
+        for(auto it = deferred[i].begin(); it != deferred[i].end();){
+            if(it.value() + 1 < frames)
+                it = deferred[i].erase(it);
+            else
+                ++it;
+        }
+    }
+    used = 0;
+}
+
+/*
+ * Returns a start time to pass to end(), or -1 when the work
+ * has to wait for a later frame.
+ */
+qint64 FrameScheduler::begin(int priority, const void* job, bool force){
+    if(!Clock.isValid())
+        Clock.start();
+    if(priority < 0 || priority >= PriorityCount)
+        priority = Background;
+    // Always let the first job of a frame through, so big jobs still get done.
+    if(!force && !Game::ignoreLoadLimits && Game::frameWorkBudget > 0 && used > 0
+            && used >= (qint64)Game::frameWorkBudget*10*Share[priority]){
+        auto it = deferred[priority].find(job);
+        if(it == deferred[priority].end()){
+            deferred[priority].insert(job, frames);
+            totalWaiting[priority]++;
+            waiting[priority]++;
+        } else if(it.value() != frames){
+            it.value() = frames;
+            waiting[priority]++;
+        }
+        return -1;
+    }
+    if(!deferred[priority].isEmpty())
+        deferred[priority].remove(job);
+    ran[priority]++;
+    return Clock.nsecsElapsed();
+}
+
+void FrameScheduler::end(int priority, qint64 start){
+    if(start < 0)
+        return;
+    if(priority < 0 || priority >= PriorityCount)
+        priority = Background;
+    qint64 time = Clock.nsecsElapsed() - start;
+    used += time;
+    totalUsed[priority] += time;
+}
+
+QString FrameScheduler::GetStatistics(){
+    static const char* names[PriorityCount] = { "uploads", "builds", "background" };
+    const double ms = 1000000.0;
+    QString out;
+    out += QString("Frames: %1, budget %2 us\n").arg(frames).arg(Game::frameWorkBudget);
+    out += QString("Over budget: %1 frames, %2 ms total, %3 ms max\n")
+            .arg(overrunFrames).arg(overrunTime/ms, 0, 'f', 2).arg(maxOverrun/ms, 0, 'f', 2);
+    for(int i = 0; i < PriorityCount; i++){
+        out += QString("  %1: %2 jobs, %3 ms, %4 deferred (max %5 in a frame)\n")
+                .arg(names[i]).arg(totalRan[i]).arg(totalUsed[i]/ms, 0, 'f', 2)
+                .arg(totalWaiting[i]).arg(maxWaiting[i]);
+    }
+    out += QString("Queued: %1 shapes, %2 textures, %3 tiles\n")
+            .arg(ShapeLoader::pendingCount()).arg(TexLoader::pendingCount()).arg(TileStreamer::pendingCount());
+    const double mb = 1024.0*1024.0;
+    out += QString("Resident textures: %1 MB / %2 MB\n").arg(TexLib::ResidentBytes/mb, 0, 'f', 2).arg(Game::textureMemoryLimit);
+    out += QString("Resident shapes: %1 MB / %2 MB\n").arg(ShapeLib::ResidentBytes/mb, 0, 'f', 2).arg(Game::shapeMemoryLimit);
+    out += QString("Pixel kernels: %1\n").arg(PixelKernels::levelName());
+    return out;
+}
@@ -0,0 +1,62 @@
+/*  This file is part of TSRE5.
+ *
+ *  TSRE5 - train sim game engine and MSTS/OR Editors. 
+ *  Copyright (C) 2016 Piotr Gadecki <pgadecki@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later. 
+ *
+ *  See LICENSE.md or https://www.gnu.org/licenses/gpl.html
+ */
+
+
+#ifndef FRAMESCHEDULER_H
+#define	FRAMESCHEDULER_H
+
+#include <QElapsedTimer>
+#include <QString>
+#include <QHash>
+
+/*
+ * Time budget for deferred work done on the GL thread during a frame.
+ * Work asks begin() before running and reports with end() after.
+ * Each priority may run until its share of Game::frameWorkBudget
+ * microseconds is spent, lower priorities get a smaller share so
+ * uploads of visible data are not starved by builds.
+ * Refused work stays where it is and asks again next frame.
+ * job identifies the work, so a job refused many times counts as one
+ * deferred job in the statistics.
+ */
+class FrameScheduler {
+public:
+    enum Priority {
+        Upload = 0,     // shape VBO and texture uploads
+        Build = 1,      // forest, transfer and shape builds, streamed tiles
+        Background = 2, // TDB line rebuilds
+        PriorityCount = 3
+    };
+
+    static void nextFrame();
+    static qint64 begin(int priority, const void* job, bool force = false);
+    static void end(int priority, qint64 start);
+    static QString GetStatistics();
+
+private:
+    static const int Share[PriorityCount];
+    static QElapsedTimer Clock;
+    static qint64 used;
+    static int ran[PriorityCount];
+    static int waiting[PriorityCount];
+    // Deferred jobs and the last frame they were refused in.
+    static QHash<const void*, unsigned long long> deferred[PriorityCount];
+
+    static unsigned long long frames;
+    static unsigned long long overrunFrames;
+    static qint64 overrunTime;
+    static qint64 maxOverrun;
+    static qint64 totalUsed[PriorityCount];
+    static unsigned long long totalRan[PriorityCount];
+    static unsigned long long totalWaiting[PriorityCount];
+    static int maxWaiting[PriorityCount];
+};
+
+#endif	/* FRAMESCHEDULER_H */
@@ -15,7 +15,11 @@
 #include <tsre/renderer/RenderItem.h>
 #include <tsre/math3d/GLMatrix.h>
 #include <QOpenGLFunctions>
+#include <QOpenGLExtraFunctions>
+#include <QDebug>
 #include <tsre/ogl/GLUU.h>
+#include <tsre/Game.h>
+#include <algorithm>
 
 OpenGL3Renderer::OpenGL3Renderer() {
     mvMatrix = new float[16];
@@ -51,10 +55,10 @@ void OpenGL3Renderer::pushItem(RenderItem* r, float* mvmatrix){
 void OpenGL3Renderer::pushItemsVNTA(QVector<RenderItem*>& r, float* mvmatrix){
     for(int i = 0; i < r.size(); i++){
         //r[i]->mvMatrix = Mat4::clone(mvmatrix);
-        //itemsVNTA[r[i]->texAddr].push_back(r[i]);
-        if(itemsVNTA[r[i]->texAddr][(unsigned long long int)r[i]] == NULL){
-            itemsVNTA[r[i]->texAddr][(unsigned long long int)r[i]] = r[i];
+        if(r[i]->drawFrame != drawFrame){
+            r[i]->drawFrame = drawFrame;
             r[i]->mvMatrixList.clear();
+            drawList.push_back(r[i]);
         }
         r[i]->mvMatrixList.push_back(mvmatrix);
         /*RenderItem *rr = new RenderItem();
@@ -97,50 +101,113 @@ void OpenGL3Renderer::renderFrame(){
     gluu->enableTextures();
     f = QOpenGLContext::currentContext()->functions();
     
-    QHashIterator<unsigned int, QHash<unsigned long long int, RenderItem*>> it(itemsVNTA);
-    //QHashIterator<unsigned int, QVector<RenderItem*>> it(itemsVNTA);
-    while (it.hasNext()) {
-        it.next();
-        f->glBindTexture(GL_TEXTURE_2D, it.key());
-        
-        QHashIterator<unsigned long long int, RenderItem*> it2(itemsVNTA[it.key()]);
-        //for (int i = 0; i < it.value().size(); ++i) {
-        while (it2.hasNext()) {
-            it2.next();
-            if(it2.value() == NULL)
-                continue;
-            QOpenGLVertexArrayObject::Binder vaoBinder(it2.value()->VAO);
-            //itemsVNTA[i]->VBO->bind();
-            //f->glBindTexture(GL_TEXTURE_2D, it2.value()->texAddr);
-            gluu->currentShader->setUniformValue(gluu->currentShader->msMatrixUniform, *reinterpret_cast<float(*)[4][4]>(it2.value()->msMatrix));
-            //gluu->currentShader->setUniformValue(gluu->currentShader->mvMatrixUniform, *reinterpret_cast<float(*)[4][4]>(it2.value()->mvMatrix));
-
-            for(int i = 0; i < it2.value()->mvMatrixList.size(); i++){
-                gluu->currentShader->setUniformValue(gluu->currentShader->mvMatrixUniform, *reinterpret_cast<float(*)[4][4]>(it2.value()->mvMatrixList[i]));
-                f->glDrawArrays(GL_TRIANGLES, it2.value()->vertOffset, it2.value()->vertCount);
-            }
-            //if(!itemsVNTA[it.key()]->shared)
-            //    delete itemsVNTA[it.key()];
+    bool instanced = useInstancing();
+    sortDrawList(instanced);
+    if(instanced){
+        if(!instanceVBO.isCreated()){
+            instanceVBO.create();
+            instanceVBO.setUsagePattern(QOpenGLBuffer::StreamDraw);
         }
-        /*for (int i = 0; i < it.value().size(); ++i) {
-            QOpenGLVertexArrayObject::Binder vaoBinder(it.value()[i]->VAO);
-            gluu->currentShader->setUniformValue(gluu->currentShader->msMatrixUniform, *reinterpret_cast<float(*)[4][4]>(it.value()[i]->msMatrix));
-            gluu->currentShader->setUniformValue(gluu->currentShader->mvMatrixUniform, *reinterpret_cast<float(*)[4][4]>(it.value()[i]->mvMatrix));
-            f->glDrawArrays(GL_TRIANGLES, it.value()[i]->vertOffset, it.value()[i]->vertCount);
-            if(!itemsVNTA[it.key()][i]->shared)
-                delete itemsVNTA[it.key()][i];
-        }*/
-        itemsVNTA[it.key()].clear();
+        instanceVBO.bind();
+        instanceVBO.allocate(instanceData.constData(), instanceData.size() * sizeof(GLfloat));
+        instanceVBO.release();
+        gluu->currentShader->setUniformValue(gluu->currentShader->shaderInstanced, 1);
     }
-    
-    itemsVNTA.clear();
+
+    unsigned int texAddr = 0;
+    int first = 0;
+    for(int i = 0; i < drawList.size(); i++){
+        RenderItem* r = drawList[i];
+        if(i == 0 || r->texAddr != texAddr){
+            texAddr = r->texAddr;
+            f->glBindTexture(GL_TEXTURE_2D, texAddr);
+        }
+        QOpenGLVertexArrayObject::Binder vaoBinder(r->VAO);
+        gluu->currentShader->setUniformValue(gluu->currentShader->msMatrixUniform, *reinterpret_cast<float(*)[4][4]>(r->msMatrix));
+        if(instanced){
+            drawInstanced(r, first);
+            first += r->mvMatrixList.size();
+            continue;
+        }
+        for(int j = 0; j < r->mvMatrixList.size(); j++){
+            gluu->currentShader->setUniformValue(gluu->currentShader->mvMatrixUniform, *reinterpret_cast<float(*)[4][4]>(r->mvMatrixList[j]));
+            f->glDrawArrays(GL_TRIANGLES, r->vertOffset, r->vertCount);
+        }
+    }
+    if(instanced)
+        gluu->currentShader->setUniformValue(gluu->currentShader->shaderInstanced, 0);
+
+    endFrame();
+}
+
+/*
+ * Sorts the draw list by texture and VAO. With instancing all matrices
+ * of the frame are copied to instanceData, in draw list order.
+ */
+void OpenGL3Renderer::sortDrawList(bool instanced){
+    std::sort(drawList.begin(), drawList.end(), drawLess);
+    if(!instanced)
+        return;
+    int count = 0;
+    for(int i = 0; i < drawList.size(); i++)
+        count += drawList[i]->mvMatrixList.size();
+    instanceData.resize(count*16);
+    float* out = instanceData.data();
+    for(int i = 0; i < drawList.size(); i++)
+        for(int j = 0; j < drawList[i]->mvMatrixList.size(); j++, out += 16)
+            std::copy(drawList[i]->mvMatrixList[j], drawList[i]->mvMatrixList[j] + 16, out);
+}
+
+// Drops the items of the frame and rewinds the matrix arena.
+void OpenGL3Renderer::endFrame(){
+    drawList.clear();
+    drawFrame++;
     mvMatrixs.clear();
     
-    for(int i=0; i<mvMatrixDelete.size(); i++){
-        delete[] mvMatrixDelete[i];
-    }
-    mvMatrixDelete.clear();
+    matrixArena.reset();
 }
 
+bool OpenGL3Renderer::drawLess(const RenderItem* a, const RenderItem* b){
+    if(a->texAddr != b->texAddr)
+        return a->texAddr < b->texAddr;
+    if(a->VAO != b->VAO)
+        return a->VAO < b->VAO;
+    return a->vertOffset < b->vertOffset;
+}
 
+// Instancing needs GL 3.3 / ES 3.0 or ARB_instanced_arrays, and a shader
+// that reads instanceMVMatrix. Otherwise each instance is drawn on its own.
+// Off by default, the stock shaders in appdata don't read instanceMVMatrix yet.
+bool OpenGL3Renderer::useInstancing(){
+    if(!Game::instancedDrawing)
+        return false;
+    QOpenGLContext *context = QOpenGLContext::currentContext();
+    if(instancingSupported < 0){
+        QSurfaceFormat format = context->format();
+        if(context->isOpenGLES())
+            instancingSupported = format.version() >= qMakePair(3, 0);
+        else
+            instancingSupported = format.version() >= qMakePair(3, 3) || context->hasExtension("GL_ARB_instanced_arrays");
+        qDebug() << "OpenGL3Renderer: instanced drawing" << (instancingSupported == 1);
+    }
+    if(instancingSupported == 0)
+        return false;
+    return GLUU::get()->currentShader->instanceMVMatrixAttribute >= 0;
+}
 
+void OpenGL3Renderer::drawInstanced(RenderItem* r, int first){
+    QOpenGLExtraFunctions *ef = QOpenGLContext::currentContext()->extraFunctions();
+    int loc = GLUU::get()->currentShader->instanceMVMatrixAttribute;
+    instanceVBO.bind();
+    for(int i = 0; i < 4; i++){
+        ef->glEnableVertexAttribArray(loc + i);
+        ef->glVertexAttribPointer(loc + i, 4, GL_FLOAT, GL_FALSE, 16 * sizeof(GLfloat),
+                reinterpret_cast<void *>((first * 16 + i * 4) * sizeof(GLfloat)));
+        ef->glVertexAttribDivisor(loc + i, 1);
+    }
+    instanceVBO.release();
+    ef->glDrawArraysInstanced(GL_TRIANGLES, r->vertOffset, r->vertCount, r->mvMatrixList.size());
+    // VAOs are also drawn directly by shapes, leave them without instance arrays.
+    for(int i = 0; i < 4; i++)
+        ef->glDisableVertexAttribArray(loc + i);
+}
@@ -17,6 +17,7 @@
 #include <QOpenGLBuffer>
 
 class QOpenGLFunctions;
+class QOpenGLExtraFunctions;
 
 class OpenGL3Renderer : public Renderer {
 public:
@@ -27,9 +28,18 @@ public:
     void pushItem(RenderItem *r, float* mvmatrix);
     void pushItemsVNTA(QVector<RenderItem*>& r, float* mvmatrix);
     void pushItemVNTA(RenderItem *r, float* mvmatrix);
+    void sortDrawList(bool instanced);
+    void endFrame();
+    // Model-view matrices of the frame in draw list order, for instancing.
+    QVector<float> instanceData;
 private:
     QOpenGLVertexArrayObject VAO;
     QOpenGLFunctions *f;
+    QOpenGLBuffer instanceVBO;
+    int instancingSupported = -1;
+    static bool drawLess(const RenderItem* a, const RenderItem* b);
+    bool useInstancing();
+    void drawInstanced(RenderItem* r, int first);
 };
 
 #endif /* OPENGL3RENDERER_H */
@@ -31,6 +31,7 @@ public:
     float *mvMatrix = 0;
     QVector<float*> mvMatrixList;
     unsigned int mvMatrixId = -1;
+    unsigned int drawFrame = 0;
     unsigned char normalsEnabled = 0;
     unsigned char texturesEnabled = 0;
     float brightness = 1.0;
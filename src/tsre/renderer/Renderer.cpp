@@ -31,15 +31,18 @@ void Renderer::pushItemsVNTA(QVector<RenderItem*>& r, float* mvmatrix){
 void Renderer::pushItemVNTA(RenderItem* r, float* mvmatrix){
 }
 
+// Pushed matrices come from matrixArena and stay valid until the end of
+// the frame, render items keep pointers to them in mvMatrixList.
 void Renderer::mvPushMatrix() {
-    mvMatrixStack[imvMatrixStack++] = Mat4::clone(mvMatrix);
+    float* m = matrixArena.alloc(16);
+    Mat4::copy(m, mvMatrix);
+    mvMatrixStack[imvMatrixStack++] = mvMatrix;
+    mvMatrix = m;
 }
 
 void Renderer::mvPopMatrix() {
-    if (--imvMatrixStack < 0) return;
-    //delete[] mvMatrix;
-    mvMatrixDelete.push_back(mvMatrix);
-    mvMatrix = mvMatrixStack[imvMatrixStack];
+    if (imvMatrixStack <= 0) return;
+    mvMatrix = mvMatrixStack[--imvMatrixStack];
 }
 
 void Renderer::renderFrame(){
@@ -13,6 +13,7 @@
 
 #include <QVector>
 #include <QHash>
+#include <tsre/renderer/FrameArena.h>
 
 class RenderItem;
 
@@ -26,7 +27,7 @@ public:
     float* objStrMatrix = NULL;
     float* mvMatrix = NULL;
     float* mvMatrixStack[1000];
-    QVector<float*> mvMatrixDelete;
+    FrameArena matrixArena;
     int imvMatrixStack = 0;
     Renderer();
     Renderer(const Renderer& orig);
@@ -38,8 +39,9 @@ public:
     void mvPopMatrix();
     QVector<RenderItem*> items; 
     QVector<float*> mvMatrixs;
-    //QHash<unsigned int, QVector<RenderItem*>> itemsVNTA;
-    QHash<unsigned int, QHash<unsigned long long int, RenderItem*>> itemsVNTA; 
+    // Items pushed this frame, sorted by texture and VAO before drawing.
+    QVector<RenderItem*> drawList;
+    unsigned int drawFrame = 1;
     virtual void renderFrame();
 private:
    
@@ -17,9 +17,11 @@
 #include <QDebug>
 #include <QtCore>
 #include <iostream>
+#include <cfloat>
 #include <QOpenGLShaderProgram>
 #include <tsre/ogl/GLUU.h>
 #include <tsre/math3d/GLMatrix.h>
+#include <tsre/math3d/Intersections.h>
 #include <QString>
 #include <tsre/Game.h>
 #include <tsre/fileFunctions/TS.h>
@@ -28,6 +30,11 @@
 #include <shapeViewer/ContentHierarchyInfo.h>
 #include <tsre/renderer/RenderItem.h>
 #include <tsre/renderer/Renderer.h>
+#include <tsre/shape/ShapeLoader.h>
+#include <tsre/shape/ShapeLib.h>
+#include <tsre/texture/TexLoader.h>
+#include <tsre/renderer/FrameScheduler.h>
+#include <tsre/ogl/OglObj.h>
 
 SFile::SFile() {
     pathid = "";
@@ -50,15 +57,28 @@ SFile::~SFile() {
 }
 
 void SFile::load() {
+    if(loadData()){
+        uploadGeometry();
+        loaded = 1;
+    }
+}
+
+void SFile::loadThreaded() {
+    loadParsed = loadData();
+    loadState.storeRelease(LoadParsed);
+}
+
+bool SFile::loadData() {
     //unsigned long long int timeNow = QDateTime::currentMSecsSinceEpoch();
     QFile *file = new QFile(pathid);
     if (!file->open(QIODevice::ReadOnly)){
         qDebug() << "S Shape: not exist "<<pathid;
         file->close();
-        return;
+        return false;
     }
     FileBuffer* data = ReadFile::read(file);
     int loadingCount = 0;
+    bool parsed = false;
     //qDebug() << "--" << pathid << "--" << data->length;
 
     data->off = 32;
@@ -88,6 +108,7 @@ void SFile::load() {
                     loadingCount++;
                     SFileC::odczytajpunktyc(data, this);
                     getSize();
+                    loadState.storeRelease(LoadBound);
                     break;
                 case 9:
                     loadingCount++;
@@ -130,10 +151,10 @@ void SFile::load() {
                 case 31:
                     if(loadingCount < 9){
                         qDebug() << "#shape - loading error" << 31 << TS::IdName[31];
-                        return;
+                        return false;
                     }
                     SFileC::odczytajloddc(data, this);
-                    loaded = 1;
+                    parsed = true;
                     break;
                 case 29:
                     int pozycja1,offset1,akto1,some_val;
@@ -176,10 +197,10 @@ void SFile::load() {
         data->off = 0;
         ParserX::NextLine(data);
 
-        QString sh = "";
-        while (!((sh = ParserX::NextTokenInside(data).toLower()) == "")) {
+        ParserX::Token sh;
+        while (!((sh = ParserX::NextTokenView(data)).isEmpty())) {
             if(sh == "shape"){
-                while (!((sh = ParserX::NextTokenInside(data).toLower()) == "")) {
+                while (!((sh = ParserX::NextTokenView(data)).isEmpty())) {
                     //qDebug() << sh;
                     if(sh == "shader_names"){
                         SFileX::odczytajshaders(data, this);
@@ -190,6 +211,7 @@ void SFile::load() {
                     if(sh == "points"){
                         SFileX::odczytajpunkty(data, this);
                         getSize();
+                        loadState.storeRelease(LoadBound);
                         loadingCount++;
                         ParserX::SkipToken(data);
                         continue;
@@ -269,15 +291,15 @@ void SFile::load() {
                     if(sh == "lod_controls"){
                         if(loadingCount < 9){
                             qDebug() << "#shape - loading error" << sh;
-                            return;
+                            return false;
                         }
                         SFileX::odczytajlodd(data, this);
-                        loaded = 1;
+                        parsed = true;
                         ParserX::SkipToken(data);
                         continue;
                     }
                     if(sh == "animations"){
-                        while (!((sh = ParserX::NextTokenInside(data).toLower()) == "")) {
+                        while (!((sh = ParserX::NextTokenView(data)).isEmpty())) {
                             if(sh == "animation"){
                                 animations.push_back(Animation());
                                 animations.back().loadX(data);
@@ -310,11 +332,224 @@ void SFile::load() {
     }
     delete data;
     file->close();
-    if(loaded == 1)
+    if(parsed)
         buildFrameIds();
     loadSd();
     //qDebug() <<this->pathid << QDateTime::currentMSecsSinceEpoch() - timeNow;
-    return;
+    return parsed;
+}
+
+void SFile::uploadGeometry() {
+    QOpenGLFunctions *f = QOpenGLContext::currentContext()->functions();
+    buildPickTriangles();
+    memoryBytes = pickTriangles.size()*sizeof(float);
+    memoryBytes += (tpoints.ipoints + tpoints.iuv_points + tpoints.inormals)*sizeof(fpoint);
+    for (int j = 0; j < iloscd; j++) {
+        for (int ii = 0; ii < distancelevel[j].iloscs; ii++) {
+            sub &s = distancelevel[j].subobiekty[ii];
+            if(s.vertexData == NULL)
+                continue;
+            s.VAO.create();
+            QOpenGLVertexArrayObject::Binder vaoBinder(&s.VAO);
+
+            s.VBO.create();
+            s.VBO.bind();
+            s.VBO.allocate(s.vertexData, s.vertexCount * 9 * sizeof(GLfloat));
+            memoryBytes += s.vertexCount * 9 * sizeof(GLfloat);
+            f->glEnableVertexAttribArray(0);
+            f->glEnableVertexAttribArray(1);
+            f->glEnableVertexAttribArray(2);
+            f->glEnableVertexAttribArray(3);
+            f->glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(GLfloat), 0);
+            f->glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(GLfloat), reinterpret_cast<void *>(3 * sizeof(GLfloat)));
+            f->glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 9 * sizeof(GLfloat), reinterpret_cast<void *>(6 * sizeof(GLfloat)));
+            f->glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, 9 * sizeof(GLfloat), reinterpret_cast<void *>(8 * sizeof(GLfloat)));
+            s.VBO.release();
+
+            delete[] s.vertexData;
+            s.vertexData = NULL;
+        }
+    }
+    ShapeLib::ResidentBytes += memoryBytes;
+}
+
+/*
+ * Frees GL buffers and parsed data, and releases the textures to TexLib.
+ * SFile itself stays in ShapeLib, loadStep() loads it again when drawn.
+ */
+void SFile::unload() {
+    if(loaded != 1)
+        return;
+    for (int i = 0; i < ilosci; i++) {
+        if(image[i].tex >= 0)
+            TexLib::delRef(image[i].tex);
+    }
+    for (int j = 0; j < iloscd; j++) {
+        for (int ii = 0; ii < distancelevel[j].iloscs; ii++) {
+            sub &s = distancelevel[j].subobiekty[ii];
+            if(s.VAO.isCreated())
+                s.VAO.destroy();
+            if(s.VBO.isCreated())
+                s.VBO.destroy();
+            delete[] s.vertexData;
+            for (int jj = 0; jj < s.iloscc; jj++)
+                delete[] s.czesci[jj].idx;
+            delete[] s.czesci;
+        }
+        delete[] distancelevel[j].subobiekty;
+        delete[] distancelevel[j].hierarchia;
+    }
+    delete[] distancelevel;
+    delete[] tpoints.points;
+    delete[] tpoints.uv_points;
+    delete[] tpoints.normals;
+    delete[] macierz;
+    delete[] image;
+    delete[] texture;
+    delete[] vtxstate;
+    delete[] primstate;
+    delete[] shader;
+    distancelevel = NULL;
+    tpoints = punlist();
+    macierz = NULL;
+    image = NULL;
+    texture = NULL;
+    vtxstate = NULL;
+    primstate = NULL;
+    shader = NULL;
+    iloscd = iloscm = ilosci = ilosct = iloscv = iloscps = ishaders = 0;
+    animations.clear();
+    pickTriangles.clear();
+    pickTriangles.squeeze();
+    pickBVH = BVH();
+    renderItems.clear();
+    requiresUpdate = false;
+    texturesPending = false;
+
+    ShapeLib::ResidentBytes -= memoryBytes;
+    memoryBytes = 0;
+    loaded = 0;
+    loadState.storeRelease(LoadNone);
+}
+
+/*
+ * Copies level 0 vertex positions with the part matrices applied,
+ * before uploadGeometry() frees the vertex data.
+ */
+void SFile::buildPickTriangles() {
+    pickTriangles.clear();
+    pickBVH = BVH();
+    if (!Game::cpuPicking || iloscd < 1)
+        return;
+    float m[16];
+    float p[3];
+    for (int ii = 0; ii < distancelevel[0].iloscs; ii++) {
+        sub &s = distancelevel[0].subobiekty[ii];
+        if(s.vertexData == NULL)
+            continue;
+        for (int j = 0; j < s.iloscc; j++) {
+            int prim_state = s.czesci[j].prim_state_idx;
+            int matrix = vtxstate[primstate[prim_state].vtx_state].matrix;
+            Mat4::identity(m);
+            getPmatrix(0, m, matrix);
+            int count = s.czesci[j].iloscv - s.czesci[j].iloscv % 3;
+            for (int k = 0; k < count; k++) {
+                Vec3::transformMat4(p, &s.vertexData[(s.czesci[j].offset + k)*9], m);
+                pickTriangles.push_back(p[0]);
+                pickTriangles.push_back(p[1]);
+                pickTriangles.push_back(p[2]);
+            }
+        }
+    }
+    pickTriangles.squeeze();
+}
+
+/*
+ * Nearest hit of a shape space ray with the level 0 geometry.
+ * Only triangles whose boxes the ray enters are tested, nearest box first.
+ */
+bool SFile::intersectRay(float* origin, float* dir, float &t) {
+    int count = pickTriangles.size()/9;
+    if (count == 0)
+        return false;
+    float* tri = pickTriangles.data();
+    if (pickBVH.size() != count) {
+        std::vector<float> boxes(count*6);
+        BVH::triangleBoxes(tri, count, 3, boxes.data());
+        pickBVH.build(boxes.data(), count);
+    }
+    std::vector<BVH::Hit> hits;
+    pickBVH.intersectRay(origin, dir, FLT_MAX, hits);
+    bool hit = false;
+    float tt;
+    for (unsigned int i = 0; i < hits.size(); i++) {
+        if (hit && hits[i].t > t)
+            break;
+        float* v = &tri[hits[i].id*9];
+        if (!Intersections::rayIntersectsTriangle(origin, dir, v, v+3, v+6, tt))
+            continue;
+        if (!hit || tt < t) {
+            t = tt;
+            hit = true;
+        }
+    }
+    return hit;
+}
+
+/*
+ * Drives loading from the render functions.
+ * Returns true when the shape became ready to draw in this call.
+ */
+bool SFile::loadStep() {
+    int s = loadState.loadAcquire();
+    if(s == LoadNone){
+        if(ShapeLoader::IsThread){
+            loadState.storeRelease(LoadQueued);
+            ShapeLoader::enqueue(this);
+            return false;
+        }
+        qint64 start = FrameScheduler::begin(FrameScheduler::Build, this);
+        if(start < 0) return false;
+        loaded = 2;
+        load();
+        FrameScheduler::end(FrameScheduler::Build, start);
+        return false;
+    }
+    if(s != LoadParsed)
+        return false;
+    if(!loadParsed){
+        loaded = 2;
+    } else {
+        qint64 start = FrameScheduler::begin(FrameScheduler::Upload, this);
+        if(start < 0)
+            return false;
+        uploadGeometry();
+        FrameScheduler::end(FrameScheduler::Upload, start);
+        loaded = 1;
+    }
+    if(placeholder != NULL){
+        placeholder->deleteVBO();
+        delete placeholder;
+        placeholder = NULL;
+    }
+    return loaded == 1;
+}
+
+/*
+ * Bounding box drawn while the shape is still loading.
+ * Only bound[] is used, the rest of the shape may be written by the loader thread.
+ */
+OglObj* SFile::getPlaceholder() {
+    if(placeholder != NULL)
+        return placeholder;
+    if(loadState.loadAcquire() < LoadBound)
+        return NULL;
+    QVector<float> points;
+    addBoxLines(bound, points);
+    placeholder = new OglObj();
+    placeholder->setMaterial(0.5, 0.5, 0.5);
+    placeholder->init(points.data(), points.size(), RenderItem::V, GL_LINES);
+    return placeholder;
 }
 
 void SFile::Animation::loadC(FileBuffer* data, int length){
@@ -420,23 +655,23 @@ void SFile::Animation::loadX(FileBuffer* data){
     frames = ParserX::GetNumber(data);
     fps = ParserX::GetNumber(data);
     
-    QString sh;
+    ParserX::Token sh;
     int count;
-    while (!((sh = ParserX::NextTokenInside(data).toLower()) == "")) {
+    while (!((sh = ParserX::NextTokenView(data)).isEmpty())) {
         if(sh == "anim_nodes"){
             count = ParserX::GetNumber(data);
-            while (!((sh = ParserX::NextTokenInside(data).toLower()) == "")) {
+            while (!((sh = ParserX::NextTokenView(data)).isEmpty())) {
                 if(sh == "anim_node"){
                     //qDebug() << 
                     ParserX::NextTokenInside(data);
                     node.push_back(AnimNode());
-                    while (!((sh = ParserX::NextTokenInside(data).toLower()) == "")) {
+                    while (!((sh = ParserX::NextTokenView(data)).isEmpty())) {
                         if(sh == "controllers"){
                             count = ParserX::GetNumber(data);
-                            while (!((sh = ParserX::NextTokenInside(data).toLower()) == "")) {
+                            while (!((sh = ParserX::NextTokenView(data)).isEmpty())) {
                                 if(sh == "tcb_rot"){
                                     count =  ParserX::GetNumber(data);
-                                    while (!((sh = ParserX::NextTokenInside(data).toLower()) == "")) {
+                                    while (!((sh = ParserX::NextTokenView(data)).isEmpty())) {
                                         if(sh == "tcb_key"){
                                             node.back().tcbKey.push_back(AnimNode::TcbKey());
                                             node.back().tcbKey.back().frame = ParserX::GetUInt(data);
@@ -467,7 +702,7 @@ void SFile::Animation::loadX(FileBuffer* data){
                                 }
                                 if(sh == "linear_pos"){
                                     count = ParserX::GetNumber(data);
-                                    while (!((sh = ParserX::NextTokenInside(data).toLower()) == "")) {
+                                    while (!((sh = ParserX::NextTokenView(data)).isEmpty())) {
                                         if(sh == "linear_key"){
                                             node.back().linearKey.push_back(AnimNode::LinearKey());
                                             node.back().linearKey.back().frame = ParserX::GetUInt(data);
@@ -513,16 +748,16 @@ void SFile::loadSd() {
     file.close();
     data->toUtf16();
     data->skipBOM();
-    QString sh;
+    ParserX::Token sh;
     
-    while (!((sh = ParserX::NextTokenInside(data).toLower()) == "")) {
+    while (!((sh = ParserX::NextTokenView(data)).isEmpty())) {
         //qDebug() << sh;
         if (sh == ("simisa@@@@@@@@@@jinx0t1t______")) {
             continue;
         }
         if (sh == ("shape")) {
             sdName = ParserX::GetString(data).trimmed();
-            while (!((sh = ParserX::NextTokenInside(data).toLower()) == "")) {
+            while (!((sh = ParserX::NextTokenView(data)).isEmpty())) {
                 if (sh == ("esd_detail_level")) {
                     esdDetailLevel = ParserX::GetNumber(data);
                     ParserX::SkipToken(data);
@@ -546,7 +781,7 @@ void SFile::loadSd() {
                     continue;
                 }
                 if (sh == ("esd_complex")) {
-                    while (!((sh = ParserX::NextTokenInside(data).toLower()) == "")) {
+                    while (!((sh = ParserX::NextTokenView(data)).isEmpty())) {
                         if (sh == ("esd_complex_box")) {
                             esdBoundingBox << EsdBoundingBox();
                             for(int i = 0; i < 3; i++){
@@ -617,35 +852,53 @@ void SFile::getSize() {
         //console.log(this.size);
     }
 
+/*
+ * Copies bound[] once the loader thread has filled it.
+ */
+bool SFile::getBound(float* out) {
+    if(loadState.loadAcquire() < LoadBound)
+        return false;
+    // Root matrix mirrors x, same as addBoxLines().
+    out[0] = -bound[1];
+    out[1] = -bound[0];
+    for(int i = 2; i < 6; i++)
+        out[i] = bound[i];
+    return true;
+}
+
+void SFile::addBoxLines(float* b, QVector<float>& points){
+    for(int i=0; i<2; i++)
+        for(int j=4; j<6; j++){
+            points.push_back(-b[i]);
+            points.push_back(b[2]);
+            points.push_back(b[j]);
+            points.push_back(-b[i]);
+            points.push_back(b[3]);
+            points.push_back(b[j]);
+        }
+    for(int i=0; i<2; i++)
+        for(int j=2; j<4; j++){
+            points.push_back(-b[i]);
+            points.push_back(b[j]);
+            points.push_back(b[4]);
+            points.push_back(-b[i]);
+            points.push_back(b[j]);
+            points.push_back(b[5]);
+        }
+    for(int i=4; i<6; i++)
+        for(int j=2; j<4; j++){
+            points.push_back(-b[0]);
+            points.push_back(b[j]);
+            points.push_back(b[i]);
+            points.push_back(-b[1]);
+            points.push_back(b[j]);
+            points.push_back(b[i]);
+        }
+}
+
 bool SFile::getBoxPoints(QVector<float>& points){
     if(this->esdBoundingBox.size() == 0){
-        for(int i=0; i<2; i++)
-            for(int j=4; j<6; j++){
-                points.push_back(-bound[i]);
-                points.push_back(bound[2]);
-                points.push_back(bound[j]);
-                points.push_back(-bound[i]);
-                points.push_back(bound[3]);
-                points.push_back(bound[j]);
-            }
-        for(int i=0; i<2; i++)
-            for(int j=2; j<4; j++){
-                points.push_back(-bound[i]);
-                points.push_back(bound[j]);
-                points.push_back(bound[4]);
-                points.push_back(-bound[i]);
-                points.push_back(bound[j]);
-                points.push_back(bound[5]);
-            }
-        for(int i=4; i<6; i++)
-            for(int j=2; j<4; j++){
-                points.push_back(-bound[0]);
-                points.push_back(bound[j]);
-                points.push_back(bound[i]);
-                points.push_back(-bound[1]);
-                points.push_back(bound[j]);
-                points.push_back(bound[i]);
-            }
+        addBoxLines(bound, points);
     } else {
         float tbound[6];
         for(int u = 0; u < this->esdBoundingBox.size(); u++ ){
@@ -655,40 +908,7 @@ bool SFile::getBoxPoints(QVector<float>& points){
             tbound[3] = this->esdBoundingBox[u].shape[4];
             tbound[4] = this->esdBoundingBox[u].shape[2];
             tbound[5] = this->esdBoundingBox[u].shape[5];
-            
-            //int pointsBeg = points.size();
-            ///////////
-            for(int i=0; i<2; i++)
-                for(int j=4; j<6; j++){
-                    points.push_back(-tbound[i]);
-                    points.push_back(tbound[2]);
-                    points.push_back(tbound[j]);
-                    points.push_back(-tbound[i]);
-                    points.push_back(tbound[3]);
-                    points.push_back(tbound[j]);
-                }
-            for(int i=0; i<2; i++)
-                for(int j=2; j<4; j++){
-                    points.push_back(-tbound[i]);
-                    points.push_back(tbound[j]);
-                    points.push_back(tbound[4]);
-                    points.push_back(-tbound[i]);
-                    points.push_back(tbound[j]);
-                    points.push_back(tbound[5]);
-                }
-            for(int i=4; i<6; i++)
-                for(int j=2; j<4; j++){
-                    points.push_back(-tbound[0]);
-                    points.push_back(tbound[j]);
-                    points.push_back(tbound[i]);
-                    points.push_back(-tbound[1]);
-                    points.push_back(tbound[j]);
-                    points.push_back(tbound[i]);
-                }
-            //int pointsEnd = points.size();
-            //for(int i = pointsBeg; i < pointsEnd; i++){
-            //    //Vec3::add(&points[i], &points[i], this->esdBoundingBox[u].translation);
-            //}
+            addBoxLines(tbound, points);
         }
     }
     return true;
@@ -817,11 +1037,13 @@ void SFile::addSnapablePoints(QVector<float> &out){
 }
 
 void SFile::reload() {
-    loaded = 0;
+    int s = loadState.loadAcquire();
+    if(loaded == 0 && s != LoadNone)
+        return;
     qDebug() << "reload";
     QStringList list;
     
-    for (int i = 0; i < distancelevel[0].iloscs; i++) {
+    for (int i = 0; iloscd > 0 && i < distancelevel[0].iloscs; i++) {
         for (int j = 0; j < distancelevel[0].subobiekty[i].iloscc; j++) {
             int prim_state = distancelevel[0].subobiekty[i].czesci[j].prim_state_idx;
 
@@ -834,6 +1056,9 @@ void SFile::reload() {
     }
     
     list.removeDuplicates();
+    unload();
+    loadState.storeRelease(LoadNone);
+    loaded = 0;
     for(QString s : list){
         qDebug() << s;
         TexLib::addTex(texPath, s, true);
@@ -901,7 +1126,7 @@ void SFile::enableSubObjByName(unsigned int stateId, QString name, bool val){
 }
 
 void SFile::updateSim(float deltaTime, unsigned int stateId){
-    if (isinit != 1 || loaded == 2)
+    if (isinit != 1 || loaded != 1)
         return;
     
     animated = false;
@@ -927,6 +1152,37 @@ void SFile::render() {
     render(0,0);
 }
 
+/*
+ * Once per frame marks the textures of the shape as used, the render
+ * items only keep their GL names.
+ */
+void SFile::stampTextures(){
+    for(int i = 0; i < ilosci; i++){
+        if(image[i].tex < 0)
+            continue;
+        auto it = TexLib::mtex.find(image[i].tex);
+        if(it != TexLib::mtex.end() && it->second != NULL)
+            it->second->lastUsed = TexLoader::Frame;
+    }
+}
+
+void SFile::touchPendingTextures(){
+    texturesPending = false;
+    for(int i = 0; i < ilosci; i++){
+        if(image[i].tex < 0 || image[i].texAddr >= 0)
+            continue;
+        Texture* t = TexLib::mtex[image[i].tex];
+        if(t == NULL || t->missing || t->error)
+            continue;
+        if(t->loaded){
+            requiresUpdate = true;
+            continue;
+        }
+        TexLib::touchTex(image[i].tex);
+        texturesPending = true;
+    }
+}
+
 void SFile::pushRenderItem(){
     pushRenderItem(0,0);
 }
@@ -934,12 +1190,14 @@ void SFile::pushRenderItem(){
 void SFile::pushRenderItem(int selectionColor, unsigned int stateId){
     if (isinit != 1 || loaded == 2)
         return;
-    if (loaded == 0) {
-        if(Game::allowObjLag < 1) return;
-        
-        Game::allowObjLag-=2;
-        loaded = 2;
-        load();
+    if (lastUsed != TexLoader::Frame) {
+        lastUsed = TexLoader::Frame;
+        stampTextures();
+    }
+    if (loaded == 0 && !loadStep()) {
+        OglObj* box = getPlaceholder();
+        if(box != NULL)
+            box->pushRenderItem(selectionColor);
         return;
     }
     
@@ -949,6 +1207,9 @@ void SFile::pushRenderItem(int selectionColor, unsigned int stateId){
             it = state[stateId].enableSubObjQueue.erase(it);
         }
     }
+    
+    if(texturesPending)
+        touchPendingTextures();
 
     if(renderItems[stateId].size() == 0 || requiresUpdate){
         requiresUpdate = false;
@@ -1014,6 +1275,7 @@ void SFile::pushRenderItem(int selectionColor, unsigned int stateId){
                     requiresUpdate = true;
                 } else {
                     //                    requiresUpdate = true;
+                    texturesPending = true;
                 }
 
                 r->VBO = &distancelevel[currentDlevel].subobiekty[i].VBO;
@@ -1049,12 +1311,14 @@ void SFile::render(int selectionColor, unsigned int stateId) {
 
     if (isinit != 1 || loaded == 2)
         return;
-    if (loaded == 0) {
-        if(Game::allowObjLag < 1)  return;
-        
-        Game::allowObjLag-=2;
-        loaded = 2;
-        load();
+    if (lastUsed != TexLoader::Frame) {
+        lastUsed = TexLoader::Frame;
+        stampTextures();
+    }
+    if (loaded == 0 && !loadStep()) {
+        OglObj* box = getPlaceholder();
+        if(box != NULL)
+            box->render(selectionColor);
         return;
     }
     
@@ -1171,6 +1435,7 @@ void SFile::render(int selectionColor, unsigned int stateId) {
                 //glDisable(GL_TEXTURE_2D);
                 //}
             } else {
+                TexLib::touchTex(image[texture[primstate[prim_state].arg4].image].tex);
                 //glDisable(GL_TEXTURE_2D);
             }/**/
             
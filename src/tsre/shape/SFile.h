@@ -19,12 +19,15 @@
 #include <QMatrix4x4>
 #include <QString>
 #include <QVector>
+#include <QAtomicInt>
+#include <tsre/math3d/BVH.h>
 
 class FileBuffer;
 class ShapeTextureInfo;
 class ShapeHierarchyInfo;
 class ContentHierarchyInfo;
 class RenderItem;
+class OglObj;
 
 class SFile {
 public:
@@ -54,6 +57,8 @@ public:
         czes* czesci;
         QOpenGLBuffer VBO;
         QOpenGLVertexArrayObject VAO;
+        float* vertexData = NULL;
+        int vertexCount = 0;
     };
 
     struct dist {
@@ -95,12 +100,12 @@ public:
     };
 
     struct punlist {
-        fpoint* points;
-        fpoint* uv_points;
-        fpoint* normals;
-        int ipoints;
-        int iuv_points;
-        int inormals;
+        fpoint* points = NULL;
+        fpoint* uv_points = NULL;
+        fpoint* normals = NULL;
+        int ipoints = 0;
+        int iuv_points = 0;
+        int inormals = 0;
     };
     
     // zmienne
@@ -172,6 +177,10 @@ public:
     bool loadedSd = false;
     int texloaded = 0;
     int ref = 0;
+    // TexLoader::Frame of the last draw or release.
+    int lastUsed = 0;
+    // GL buffers and parsed data, counted in ShapeLib::ResidentBytes.
+    int memoryBytes = 0;
     int esdDetailLevel = -1;
     int esdAlternativeTexture = -1;
     QVector<EsdBoundingBox> esdBoundingBox;
@@ -179,22 +188,22 @@ public:
     //VBO vbo[];
     punlist tpoints;
     // zmienne
-    int iloscd;
+    int iloscd = 0;
     int iloscm = 0;
-    matrt* macierz;
-    int ilosci;
-    imgs* image;
-    int ilosct;
-    text* texture;
-    int iloscv;
-    vtxs* vtxstate;
-    int iloscps;
-    primst* primstate;
-    dist* distancelevel;
+    matrt* macierz = NULL;
+    int ilosci = 0;
+    imgs* image = NULL;
+    int ilosct = 0;
+    text* texture = NULL;
+    int iloscv = 0;
+    vtxs* vtxstate = NULL;
+    int iloscps = 0;
+    primst* primstate = NULL;
+    dist* distancelevel = NULL;
     int currentDistanceLevel = 0;
     
-    int ishaders;
-    fshader* shader;
+    int ishaders = 0;
+    fshader* shader = NULL;
     float size;
     float bound[6];
     
@@ -203,6 +212,7 @@ public:
     SFile(const SFile& orig);
     virtual ~SFile();
     void load();
+    void loadThreaded();
     void enablePart(unsigned int uid, unsigned int stateId = 0);
     void disablePart(unsigned int uid, unsigned int stateId = 0);
     void updateSim(float deltaTime, unsigned int stateId = 0);
@@ -211,11 +221,14 @@ public:
     void pushRenderItem();
     void pushRenderItem(int selectionColor, unsigned int stateId);
     void getSize();
+    bool getBound(float* out);
+    bool intersectRay(float* origin, float* dir, float &t);
     bool getBoxPoints(QVector<float> &points);
     void getFloorBorderLinePoints(float *&punkty);
     bool isSnapable();
     void addSnapablePoints(QVector<float> &out);
     void reload();
+    void unload();
     unsigned int newState();
     void setAnimated(unsigned int stateId, bool animated);
     void setEnabledSubObjs(unsigned int stateId, unsigned int enabledSubObjs);
@@ -236,6 +249,25 @@ private:
     };
     QVector<State> state;
     
+    enum LoadState {
+        LoadNone = 0,
+        LoadQueued = 1,
+        LoadBound = 2,
+        LoadParsed = 3
+    };
+    QAtomicInt loadState;
+    bool loadParsed = false;
+    OglObj* placeholder = NULL;
+    // Level 0 triangles in shape space, 9 floats each, kept for CPU picking.
+    QVector<float> pickTriangles;
+    // Boxes of pickTriangles, built on the first intersectRay().
+    BVH pickBVH;
+    bool loadData();
+    bool loadStep();
+    void uploadGeometry();
+    void buildPickTriangles();
+    OglObj* getPlaceholder();
+    static void addBoxLines(float* b, QVector<float>& points);
     void loadSd();
     float* getPmatrix(int currentDlevel, float* pmatrix, int matrix);
     float* getPmatrixAnimated(int currentDlevel, float* pmatrix, int matrix, float frame);
@@ -243,6 +275,9 @@ private:
     bool snapable = false;
     //float *mvMatrix = NULL;
     bool requiresUpdate = false;
+    bool texturesPending = false;
+    void touchPendingTextures();
+    void stampTextures();
     QHash<unsigned int, QVector<RenderItem *>> renderItems;
 };
 
@@ -265,7 +265,6 @@
         int i, w, n, p, txt;
         int v_ilosc;
         
-        QOpenGLFunctions *f = QOpenGLContext::currentContext()->functions();
         GLUU* gluu = GLUU::get();
         fvertex* vert = new fvertex[120000];
 
@@ -487,23 +486,13 @@
                     iloscv += pliks->distancelevel[j].subobiekty[ii].czesci[jj].iloscv;
                 }
 
-                pliks->distancelevel[j].subobiekty[ii].VAO.create();
-                QOpenGLVertexArrayObject::Binder vaoBinder(&pliks->distancelevel[j].subobiekty[ii].VAO);
-                        
-                pliks->distancelevel[j].subobiekty[ii].VBO.create();
-                pliks->distancelevel[j].subobiekty[ii].VBO.bind();
-                pliks->distancelevel[j].subobiekty[ii].VBO.allocate(iloscv * 9 * sizeof(GLfloat));
-                f->glEnableVertexAttribArray(0);
-                f->glEnableVertexAttribArray(1);
-                f->glEnableVertexAttribArray(2);
-                f->glEnableVertexAttribArray(3);
-                f->glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(GLfloat), 0);
-                f->glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(GLfloat), reinterpret_cast<void *>(3 * sizeof(GLfloat)));
-                f->glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 9 * sizeof(GLfloat), reinterpret_cast<void *>(6 * sizeof(GLfloat)));
-                f->glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, 9 * sizeof(GLfloat), reinterpret_cast<void *>(8 * sizeof(GLfloat)));
+                // Geometry is kept on the CPU side here, SFile::uploadGeometry() moves it
+                // to the VBO on the GL thread, so parsing can run on a loader thread.
+                pliks->distancelevel[j].subobiekty[ii].vertexCount = iloscv;
+                pliks->distancelevel[j].subobiekty[ii].vertexData = new float[iloscv * 9];
 
                 for (int jj = 0; jj < pliks->distancelevel[j].subobiekty[ii].iloscc; jj++) {
-                    float *wierzcholki = new float[pliks->distancelevel[j].subobiekty[ii].czesci[jj].iloscv*9];
+                    float *wierzcholki = pliks->distancelevel[j].subobiekty[ii].vertexData + offset * 9;
 
                     for (int iii = pliks->distancelevel[j].subobiekty[ii].czesci[jj].iloscv - 1; iii >= 0; iii--) {
                             //pliks->distancelevel[j].subobiekty[ii].czesci[czilosc].wierzcholki[iii] = new SFile::wie();
@@ -539,13 +528,10 @@
                             //directxSmierdzi-=2;
                             //if(directxSmierdzi<-2) directxSmierdzi = 2;
                     }
-                    pliks->distancelevel[j].subobiekty[ii].VBO.write(offset * 9 * sizeof(GLfloat), wierzcholki, pliks->distancelevel[j].subobiekty[ii].czesci[jj].iloscv * 9 * sizeof(GLfloat));
-                    delete[] wierzcholki;
                     pliks->distancelevel[j].subobiekty[ii].czesci[jj].offset = offset;
                     offset += pliks->distancelevel[j].subobiekty[ii].czesci[jj].iloscv;
                     delete[] pliks->distancelevel[j].subobiekty[ii].czesci[jj].idx;
                 }
-                pliks->distancelevel[j].subobiekty[ii].VBO.release();
             }
         }
         delete[] vert;
@@ -222,24 +222,21 @@ void SFileX::odczytajprim_states(FileBuffer* bufor, SFile* pliks) {
 //-----------------------------------
 
 void SFileX::odczytajlodd(FileBuffer* bufor, SFile* pliks) {
-    QString sh = "";
+    ParserX::Token sh;
     int i, j, ii, jj;
     int iloscs, iloscv;
     int aktidx, iloscp, w, czilosc = 0, iii;
     int n, p, txt, nul;
     int v_ilosc;
 
-    QOpenGLFunctions *f = QOpenGLContext::currentContext()->functions();
     GLUU* gluu = GLUU::get();
     fvertex* vert = new fvertex[120000];
 
     i = 0; // odczytujemy jeden lodcontrol=0;
-    sh = "lod_control";
-    ParserX::FindTokenDomIgnore(sh, bufor);
+    ParserX::FindTokenDomIgnore("lod_control", bufor);
     //console.log("znaleziono sekcje " + sh + " na " + bufor.p);
     //szukamy sekcji distance levels
-    sh = "distance_levels";
-    ParserX::FindTokenDomIgnore(sh, bufor);
+    ParserX::FindTokenDomIgnore("distance_levels", bufor);
     //console.log("znaleziono sekcje " + sh + " na " + bufor.p);
     // wczytujemy ilosc distancelevels
     pliks->iloscd = ParserX::GetNumber(bufor);
@@ -250,12 +247,10 @@ void SFileX::odczytajlodd(FileBuffer* bufor, SFile* pliks) {
     for (j = 0; j < pliks->iloscd; j++) {
         //pliks->distancelevel[j] = new SFile->Dist();
 
-        sh = "distance_level";
-        ParserX::FindTokenDomIgnore(sh, bufor);
+        ParserX::FindTokenDomIgnore("distance_level", bufor);
         //qDebug() << QString("znaleziono sekcje " + sh + " na " + bufor->off);
         //wczytanie hierarchii
-        sh = "distance_level_header";
-        ParserX::FindTokenDomIgnore(sh, bufor);
+        ParserX::FindTokenDomIgnore("distance_level_header", bufor);
         pliks->distancelevel[j].levelSelection = ParserX::GetNumber(bufor); //dlevel_selection//
         pliks->distancelevel[j].ilosch = ParserX::GetNumber(bufor);
         pliks->distancelevel[j].hierarchia = new int[pliks->distancelevel[j].ilosch + 1];
@@ -264,8 +259,7 @@ void SFileX::odczytajlodd(FileBuffer* bufor, SFile* pliks) {
         }
 
         //szukamy subobjektow
-        sh = "sub_objects";
-        ParserX::FindTokenDomIgnore(sh, bufor);
+        ParserX::FindTokenDomIgnore("sub_objects", bufor);
         //console.log("znaleziono sekcje " + sh + " na " + bufor.p);
         //ilosc subobjektow
         pliks->distancelevel[j].iloscs = ParserX::GetNumber(bufor);
@@ -275,19 +269,18 @@ void SFileX::odczytajlodd(FileBuffer* bufor, SFile* pliks) {
         //wczytujemy subobjekty
         iloscs = pliks->distancelevel[j].iloscs;
         for (ii = 0; ii < iloscs; ii++) {
-            sh = "sub_object";
-            ParserX::FindTokenDomIgnore(sh, bufor);
+            ParserX::FindTokenDomIgnore("sub_object", bufor);
 
-            while (!((sh = ParserX::NextTokenInside(bufor).toLower()) == "")) {
+            while (!((sh = ParserX::NextTokenView(bufor)).isEmpty())) {
                 if(sh == "sub_object_header"){
                     ParserX::GetHex(bufor);
                     ParserX::GetNumber(bufor);
                     ParserX::GetNumber(bufor);
                     ParserX::GetHex(bufor);
                     ParserX::GetHex(bufor);
-                    while (!((sh = ParserX::NextTokenInside(bufor).toLower()) == "")) {
+                    while (!((sh = ParserX::NextTokenView(bufor)).isEmpty())) {
                         if(sh == "geometry_info"){
-                            while (!((sh = ParserX::NextTokenInside(bufor).toLower()) == "")) {
+                            while (!((sh = ParserX::NextTokenView(bufor)).isEmpty())) {
                                 if(sh == "geometry_nodes"){
                                     ParserX::SkipToken(bufor);
                                     continue;
@@ -369,15 +362,14 @@ void SFileX::odczytajlodd(FileBuffer* bufor, SFile* pliks) {
                         //qDebug() << "cc " << pliks->distancelevel[j].subobiekty[ii].iloscc;
                         //wybor sekcji lista czy indeks
                         //w = ParserX::sekcjap(bufor);
-                        sh = ParserX::NextTokenDomIgnore(bufor).toLower();
+                        QString prim = ParserX::NextTokenDomIgnore(bufor).toLower();
                         //w = 
                         //console.log("ww " + w);
-                        if (sh == "indexed_trilist") {
+                        if (prim == "indexed_trilist") {
                             //jesli lista
                             pliks->distancelevel[j].subobiekty[ii].czesci[czilosc].prim_state_idx = aktidx;
                             //wczytanie indeksow wierzcholkow
-                            sh = "vertex_idxs";
-                            ParserX::FindTokenDomIgnore(sh, bufor);
+                            ParserX::FindTokenDomIgnore("vertex_idxs", bufor);
                             //console.log("znaleziono sekcje " + sh + " na " + bufor.p);
                             pliks->distancelevel[j].subobiekty[ii].czesci[czilosc].iloscv = ParserX::GetNumber(bufor);
 
@@ -424,10 +416,8 @@ void SFileX::odczytajlodd(FileBuffer* bufor, SFile* pliks) {
                             //twierzcholki = null;
                             //pliks->distancelevel[j].subobiekty[ii][czilosc].pwierzcholki = pwierzcholki;
                             //pominiecie normals i flags 
-                            sh = "normal_idxs";
-                            ParserX::FindTokenDomIgnore(sh, bufor);
-                            sh = "flags";
-                            ParserX::FindTokenDomIgnore(sh, bufor);
+                            ParserX::FindTokenDomIgnore("normal_idxs", bufor);
+                            ParserX::FindTokenDomIgnore("flags", bufor);
                             ParserX::SkipToken(bufor);
                             czilosc++;
                         } else {
@@ -443,23 +433,13 @@ void SFileX::odczytajlodd(FileBuffer* bufor, SFile* pliks) {
                         iloscv += pliks->distancelevel[j].subobiekty[ii].czesci[jj].iloscv;
                     }
 
-                    pliks->distancelevel[j].subobiekty[ii].VAO.create();
-                    QOpenGLVertexArrayObject::Binder vaoBinder(&pliks->distancelevel[j].subobiekty[ii].VAO);
-
-                    pliks->distancelevel[j].subobiekty[ii].VBO.create();
-                    pliks->distancelevel[j].subobiekty[ii].VBO.bind();
-                    pliks->distancelevel[j].subobiekty[ii].VBO.allocate(iloscv * 9 * sizeof(GLfloat));
-                    f->glEnableVertexAttribArray(0);
-                    f->glEnableVertexAttribArray(1);
-                    f->glEnableVertexAttribArray(2);
-                    f->glEnableVertexAttribArray(3);
-                    f->glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(GLfloat), 0);
-                    f->glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(GLfloat), reinterpret_cast<void *>(3 * sizeof(GLfloat)));
-                    f->glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 9 * sizeof(GLfloat), reinterpret_cast<void *>(6 * sizeof(GLfloat)));
-                    f->glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, 9 * sizeof(GLfloat), reinterpret_cast<void *>(8 * sizeof(GLfloat)));
+                    // Geometry is kept on the CPU side here, SFile::uploadGeometry() moves it
+                    // to the VBO on the GL thread, so parsing can run on a loader thread.
+                    pliks->distancelevel[j].subobiekty[ii].vertexCount = iloscv;
+                    pliks->distancelevel[j].subobiekty[ii].vertexData = new float[iloscv * 9];
 
                     for (int jj = 0; jj < pliks->distancelevel[j].subobiekty[ii].iloscc; jj++) {
-                        float *wierzcholki = new float[pliks->distancelevel[j].subobiekty[ii].czesci[jj].iloscv*9];
+                        float *wierzcholki = pliks->distancelevel[j].subobiekty[ii].vertexData + offset * 9;
 
                         for (int iii = pliks->distancelevel[j].subobiekty[ii].czesci[jj].iloscv - 1; iii >= 0; iii--) {
                                 //pliks->distancelevel[j].subobiekty[ii].czesci[czilosc].wierzcholki[iii] = new SFile::wie();
@@ -495,13 +475,10 @@ void SFileX::odczytajlodd(FileBuffer* bufor, SFile* pliks) {
                                 //directxSmierdzi-=2;
                                 //if(directxSmierdzi<-2) directxSmierdzi = 2;
                         }
-                        pliks->distancelevel[j].subobiekty[ii].VBO.write(offset * 9 * sizeof(GLfloat), wierzcholki, pliks->distancelevel[j].subobiekty[ii].czesci[jj].iloscv * 9 * sizeof(GLfloat));
-                        delete[] wierzcholki;
                         pliks->distancelevel[j].subobiekty[ii].czesci[jj].offset = offset;
                         offset += pliks->distancelevel[j].subobiekty[ii].czesci[jj].iloscv;
                         delete[] pliks->distancelevel[j].subobiekty[ii].czesci[jj].idx;
                     }
-                    pliks->distancelevel[j].subobiekty[ii].VBO.release();
                 
                     ParserX::SkipToken(bufor);
                     ParserX::SkipToken(bufor);
@@ -12,9 +12,14 @@
 #include <tsre/Game.h>
 #include <QDebug>
 #include <tsre/shape/SFile.h>
+#include <tsre/texture/TexLoader.h>
+#include <algorithm>
+#include <vector>
 
 //int ShapeLib::jestshape;
 //std::unordered_map<int, SFile*> ShapeLib::shape;
+long long ShapeLib::ResidentBytes = 0;
+int ShapeLib::KeepFrames = 300;
 
 ShapeLib::ShapeLib() {
 }
@@ -26,25 +31,71 @@ ShapeLib::~ShapeLib() {
 }
 
 void ShapeLib::reset() {
+    for(auto it = shape.begin(); it != shape.end(); ++it)
+        if(it->second != NULL)
+            ResidentBytes -= it->second->memoryBytes;
     jestshape = 0;
     shape.clear();
+    pathIndex.clear();
 }
         
 void ShapeLib::delRef(int texx) {
-    /*if(!mtex.containsKey(texx)) return;
-    mtex.get(texx).ref--;
-    if(mtex.get(texx).ref<=0){
-
-        if(mtex.get(texx).glLoaded){
-            mtex.get(texx).delVBO(gl);
-            mtex.remove(texx);
-        }
-    }*/
+    auto it = shape.find(texx);
+    if(it != shape.end())
+        delRef(it->second);
 }
         
 void ShapeLib::addRef(int texx) {
-    //if(!mtex.containsKey(texx)) return;
-    //mtex.get(texx).ref++;
+    auto it = shape.find(texx);
+    if(it != shape.end())
+        addRef(it->second);
+}
+
+/*
+ * Shapes are not deleted at zero references, unloadUnused() frees
+ * their data later if memory is needed.
+ */
+void ShapeLib::delRef(SFile* shape) {
+    if(shape == NULL)
+        return;
+    shape->ref--;
+    shape->lastUsed = TexLoader::Frame;
+}
+
+void ShapeLib::addRef(SFile* shape) {
+    if(shape == NULL)
+        return;
+    shape->ref++;
+}
+
+/*
+ * Unloads shapes no object references and not drawn for KeepFrames
+ * frames, least recently used first, while loaded shapes use more than
+ * Game::shapeMemoryLimit megabytes. Needs the GL context of this library.
+ */
+void ShapeLib::unloadUnused() {
+    long long limit = (long long)Game::shapeMemoryLimit*1024*1024;
+    if(Game::shapeMemoryLimit <= 0 || ResidentBytes <= limit)
+        return;
+    std::vector<std::pair<int, SFile*>> unused;
+    for(auto it = shape.begin(); it != shape.end(); ++it){
+        SFile* s = it->second;
+        if(s == NULL || s->ref > 0 || s->loaded != 1)
+            continue;
+        if(TexLoader::Frame - s->lastUsed < KeepFrames)
+            continue;
+        unused.push_back(std::make_pair(s->lastUsed, s));
+    }
+    std::sort(unused.begin(), unused.end(), [](const std::pair<int, SFile*>& a, const std::pair<int, SFile*>& b){
+        return a.first < b.first;
+    });
+    int count = 0;
+    for(unsigned int i = 0; i < unused.size() && ResidentBytes > limit; i++){
+        unused[i].second->unload();
+        count++;
+    }
+    if(count > 0)
+        qDebug() << "ShapeLib: unloaded" << count << "shapes," << ResidentBytes/(1024*1024) << "MB resident";
 }
 
 int ShapeLib::addShape(QString path){
@@ -58,18 +109,21 @@ int ShapeLib::addShape(QString path, QString texPath) {
     pathid.replace("\\", "/");
     pathid.replace("//", "/");
     //console.log(pathid);
-    for ( auto it = shape.begin(); it != shape.end(); ++it ){
-        if(it->second == NULL) continue;
-        if (((SFile*) it->second)->pathid.length() == pathid.length())
-            if (((SFile*) it->second)->pathid == pathid) {
-                ((SFile*) it->second)->ref++;
-                return (int)it->first;
-            }
+    auto it = pathIndex.find(pathid);
+    if(it != pathIndex.end()){
+        auto sit = shape.find(it.value());
+        if(sit != shape.end() && sit->second != NULL){
+            sit->second->ref++;
+            return it.value();
+        }
+        pathIndex.erase(it);
     }
     qDebug() << "Nowy " << jestshape << " shape: " << pathid;
 
     shape[jestshape] = new SFile(pathid, path.split("/").last(), texPath);
     shape[jestshape]->pathid = pathid;
+    shape[jestshape]->ref = 1;
+    pathIndex[pathid] = jestshape;
 
     return jestshape++;
 }
\ No newline at end of file
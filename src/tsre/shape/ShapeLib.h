@@ -3,21 +3,28 @@
 
 #include <unordered_map>
 #include <QString>
+#include <QHash>
 
 class SFile;
 
 class ShapeLib {
 public:
+    static long long ResidentBytes;
+    static int KeepFrames;
     int jestshape = 0;
     std::unordered_map<int, SFile*> shape;
+    QHash<QString, int> pathIndex;
     ShapeLib();
     ShapeLib(const ShapeLib& orig);
     virtual ~ShapeLib();
     void reset();
     void delRef(int texx);
     void addRef(int texx);
+    static void delRef(SFile* shape);
+    static void addRef(SFile* shape);
     int addShape(QString path);
     int addShape(QString path, QString texPath);
+    void unloadUnused();
 private:
 
 };
@@ -0,0 +1,65 @@
+/*  This file is part of TSRE5.
+ *
+ *  TSRE5 - train sim game engine and MSTS/OR Editors.
+ *  Copyright (C) 2016 Piotr Gadecki <pgadecki@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *
+ *  See LICENSE.md or https://www.gnu.org/licenses/gpl.html
+ */
+
+#include <tsre/shape/ShapeLoader.h>
+#include <tsre/shape/SFile.h>
+#include <tsre/Game.h>
+#include <QMutexLocker>
+#include <QDebug>
+
+bool ShapeLoader::IsThread = true;
+
+QMutex ShapeLoader::mutex;
+QWaitCondition ShapeLoader::jobAdded;
+QQueue<SFile*> ShapeLoader::jobs;
+QVector<ShapeLoader*> ShapeLoader::workers;
+
+void ShapeLoader::startWorkers(){
+    int count = Game::shapeLoaderThreads;
+    if(count <= 0)
+        count = QThread::idealThreadCount()/2;
+    if(count < 1)
+        count = 1;
+    for(int i = 0; i < count; i++){
+        ShapeLoader* worker = new ShapeLoader();
+        workers.push_back(worker);
+        worker->start(QThread::LowPriority);
+    }
+    qDebug() << "ShapeLoader: threads" << count;
+}
+
+void ShapeLoader::enqueue(SFile* shape){
+    if(shape == NULL)
+        return;
+    QMutexLocker locker(&mutex);
+    if(workers.size() == 0)
+        startWorkers();
+    jobs.enqueue(shape);
+    jobAdded.wakeOne();
+}
+
+int ShapeLoader::pendingCount(){
+    QMutexLocker locker(&mutex);
+    return jobs.size();
+}
+
+void ShapeLoader::run(){
+    SFile* shape;
+    for(;;){
+        mutex.lock();
+        while(jobs.size() == 0)
+            jobAdded.wait(&mutex);
+        shape = jobs.dequeue();
+        mutex.unlock();
+
+        shape->loadThreaded();
+    }
+}
+
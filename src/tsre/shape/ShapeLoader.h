@@ -0,0 +1,48 @@
+/*  This file is part of TSRE5.
+ *
+ *  TSRE5 - train sim game engine and MSTS/OR Editors.
+ *  Copyright (C) 2016 Piotr Gadecki <pgadecki@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *
+ *  See LICENSE.md or https://www.gnu.org/licenses/gpl.html
+ */
+
+#ifndef SHAPELOADER_H
+#define	SHAPELOADER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QVector>
+
+class SFile;
+
+/*
+ * Shared pool of shape loading threads.
+ * Workers read, inflate and parse .s files into CPU-side vertex data,
+ * SFile::uploadGeometry() is then called on the GL thread and limited
+ * by FrameScheduler.
+ */
+class ShapeLoader : public QThread {
+    Q_OBJECT
+public:
+    static bool IsThread;
+
+    static void enqueue(SFile* shape);
+    static int pendingCount();
+
+protected:
+    void run();
+
+private:
+    static QMutex mutex;
+    static QWaitCondition jobAdded;
+    static QQueue<SFile*> jobs;
+    static QVector<ShapeLoader*> workers;
+    static void startWorkers();
+};
+
+#endif	/* SHAPELOADER_H */
+
@@ -91,6 +91,8 @@ QString SoundDefinitionGroup::Stream::Trigger::getFileName(){
 
 void SoundDefinitionGroup::Stream::setRelative(bool v){
     relative = v;
+    if(alSid < 0)
+        return;
     if(relative)
         alSourcei(alSid, AL_SOURCE_RELATIVE, AL_TRUE);
     else
@@ -536,7 +538,7 @@ void SoundDefinitionGroup::Stream::setPosition(int x, int y, float *pos){
     tilePos[1] = pos[1];
     tilePos[2] = pos[2];
     
-    alSource3f(alSid, AL_POSITION, tilePos[0] - 2048*(SoundManager::listenerX-x), tilePos[1], tilePos[2] - 2048*(SoundManager::listenerZ-y));
+    updatePosition();
 }
 
 void SoundDefinitionGroup::Stream::update(SoundVariables *variables){
@@ -544,22 +546,29 @@ void SoundDefinitionGroup::Stream::update(SoundVariables *variables){
         if(trigger[i]->activate(variables)){
             if(trigger[i]->mode == Trigger::ONESHOT_MODE){
                 bindTo(trigger[i]->alBid);
-                qDebug() << "bind" << i << alSid << trigger[i]->alBid;
-                alSourcei(alSid, AL_LOOPING, AL_FALSE);
-                alSourcePlay(alSid);
+                looping = false;
+                playing = boundBid > 0;
+                if(alSid >= 0){
+                    alSourcei(alSid, AL_LOOPING, AL_FALSE);
+                    alSourcePlay(alSid);
+                }
                 isInit = true;
             }
             if(trigger[i]->mode == Trigger::LOOPSTART_MODE){
                 bindTo(trigger[i]->alBid);
-                qDebug() << "bind" << i << alSid << trigger[i]->alBid;
-                alSourcei(alSid, AL_LOOPING, AL_TRUE);
-                alSourcePlay(alSid);
+                looping = true;
+                playing = boundBid > 0;
+                if(alSid >= 0){
+                    alSourcei(alSid, AL_LOOPING, AL_TRUE);
+                    alSourcePlay(alSid);
+                }
                 isInit = true;
             }
             if(trigger[i]->mode == Trigger::LOOPRELEASE_MODE){
+                if(alSid >= 0)
+                    alSourceStop(alSid);
                 bindTo(0);
-                qDebug() << "u-bind" << i << alSid << "NULL";
-                alSourceStop(alSid);
+                playing = false;
                 isInit = true;
             }
         }
@@ -572,17 +581,21 @@ void SoundDefinitionGroup::Stream::update(SoundVariables *variables){
         }*/
     }
 
-    if(volumeCurve != NULL){
-        float newv = volumeCurve->getValue(variables);
-        alSourcef(alSid, AL_GAIN, newv);
-    }
-    if(freqCurve != NULL){
-        float newv = freqCurve->getValue(variables);
-        alSourcef(alSid, AL_PITCH, newv/12025.0);
-    }
+    if(volumeCurve != NULL)
+        gain = volumeCurve->getValue(variables);
+    if(freqCurve != NULL)
+        pitch = freqCurve->getValue(variables)/12025.0;
+    if(alSid < 0)
+        return;
+    if(volumeCurve != NULL)
+        alSourcef(alSid, AL_GAIN, gain);
+    if(freqCurve != NULL)
+        alSourcef(alSid, AL_PITCH, pitch);
 }
 
 void SoundDefinitionGroup::Stream::updatePosition(){
+    if(alSid < 0)
+        return;
     if(relative)
         alSource3f(alSid, AL_POSITION, 0, 0, 0);    
     else
@@ -590,122 +603,58 @@ void SoundDefinitionGroup::Stream::updatePosition(){
 }
 
 void SoundDefinitionGroup::Stream::bindTo(int i){
-    alSourcei(alSid, AL_BUFFER, i);
+    if(i < 0)
+        i = 0;
+    boundBid = i;
+    if(alSid >= 0)
+        alSourcei(alSid, AL_BUFFER, i);
     //qDebug("buffer binding");
 }
 
-void SoundDefinitionGroup::Stream::init(QString path, bool stereo){
-
-    alGenSources((ALuint)1, (ALuint*)&alSid);
-    qDebug("source generation");
-
-    float pitch = 1.0;
-    //if(stereo)
-    //    pitch = 2.0;
-        
+void SoundDefinitionGroup::Stream::acquireVoice(){
+    if(alSid >= 0)
+        return;
+    alSid = SoundManager::AcquireVoice();
+    if(alSid < 0)
+        return;
+    
     alSourcef(alSid, AL_PITCH, pitch);
-    qDebug("source pitch");
-    alSourcef(alSid, AL_GAIN, 1.0);
-    qDebug("source gain");
-        
-    alSourcei(alSid, AL_SOURCE_RELATIVE, AL_FALSE);
-        
+    alSourcef(alSid, AL_GAIN, gain);
     alSourcef(alSid, AL_REFERENCE_DISTANCE, 1);
-    alSourcef(alSid, AL_MAX_DISTANCE, 1000);
-    alDistanceModel(AL_LINEAR_DISTANCE_CLAMPED);
-        
-    alSource3f(alSid, AL_POSITION, 0, 0, 0);
-    qDebug("source position");
+    alSourcef(alSid, AL_MAX_DISTANCE, distance);
     alSource3f(alSid, AL_VELOCITY, 0, 0, 0);
-    qDebug("source velocity");
-    alSourcei(alSid, AL_LOOPING, AL_TRUE);
-    qDebug("source looping");
+    alSourcei(alSid, AL_LOOPING, looping ? AL_TRUE : AL_FALSE);
+    alSourcei(alSid, AL_SOURCE_RELATIVE, relative ? AL_TRUE : AL_FALSE);
+    updatePosition();
+    alSourcei(alSid, AL_BUFFER, boundBid);
+    if(playing)
+        alSourcePlay(alSid);
+}
 
+void SoundDefinitionGroup::Stream::releaseVoice(){
+    if(alSid < 0)
+        return;
+    SoundManager::ReleaseVoice(alSid);
+    alSid = -1;
+}
 
+void SoundDefinitionGroup::Stream::init(QString path, bool stereo){
+    // AL source is given later by SoundManager::UpdateVoices.
     for(int i = 0; i < trigger.size(); i++){
         if(trigger[i]->files.size() < 1)
             continue;
         if(trigger[i]->mode != Trigger::LOOPSTART_MODE && trigger[i]->mode != Trigger::ONESHOT_MODE )
             continue;
-        alGenBuffers(1, (ALuint*)&trigger[i]->alBid);
-        qDebug("buffer generation");
-        QString filepath = path + "/" + trigger[i]->files.first();
-        filepath.replace("//", "/");
-        QFile file(filepath);
-        qDebug()<< "vaw" << file.fileName();
-        if (!file.open(QIODevice::ReadOnly)){
-            qDebug() << "fail vaw file "<< file.fileName();
-            return;
-        }
-        FileBuffer* filedata = ReadFile::read(&file);
-        
-        qDebug() << filedata->get();
-        qDebug() << filedata->get();
-        qDebug() << filedata->get();
-        qDebug() << filedata->get();
-        
-        qDebug() << filedata->getInt();
-
-        qDebug() << filedata->get();
-        qDebug() << filedata->get();
-        qDebug() << filedata->get();
-        qDebug() << filedata->get();
-
-        qDebug() << filedata->get();
-        qDebug() << filedata->get();
-        qDebug() << filedata->get();
-        qDebug() << filedata->get();
-
-        unsigned short chunkSize = filedata->getUint();
-        
-        unsigned short audioFormat = filedata->getShort();
-        qDebug() <<"audioFormat"<<audioFormat;
-        unsigned short channels = filedata->getShort();
-        qDebug() <<"channels"<<channels;
-        unsigned int sampleRate = filedata->getUint();
-        qDebug() <<"sampleRate"<<sampleRate;
-        unsigned int byteRate = filedata->getUint();
-        qDebug() <<"byteRate" << byteRate;
-        filedata->getSignedShort();
-        unsigned short bitsPerSample = filedata->getShort();
-        qDebug() <<"bitsPerSample"<<bitsPerSample;
-
-        if (chunkSize != 16) {
-                unsigned short extraParams = filedata->getShort();
-                filedata->off += extraParams;
-        }
-
-        qDebug() << filedata->get();
-        qDebug() << filedata->get();
-        qDebug() << filedata->get();
-        qDebug() << filedata->get();
-
-        unsigned int dataChunkSize = filedata->getUint();
-        qDebug() << "dataChunkSize" << dataChunkSize;
-        //dataChunkSize = dataChunkSize/channels;
-        unsigned char* bufferData = new unsigned char[dataChunkSize];
-        //if (channels == 1)
-            for(int ii = 0; ii < dataChunkSize; ii++)
-                bufferData[ii] = filedata->get();
-        /*if (channels == 2)
-            for(int ii = 0; ii < dataChunkSize; ii+=2){
-                filedata->get();
-                filedata->get();
-                bufferData[ii] = filedata->get();
-                bufferData[ii+1] = filedata->get();
-            }
-        */
-        float duration = float(dataChunkSize) / byteRate;
-        ALenum formatinfo = AL_FORMAT_STEREO16;
-        if (channels == 1)
-                formatinfo = AL_FORMAT_MONO16;
-        alBufferData(trigger[i]->alBid, formatinfo, bufferData, dataChunkSize, sampleRate);
-
-	qDebug("loading wav file");
-
-	qDebug("buffer copy");
-
+        trigger[i]->alBid = SoundManager::GetBuffer(path + "/" + trigger[i]->files.first());
     }
-    
+}
 
+void SoundDefinitionGroup::Stream::release(){
+    releaseVoice();
+    bindTo(0);
+    playing = false;
+    for(int i = 0; i < trigger.size(); i++){
+        SoundManager::ReleaseBuffer(trigger[i]->alBid);
+        trigger[i]->alBid = -1;
+    }
 }
@@ -111,6 +111,13 @@ class SoundDefinitionGroup {
             bool isInit = false;
             
             float lastVolume = -1;
+            
+            // State kept while the stream has no AL source.
+            bool playing = false;
+            bool looping = true;
+            int boundBid = 0;
+            float gain = 1.0;
+            float pitch = 1.0;
         
             void load(FileBuffer* data);
             void setPosition(int x, int y, float *pos);
@@ -118,7 +125,10 @@ class SoundDefinitionGroup {
             void updatePosition();
             void setRelative(bool v);
             void init(QString path, bool stereo);
+            void release();
             void bindTo(int i);
+            void acquireVoice();
+            void releaseVoice();
         };
         
         Activation activation;
@@ -22,6 +22,11 @@
 #include <tsre/fileFunctions/ReadFile.h>
 #include <tsre/fileFunctions/FileBuffer.h>
 #include <tsre/math3d/GLMatrix.h>
+#include <tsre/Game.h>
+#include <QFile>
+#include <QtEndian>
+#include <QDebug>
+#include <algorithm>
 
 QMap<int, SoundSource*> SoundManager::Sources;
 int SoundManager::SourcesCount;
@@ -30,6 +35,10 @@ ALCcontext *SoundManager::context = NULL;
 float SoundManager::listenerPos[3] = {0,0,0};
 int SoundManager::listenerX = 0;
 int SoundManager::listenerZ = 0;
+QHash<QString, int> SoundManager::BufferIds;
+QHash<int, SoundManager::SoundBuffer> SoundManager::Buffers;
+QVector<int> SoundManager::FreeVoices;
+int SoundManager::VoicesCount = 0;
 
 void SoundManager::InitAl() {
     ALboolean enumeration;
@@ -72,6 +81,7 @@ void SoundManager::InitAl() {
 	qDebug("listener velocity");
 	alListenerfv(AL_ORIENTATION, listenerOri);
 	qDebug("listener orientation");
+        alDistanceModel(AL_LINEAR_DISTANCE_CLAMPED);
 
         
                 
@@ -85,10 +95,12 @@ void SoundManager::UpdateAll(){
             if(i.value() == NULL) continue;
             i.value()->update();
         }
+    UpdateVoices();
 }
 
 void SoundManager::UpdateListenerPos(int x, int y, float* pos, float* target, float* up){
     alListener3f(AL_POSITION, pos[0], pos[1], pos[2]);
+    Vec3::copy(listenerPos, pos);
     float o[6];
     o[0] = target[0] - pos[0];
     o[1] = target[1] - pos[1];
@@ -127,6 +139,192 @@ int SoundManager::AddSoundSource(SoundDefinitionGroup* g){
 
 
 
+float SoundManager::GetListenerDistance(int x, int y, float *pos){
+    float d[3];
+    d[0] = pos[0] - 2048*(listenerX-x) - listenerPos[0];
+    d[1] = pos[1] - listenerPos[1];
+    d[2] = pos[2] - 2048*(listenerZ-y) - listenerPos[2];
+    return Vec3::length(d);
+}
+
+int SoundManager::GetBuffer(QString path){
+    path.replace("//", "/");
+    if(BufferIds.contains(path)){
+        int id = BufferIds[path];
+        if(id > 0)
+            Buffers[id].refCount++;
+        return id;
+    }
+    
+    ALuint alBid = 0;
+    alGenBuffers(1, &alBid);
+    if(!LoadWav(alBid, path)){
+        alDeleteBuffers(1, &alBid);
+        // Remember missing and broken files, don't read them again.
+        BufferIds[path] = -1;
+        return -1;
+    }
+    BufferIds[path] = alBid;
+    SoundBuffer &b = Buffers[alBid];
+    b.path = path;
+    b.refCount = 1;
+    alGetBufferi(alBid, AL_SIZE, &b.bytes);
+    return alBid;
+}
+
+void SoundManager::ReleaseBuffer(int alBid){
+    if(alBid <= 0 || !Buffers.contains(alBid))
+        return;
+    SoundBuffer &b = Buffers[alBid];
+    if(--b.refCount > 0)
+        return;
+    BufferIds.remove(b.path);
+    Buffers.remove(alBid);
+    ALuint id = alBid;
+    alDeleteBuffers(1, &id);
+}
+
+bool SoundManager::LoadWav(int alBid, QString path){
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)){
+        qDebug() << "fail vaw file "<< file.fileName();
+        return false;
+    }
+    qint64 size = file.size();
+    QByteArray fileData;
+    const uchar* data = file.map(0, size);
+    if(data == NULL){
+        fileData = file.readAll();
+        data = (const uchar*)fileData.constData();
+        size = fileData.size();
+    }
+    
+    if(size < 12 || memcmp(data, "RIFF", 4) != 0 || memcmp(data + 8, "WAVE", 4) != 0){
+        qDebug() << "not a wav file" << path;
+        return false;
+    }
+    
+    unsigned short audioFormat = 0;
+    unsigned short channels = 0;
+    unsigned int sampleRate = 0;
+    unsigned short bitsPerSample = 0;
+    const uchar* pcm = NULL;
+    unsigned int pcmSize = 0;
+    
+    qint64 off = 12;
+    while(off + 8 <= size){
+        unsigned int chunkSize = qFromLittleEndian<quint32>(data + off + 4);
+        const uchar* chunk = data + off + 8;
+        qint64 avail = size - off - 8;
+        if(memcmp(data + off, "fmt ", 4) == 0 && avail >= 16){
+            audioFormat = qFromLittleEndian<quint16>(chunk);
+            channels = qFromLittleEndian<quint16>(chunk + 2);
+            sampleRate = qFromLittleEndian<quint32>(chunk + 4);
+            bitsPerSample = qFromLittleEndian<quint16>(chunk + 14);
+        } else if(memcmp(data + off, "data", 4) == 0){
+            pcm = chunk;
+            pcmSize = qMin((qint64)chunkSize, avail);
+            break;
+        }
+        off += 8 + chunkSize + (chunkSize & 1);
+    }
+    
+    if(pcm == NULL || audioFormat != 1 || sampleRate == 0){
+        qDebug() << "unsupported wav file" << path << "format" << audioFormat;
+        return false;
+    }
+    
+    ALenum formatinfo;
+    if(bitsPerSample == 8)
+        formatinfo = channels == 1 ? AL_FORMAT_MONO8 : AL_FORMAT_STEREO8;
+    else
+        formatinfo = channels == 1 ? AL_FORMAT_MONO16 : AL_FORMAT_STEREO16;
+    
+    // PCM is uploaded straight from the mapped file.
+    alGetError();
+    alBufferData(alBid, formatinfo, pcm, pcmSize, sampleRate);
+    return alGetError() == AL_NO_ERROR;
+}
+
+int SoundManager::AcquireVoice(){
+    if(FreeVoices.size() > 0){
+        int alSid = FreeVoices.back();
+        FreeVoices.pop_back();
+        return alSid;
+    }
+    if(VoicesCount >= Game::soundVoices)
+        return -1;
+    
+    ALuint alSid = 0;
+    alGetError();
+    alGenSources(1, &alSid);
+    // Driver is out of sources.
+    if(alGetError() != AL_NO_ERROR)
+        return -1;
+    VoicesCount++;
+    return alSid;
+}
+
+void SoundManager::ReleaseVoice(int alSid){
+    if(alSid < 0)
+        return;
+    alSourceStop(alSid);
+    alSourcei(alSid, AL_BUFFER, 0);
+    FreeVoices.push_back(alSid);
+}
+
+void SoundManager::UpdateVoices(){
+    struct Voice {
+        float distance;
+        SoundDefinitionGroup::Stream* stream;
+    };
+    std::vector<Voice> audible;
+    
+    QMapIterator<int, SoundSource*> i(Sources);
+    while (i.hasNext()) {
+        i.next();
+        if(i.value() == NULL) continue;
+        for(int j = 0; j < i.value()->stream.size(); j++){
+            SoundDefinitionGroup::Stream* s = i.value()->stream[j];
+            if(s->alSid >= 0 && s->playing && !s->looping){
+                ALint state;
+                alGetSourcei(s->alSid, AL_SOURCE_STATE, &state);
+                if(state == AL_STOPPED)
+                    s->playing = false;
+            }
+            if(!s->playing){
+                s->releaseVoice();
+                continue;
+            }
+            float d = 0;
+            if(!s->relative)
+                d = GetListenerDistance(s->X, s->Y, s->tilePos);
+            if(d > s->distance){
+                s->releaseVoice();
+                // One-shot sounds are not heard, drop them.
+                if(!s->looping)
+                    s->playing = false;
+                continue;
+            }
+            audible.push_back({d, s});
+        }
+    }
+    
+    std::sort(audible.begin(), audible.end(), [](const Voice& a, const Voice& b){
+        return a.distance < b.distance;
+    });
+    
+    unsigned int voices = qMax(Game::soundVoices, 0);
+    // Free voices of the streams that lost them first, so the nearest can take them.
+    for(unsigned int j = voices; j < audible.size(); j++){
+        audible[j].stream->releaseVoice();
+        if(!audible[j].stream->looping)
+            audible[j].stream->playing = false;
+    }
+    for(unsigned int j = 0; j < audible.size() && j < voices; j++)
+        audible[j].stream->acquireVoice();
+}
+
 void SoundManager::CloseAl(){
     //alDeleteSources(1, &source);
     //alDeleteBuffers(1, &buffer);
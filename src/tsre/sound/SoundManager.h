@@ -20,10 +20,19 @@
 #endif
 #include <QString>
 #include <QMap>
+#include <QHash>
+#include <QVector>
 
 class SoundSource;
 class SoundDefinitionGroup;
 
+/*
+ * Sound buffers are shared by file path and refcounted, every trigger
+ * that plays the same .wav uses one AL buffer.
+ * AL sources are voices given only to the Game::soundVoices most audible
+ * playing streams, other streams keep their state and stay virtual
+ * until the listener comes closer.
+ */
 class SoundManager {
 public:
     static QMap<int, SoundSource*> Sources;
@@ -40,7 +49,25 @@ public:
     static int AddSoundSource(SoundDefinitionGroup* g);
     static int InitSource(QString path);
     
+    static int GetBuffer(QString path);
+    static void ReleaseBuffer(int alBid);
+    static int AcquireVoice();
+    static void ReleaseVoice(int alSid);
+    static void UpdateVoices();
+    static float GetListenerDistance(int x, int y, float *pos);
+    
 private:
+    struct SoundBuffer {
+        QString path;
+        int refCount = 0;
+        int bytes = 0;
+    };
+    static QHash<QString, int> BufferIds;
+    static QHash<int, SoundBuffer> Buffers;
+    static QVector<int> FreeVoices;
+    static int VoicesCount;
+    
+    static bool LoadWav(int alBid, QString path);
 
     static ALCdevice *device;
     static ALCcontext *context;
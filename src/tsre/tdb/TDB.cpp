@@ -11,6 +11,8 @@
 #include <tsre/tdb/TDB.h>
 #include <QDebug>
 #include <functional>
+#include <algorithm>
+#include <math.h>
 #include <tsre/Game.h>
 #include <tsre/fileFunctions/ParserX.h>
 #include <tsre/fileFunctions/ReadFile.h>
@@ -32,6 +34,7 @@
 #include <tsre/ErrorMessagesLib.h>
 #include <tsre/ErrorMessage.h>
 #include <tsre/world/Route.h>
+#include <tsre/renderer/FrameScheduler.h>
 
 std::unordered_map<int, TRitem*>* TDB::StaticTrackItems;
 
@@ -57,7 +60,7 @@ TDB::TDB(TSectionDAT* tsection, bool road) {
 
 void TDB::loadTdb(){
 
-    QString sh;
+    ParserX::Token sh;
     QString extension = "tdb";
     if(this->road) extension = "rdb";
     QString path = Game::root + "/routes/" + Game::route + "/" + Game::routeName + "." + extension;
@@ -73,7 +76,7 @@ void TDB::loadTdb(){
     ParserX::NextLine(data);
     iTRnodes = 0;
     
-    while (!((sh = ParserX::NextTokenInside(data).toLower()) == "")) {
+    while (!((sh = ParserX::NextTokenView(data)).isEmpty())) {
         if (sh == "trackdb") {
             loadUtf16Data(data);
             ParserX::SkipToken(data);
@@ -111,17 +114,17 @@ void TDB::loadUtf16Data(FileBuffer *data){
     float xx;
     int t;
     bool ok;
-    QString sh;
-            while (!((sh = ParserX::NextTokenInside(data).toLower()) == "")) {
+    ParserX::Token sh;
+            while (!((sh = ParserX::NextTokenView(data)).isEmpty())) {
                 if(sh == "tracknodes"){
                     iTRnodes = (int) ParserX::GetNumber(data); //odczytanie ilosci sciezek
                     qDebug() << "TDB TrackNodes count " << iTRnodes;
 
-                    while (!((sh = ParserX::NextTokenInside(data).toLower()) == "")) {
+                    while (!((sh = ParserX::NextTokenView(data)).isEmpty())) {
                         if(sh == "tracknode"){
                             t = (int) ParserX::GetNumber(data); // odczytanie numeru sciezki
                             trackNodes[t] = new TRnode();
-                            while (!((sh = ParserX::NextTokenInside(data).toLower()) == "")) {
+                            while (!((sh = ParserX::NextTokenView(data)).isEmpty())) {
                                 if(sh == "trendnode"){
                                     trackNodes[t]->typ = 0; //typ endnode
                                     ParserX::SkipToken(data);
@@ -129,7 +132,7 @@ void TDB::loadUtf16Data(FileBuffer *data){
                                 }
                                 if(sh == "trvectornode"){
                                     trackNodes[t]->typ = 1; //typ vector 
-                                    while (!((sh = ParserX::NextTokenInside(data).toLower()) == "")) {
+                                    while (!((sh = ParserX::NextTokenView(data)).isEmpty())) {
                                         if(sh == "trvectorsections"){
                                             uu = (int) ParserX::GetNumberInside(data, &ok);
                                             if(ok){
@@ -219,19 +222,19 @@ void TDB::loadUtf16Data(FileBuffer *data){
                 if(sh == "tritemtable"){
                     iTRitems = (int) ParserX::GetNumber(data); //odczytanie ilosci sciezek
                     TRitem* nowy;
-                    while (!((sh = ParserX::NextTokenInside(data).toLower()) == "")) {
+                    while (!((sh = ParserX::NextTokenView(data)).isEmpty())) {
                         //qDebug() <<"ssh1 "<< sh;
                         nowy = new TRitem();
                         if(this->road)
                             nowy->tdbId = 1;
                         
-                        if(!nowy->init(sh)){
+                        if(!nowy->init(sh.toString())){
                             qDebug() << "#TDB TrItemTable undefined token " << sh;
                             ParserX::SkipToken(data);
                             continue;
                         }
 
-                        while (!((sh = ParserX::NextTokenInside(data).toLower()) == "")) {
+                        while (!((sh = ParserX::NextTokenView(data)).isEmpty())) {
                             nowy->set(sh, data);
                             ParserX::SkipToken(data);
                         }
@@ -246,6 +249,7 @@ void TDB::loadUtf16Data(FileBuffer *data){
                 qDebug() << "#TDB trackdb undefined token " << sh;
                 ParserX::SkipToken(data);
             }
+            markIndexDirty();
 }
 
 void TDB::updateUiDs(QVector<int*> &trackObjUpdates, int startNode){
@@ -299,7 +303,7 @@ void TDB::updateSectionAndShapeIds(QHash<unsigned int,unsigned int>& fixedSectio
 }
 
 void TDB::loadTit(){
-    QString sh;
+    ParserX::Token sh;
     QString extension = "tit";
     if(this->road) extension = "rit";
     QString path = Game::root + "/routes/" + Game::route + "/" + Game::routeName + "." + extension;
@@ -314,21 +318,21 @@ void TDB::loadTit(){
     bufor->skipBOM();
     ParserX::NextLine(bufor);
     
-    while (!((sh = ParserX::NextTokenInside(bufor).toLower()) == "")) {
+    while (!((sh = ParserX::NextTokenView(bufor)).isEmpty())) {
         if(sh == "tritemtable"){
             int iiTRitems = (int) ParserX::GetNumber(bufor); //odczytanie ilosci sciezek
             TRitem* nowy = new TRitem();
             nowy->titLoading = true;
             
-            while (!((sh = ParserX::NextTokenInside(bufor).toLower()) == "")) {
+            while (!((sh = ParserX::NextTokenView(bufor)).isEmpty())) {
                 //qDebug() <<"ssh2 "<< sh;
-                if(!nowy->init(sh)){
+                if(!nowy->init(sh.toString())){
                     qDebug() << "#TIT TrItemTable undefined token " << sh;
                     ParserX::SkipToken(bufor);
                     continue;
                 }
 
-                while (!((sh = ParserX::NextTokenInside(bufor).toLower()) == "")) {
+                while (!((sh = ParserX::NextTokenView(bufor)).isEmpty())) {
                     nowy->set(sh, bufor);
                     ParserX::SkipToken(bufor);
                 }
@@ -378,6 +382,7 @@ void TDB::mergeTDB(TDB *secondTDB, float offsetXYZ[3], unsigned int& trackNodeOf
         n->addTrackNodeItemOffset(trackNodeOffset, trackItemOffset);
         this->trackNodes[++iTRnodes] = n;
     }
+    markIndexDirty();
     qDebug() << "new tracknodes" << secondTDB->iTRnodes;
     
     // Add new trackItems
@@ -592,7 +597,18 @@ int TDB::findVectorNodeBetweenTwoNodes(int first, int second){
 int TDB::findNearestNode(int &x, int &z, float* p, float* q, float maxD, bool updatePosition) {
     int nearestID = -1;
     float nearestD = 999;
-    for (int j = 1; j <= iTRnodes; j++) {
+    
+    // Only tiles that can hold a node closer than maxD.
+    updateIndex();
+    std::vector<int> nodes;
+    index.getNodes(
+            floor((x*2048 + p[0] - maxD - 1024)/2048), ceil((x*2048 + p[0] + maxD + 1024)/2048),
+            floor((z*2048 + p[2] - maxD - 1024)/2048), ceil((z*2048 + p[2] + maxD + 1024)/2048),
+            nodes);
+    std::sort(nodes.begin(), nodes.end());
+    
+    for (unsigned int i = 0; i < nodes.size(); i++) {
+        int j = nodes[i];
         TRnode* n = trackNodes[j];
         if(n == NULL) continue;
         if (n->typ == 0 || n->typ == 2) {
@@ -883,6 +899,7 @@ int TDB::newJunction(int x, int z, float* p, float* qe, int r, int uid, int end)
     newNode->TrPinK[2] = 0;
     
     newNode->args[1] = r;
+    markIndexDirty(junction);
     
     return junction;
 }
@@ -1037,6 +1054,7 @@ void TDB::moveItemsFrom2to1(int id2, int id1){
     
     section1->trItemRef = array;
     section1->iTri = iTri;
+    markIndexDirty(id1);
 }
 
 float TDB::getVectorSectionLength(int id){
@@ -1295,6 +1313,7 @@ bool TDB::deleteAllTrItemsFromVectorSection(int id){
         }
     }
     vect->iTri = 0;
+    markIndexDirty(id);
     return true;
 }
 
@@ -1495,6 +1514,7 @@ int TDB::rotate(int id){
     for(int i = 0; i < vect->iTri; i++){
         this->trackItems[vect->trItemRef[i]]->flipTrackPos(d);
     }
+    markIndexDirty(id);
     return 0;
 }
 
@@ -1929,7 +1949,12 @@ void TDB::renderAll(GLUU *gluu, float* playerT, float playerRot) {
 
     if (!loaded) return;
     int hash = (int)playerT[0] * 10000 + (int)playerT[1];
-    if (!isInitLines || lineHash != hash) {
+    // After edits the old lines stay valid until the rebuild gets time,
+    // a new camera tile needs them rebuilt now.
+    qint64 rebuildStart = -1;
+    if (!isInitLines || lineHash != hash)
+        rebuildStart = FrameScheduler::begin(FrameScheduler::Background, &linieSieci, lineHash != hash || !linieSieci.loaded);
+    if (rebuildStart >= 0) {
         TRnode *n;
         int lLen = 0, kLen = 0, pLen = 0;
         //qDebug() <<"update";
@@ -2048,6 +2073,7 @@ void TDB::renderAll(GLUU *gluu, float* playerT, float playerRot) {
         delete[] linie;
         delete[] konce;
         delete[] punkty;
+        FrameScheduler::end(FrameScheduler::Background, rebuildStart);
     }
 
     gluu->currentShader->setUniformValue(gluu->currentShader->mvMatrixUniform, *reinterpret_cast<float(*)[4][4]> (gluu->mvMatrix));
@@ -2079,28 +2105,35 @@ void TDB::getLines(float * &lineBuffer, int &length, float* playerT){
     Vector3f o;
     collisionLineHash = hash;
     int len = 0;
+    
+    updateIndex();
+    std::vector<TDBIndex::Section> sections;
+    index.getSections(floor(playerT[0]) - 1, ceil(playerT[0]) + 1, floor(playerT[1]) - 1, ceil(playerT[1]) + 1, sections);
+    std::sort(sections.begin(), sections.end());
 
-    for (int j = 1; j <= iTRnodes; j++) {
-        TRnode* n = trackNodes[j];
+    for (unsigned int k = 0; k < sections.size(); k++) {
+        TRnode* n = trackNodes[sections[k].node];
+        int i = sections[k].idx;
         if (n == NULL) continue;
-        if (n->typ == -1) continue;
         if (n->typ == 1) {
-            for (int i = 0; i < n->iTrv; i++) {
+            {
                 if (fabs(n->trVectorSection[i].param[8] - playerT[0]) > 1 || fabs(-n->trVectorSection[i].param[9] - playerT[1]) > 1) continue;
                 len += getLineBufferSize((int) n->trVectorSection[i].param[0], 6, 0);
             }
         }
     }
     //qDebug() << "len" << len;
+    delete[] this->collisionLineBuffer;
     this->collisionLineBuffer = new float[len];
     float* ptr = this->collisionLineBuffer;
 
-    for (int j = 1; j <= iTRnodes; j++) {
+    for (unsigned int k = 0; k < sections.size(); k++) {
+        int j = sections[k].node;
         TRnode* n = trackNodes[j];
+        int i = sections[k].idx;
         if (n == NULL) continue;
-        if (n->typ == -1) continue;
         if (n->typ == 1) {
-            for (int i = 0; i < n->iTrv; i++) {
+            {
                 if (fabs(n->trVectorSection[i].param[8] - playerT[0]) > 1 || fabs(-n->trVectorSection[i].param[9] - playerT[1]) > 1) continue;
                 p.set(
                         (n->trVectorSection[i].param[8] - playerT[0])*2048 + n->trVectorSection[i].param[10],
@@ -2166,7 +2199,10 @@ void TDB::renderLines(GLUU *gluu, float* playerT, float playerRot) {
 
     if (!loaded) return;
     int hash = (int)playerT[0] * 10000 + (int)playerT[1];
-    if (!sectionLines.loaded || sectionHash != hash || !isInitSectLines) {
+    qint64 rebuildStart = -1;
+    if (!sectionLines.loaded || sectionHash != hash || !isInitSectLines)
+        rebuildStart = FrameScheduler::begin(FrameScheduler::Background, &sectionLines, !sectionLines.loaded || sectionHash != hash);
+    if (rebuildStart >= 0) {
         Vector3f p;
         Vector3f o;
         sectionHash = hash;
@@ -2239,6 +2275,7 @@ void TDB::renderLines(GLUU *gluu, float* playerT, float playerRot) {
             sectionLines.setMaterial(1.0, 1.0, 0.0);
         sectionLines.init(punkty, ptr - punkty, RenderItem::V, GL_LINES);
         delete[] punkty;
+        FrameScheduler::end(FrameScheduler::Background, rebuildStart);
     }
 
     gluu->currentShader->setUniformValue(gluu->currentShader->mvMatrixUniform, *reinterpret_cast<float(*)[4][4]> (gluu->mvMatrix));
@@ -2322,30 +2359,19 @@ bool TDB::getDrawPositionOnTrNode(float* out, int id, float metry, float *sElev)
 }
 
 int TDB::findTrItemNodeId(int id){
-    for (int j = 1; j <= iTRnodes; j++) {
-        TRnode* n = trackNodes[j];
-        if (n == NULL) continue;
-        if (n->typ == 1) {
-            for (int i = 0; i < n->iTri; i++) {
-                if(n->trItemRef[i] == id)
-                    return j;
-            }
-        }
-    }
-    return -1;
+    updateIndex();
+    const std::vector<int>* nodes = index.getItemNodes(id);
+    if(nodes == NULL)
+        return -1;
+    return nodes->front();
 }
 
 int TDB::findTrItemNodeIds(int id, QVector<int>& ids){
-    for (int j = 1; j <= iTRnodes; j++) {
-        TRnode* n = trackNodes[j];
-        if (n == NULL) continue;
-        if (n->typ == 1) {
-            for (int i = 0; i < n->iTri; i++) {
-                if(n->trItemRef[i] == id)
-                    ids.push_back(j);
-            }
-        }
-    }
+    updateIndex();
+    const std::vector<int>* nodes = index.getItemNodes(id);
+    if(nodes != NULL)
+        for(unsigned int i = 0; i < nodes->size(); i++)
+            ids.push_back((*nodes)[i]);
     if(ids.size() == 0)
         return -1;
     return ids[0];
@@ -3177,6 +3203,7 @@ void TDB::addItemToTrNode(int tid, int iid){
     newVec[n->iTri++] = iid;
     delete[] n->trItemRef;
     n->trItemRef = newVec;
+    markIndexDirty(tid);
 }
 
 void TDB::deleteItemFromTrNode(int tid, int iid){
@@ -3329,6 +3356,7 @@ void TDB::deleteTree(int d) {
                 trackNodes[i] = NULL;
             }
         }
+        markIndexDirty();
         TDB::refresh();
     }
     
@@ -3367,6 +3395,7 @@ bool TDB::deleteNulls() {
                         trackNodes[trackNodes[i]->TrPinS[j]]->podmienTrPin(stare, i);
                 }
                 replaceSignalDirJunctionId(stare, i);
+                markIndexDirty();
                 return true;
             }
         }
@@ -3438,7 +3467,42 @@ void TDB::saveEmpty(bool road) {
 }
     
 void TDB::updateTrNode(int nid){
-    
+    markIndexDirty(nid);
+}
+
+void TDB::markIndexDirty(int nid){
+    if(nid <= 0)
+        return;
+    indexDirty.push_back(nid);
+}
+
+void TDB::markIndexDirty(){
+    indexRebuild = true;
+    indexDirty.clear();
+}
+
+/*
+ * Applies node changes to the index, called before every indexed query.
+ */
+void TDB::updateIndex(){
+    if(indexRebuild){
+        index.clear();
+        for(int i = 1; i <= iTRnodes; i++){
+            auto it = trackNodes.find(i);
+            if(it != trackNodes.end())
+                index.insert(i, it->second);
+        }
+        indexRebuild = false;
+        indexDirty.clear();
+        return;
+    }
+    for(unsigned int i = 0; i < indexDirty.size(); i++){
+        index.remove(indexDirty[i]);
+        auto it = trackNodes.find(indexDirty[i]);
+        if(it != trackNodes.end())
+            index.insert(indexDirty[i], it->second);
+    }
+    indexDirty.clear();
 }
 
 void TDB::updateTrItem(int iid){
@@ -3490,12 +3554,12 @@ void TDB::save() {
 }
 
 int TDB::updateTrNodeData(FileBuffer *data){
-    QString sh;
+    ParserX::Token sh;
     int nid = 0;
 
     TRnode *nowy = NULL;
     
-    while (!((sh = ParserX::NextTokenInside(data).toLower()) == "")) {
+    while (!((sh = ParserX::NextTokenView(data)).isEmpty())) {
         qDebug() << sh;
         if (sh == ("id")) {
             nid = ParserX::GetNumber(data);
@@ -3520,18 +3584,19 @@ int TDB::updateTrNodeData(FileBuffer *data){
         ParserX::SkipToken(data);
         continue;
     }
+    markIndexDirty(nid);
     return nid;
 }
 
 TRitem *TDB::updateTrItemData(FileBuffer *data){
-    QString sh;
+    ParserX::Token sh;
     int nid = 0;
 
     TRitem *nowy = new TRitem();
     if(this->road)
         nowy->tdbId = 1;
     
-    while (!((sh = ParserX::NextTokenInside(data).toLower()) == "")) {
+    while (!((sh = ParserX::NextTokenView(data)).isEmpty())) {
         qDebug() << sh;
         if (sh == ("id")) {
             nid = ParserX::GetNumber(data);
@@ -3545,12 +3610,12 @@ TRitem *TDB::updateTrItemData(FileBuffer *data){
             ParserX::SkipToken(data);
             continue;
         }
-        if(!nowy->init(sh)){
+        if(!nowy->init(sh.toString())){
             qDebug() << "#TDB TrItemTable undefined token " << sh;
             ParserX::SkipToken(data);
             continue;
         } else {
-            while (!((sh = ParserX::NextTokenInside(data).toLower()) == "")) {
+            while (!((sh = ParserX::NextTokenView(data)).isEmpty())) {
                 nowy->set(sh, data);
                 ParserX::SkipToken(data);
             }
@@ -3566,10 +3631,10 @@ TRitem *TDB::updateTrItemData(FileBuffer *data){
 }
 
 void TDB::updateTrackShapeData(FileBuffer *data){
-    QString sh;
+    ParserX::Token sh;
     TrackShape *nowy = new TrackShape();
     
-    while (!((sh = ParserX::NextTokenInside(data).toLower()) == "")) {
+    while (!((sh = ParserX::NextTokenView(data)).isEmpty())) {
         qDebug() << sh;
         if (sh == ("trackshape")) {
             nowy->loadUtf16Data(data);
@@ -3585,10 +3650,10 @@ void TDB::updateTrackShapeData(FileBuffer *data){
 }
 
 void TDB::updateTrackSectionData(FileBuffer *data){
-    QString sh;
+    ParserX::Token sh;
     TSection *nowy = new TSection();
     
-    while (!((sh = ParserX::NextTokenInside(data).toLower()) == "")) {
+    while (!((sh = ParserX::NextTokenView(data)).isEmpty())) {
         qDebug() << sh;
         if (sh == ("tracksection")) {
             nowy->loadUtf16Data(data);
@@ -3763,9 +3828,10 @@ TDB::TDB(const TDB& o) {
     endIdObj = o.endIdObj;
     junctIdObj = o.junctIdObj;
     
-    collisionLineBuffer = o.collisionLineBuffer;
-    collisionLineLength = o.collisionLineLength;
-    collisionLineHash = o.collisionLineHash;
+    // getLines() frees the buffer, each copy builds its own.
+    collisionLineBuffer = NULL;
+    collisionLineLength = 0;
+    collisionLineHash = 0;
     
     // deep copy
     loaded = o.loaded;
@@ -3801,6 +3867,7 @@ TDB::~TDB() {
             continue;
         delete it->second;
     }
+    delete[] collisionLineBuffer;
 }
 
 void TDB::getUsedTileList(QMap<int, QPair<int, int>*> &tileList, int radius, int step){
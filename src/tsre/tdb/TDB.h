@@ -22,6 +22,7 @@
 #include <tsre/world/objects/SignalObj.h>
 #include <tsre/math3d/Vector4f.h>
 #include <tsre/ErrorMessage.h>
+#include <tsre/tdb/TDBIndex.h>
 
 class TRnode;
 class TRitem;
@@ -61,6 +62,8 @@ public:
     virtual ~TDB();
     virtual int getNextItrNode();
     void refresh();
+    void markIndexDirty(int nid);
+    void markIndexDirty();
     virtual void updateTrNode(int nid);
     virtual void updateTrItem(int iid);
     virtual void updateTrackSection(int id);
@@ -178,6 +181,11 @@ protected:
     int collisionLineLength = 0;
     int collisionLineHash = 0;
     
+    TDBIndex index;
+    std::vector<int> indexDirty;
+    bool indexRebuild = true;
+    void updateIndex();
+    
     std::unordered_map<int, TextObj*> endIdObj;
     std::unordered_map<int, TextObj*> junctIdObj;
     
@@ -24,6 +24,7 @@ TDBClient::TDBClient(const TDBClient& o) : TDB(o){
 void TDBClient::updateTrNode(int nid){
     if(nid < 0)
         return;
+    TDB::updateTrNode(nid);
     Game::serverClient->updateTrackNodeData(nid, this->tdbId, this->trackNodes[nid]);
 }
 
@@ -0,0 +1,106 @@
+/*  This file is part of TSRE5.
+ *
+ *  TSRE5 - train sim game engine and MSTS/OR Editors. 
+ *  Copyright (C) 2016 Piotr Gadecki <pgadecki@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later. 
+ *
+ *  See LICENSE.md or https://www.gnu.org/licenses/gpl.html
+ */
+
+#include <tsre/tdb/TDBIndex.h>
+#include <tsre/tdb/TRnode.h>
+#include <algorithm>
+
+long long int TDBIndex::tileKey(int x, int z){
+    return ((long long int)x << 32) | (unsigned int)z;
+}
+
+void TDBIndex::clear(){
+    tileSections.clear();
+    tileNodes.clear();
+    itemNodes.clear();
+    nodeKeys.clear();
+}
+
+void TDBIndex::insert(int nid, TRnode* n){
+    if(n == NULL)
+        return;
+    NodeKeys &keys = nodeKeys[nid];
+    if(n->typ == 1){
+        for(int i = 0; i < n->iTrv; i++){
+            long long int key = tileKey(n->trVectorSection[i].param[8], -n->trVectorSection[i].param[9]);
+            tileSections[key].push_back({nid, i});
+            if(std::find(keys.sectionTiles.begin(), keys.sectionTiles.end(), key) == keys.sectionTiles.end())
+                keys.sectionTiles.push_back(key);
+        }
+        for(int i = 0; i < n->iTri; i++){
+            // Kept sorted, lookups return the lowest node id first.
+            std::vector<int> &nodes = itemNodes[n->trItemRef[i]];
+            nodes.insert(std::upper_bound(nodes.begin(), nodes.end(), nid), nid);
+            keys.items.push_back(n->trItemRef[i]);
+        }
+    } else if(n->typ == 0 || n->typ == 2){
+        keys.nodeTile = tileKey(n->UiD[4], -n->UiD[5]);
+        keys.endpoint = true;
+        tileNodes[keys.nodeTile].push_back(nid);
+    }
+}
+
+void TDBIndex::remove(int nid){
+    auto it = nodeKeys.find(nid);
+    if(it == nodeKeys.end())
+        return;
+    NodeKeys &keys = it->second;
+    for(unsigned int i = 0; i < keys.sectionTiles.size(); i++){
+        std::vector<Section> &sections = tileSections[keys.sectionTiles[i]];
+        sections.erase(std::remove_if(sections.begin(), sections.end(), 
+                [nid](const Section& s){ return s.node == nid; }), sections.end());
+        if(sections.size() == 0)
+            tileSections.erase(keys.sectionTiles[i]);
+    }
+    if(keys.endpoint){
+        std::vector<int> &nodes = tileNodes[keys.nodeTile];
+        nodes.erase(std::remove(nodes.begin(), nodes.end(), nid), nodes.end());
+        if(nodes.size() == 0)
+            tileNodes.erase(keys.nodeTile);
+    }
+    for(unsigned int i = 0; i < keys.items.size(); i++){
+        std::vector<int> &nodes = itemNodes[keys.items[i]];
+        auto n = std::lower_bound(nodes.begin(), nodes.end(), nid);
+        if(n != nodes.end() && *n == nid)
+            nodes.erase(n);
+        if(nodes.size() == 0)
+            itemNodes.erase(keys.items[i]);
+    }
+    nodeKeys.erase(it);
+}
+
+void TDBIndex::getSections(int minX, int maxX, int minZ, int maxZ, std::vector<Section> &out){
+    for(int x = minX; x <= maxX; x++){
+        for(int z = minZ; z <= maxZ; z++){
+            auto it = tileSections.find(tileKey(x, z));
+            if(it == tileSections.end())
+                continue;
+            out.insert(out.end(), it->second.begin(), it->second.end());
+        }
+    }
+}
+
+void TDBIndex::getNodes(int minX, int maxX, int minZ, int maxZ, std::vector<int> &out){
+    for(int x = minX; x <= maxX; x++){
+        for(int z = minZ; z <= maxZ; z++){
+            auto it = tileNodes.find(tileKey(x, z));
+            if(it == tileNodes.end())
+                continue;
+            out.insert(out.end(), it->second.begin(), it->second.end());
+        }
+    }
+}
+
+const std::vector<int>* TDBIndex::getItemNodes(int itemId){
+    auto it = itemNodes.find(itemId);
+    if(it == itemNodes.end())
+        return NULL;
+    return &it->second;
+}
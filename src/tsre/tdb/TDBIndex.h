@@ -0,0 +1,61 @@
+/*  This file is part of TSRE5.
+ *
+ *  TSRE5 - train sim game engine and MSTS/OR Editors. 
+ *  Copyright (C) 2016 Piotr Gadecki <pgadecki@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later. 
+ *
+ *  See LICENSE.md or https://www.gnu.org/licenses/gpl.html
+ */
+
+#ifndef TDBINDEX_H
+#define	TDBINDEX_H
+
+#include <unordered_map>
+#include <vector>
+
+class TRnode;
+
+/*
+ * Lookup tables over TDB track nodes:
+ * - vector sections by the tile they start in,
+ * - end and junction nodes by tile,
+ * - track item id to the vector nodes referencing it.
+ * Tiles are in editor coordinates (x, -z of the .tdb file).
+ * TDB keeps it up to date node by node, see TDB::updateTrNode.
+ */
+class TDBIndex {
+public:
+    struct Section {
+        int node;
+        int idx;
+        bool operator < (const Section& s) const {
+            if(node != s.node)
+                return node < s.node;
+            return idx < s.idx;
+        }
+    };
+    
+    void clear();
+    void insert(int nid, TRnode* n);
+    void remove(int nid);
+    void getSections(int minX, int maxX, int minZ, int maxZ, std::vector<Section> &out);
+    void getNodes(int minX, int maxX, int minZ, int maxZ, std::vector<int> &out);
+    const std::vector<int>* getItemNodes(int itemId);
+
+private:
+    struct NodeKeys {
+        std::vector<long long int> sectionTiles;
+        long long int nodeTile;
+        bool endpoint = false;
+        std::vector<int> items;
+    };
+    std::unordered_map<long long int, std::vector<Section>> tileSections;
+    std::unordered_map<long long int, std::vector<int>> tileNodes;
+    std::unordered_map<int, std::vector<int>> itemNodes;
+    std::unordered_map<int, NodeKeys> nodeKeys;
+    static long long int tileKey(int x, int z);
+};
+
+#endif	/* TDBINDEX_H */
+
@@ -293,6 +293,51 @@ TRitem::TRitem(const TRitem& o) {
     
 }
 
+static bool sameArray(const void* a, const void* b, int size){
+    if(a == NULL || b == NULL)
+        return a == b;
+    return memcmp(a, b, size) == 0;
+}
+
+// Exact comparison of the data saved to .tdb/.tit, used by Undo to find changed items.
+bool TRitem::sameData(TRitem* o){
+    if(type != o->type || tdbId != o->tdbId || trItemId != o->trItemId)
+        return false;
+    if(memcmp(&trItemSData1, &o->trItemSData1, sizeof(float)) != 0 || trItemSData2 != o->trItemSData2)
+        return false;
+    if(!sameArray(trItemPData, o->trItemPData, sizeof(float[4])))
+        return false;
+    if(!sameArray(trItemRData, o->trItemRData, sizeof(float[5])))
+        return false;
+    if(!sameArray(crossoverTrItemData, o->crossoverTrItemData, sizeof(int[2])))
+        return false;
+    if(!sameArray(platformTrItemData, o->platformTrItemData, sizeof(unsigned int[2])))
+        return false;
+    if(platformName != o->platformName || stationName != o->stationName)
+        return false;
+    if(platformMinWaitingTime != o->platformMinWaitingTime || platformNumPassengersWaiting != o->platformNumPassengersWaiting)
+        return false;
+    if(!sameArray(trItemSRData, o->trItemSRData, sizeof(float[3])))
+        return false;
+    if(!sameArray(speedpostTrItemData, o->speedpostTrItemData, sizeof(float[4])))
+        return false;
+    if(speedpostTrItemDataLength != o->speedpostTrItemDataLength)
+        return false;
+    if(trSignalType1 != o->trSignalType1 || trSignalType2 != o->trSignalType2)
+        return false;
+    if(memcmp(&trSignalType3, &o->trSignalType3, sizeof(float)) != 0 || trSignalType4 != o->trSignalType4)
+        return false;
+    if(trSignalDirs != o->trSignalDirs)
+        return false;
+    if(!sameArray(trSignalDir, o->trSignalDir, sizeof(int)*trSignalDirs*4))
+        return false;
+    if(!sameArray(trSignalRDir, o->trSignalRDir, sizeof(float)*trSignalDirs*6))
+        return false;
+    if(memcmp(&pickupTrItemData1, &o->pickupTrItemData1, sizeof(float)) != 0 || pickupTrItemData2 != o->pickupTrItemData2)
+        return false;
+    return titLoading == o->titLoading;
+}
+
 TRitem::~TRitem() {
     if(trItemPData != NULL)
         delete[] trItemPData;
@@ -337,7 +382,7 @@ bool TRitem::init(QString sh) {
     return false;
 }
 
-void TRitem::set(QString sh, FileBuffer* data) {
+void TRitem::set(ParserX::Token sh, FileBuffer* data) {
     //qDebug() << "---"<< sh;
     if (sh == ("tritemid")) {
         trItemId = ParserX::GetUInt(data);
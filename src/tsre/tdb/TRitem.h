@@ -18,6 +18,7 @@
 #include <QString>
 #include <tsre/ogl/Pointer3d.h>
 #include <tsre/GameObj.h>
+#include <tsre/fileFunctions/ParserX.h>
 
 class FileBuffer;
 class QTextStream;
@@ -48,6 +49,7 @@ public:
     TRitem(int id);
     TRitem(const TRitem& o);
     virtual ~TRitem();
+    bool sameData(TRitem* o);
     
     QString type;
     
@@ -81,7 +83,7 @@ public:
     unsigned int pickupTrItemData2;
     
     bool init(QString sh);
-    void set(QString sh, FileBuffer* data);
+    void set(ParserX::Token sh, FileBuffer* data);
     void save(QTextStream* out);
     void save(QTextStream* out, bool tit);
     void addToTrackPos(float d);
@@ -60,11 +60,11 @@ TRnode::~TRnode() {
 
 void TRnode::loadUtf16Data(FileBuffer *data){
     bool ok = false;
-    QString sh = "";
+    ParserX::Token sh;
     int i = 0, j = 0, ii = 0, uu = 0;
     float xx = 0;
     int t = (int) ParserX::GetNumber(data); // odczytanie numeru sciezki
-                            while (!((sh = ParserX::NextTokenInside(data).toLower()) == "")) {
+                            while (!((sh = ParserX::NextTokenView(data)).isEmpty())) {
                                 if(sh == "trendnode"){
                                     typ = 0; //typ endnode
                                     ParserX::SkipToken(data);
@@ -72,7 +72,7 @@ void TRnode::loadUtf16Data(FileBuffer *data){
                                 }
                                 if(sh == "trvectornode"){
                                     typ = 1; //typ vector 
-                                    while (!((sh = ParserX::NextTokenInside(data).toLower()) == "")) {
+                                    while (!((sh = ParserX::NextTokenView(data)).isEmpty())) {
                                         if(sh == "trvectorsections"){
                                             int uu = (int) ParserX::GetNumberInside(data, &ok);
                                             if(ok){
@@ -239,6 +239,25 @@ bool TRnode::equals(TRnode* r) {
     return false;
 }
 
+// Exact comparison of all stored data, used by Undo to find changed nodes.
+bool TRnode::sameData(TRnode* r) {
+    if (typ != r->typ || iTrv != r->iTrv || iTri != r->iTri)
+        return false;
+    if (TrP1 != r->TrP1 || TrP2 != r->TrP2)
+        return false;
+    if (memcmp(args, r->args, sizeof(int[3])) != 0)
+        return false;
+    if (memcmp(UiD, r->UiD, sizeof(float[12])) != 0)
+        return false;
+    if (memcmp(TrPinS, r->TrPinS, sizeof(int[3])) != 0 || memcmp(TrPinK, r->TrPinK, sizeof(int[3])) != 0)
+        return false;
+    if (iTrv > 0 && memcmp(trVectorSection, r->trVectorSection, sizeof(TRSect)*iTrv) != 0)
+        return false;
+    if (iTri > 0 && memcmp(trItemRef, r->trItemRef, sizeof(int)*iTri) != 0)
+        return false;
+    return true;
+}
+
 bool TRnode::equalsIgnoreType(TRnode* r) {
     if (typ == 1)
         return false;
@@ -43,6 +43,7 @@ public:
     bool isEnd();
     bool equals(TRnode* r);
     bool equalsIgnoreType(TRnode* r);
+    bool sameData(TRnode* r);
     int podmienTrPin(int stare, int nowe);
     bool isLikedTo(int id);
     int setTrPinK(int id, int nowe);
@@ -12,10 +12,15 @@
 #include <tsre/fileFunctions/ReadFile.h>
 #include <tsre/fileFunctions/FileBuffer.h>
 #include <tsre/texture/Texture.h>
+#include <tsre/texture/S3tc.h>
+#include <tsre/texture/PixelKernels.h>
+#include <tsre/texture/TextureCache.h>
 #include <QDebug>
 #include <QOpenGLShaderProgram>
 #include <QString>
 #include <tsre/Game.h>
+#include <algorithm>
+#include <string.h>
 
 bool AceLib::IsThread = true;
 
@@ -29,6 +34,8 @@ AceLib::AceLib(){
 //bool AceLib::LoadACE(Texture* texture) {
 void AceLib::run() {
 
+    if(TextureCache::enabled() && TextureCache::read(texture))
+        return;
     QFile file(texture->pathid);
     if (!file.open(QIODevice::ReadOnly)){
         texture->missing = true;
@@ -44,7 +51,6 @@ void AceLib::run() {
     unsigned char* bufor = data->data;
     int offset = 0;//-16;
     int typ = 0, dane;
-    unsigned char tempt;
 
     dane = bufor[20 + offset];
     texture->compressed = bufor[32 + offset];
@@ -100,17 +106,20 @@ void AceLib::run() {
     }
 
     texture->bytesPerPixel = (texture->bpp / 8);
-    texture->imageSize = (texture->bytesPerPixel * texture->width * texture->height);
-    texture->imageData = new unsigned char[texture->imageSize];
     if (texture->bpp == 24) {
         texture->type = GL_RGB;
     } else {
         texture->type = GL_RGBA;
     }
+    if (texture->compressed == 18 && S3tc::keepCompressed() && loadDXT1(bufor, data->length)) {
+        delete data;
+        return;
+    }
+    texture->imageSize = (texture->bytesPerPixel * texture->width * texture->height);
+    texture->imageData = new unsigned char[texture->imageSize];
         
     int ptr = 0;
     if (texture->compressed != 18) {
-        int iw = 0, ite;
         if (typ == 0) ptr = 216 + offset;
         if (typ == 1) ptr = 248 + offset;
         if (typ == 2) ptr = 232 + offset;
@@ -125,57 +134,32 @@ void AceLib::run() {
         //if(!IsThread)
         //    qDebug() << "tekstura wtyp" << typ;
             
+        // Rows keep R, G, B and A planes one after another.
+        const int w = texture->width;
+        unsigned char* out = texture->imageData;
         if (typ == 0) {
             for (int ih = 0; ih<texture->height; ih++) {
-                for (iw = 0; iw<texture->width; iw = iw + 1) {
-                    texture->imageData[texture->bytesPerPixel * texture->width * ih + iw * texture->bytesPerPixel] = bufor[ptr++];
-                }
-                for (iw = 0; iw<texture->width; iw = iw + 1) {
-                    texture->imageData[texture->bytesPerPixel * texture->width * ih + iw * texture->bytesPerPixel + 1] = bufor[ptr++];
-                }
-                for (iw = 0; iw<texture->width; iw = iw + 1) {
-                    texture->imageData[texture->bytesPerPixel * texture->width * ih + iw * texture->bytesPerPixel + 2] = bufor[ptr++];
-                }
+                PixelKernels::interleaveRGB(bufor + ptr, bufor + ptr + w, bufor + ptr + 2*w, out + texture->bytesPerPixel * w * ih, w);
+                ptr += 3*w;
             }
         }
         if (typ == 1) {
             for (int ih = 0; ih<texture->height; ih++) {
-                for (iw = 0; iw<texture->width; iw = iw + 1) {
-                    texture->imageData[texture->bytesPerPixel * texture->width * ih + iw * texture->bytesPerPixel] = bufor[ptr++];
-                }
-                for (iw = 0; iw<texture->width; iw = iw + 1) {
-                    texture->imageData[texture->bytesPerPixel * texture->width * ih + iw * texture->bytesPerPixel + 1] = bufor[ptr++];
-                }
-                for (iw = 0; iw<texture->width; iw = iw + 1) {
-                    texture->imageData[texture->bytesPerPixel * texture->width * ih + iw * texture->bytesPerPixel + 2] = bufor[ptr++];
-                }
-                ptr += texture->height / 8;
-                for (iw = 0; iw<texture->width; iw = iw + 1) {
-                    texture->imageData[texture->bytesPerPixel * texture->width * ih + iw * texture->bytesPerPixel + 3] = bufor[ptr++];
-                }
+                const unsigned char* rgb = bufor + ptr;
+                ptr += 3*w + texture->height / 8;
+                PixelKernels::interleaveRGBA(rgb, rgb + w, rgb + 2*w, bufor + ptr, out + texture->bytesPerPixel * w * ih, w);
+                ptr += w;
             }
         }
         if (typ == 2) {
+            unsigned char* alpha = new unsigned char[w];
             for (int ih = 0; ih<texture->height; ih++) {
-                for (iw = 0; iw<texture->width; iw = iw + 1) {
-                    texture->imageData[texture->bytesPerPixel * texture->width * ih + iw * texture->bytesPerPixel] = bufor[ptr++];
-                }
-                for (iw = 0; iw<texture->width; iw = iw + 1) {
-                    texture->imageData[texture->bytesPerPixel * texture->width * ih + iw * texture->bytesPerPixel + 1] = bufor[ptr++];
-                }
-                for (iw = 0; iw<texture->width; iw = iw + 1) {
-                    texture->imageData[texture->bytesPerPixel * texture->width * ih + iw * texture->bytesPerPixel + 2] = bufor[ptr++];
-                }
-                for (iw = 0; iw<texture->width; ptr++) {
-                    for (ite = 0; ite < 8; ite++) {
-                        tempt = (unsigned char)(bufor[ptr] << ite);
-                        texture->imageData[texture->bytesPerPixel * texture->width * ih + iw * texture->bytesPerPixel + 3] = (unsigned char)(tempt >> 7)*255;
-                        iw = iw + 1;
-                        if(iw == texture->width)
-                            break;
-                    }
-                }
+                const unsigned char* rgb = bufor + ptr;
+                PixelKernels::expandMask(bufor + ptr + 3*w, alpha, w);
+                PixelKernels::interleaveRGBA(rgb, rgb + w, rgb + 2*w, alpha, out + texture->bytesPerPixel * w * ih, w);
+                ptr += 3*w + (w + 7) / 8;
             }
+            delete[] alpha;
         }
         //texture->loaded = true;
         //texture->editable = true;        
@@ -284,6 +268,8 @@ void AceLib::run() {
         texture->width = nw;
         texture->height = nh;
     }
+    if(texture->compressed != 18 && TextureCache::enabled())
+        TextureCache::write(texture);
     texture->loaded = true;
     texture->editable = true;        
     //qDebug() << "--";
@@ -292,6 +278,57 @@ void AceLib::run() {
     return;
 }
 
+/*
+ * Keeps the DXT1 payload for glCompressedTexImage2D. Levels after the
+ * first are used while each starts with its expected size.
+ */
+bool AceLib::loadDXT1(unsigned char* bufor, int length) {
+    unsigned int format = texture->bpp == 24 ? S3tc::DXT1 : S3tc::DXT1A;
+    int ptr = 216;
+    int tempp = texture->height;
+    if (texture->bpp == 24) ptr += 4;
+    else ptr += 20;
+    while (tempp >= 1) {
+        ptr += 4;
+        tempp = tempp / 2;
+    }
+
+    int w = texture->width, h = texture->height;
+    int size = S3tc::levelSize(format, w, h);
+    if (ptr + size > length)
+        return false;
+    QVector<int> offsets;
+    offsets.push_back(ptr);
+    int total = size;
+    ptr += size;
+    while ((w > 1 || h > 1) && ptr + 4 <= length) {
+        w = std::max(1, w / 2);
+        h = std::max(1, h / 2);
+        size = S3tc::levelSize(format, w, h);
+        if (*(int*)&bufor[ptr] != size || ptr + 4 + size > length)
+            break;
+        offsets.push_back(ptr + 4);
+        total += size;
+        ptr += 4 + size;
+    }
+
+    texture->imageData = new unsigned char[total];
+    w = texture->width;
+    h = texture->height;
+    for (int i = 0, out = 0; i < offsets.size(); i++) {
+        size = S3tc::levelSize(format, w, h);
+        memcpy(texture->imageData + out, bufor + offsets[i], size);
+        out += size;
+        w = std::max(1, w / 2);
+        h = std::max(1, h / 2);
+    }
+    texture->imageSize = total;
+    texture->compressedFormat = format;
+    texture->mipLevels = offsets.size();
+    texture->loaded = true;
+    return true;
+}
+
 void AceLib::save(QString path, Texture* t){
     path.replace("//", "/");
     QFile *file = new QFile(path);
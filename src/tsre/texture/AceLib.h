@@ -11,21 +11,18 @@
 #ifndef ACELIB_H
 #define	ACELIB_H
 
-#include <QThread>
+#include <tsre/texture/TexLoader.h>
 #include <tsre/texture/Texture.h>
 
-class AceLib : public QThread
- {
-     Q_OBJECT
-
+class AceLib : public TexDecoder {
 public:
     static bool IsThread;
     AceLib();
     //static bool LoadACE(Texture* texture);
-    Texture* texture;
     static void save(QString path, Texture* t);
     void run();
 private:
+    bool loadDXT1(unsigned char* bufor, int length);
     
 protected:
     
@@ -9,12 +9,15 @@
  */
 
 #include <tsre/texture/DdsLib.h>
+#include <tsre/texture/S3tc.h>
 #include <QDebug>
 #include <QString>
 #include <QFile>
 #include <QOpenGLShaderProgram>
 #include <QOpenGLFunctions>
 #include <cstdint>
+#include <algorithm>
+#include <string.h>
 
 bool DdsLib::IsThread = true;
 
@@ -61,206 +64,9 @@ static const quint32 DDPF_RGB         = 0x00000040;
 
 // FOURCCs
 static const quint32 FOURCC_DXT1 = 0x31545844; // "DXT1"
-static const quint32 FOURCC_DXT3 = 0x33545844; // "DXT3" (not handled here)
+static const quint32 FOURCC_DXT3 = 0x33545844; // "DXT3"
 static const quint32 FOURCC_DXT5 = 0x35545844; // "DXT5"
 
-// Helper: 16-bit 565 to RGB8
-static inline void decodeRGB565(quint16 c, uint8_t &r, uint8_t &g, uint8_t &b)
-{
-    r = static_cast<uint8_t>(((c >> 11) & 0x1F) * 255 / 31);
-    g = static_cast<uint8_t>(((c >> 5)  & 0x3F) * 255 / 63);
-    b = static_cast<uint8_t>((c & 0x1F) * 255 / 31);
-}
-
-// Decompress a DXT1 block into a 4x4 RGBA tile
-static void decodeDXT1Block(const uint8_t *block, uint8_t *rgba,
-                            int stride /* bytes per row */, bool &hasAlpha)
-{
-    quint16 c0 = block[0] | (block[1] << 8);
-    quint16 c1 = block[2] | (block[3] << 8);
-
-    uint8_t r0, g0, b0;
-    uint8_t r1, g1, b1;
-    decodeRGB565(c0, r0, g0, b0);
-    decodeRGB565(c1, r1, g1, b1);
-
-    uint8_t colors[4][4]; // RGBA
-    colors[0][0] = r0; colors[0][1] = g0; colors[0][2] = b0; colors[0][3] = 255;
-    colors[1][0] = r1; colors[1][1] = g1; colors[1][2] = b1; colors[1][3] = 255;
-
-    if (c0 > c1) {
-        // 4-color block
-        colors[2][0] = (2 * r0 + r1) / 3;
-        colors[2][1] = (2 * g0 + g1) / 3;
-        colors[2][2] = (2 * b0 + b1) / 3;
-        colors[2][3] = 255;
-
-        colors[3][0] = (r0 + 2 * r1) / 3;
-        colors[3][1] = (g0 + 2 * g1) / 3;
-        colors[3][2] = (b0 + 2 * b1) / 3;
-        colors[3][3] = 255;
-    } else {
-        // 3-color block + 1 transparent
-        colors[2][0] = (r0 + r1) / 2;
-        colors[2][1] = (g0 + g1) / 2;
-        colors[2][2] = (b0 + b1) / 2;
-        colors[2][3] = 255;
-
-        colors[3][0] = 0;
-        colors[3][1] = 0;
-        colors[3][2] = 0;
-        colors[3][3] = 0;   // transparent
-        hasAlpha = true;
-    }
-
-    const uint32_t code = block[4] | (block[5] << 8) | (block[6] << 16) | (block[7] << 24);
-
-    for (int j = 0; j < 4; ++j) {
-        for (int i = 0; i < 4; ++i) {
-            const int idx = (code >> (2 * (4 * j + i))) & 0x03;
-            uint8_t *dst = rgba + j * stride + i * 4;
-            dst[0] = colors[idx][0];
-            dst[1] = colors[idx][1];
-            dst[2] = colors[idx][2];
-            dst[3] = colors[idx][3];
-        }
-    }
-}
-
-// Decompress a DXT3 block into a 4x4 RGBA tile
-static void decodeDXT3Block(const uint8_t *block, uint8_t *rgba, int stride /* bytes per row */)
-{
-    // First 8 bytes: 4-bit alpha for 16 pixels (64 bits)
-    uint64_t alphaBits = 0;
-    for (int i = 0; i < 8; ++i) {
-        alphaBits |= (uint64_t(block[i]) << (8 * i));
-    }
-
-    // Next 8 bytes: color data like DXT1, but always 4-color mode (no implicit transparency)
-    const uint8_t *colorBlock = block + 8;
-
-    quint16 c0 = colorBlock[0] | (colorBlock[1] << 8);
-    quint16 c1 = colorBlock[2] | (colorBlock[3] << 8);
-
-    uint8_t r0, g0, b0;
-    uint8_t r1, g1, b1;
-    decodeRGB565(c0, r0, g0, b0);
-    decodeRGB565(c1, r1, g1, b1);
-
-    uint8_t colors[4][3]; // RGB
-    colors[0][0] = r0; colors[0][1] = g0; colors[0][2] = b0;
-    colors[1][0] = r1; colors[1][1] = g1; colors[1][2] = b1;
-
-    // DXT3 always treats this as a 4-color block (no transparent color)
-    colors[2][0] = (2 * r0 + r1) / 3;
-    colors[2][1] = (2 * g0 + g1) / 3;
-    colors[2][2] = (2 * b0 + b1) / 3;
-
-    colors[3][0] = (r0 + 2 * r1) / 3;
-    colors[3][1] = (g0 + 2 * g1) / 3;
-    colors[3][2] = (b0 + 2 * b1) / 3;
-
-    const uint32_t code = colorBlock[4] | (colorBlock[5] << 8) |
-                          (colorBlock[6] << 16) | (colorBlock[7] << 24);
-
-    for (int j = 0; j < 4; ++j) {
-        for (int i = 0; i < 4; ++i) {
-            const int pixelIndex = 4 * j + i;
-
-            // 4-bit alpha for each pixel
-            const uint8_t alpha4 = (alphaBits >> (4 * pixelIndex)) & 0x0F;
-            const uint8_t a = alpha4 * 17; // scale 0..15 to 0..255
-
-            const int colorIndex = (code >> (2 * pixelIndex)) & 0x03;
-
-            uint8_t *dst = rgba + j * stride + i * 4;
-            dst[0] = colors[colorIndex][0];
-            dst[1] = colors[colorIndex][1];
-            dst[2] = colors[colorIndex][2];
-            dst[3] = a;
-        }
-    }
-}
-
-// Decompress a DXT5 block into a 4x4 RGBA tile
-static void decodeDXT5Block(const uint8_t *block, uint8_t *rgba, int stride)
-{
-    // Alpha
-    const uint8_t alpha0 = block[0];
-    const uint8_t alpha1 = block[1];
-
-    uint8_t alphaTable[8];
-    alphaTable[0] = alpha0;
-    alphaTable[1] = alpha1;
-    if (alpha0 > alpha1) {
-        // 6 interpolated alpha values.
-        alphaTable[2] = (6 * alpha0 + 1 * alpha1) / 7;
-        alphaTable[3] = (5 * alpha0 + 2 * alpha1) / 7;
-        alphaTable[4] = (4 * alpha0 + 3 * alpha1) / 7;
-        alphaTable[5] = (3 * alpha0 + 4 * alpha1) / 7;
-        alphaTable[6] = (2 * alpha0 + 5 * alpha1) / 7;
-        alphaTable[7] = (1 * alpha0 + 6 * alpha1) / 7;
-    } else {
-        // 4 interpolated alpha values, then 0 and 255.
-        alphaTable[2] = (4 * alpha0 + 1 * alpha1) / 5;
-        alphaTable[3] = (3 * alpha0 + 2 * alpha1) / 5;
-        alphaTable[4] = (2 * alpha0 + 3 * alpha1) / 5;
-        alphaTable[5] = (1 * alpha0 + 4 * alpha1) / 5;
-        alphaTable[6] = 0;
-        alphaTable[7] = 255;
-    }
-
-    // 48 bits of alpha indices
-    uint64_t alphaBits = 0;
-    for (int i = 0; i < 6; ++i) {
-        alphaBits |= (uint64_t(block[2 + i]) << (8 * i));
-    }
-
-    // Color data (DXT1-like) in block[8..15]
-    const uint8_t *colorBlock = block + 8;
-
-    quint16 c0 = colorBlock[0] | (colorBlock[1] << 8);
-    quint16 c1 = colorBlock[2] | (colorBlock[3] << 8);
-
-    uint8_t r0, g0, b0;
-    uint8_t r1, g1, b1;
-    decodeRGB565(c0, r0, g0, b0);
-    decodeRGB565(c1, r1, g1, b1);
-
-    uint8_t colors[4][3]; // RGB only
-    colors[0][0] = r0; colors[0][1] = g0; colors[0][2] = b0;
-    colors[1][0] = r1; colors[1][1] = g1; colors[1][2] = b1;
-
-    colors[2][0] = (2 * r0 + r1) / 3;
-    colors[2][1] = (2 * g0 + g1) / 3;
-    colors[2][2] = (2 * b0 + b1) / 3;
-
-    colors[3][0] = (r0 + 2 * r1) / 3;
-    colors[3][1] = (g0 + 2 * g1) / 3;
-    colors[3][2] = (b0 + 2 * b1) / 3;
-
-    const uint32_t code = colorBlock[4] | (colorBlock[5] << 8) |
-                          (colorBlock[6] << 16) | (colorBlock[7] << 24);
-
-    for (int j = 0; j < 4; ++j) {
-        for (int i = 0; i < 4; ++i) {
-            const int pixelIndex = 4 * j + i;
-
-            // color index
-            const int colorIndex = (code >> (2 * pixelIndex)) & 0x03;
-
-            // alpha index (3 bits per pixel)
-            const int alphaIndex = (alphaBits >> (3 * pixelIndex)) & 0x07;
-
-            uint8_t *dst = rgba + j * stride + i * 4;
-            dst[0] = colors[colorIndex][0];
-            dst[1] = colors[colorIndex][1];
-            dst[2] = colors[colorIndex][2];
-            dst[3] = alphaTable[alphaIndex];
-        }
-    }
-}
-
 void DdsLib::run()
 {
     QFile file(texture->pathid);
@@ -344,6 +150,56 @@ void DdsLib::run()
         const int blocksWide  = (width  + 3) / 4;
         const int blocksHigh  = (height + 3) / 4;
 
+        // Keep the blocks and the mip levels in the file for glCompressedTexImage2D.
+        unsigned int format = 0;
+        if (fourCC == FOURCC_DXT1) format = S3tc::DXT1;
+        else if (fourCC == FOURCC_DXT3) format = S3tc::DXT3;
+        else if (fourCC == FOURCC_DXT5) format = S3tc::DXT5;
+        if (format != 0 && S3tc::keepCompressed()) {
+            int levels = 0;
+            int size = 0;
+            int w = int(width), h = int(height);
+            const int maxLevels = std::max(1, int(header.dwMipMapCount));
+            while (levels < maxLevels && size + S3tc::levelSize(format, w, h) <= data.size()) {
+                size += S3tc::levelSize(format, w, h);
+                levels++;
+                if (w == 1 && h == 1) break;
+                w = std::max(1, w / 2);
+                h = std::max(1, h / 2);
+            }
+            if (levels > 0) {
+                if (format == S3tc::DXT1 && (S3tc::dxt1HasAlpha(src, S3tc::levelSize(format, width, height))
+                        || (pf.dwFlags & DDPF_ALPHAPIXELS)))
+                    format = S3tc::DXT1A;
+                if (format == S3tc::DXT1) {
+                    texture->bytesPerPixel = 3;
+                    texture->type = GL_RGB;
+                } else {
+                    texture->bytesPerPixel = 4;
+                    texture->type = GL_RGBA;
+                }
+                if(texture->imageData != nullptr)
+                    delete[] texture->imageData;
+                texture->imageData = new unsigned char[size];
+                memcpy(texture->imageData, src, size);
+                texture->imageSize = size;
+                texture->compressedFormat = format;
+                texture->mipLevels = levels;
+                texture->width  = int(width);
+                texture->height = int(height);
+
+                if (!IsThread) {
+                    qDebug() << "DDS tex (kept compressed):" << texture->pathid
+                             << "w:" << texture->width
+                             << "h:" << texture->height
+                             << "mips:" << texture->mipLevels;
+                }
+
+                texture->loaded = true;
+                return;
+            }
+        }
+
         bool hasAlphaDXT1 = false;
         bool hasAlpha = false;
 
@@ -365,7 +221,7 @@ void DdsLib::run()
                 for (int bx = 0; bx < blocksWide; ++bx) {
                     uint8_t tile[4 * 4 * 4]; // 4x4 RGBA
                     bool tileHasAlpha = false;
-                    decodeDXT1Block(blockPtr, tile, 4 * 4, tileHasAlpha);
+                    S3tc::decodeDXT1Block(blockPtr, tile, 4 * 4, tileHasAlpha);
                     if (tileHasAlpha) hasAlphaDXT1 = true;
 
                     const int x0 = bx * 4;
@@ -423,7 +279,7 @@ void DdsLib::run()
             for (int by = 0; by < blocksHigh; ++by) {
                 for (int bx = 0; bx < blocksWide; ++bx) {
                     uint8_t tile[4 * 4 * 4]; // 4x4 RGBA
-                    decodeDXT3Block(blockPtr, tile, 4 * 4);
+                    S3tc::decodeDXT3Block(blockPtr, tile, 4 * 4);
 
                     const int x0 = bx * 4;
                     const int y0 = by * 4;
@@ -461,7 +317,7 @@ void DdsLib::run()
             for (int by = 0; by < blocksHigh; ++by) {
                 for (int bx = 0; bx < blocksWide; ++bx) {
                     uint8_t tile[4 * 4 * 4]; // 4x4 RGBA
-                    decodeDXT5Block(blockPtr, tile, 4 * 4);
+                    S3tc::decodeDXT5Block(blockPtr, tile, 4 * 4);
 
                     const int x0 = bx * 4;
                     const int y0 = by * 4;
@@ -11,17 +11,13 @@
 #ifndef DDSLIB_H
 #define	DDSLIB_H
 
-#include <QThread>
+#include <tsre/texture/TexLoader.h>
 #include <tsre/texture/Texture.h>
 
-class DdsLib : public QThread
- {
-     Q_OBJECT
-
+class DdsLib : public TexDecoder {
 public:
     static bool IsThread;
     DdsLib();
-    Texture* texture = nullptr;
     //static void save(QString path, Texture* t);
     void run();
 private:
@@ -9,6 +9,7 @@
  */
 
 #include <tsre/texture/ImageLib.h>
+#include <tsre/texture/TextureCache.h>
 #include <QDebug>
 #include <QString>
 #include <QImage>
@@ -20,6 +21,8 @@ ImageLib::ImageLib() {
 }
 
 void ImageLib::run(){
+    if(TextureCache::enabled() && TextureCache::read(texture))
+        return;
     QImage img(texture->pathid);    
 
     if(img.isNull() && !IsThread) {
@@ -61,6 +64,8 @@ void ImageLib::run(){
     //    lineWidth = lineWidth + 4 - lineWidth%4;
     //memcpy(texture->imageData, img.bits(), texture->width*texture->height*texture->bytesPerPixel);
     
+    if(TextureCache::enabled())
+        TextureCache::write(texture);
     texture->loaded = true;
     texture->editable = true;
     
@@ -11,17 +11,13 @@
 #ifndef IMAGELIB_H
 #define	IMAGELIB_H
 
-#include <QThread>
+#include <tsre/texture/TexLoader.h>
 #include <tsre/texture/Texture.h>
 
-class ImageLib : public QThread
- {
-     Q_OBJECT
-
+class ImageLib : public TexDecoder {
 public:
     ImageLib();
     static bool IsThread;
-    Texture* texture;
     void run();
 private:
     
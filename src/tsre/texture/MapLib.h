@@ -11,23 +11,20 @@
 #ifndef MAPLIB_H
 #define	MAPLIB_H
 
-#include <QThread>
+#include <tsre/texture/TexLoader.h>
 #include <tsre/texture/Texture.h>
 #include <unordered_map>
 
 
-class MapLib : public QThread
- {
-     Q_OBJECT
-
+class MapLib : public TexDecoder {
 public:
     MapLib();
-    Texture* texture;
+    void run();
 
 private:
     
 protected:
-     void run();
+
 };
 
 
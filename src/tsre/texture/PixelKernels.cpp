@@ -0,0 +1,499 @@
+/*  This file is part of TSRE5.
+ *
+ *  TSRE5 - train sim game engine and MSTS/OR Editors.
+ *  Copyright (C) 2016 Piotr Gadecki <pgadecki@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *
+ *  See LICENSE.md or https://www.gnu.org/licenses/gpl.html
+ */
+
+#include <tsre/texture/PixelKernels.h>
+#include <tsre/Game.h>
+#include <QDebug>
+#include <string.h>
+
+#if defined(Q_PROCESSOR_X86)
+#define PIXELKERNELS_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(Q_PROCESSOR_ARM_64) && defined(__ARM_NEON) && !defined(__ARM_BIG_ENDIAN)
+#define PIXELKERNELS_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_SSE2
+#define TARGET_AVX2
+#endif
+
+static const char* LevelNames[] = { "scalar", "SSE2", "AVX2", "NEON" };
+
+int PixelKernels::forced = -1;
+
+int PixelKernels::detected(){
+    static const int current = detect();
+    return current;
+}
+
+int PixelKernels::level(){
+    if(forced >= 0)
+        return forced;
+    return detected();
+}
+
+bool PixelKernels::supported(int level){
+    if(level == Scalar)
+        return true;
+    if(detected() == NEON)
+        return level == NEON;
+    return level != NEON && level <= detected();
+}
+
+void PixelKernels::setLevel(int level){
+    if(level >= 0 && !supported(level))
+        return;
+    forced = level;
+}
+
+const char* PixelKernels::levelName(){
+    return LevelNames[level()];
+}
+
+int PixelKernels::detect(){
+    int found = Scalar;
+    if(Game::useSimdKernels){
+#if defined(PIXELKERNELS_X86)
+        // Qt 6 needs SSE2 on x86.
+        found = SSE2;
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        if(info[0] >= 7){
+            __cpuid(info, 1);
+            bool osAvx = (info[2] & (1 << 27)) && (info[2] & (1 << 28));
+            __cpuidex(info, 7, 0);
+            if(osAvx && (info[1] & (1 << 5)) && (_xgetbv(0) & 6) == 6)
+                found = AVX2;
+        }
+#else
+        __builtin_cpu_init();
+        if(__builtin_cpu_supports("avx2"))
+            found = AVX2;
+#endif
+#elif defined(PIXELKERNELS_NEON)
+        found = NEON;
+#endif
+    }
+    qDebug() << "PixelKernels:" << LevelNames[found];
+    return found;
+}
+
+/*===============================================================
+===== Scalar, also used for the ends of rows
+==============================================================*/
+static void interleaveRGBScalar(const unsigned char* r, const unsigned char* g, const unsigned char* b,
+        unsigned char* out, int count){
+    for(int i = 0; i < count; i++){
+        out[i*3 + 0] = r[i];
+        out[i*3 + 1] = g[i];
+        out[i*3 + 2] = b[i];
+    }
+}
+
+static void interleaveRGBAScalar(const unsigned char* r, const unsigned char* g, const unsigned char* b,
+        const unsigned char* a, unsigned char* out, int count){
+    for(int i = 0; i < count; i++){
+        out[i*4 + 0] = r[i];
+        out[i*4 + 1] = g[i];
+        out[i*4 + 2] = b[i];
+        out[i*4 + 3] = a[i];
+    }
+}
+
+static void expandMaskScalar(const unsigned char* bits, unsigned char* out, int first, int count){
+    for(int i = first; i < count; i++)
+        out[i] = ((bits[i >> 3] << (i & 7)) & 0x80) ? 255 : 0;
+}
+
+static void expandBlockScalar(quint32 code, const quint32* palette, unsigned char* rgba, int stride){
+    for(int j = 0; j < 4; j++)
+        for(int i = 0; i < 4; i++)
+            memcpy(rgba + j*stride + i*4, &palette[(code >> (2*(4*j + i))) & 0x03], 4);
+}
+
+static void expandBlockAlphaScalar(quint64 bits, const unsigned char* table, unsigned char* rgba, int stride){
+    for(int j = 0; j < 4; j++)
+        for(int i = 0; i < 4; i++)
+            rgba[j*stride + i*4 + 3] = table[(bits >> (3*(4*j + i))) & 0x07];
+}
+
+#if defined(PIXELKERNELS_X86)
+/*===============================================================
+===== SSE2
+==============================================================*/
+// Four RGBx pixels to 12 bytes of RGB.
+TARGET_SSE2 static inline void storeRGB12(unsigned char* out, __m128i v){
+    const __m128i low = _mm_set_epi32(0, 0xFFFFFF, 0, 0xFFFFFF);
+    const __m128i high = _mm_set_epi32(0xFFFF, (int)0xFF000000, 0xFFFF, (int)0xFF000000);
+    __m128i w = _mm_or_si128(_mm_and_si128(v, low), _mm_and_si128(_mm_srli_epi64(v, 8), high));
+    w = _mm_or_si128(_mm_move_epi64(w), _mm_slli_si128(_mm_srli_si128(w, 8), 6));
+    _mm_storel_epi64((__m128i*)out, w);
+    int last = _mm_cvtsi128_si32(_mm_srli_si128(w, 8));
+    memcpy(out + 8, &last, 4);
+}
+
+TARGET_SSE2 static void interleaveRGBSse2(const unsigned char* r, const unsigned char* g, const unsigned char* b,
+        unsigned char* out, int count){
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for(; i + 16 <= count; i += 16){
+        __m128i vr = _mm_loadu_si128((const __m128i*)(r + i));
+        __m128i vg = _mm_loadu_si128((const __m128i*)(g + i));
+        __m128i vb = _mm_loadu_si128((const __m128i*)(b + i));
+        __m128i rgLo = _mm_unpacklo_epi8(vr, vg);
+        __m128i rgHi = _mm_unpackhi_epi8(vr, vg);
+        __m128i bxLo = _mm_unpacklo_epi8(vb, zero);
+        __m128i bxHi = _mm_unpackhi_epi8(vb, zero);
+        unsigned char* o = out + i*3;
+        storeRGB12(o, _mm_unpacklo_epi16(rgLo, bxLo));
+        storeRGB12(o + 12, _mm_unpackhi_epi16(rgLo, bxLo));
+        storeRGB12(o + 24, _mm_unpacklo_epi16(rgHi, bxHi));
+        storeRGB12(o + 36, _mm_unpackhi_epi16(rgHi, bxHi));
+    }
+    interleaveRGBScalar(r + i, g + i, b + i, out + i*3, count - i);
+}
+
+TARGET_SSE2 static void interleaveRGBASse2(const unsigned char* r, const unsigned char* g, const unsigned char* b,
+        const unsigned char* a, unsigned char* out, int count){
+    int i = 0;
+    for(; i + 16 <= count; i += 16){
+        __m128i vr = _mm_loadu_si128((const __m128i*)(r + i));
+        __m128i vg = _mm_loadu_si128((const __m128i*)(g + i));
+        __m128i vb = _mm_loadu_si128((const __m128i*)(b + i));
+        __m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+        __m128i rgLo = _mm_unpacklo_epi8(vr, vg);
+        __m128i rgHi = _mm_unpackhi_epi8(vr, vg);
+        __m128i baLo = _mm_unpacklo_epi8(vb, va);
+        __m128i baHi = _mm_unpackhi_epi8(vb, va);
+        __m128i* o = (__m128i*)(out + i*4);
+        _mm_storeu_si128(o, _mm_unpacklo_epi16(rgLo, baLo));
+        _mm_storeu_si128(o + 1, _mm_unpackhi_epi16(rgLo, baLo));
+        _mm_storeu_si128(o + 2, _mm_unpacklo_epi16(rgHi, baHi));
+        _mm_storeu_si128(o + 3, _mm_unpackhi_epi16(rgHi, baHi));
+    }
+    interleaveRGBAScalar(r + i, g + i, b + i, a + i, out + i*4, count - i);
+}
+
+TARGET_SSE2 static void expandMaskSse2(const unsigned char* bits, unsigned char* out, int count){
+    const __m128i select = _mm_setr_epi8((char)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+            (char)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01);
+    int i = 0;
+    for(; i + 16 <= count; i += 16){
+        __m128i v = _mm_unpacklo_epi64(_mm_set1_epi8((char)bits[i >> 3]), _mm_set1_epi8((char)bits[(i >> 3) + 1]));
+        _mm_storeu_si128((__m128i*)(out + i), _mm_cmpeq_epi8(_mm_and_si128(v, select), select));
+    }
+    expandMaskScalar(bits, out, i, count);
+}
+
+// Two bit masks per row select between the four colors.
+TARGET_SSE2 static void expandBlockSse2(quint32 code, const quint32* palette, unsigned char* rgba, int stride){
+    const __m128i bit0 = _mm_setr_epi32(0x01, 0x04, 0x10, 0x40);
+    const __m128i bit1 = _mm_setr_epi32(0x02, 0x08, 0x20, 0x80);
+    const __m128i p0 = _mm_set1_epi32((int)palette[0]);
+    const __m128i p2 = _mm_set1_epi32((int)palette[2]);
+    const __m128i d01 = _mm_xor_si128(p0, _mm_set1_epi32((int)palette[1]));
+    const __m128i d23 = _mm_xor_si128(p2, _mm_set1_epi32((int)palette[3]));
+    for(int j = 0; j < 4; j++){
+        __m128i row = _mm_set1_epi32((code >> (8*j)) & 0xFF);
+        __m128i m0 = _mm_cmpeq_epi32(_mm_and_si128(row, bit0), bit0);
+        __m128i m1 = _mm_cmpeq_epi32(_mm_and_si128(row, bit1), bit1);
+        __m128i lo = _mm_xor_si128(p0, _mm_and_si128(d01, m0));
+        __m128i hi = _mm_xor_si128(p2, _mm_and_si128(d23, m0));
+        _mm_storeu_si128((__m128i*)(rgba + j*stride), _mm_xor_si128(lo, _mm_and_si128(_mm_xor_si128(lo, hi), m1)));
+    }
+}
+
+/*===============================================================
+===== AVX2
+==============================================================*/
+// 32 pixels of four channels to four registers of 8 RGBA pixels, in order.
+TARGET_AVX2 static inline void interleave32(__m256i vr, __m256i vg, __m256i vb, __m256i va, __m256i* o){
+    __m256i rgLo = _mm256_unpacklo_epi8(vr, vg);
+    __m256i rgHi = _mm256_unpackhi_epi8(vr, vg);
+    __m256i baLo = _mm256_unpacklo_epi8(vb, va);
+    __m256i baHi = _mm256_unpackhi_epi8(vb, va);
+    // Unpack works in 128-bit lanes: pixels 0-3 and 16-19, 4-7 and 20-23 ...
+    __m256i p0 = _mm256_unpacklo_epi16(rgLo, baLo);
+    __m256i p1 = _mm256_unpackhi_epi16(rgLo, baLo);
+    __m256i p2 = _mm256_unpacklo_epi16(rgHi, baHi);
+    __m256i p3 = _mm256_unpackhi_epi16(rgHi, baHi);
+    o[0] = _mm256_permute2x128_si256(p0, p1, 0x20);
+    o[1] = _mm256_permute2x128_si256(p2, p3, 0x20);
+    o[2] = _mm256_permute2x128_si256(p0, p1, 0x31);
+    o[3] = _mm256_permute2x128_si256(p2, p3, 0x31);
+}
+
+// Eight RGBx pixels to 24 bytes of RGB.
+TARGET_AVX2 static inline void storeRGB24(unsigned char* out, __m256i v){
+    const __m256i pack = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+            0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    const __m256i order = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+    v = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(v, pack), order);
+    _mm_storeu_si128((__m128i*)out, _mm256_castsi256_si128(v));
+    _mm_storel_epi64((__m128i*)(out + 16), _mm256_extracti128_si256(v, 1));
+}
+
+TARGET_AVX2 static void interleaveRGBAvx2(const unsigned char* r, const unsigned char* g, const unsigned char* b,
+        unsigned char* out, int count){
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i o[4];
+    int i = 0;
+    for(; i + 32 <= count; i += 32){
+        interleave32(_mm256_loadu_si256((const __m256i*)(r + i)), _mm256_loadu_si256((const __m256i*)(g + i)),
+                _mm256_loadu_si256((const __m256i*)(b + i)), zero, o);
+        for(int k = 0; k < 4; k++)
+            storeRGB24(out + (i + k*8)*3, o[k]);
+    }
+    interleaveRGBScalar(r + i, g + i, b + i, out + i*3, count - i);
+}
+
+TARGET_AVX2 static void interleaveRGBAAvx2(const unsigned char* r, const unsigned char* g, const unsigned char* b,
+        const unsigned char* a, unsigned char* out, int count){
+    __m256i o[4];
+    int i = 0;
+    for(; i + 32 <= count; i += 32){
+        interleave32(_mm256_loadu_si256((const __m256i*)(r + i)), _mm256_loadu_si256((const __m256i*)(g + i)),
+                _mm256_loadu_si256((const __m256i*)(b + i)), _mm256_loadu_si256((const __m256i*)(a + i)), o);
+        for(int k = 0; k < 4; k++)
+            _mm256_storeu_si256((__m256i*)(out + (i + k*8)*4), o[k]);
+    }
+    interleaveRGBAScalar(r + i, g + i, b + i, a + i, out + i*4, count - i);
+}
+
+TARGET_AVX2 static void expandMaskAvx2(const unsigned char* bits, unsigned char* out, int count){
+    const __m256i spread = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+            2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+    const __m256i select = _mm256_setr_epi8((char)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+            (char)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+            (char)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+            (char)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01);
+    int i = 0;
+    for(; i + 32 <= count; i += 32){
+        int word;
+        memcpy(&word, bits + (i >> 3), 4);
+        __m256i v = _mm256_shuffle_epi8(_mm256_set1_epi32(word), spread);
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_cmpeq_epi8(_mm256_and_si256(v, select), select));
+    }
+    expandMaskScalar(bits, out, i, count);
+}
+
+// Two rows per register, the indices pick from the palette directly.
+TARGET_AVX2 static void expandBlockAvx2(quint32 code, const quint32* palette, unsigned char* rgba, int stride){
+    const __m256i table = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)palette));
+    const __m256i shift = _mm256_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14);
+    const __m256i mask = _mm256_set1_epi32(0x03);
+    for(int j = 0; j < 4; j += 2){
+        __m256i idx = _mm256_and_si256(_mm256_srlv_epi32(_mm256_set1_epi32((int)(code >> (8*j))), shift), mask);
+        __m256i v = _mm256_permutevar8x32_epi32(table, idx);
+        _mm_storeu_si128((__m128i*)(rgba + j*stride), _mm256_castsi256_si128(v));
+        _mm_storeu_si128((__m128i*)(rgba + (j + 1)*stride), _mm256_extracti128_si256(v, 1));
+    }
+}
+
+TARGET_AVX2 static void expandBlockAlphaAvx2(quint64 bits, const unsigned char* table, unsigned char* rgba, int stride){
+    const __m256i alpha = _mm256_slli_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)table)), 24);
+    const __m256i shift = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+    const __m256i mask = _mm256_set1_epi32(0x07);
+    const __m256i color = _mm256_set1_epi32(0x00FFFFFF);
+    for(int j = 0; j < 4; j += 2){
+        __m256i idx = _mm256_and_si256(_mm256_srlv_epi32(_mm256_set1_epi32((int)((bits >> (12*j)) & 0xFFFFFF)), shift), mask);
+        __m256i a = _mm256_permutevar8x32_epi32(alpha, idx);
+        __m256i px = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(rgba + j*stride))),
+                _mm_loadu_si128((const __m128i*)(rgba + (j + 1)*stride)), 1);
+        px = _mm256_or_si256(_mm256_and_si256(px, color), a);
+        _mm_storeu_si128((__m128i*)(rgba + j*stride), _mm256_castsi256_si128(px));
+        _mm_storeu_si128((__m128i*)(rgba + (j + 1)*stride), _mm256_extracti128_si256(px, 1));
+    }
+}
+#endif
+
+#if defined(PIXELKERNELS_NEON)
+/*===============================================================
+===== NEON
+==============================================================*/
+static void interleaveRGBNeon(const unsigned char* r, const unsigned char* g, const unsigned char* b,
+        unsigned char* out, int count){
+    int i = 0;
+    for(; i + 16 <= count; i += 16){
+        uint8x16x3_t v;
+        v.val[0] = vld1q_u8(r + i);
+        v.val[1] = vld1q_u8(g + i);
+        v.val[2] = vld1q_u8(b + i);
+        vst3q_u8(out + i*3, v);
+    }
+    interleaveRGBScalar(r + i, g + i, b + i, out + i*3, count - i);
+}
+
+static void interleaveRGBANeon(const unsigned char* r, const unsigned char* g, const unsigned char* b,
+        const unsigned char* a, unsigned char* out, int count){
+    int i = 0;
+    for(; i + 16 <= count; i += 16){
+        uint8x16x4_t v;
+        v.val[0] = vld1q_u8(r + i);
+        v.val[1] = vld1q_u8(g + i);
+        v.val[2] = vld1q_u8(b + i);
+        v.val[3] = vld1q_u8(a + i);
+        vst4q_u8(out + i*4, v);
+    }
+    interleaveRGBAScalar(r + i, g + i, b + i, a + i, out + i*4, count - i);
+}
+
+static void expandMaskNeon(const unsigned char* bits, unsigned char* out, int count){
+    static const uint8_t selectBits[16] = { 0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+            0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01 };
+    const uint8x16_t select = vld1q_u8(selectBits);
+    int i = 0;
+    for(; i + 16 <= count; i += 16){
+        uint8x16_t v = vcombine_u8(vdup_n_u8(bits[i >> 3]), vdup_n_u8(bits[(i >> 3) + 1]));
+        vst1q_u8(out + i, vtstq_u8(v, select));
+    }
+    expandMaskScalar(bits, out, i, count);
+}
+
+// Index*4 + byte gives the table lookup of each pixel byte.
+static void expandBlockNeon(quint32 code, const quint32* palette, unsigned char* rgba, int stride){
+    static const int32_t shifts[4] = { 0, -2, -4, -6 };
+    const uint8x16_t table = vld1q_u8((const uint8_t*)palette);
+    const int32x4_t shift = vld1q_s32(shifts);
+    for(int j = 0; j < 4; j++){
+        uint32x4_t idx = vandq_u32(vshlq_u32(vdupq_n_u32((code >> (8*j)) & 0xFF), shift), vdupq_n_u32(0x03));
+        uint32x4_t bytes = vaddq_u32(vmulq_n_u32(idx, 0x04040404), vdupq_n_u32(0x03020100));
+        vst1q_u8(rgba + j*stride, vqtbl1q_u8(table, vreinterpretq_u8_u32(bytes)));
+    }
+}
+
+// Color bytes look up index 0xFF, which gives 0.
+static void expandBlockAlphaNeon(quint64 bits, const unsigned char* table, unsigned char* rgba, int stride){
+    static const int32_t shifts[4] = { 0, -3, -6, -9 };
+    const uint8x16_t alpha = vcombine_u8(vld1_u8(table), vdup_n_u8(0));
+    const int32x4_t shift = vld1q_s32(shifts);
+    const uint8x16_t color = vreinterpretq_u8_u32(vdupq_n_u32(0x00FFFFFF));
+    for(int j = 0; j < 4; j++){
+        uint32x4_t idx = vandq_u32(vshlq_u32(vdupq_n_u32((bits >> (12*j)) & 0xFFF), shift), vdupq_n_u32(0x07));
+        uint32x4_t bytes = vorrq_u32(vshlq_n_u32(idx, 24), vdupq_n_u32(0x00FFFFFF));
+        uint8x16_t px = vandq_u8(vld1q_u8(rgba + j*stride), color);
+        vst1q_u8(rgba + j*stride, vorrq_u8(px, vqtbl1q_u8(alpha, vreinterpretq_u8_u32(bytes))));
+    }
+}
+#endif
+
+/*===============================================================
+===== Dispatch
+==============================================================*/
+void PixelKernels::interleaveRGB(const unsigned char* r, const unsigned char* g, const unsigned char* b,
+        unsigned char* out, int count){
+    switch(level()){
+#if defined(PIXELKERNELS_X86)
+        case AVX2:
+            interleaveRGBAvx2(r, g, b, out, count);
+            return;
+        case SSE2:
+            interleaveRGBSse2(r, g, b, out, count);
+            return;
+#endif
+#if defined(PIXELKERNELS_NEON)
+        case NEON:
+            interleaveRGBNeon(r, g, b, out, count);
+            return;
+#endif
+        default:
+            interleaveRGBScalar(r, g, b, out, count);
+    }
+}
+
+void PixelKernels::interleaveRGBA(const unsigned char* r, const unsigned char* g, const unsigned char* b,
+        const unsigned char* a, unsigned char* out, int count){
+    switch(level()){
+#if defined(PIXELKERNELS_X86)
+        case AVX2:
+            interleaveRGBAAvx2(r, g, b, a, out, count);
+            return;
+        case SSE2:
+            interleaveRGBASse2(r, g, b, a, out, count);
+            return;
+#endif
+#if defined(PIXELKERNELS_NEON)
+        case NEON:
+            interleaveRGBANeon(r, g, b, a, out, count);
+            return;
+#endif
+        default:
+            interleaveRGBAScalar(r, g, b, a, out, count);
+    }
+}
+
+void PixelKernels::expandMask(const unsigned char* bits, unsigned char* out, int count){
+    switch(level()){
+#if defined(PIXELKERNELS_X86)
+        case AVX2:
+            expandMaskAvx2(bits, out, count);
+            return;
+        case SSE2:
+            expandMaskSse2(bits, out, count);
+            return;
+#endif
+#if defined(PIXELKERNELS_NEON)
+        case NEON:
+            expandMaskNeon(bits, out, count);
+            return;
+#endif
+        default:
+            expandMaskScalar(bits, out, 0, count);
+    }
+}
+
+void PixelKernels::expandBlock(quint32 code, const quint32* palette, unsigned char* rgba, int stride){
+    switch(level()){
+#if defined(PIXELKERNELS_X86)
+        case AVX2:
+            expandBlockAvx2(code, palette, rgba, stride);
+            return;
+        case SSE2:
+            expandBlockSse2(code, palette, rgba, stride);
+            return;
+#endif
+#if defined(PIXELKERNELS_NEON)
+        case NEON:
+            expandBlockNeon(code, palette, rgba, stride);
+            return;
+#endif
+        default:
+            expandBlockScalar(code, palette, rgba, stride);
+    }
+}
+
+// SSE2 has no variable shifts or lookups, the table is cheaper there.
+void PixelKernels::expandBlockAlpha(quint64 bits, const unsigned char* table, unsigned char* rgba, int stride){
+    switch(level()){
+#if defined(PIXELKERNELS_X86)
+        case AVX2:
+            expandBlockAlphaAvx2(bits, table, rgba, stride);
+            return;
+#endif
+#if defined(PIXELKERNELS_NEON)
+        case NEON:
+            expandBlockAlphaNeon(bits, table, rgba, stride);
+            return;
+#endif
+        default:
+            expandBlockAlphaScalar(bits, table, rgba, stride);
+    }
+}
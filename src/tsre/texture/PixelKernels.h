@@ -0,0 +1,55 @@
+/*  This file is part of TSRE5.
+ *
+ *  TSRE5 - train sim game engine and MSTS/OR Editors.
+ *  Copyright (C) 2016 Piotr Gadecki <pgadecki@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *
+ *  See LICENSE.md or https://www.gnu.org/licenses/gpl.html
+ */
+
+#ifndef PIXELKERNELS_H
+#define	PIXELKERNELS_H
+
+#include <QtGlobal>
+
+/*
+ * Inner loops of the texture decoders. The SSE2, AVX2 or NEON version is
+ * chosen once at runtime, Game::useSimdKernels = false forces the scalar
+ * one. All versions give the same bytes.
+ */
+class PixelKernels {
+public:
+    enum Level {
+        Scalar = 0,
+        SSE2 = 1,
+        AVX2 = 2,
+        NEON = 3
+    };
+
+    static int level();
+    static const char* levelName();
+    // For tests and benchmarks, a level this CPU has or -1 for the detected one.
+    static bool supported(int level);
+    static void setLevel(int level);
+
+    // Planar channel rows (ACE) to RGB or RGBA pixels.
+    static void interleaveRGB(const unsigned char* r, const unsigned char* g, const unsigned char* b,
+            unsigned char* out, int count);
+    static void interleaveRGBA(const unsigned char* r, const unsigned char* g, const unsigned char* b,
+            const unsigned char* a, unsigned char* out, int count);
+    // 1-bit mask, high bit first, to 0 or 255 per pixel.
+    static void expandMask(const unsigned char* bits, unsigned char* out, int count);
+    // 4x4 block of 2-bit indices into four RGBA colors.
+    static void expandBlock(quint32 code, const quint32* palette, unsigned char* rgba, int stride);
+    // 4x4 block of 3-bit indices into eight alpha values, colors are kept.
+    static void expandBlockAlpha(quint64 bits, const unsigned char* table, unsigned char* rgba, int stride);
+
+private:
+    static int forced;
+    static int detected();
+    static int detect();
+};
+
+#endif	/* PIXELKERNELS_H */
+
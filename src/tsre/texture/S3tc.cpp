@@ -0,0 +1,476 @@
+/*  This file is part of TSRE5.
+ *
+ *  TSRE5 - train sim game engine and MSTS/OR Editors.
+ *  Copyright (C) 2016 Piotr Gadecki <pgadecki@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *
+ *  See LICENSE.md or https://www.gnu.org/licenses/gpl.html
+ */
+
+#include <tsre/texture/S3tc.h>
+#include <tsre/texture/Texture.h>
+#include <tsre/texture/PixelKernels.h>
+#include <tsre/Game.h>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLFunctions>
+#include <QOpenGLContext>
+#include <QDebug>
+#include <cstdint>
+#include <string.h>
+#include <cstdlib>
+#include <algorithm>
+
+#ifndef GL_TEXTURE_MAX_LEVEL
+#define GL_TEXTURE_MAX_LEVEL 0x813D
+#endif
+
+int S3tc::supported = -1;
+
+/*
+ * Checked on first upload, needs a current GL context.
+ * Until then decoders assume the extension is there.
+ */
+bool S3tc::Supported(){
+    if(supported < 0){
+        QOpenGLContext *context = QOpenGLContext::currentContext();
+        supported = context != NULL && context->hasExtension("GL_EXT_texture_compression_s3tc");
+        qDebug() << "S3tc: compressed textures" << (supported == 1);
+    }
+    return supported == 1;
+}
+
+bool S3tc::keepCompressed(){
+    return Game::textureCompression && Game::textureQuality <= 1 && supported != 0;
+}
+
+int S3tc::blockBytes(unsigned int format){
+    if(format == DXT1 || format == DXT1A)
+        return 8;
+    return 16;
+}
+
+int S3tc::levelSize(unsigned int format, int width, int height){
+    return ((width + 3) / 4) * ((height + 3) / 4) * blockBytes(format);
+}
+
+int S3tc::chainSize(unsigned int format, int width, int height, int levels){
+    int size = 0;
+    for(int i = 0; i < levels; i++){
+        size += levelSize(format, width, height);
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+    }
+    return size;
+}
+
+// Same test as decodeDXT1Block, a block in 3-color mode may be transparent.
+bool S3tc::dxt1HasAlpha(const unsigned char* data, int size){
+    for(int i = 0; i + 8 <= size; i += 8){
+        quint16 c0 = data[i] | (data[i + 1] << 8);
+        quint16 c1 = data[i + 2] | (data[i + 3] << 8);
+        if(c0 <= c1)
+            return true;
+    }
+    return false;
+}
+
+// Helper: 16-bit 565 to RGB8
+static inline void decodeRGB565(quint16 c, uint8_t &r, uint8_t &g, uint8_t &b)
+{
+    r = static_cast<uint8_t>(((c >> 11) & 0x1F) * 255 / 31);
+    g = static_cast<uint8_t>(((c >> 5)  & 0x3F) * 255 / 63);
+    b = static_cast<uint8_t>((c & 0x1F) * 255 / 31);
+}
+
+static inline quint16 encodeRGB565(int r, int g, int b)
+{
+    return (quint16)((((r * 31 + 127) / 255) << 11) | (((g * 63 + 127) / 255) << 5) | ((b * 31 + 127) / 255));
+}
+
+// Decompress a DXT1 block into a 4x4 RGBA tile
+void S3tc::decodeDXT1Block(const uint8_t *block, uint8_t *rgba,
+                            int stride /* bytes per row */, bool &hasAlpha)
+{
+    quint16 c0 = block[0] | (block[1] << 8);
+    quint16 c1 = block[2] | (block[3] << 8);
+
+    uint8_t r0, g0, b0;
+    uint8_t r1, g1, b1;
+    decodeRGB565(c0, r0, g0, b0);
+    decodeRGB565(c1, r1, g1, b1);
+
+    uint8_t colors[4][4]; // RGBA
+    colors[0][0] = r0; colors[0][1] = g0; colors[0][2] = b0; colors[0][3] = 255;
+    colors[1][0] = r1; colors[1][1] = g1; colors[1][2] = b1; colors[1][3] = 255;
+
+    if (c0 > c1) {
+        // 4-color block
+        colors[2][0] = (2 * r0 + r1) / 3;
+        colors[2][1] = (2 * g0 + g1) / 3;
+        colors[2][2] = (2 * b0 + b1) / 3;
+        colors[2][3] = 255;
+
+        colors[3][0] = (r0 + 2 * r1) / 3;
+        colors[3][1] = (g0 + 2 * g1) / 3;
+        colors[3][2] = (b0 + 2 * b1) / 3;
+        colors[3][3] = 255;
+    } else {
+        // 3-color block + 1 transparent
+        colors[2][0] = (r0 + r1) / 2;
+        colors[2][1] = (g0 + g1) / 2;
+        colors[2][2] = (b0 + b1) / 2;
+        colors[2][3] = 255;
+
+        colors[3][0] = 0;
+        colors[3][1] = 0;
+        colors[3][2] = 0;
+        colors[3][3] = 0;   // transparent
+        hasAlpha = true;
+    }
+
+    const uint32_t code = block[4] | (block[5] << 8) | (block[6] << 16) | (block[7] << 24);
+
+    quint32 palette[4];
+    memcpy(palette, colors, sizeof(palette));
+    PixelKernels::expandBlock(code, palette, rgba, stride);
+}
+
+// Decompress a DXT3 block into a 4x4 RGBA tile
+void S3tc::decodeDXT3Block(const uint8_t *block, uint8_t *rgba, int stride /* bytes per row */)
+{
+    // First 8 bytes: 4-bit alpha for 16 pixels (64 bits)
+    uint64_t alphaBits = 0;
+    for (int i = 0; i < 8; ++i) {
+        alphaBits |= (uint64_t(block[i]) << (8 * i));
+    }
+
+    // Next 8 bytes: color data like DXT1, but always 4-color mode (no implicit transparency)
+    const uint8_t *colorBlock = block + 8;
+
+    quint16 c0 = colorBlock[0] | (colorBlock[1] << 8);
+    quint16 c1 = colorBlock[2] | (colorBlock[3] << 8);
+
+    uint8_t r0, g0, b0;
+    uint8_t r1, g1, b1;
+    decodeRGB565(c0, r0, g0, b0);
+    decodeRGB565(c1, r1, g1, b1);
+
+    uint8_t colors[4][4]; // RGB, alpha is set per pixel
+    colors[0][0] = r0; colors[0][1] = g0; colors[0][2] = b0; colors[0][3] = 0;
+    colors[1][0] = r1; colors[1][1] = g1; colors[1][2] = b1; colors[1][3] = 0;
+
+    // DXT3 always treats this as a 4-color block (no transparent color)
+    colors[2][0] = (2 * r0 + r1) / 3;
+    colors[2][1] = (2 * g0 + g1) / 3;
+    colors[2][2] = (2 * b0 + b1) / 3;
+    colors[2][3] = 0;
+
+    colors[3][0] = (r0 + 2 * r1) / 3;
+    colors[3][1] = (g0 + 2 * g1) / 3;
+    colors[3][2] = (b0 + 2 * b1) / 3;
+    colors[3][3] = 0;
+
+    const uint32_t code = colorBlock[4] | (colorBlock[5] << 8) |
+                          (colorBlock[6] << 16) | (colorBlock[7] << 24);
+
+    quint32 palette[4];
+    memcpy(palette, colors, sizeof(palette));
+    PixelKernels::expandBlock(code, palette, rgba, stride);
+
+    for (int j = 0; j < 4; ++j) {
+        for (int i = 0; i < 4; ++i) {
+            const int pixelIndex = 4 * j + i;
+
+            // 4-bit alpha for each pixel
+            const uint8_t alpha4 = (alphaBits >> (4 * pixelIndex)) & 0x0F;
+            rgba[j * stride + i * 4 + 3] = alpha4 * 17; // scale 0..15 to 0..255
+        }
+    }
+}
+
+// Decompress a DXT5 block into a 4x4 RGBA tile
+void S3tc::decodeDXT5Block(const uint8_t *block, uint8_t *rgba, int stride)
+{
+    // Alpha
+    const uint8_t alpha0 = block[0];
+    const uint8_t alpha1 = block[1];
+
+    uint8_t alphaTable[8];
+    alphaTable[0] = alpha0;
+    alphaTable[1] = alpha1;
+    if (alpha0 > alpha1) {
+        // 6 interpolated alpha values.
+        alphaTable[2] = (6 * alpha0 + 1 * alpha1) / 7;
+        alphaTable[3] = (5 * alpha0 + 2 * alpha1) / 7;
+        alphaTable[4] = (4 * alpha0 + 3 * alpha1) / 7;
+        alphaTable[5] = (3 * alpha0 + 4 * alpha1) / 7;
+        alphaTable[6] = (2 * alpha0 + 5 * alpha1) / 7;
+        alphaTable[7] = (1 * alpha0 + 6 * alpha1) / 7;
+    } else {
+        // 4 interpolated alpha values, then 0 and 255.
+        alphaTable[2] = (4 * alpha0 + 1 * alpha1) / 5;
+        alphaTable[3] = (3 * alpha0 + 2 * alpha1) / 5;
+        alphaTable[4] = (2 * alpha0 + 3 * alpha1) / 5;
+        alphaTable[5] = (1 * alpha0 + 4 * alpha1) / 5;
+        alphaTable[6] = 0;
+        alphaTable[7] = 255;
+    }
+
+    // 48 bits of alpha indices
+    uint64_t alphaBits = 0;
+    for (int i = 0; i < 6; ++i) {
+        alphaBits |= (uint64_t(block[2 + i]) << (8 * i));
+    }
+
+    // Color data (DXT1-like) in block[8..15]
+    const uint8_t *colorBlock = block + 8;
+
+    quint16 c0 = colorBlock[0] | (colorBlock[1] << 8);
+    quint16 c1 = colorBlock[2] | (colorBlock[3] << 8);
+
+    uint8_t r0, g0, b0;
+    uint8_t r1, g1, b1;
+    decodeRGB565(c0, r0, g0, b0);
+    decodeRGB565(c1, r1, g1, b1);
+
+    uint8_t colors[4][4]; // RGB, alpha comes from the alpha block
+    colors[0][0] = r0; colors[0][1] = g0; colors[0][2] = b0; colors[0][3] = 0;
+    colors[1][0] = r1; colors[1][1] = g1; colors[1][2] = b1; colors[1][3] = 0;
+
+    colors[2][0] = (2 * r0 + r1) / 3;
+    colors[2][1] = (2 * g0 + g1) / 3;
+    colors[2][2] = (2 * b0 + b1) / 3;
+    colors[2][3] = 0;
+
+    colors[3][0] = (r0 + 2 * r1) / 3;
+    colors[3][1] = (g0 + 2 * g1) / 3;
+    colors[3][2] = (b0 + 2 * b1) / 3;
+    colors[3][3] = 0;
+
+    const uint32_t code = colorBlock[4] | (colorBlock[5] << 8) |
+                          (colorBlock[6] << 16) | (colorBlock[7] << 24);
+
+    quint32 palette[4];
+    memcpy(palette, colors, sizeof(palette));
+    PixelKernels::expandBlock(code, palette, rgba, stride);
+    PixelKernels::expandBlockAlpha(alphaBits, alphaTable, rgba, stride);
+}
+
+/*
+ * Decodes the first level of DXT data to RGBA, the caller deletes it.
+ */
+unsigned char* S3tc::decode(const unsigned char* data, unsigned int format, int width, int height){
+    unsigned char* out = new unsigned char[width*height*4];
+    const int blockSize = blockBytes(format);
+    const unsigned char* blockPtr = data;
+    bool hasAlpha = false;
+    uint8_t tile[4 * 4 * 4];
+    for(int by = 0; by < (height + 3) / 4; by++){
+        for(int bx = 0; bx < (width + 3) / 4; bx++){
+            if(format == DXT3)
+                decodeDXT3Block(blockPtr, tile, 4 * 4);
+            else if(format == DXT5)
+                decodeDXT5Block(blockPtr, tile, 4 * 4);
+            else
+                decodeDXT1Block(blockPtr, tile, 4 * 4, hasAlpha);
+            blockPtr += blockSize;
+
+            for(int j = 0; j < 4 && by*4 + j < height; j++)
+                memcpy(out + ((by*4 + j)*width + bx*4)*4, tile + j*16, std::min(4, width - bx*4)*4);
+        }
+    }
+    return out;
+}
+
+/*
+ * CPU fallback, replaces the DXT data with RGB or RGBA pixels of the first level.
+ */
+void S3tc::decompress(Texture* texture){
+    if(texture->compressedFormat == 0 || texture->imageData == NULL)
+        return;
+    unsigned char* rgba = decode(texture->imageData, texture->compressedFormat, texture->width, texture->height);
+    int count = texture->width*texture->height;
+    if(texture->bytesPerPixel == 3){
+        unsigned char* rgb = new unsigned char[count*3];
+        for(int i = 0; i < count; i++){
+            rgb[i*3 + 0] = rgba[i*4 + 0];
+            rgb[i*3 + 1] = rgba[i*4 + 1];
+            rgb[i*3 + 2] = rgba[i*4 + 2];
+        }
+        delete[] rgba;
+        rgba = rgb;
+    }
+    delete[] texture->imageData;
+    texture->imageData = rgba;
+    texture->imageSize = count*texture->bytesPerPixel;
+    texture->compressedFormat = 0;
+    texture->mipLevels = 1;
+    texture->editable = true;
+}
+
+/*
+ * Range fit: the block bounding box gives the end points,
+ * each pixel takes the nearest of the four palette colors.
+ */
+void S3tc::encodeColorBlock(const unsigned char* rgba, unsigned char* block){
+    int minC[3] = {255, 255, 255};
+    int maxC[3] = {0, 0, 0};
+    for(int i = 0; i < 16; i++)
+        for(int c = 0; c < 3; c++){
+            minC[c] = std::min(minC[c], (int)rgba[i*4 + c]);
+            maxC[c] = std::max(maxC[c], (int)rgba[i*4 + c]);
+        }
+    quint16 c0 = encodeRGB565(maxC[0], maxC[1], maxC[2]);
+    quint16 c1 = encodeRGB565(minC[0], minC[1], minC[2]);
+    block[0] = c0 & 0xFF;
+    block[1] = c0 >> 8;
+    block[2] = c1 & 0xFF;
+    block[3] = c1 >> 8;
+    uint32_t code = 0;
+    // Equal end points would be 3-color mode, all pixels take color 0.
+    if(c0 > c1){
+        uint8_t colors[4][3];
+        decodeRGB565(c0, colors[0][0], colors[0][1], colors[0][2]);
+        decodeRGB565(c1, colors[1][0], colors[1][1], colors[1][2]);
+        for(int c = 0; c < 3; c++){
+            colors[2][c] = (2 * colors[0][c] + colors[1][c]) / 3;
+            colors[3][c] = (colors[0][c] + 2 * colors[1][c]) / 3;
+        }
+        for(int i = 0; i < 16; i++){
+            int best = 0, bestDist = 0x7FFFFFFF;
+            for(int k = 0; k < 4; k++){
+                int dist = 0;
+                for(int c = 0; c < 3; c++){
+                    int d = (int)rgba[i*4 + c] - colors[k][c];
+                    dist += d*d;
+                }
+                if(dist < bestDist){
+                    bestDist = dist;
+                    best = k;
+                }
+            }
+            code |= (uint32_t)best << (2*i);
+        }
+    }
+    block[4] = code & 0xFF;
+    block[5] = (code >> 8) & 0xFF;
+    block[6] = (code >> 16) & 0xFF;
+    block[7] = (code >> 24) & 0xFF;
+}
+
+void S3tc::encodeAlphaBlock(const unsigned char* rgba, unsigned char* block){
+    int minA = 255, maxA = 0;
+    for(int i = 0; i < 16; i++){
+        minA = std::min(minA, (int)rgba[i*4 + 3]);
+        maxA = std::max(maxA, (int)rgba[i*4 + 3]);
+    }
+    block[0] = maxA;
+    block[1] = minA;
+    uint64_t bits = 0;
+    if(maxA > minA){
+        int table[8];
+        table[0] = maxA;
+        table[1] = minA;
+        for(int k = 1; k < 7; k++)
+            table[k + 1] = ((7 - k) * maxA + k * minA) / 7;
+        for(int i = 0; i < 16; i++){
+            int best = 0, bestDist = 256;
+            for(int k = 0; k < 8; k++){
+                int dist = std::abs((int)rgba[i*4 + 3] - table[k]);
+                if(dist < bestDist){
+                    bestDist = dist;
+                    best = k;
+                }
+            }
+            bits |= (uint64_t)best << (3*i);
+        }
+    }
+    for(int i = 0; i < 6; i++)
+        block[2 + i] = (bits >> (8*i)) & 0xFF;
+}
+
+/*
+ * Encodes RGB pixels to DXT1 or RGBA pixels to DXT5, with a box filtered
+ * mip chain down to 1x1. Returns the levels back to back, the caller deletes it.
+ */
+unsigned char* S3tc::compress(const unsigned char* pixels, int width, int height, int bytesPerPixel,
+        unsigned int &format, int &levels, int &size){
+    format = bytesPerPixel == 4 ? DXT5 : DXT1;
+    levels = 1;
+    for(int w = width, h = height; w > 1 || h > 1; levels++){
+        w = std::max(1, w / 2);
+        h = std::max(1, h / 2);
+    }
+    size = chainSize(format, width, height, levels);
+    unsigned char* out = new unsigned char[size];
+
+    unsigned char* level = new unsigned char[width*height*4];
+    for(int i = 0; i < width*height; i++){
+        level[i*4 + 0] = pixels[i*bytesPerPixel + 0];
+        level[i*4 + 1] = pixels[i*bytesPerPixel + 1];
+        level[i*4 + 2] = pixels[i*bytesPerPixel + 2];
+        level[i*4 + 3] = bytesPerPixel == 4 ? pixels[i*4 + 3] : 255;
+    }
+
+    unsigned char* block = out;
+    unsigned char tile[16*4];
+    int w = width, h = height;
+    for(int l = 0; l < levels; l++){
+        for(int by = 0; by < h; by += 4)
+            for(int bx = 0; bx < w; bx += 4){
+                // Edge blocks repeat the last row and column.
+                for(int j = 0; j < 4; j++)
+                    for(int i = 0; i < 4; i++)
+                        memcpy(tile + (j*4 + i)*4, level + (std::min(by + j, h - 1)*w + std::min(bx + i, w - 1))*4, 4);
+                if(format == DXT5){
+                    encodeAlphaBlock(tile, block);
+                    block += 8;
+                }
+                encodeColorBlock(tile, block);
+                block += 8;
+            }
+        if(l == levels - 1)
+            break;
+        int nw = std::max(1, w / 2);
+        int nh = std::max(1, h / 2);
+        unsigned char* next = new unsigned char[nw*nh*4];
+        for(int y = 0; y < nh; y++)
+            for(int x = 0; x < nw; x++){
+                int x0 = std::min(x*2, w - 1), x1 = std::min(x*2 + 1, w - 1);
+                int y0 = std::min(y*2, h - 1), y1 = std::min(y*2 + 1, h - 1);
+                for(int c = 0; c < 4; c++)
+                    next[(y*nw + x)*4 + c] = (level[(y0*w + x0)*4 + c] + level[(y0*w + x1)*4 + c]
+                            + level[(y1*w + x0)*4 + c] + level[(y1*w + x1)*4 + c] + 2) / 4;
+            }
+        delete[] level;
+        level = next;
+        w = nw;
+        h = nh;
+    }
+    delete[] level;
+    return out;
+}
+
+/*
+ * Uploads all levels to the bound texture, trilinear filtering when
+ * there is a mip chain.
+ */
+void S3tc::upload(Texture* texture){
+    QOpenGLFunctions *f = QOpenGLContext::currentContext()->functions();
+    int w = texture->width;
+    int h = texture->height;
+    int offset = 0;
+    for(int i = 0; i < texture->mipLevels; i++){
+        int size = levelSize(texture->compressedFormat, w, h);
+        f->glCompressedTexImage2D(GL_TEXTURE_2D, i, texture->compressedFormat, w, h, 0, size, texture->imageData + offset);
+        offset += size;
+        w = std::max(1, w / 2);
+        h = std::max(1, h / 2);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, texture->mipLevels - 1);
+    if(texture->mipLevels > 1)
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    else
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+}
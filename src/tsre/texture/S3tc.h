@@ -0,0 +1,53 @@
+/*  This file is part of TSRE5.
+ *
+ *  TSRE5 - train sim game engine and MSTS/OR Editors.
+ *  Copyright (C) 2016 Piotr Gadecki <pgadecki@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *
+ *  See LICENSE.md or https://www.gnu.org/licenses/gpl.html
+ */
+
+#ifndef S3TC_H
+#define	S3TC_H
+
+class Texture;
+
+/*
+ * DXT1/3/5 (S3TC) block helpers.
+ * Decoders keep DXT data as it is in texture->imageData, all mip levels
+ * back to back, and GLTextures() uploads it with glCompressedTexImage2D.
+ * Without GL_EXT_texture_compression_s3tc the blocks are decoded on the CPU.
+ */
+class S3tc {
+public:
+    static const unsigned int DXT1 = 0x83F0;
+    static const unsigned int DXT1A = 0x83F1;
+    static const unsigned int DXT3 = 0x83F2;
+    static const unsigned int DXT5 = 0x83F3;
+
+    static bool Supported();
+    static bool keepCompressed();
+    static int blockBytes(unsigned int format);
+    static int levelSize(unsigned int format, int width, int height);
+    static int chainSize(unsigned int format, int width, int height, int levels);
+    static bool dxt1HasAlpha(const unsigned char* data, int size);
+
+    static void decodeDXT1Block(const unsigned char* block, unsigned char* rgba, int stride, bool &hasAlpha);
+    static void decodeDXT3Block(const unsigned char* block, unsigned char* rgba, int stride);
+    static void decodeDXT5Block(const unsigned char* block, unsigned char* rgba, int stride);
+    static unsigned char* decode(const unsigned char* data, unsigned int format, int width, int height);
+    static void decompress(Texture* texture);
+
+    static unsigned char* compress(const unsigned char* pixels, int width, int height, int bytesPerPixel,
+            unsigned int &format, int &levels, int &size);
+    static void upload(Texture* texture);
+
+private:
+    static int supported;
+    static void encodeColorBlock(const unsigned char* rgba, unsigned char* block);
+    static void encodeAlphaBlock(const unsigned char* rgba, unsigned char* block);
+};
+
+#endif	/* S3TC_H */
+
@@ -15,17 +15,30 @@
 #include <tsre/texture/PaintTexLib.h>
 #include <tsre/texture/MapLib.h>
 #include <tsre/texture/Texture.h>
+#include <tsre/texture/TexLoader.h>
+#include <tsre/renderer/Renderer.h>
 #include <QDebug>
 #include <QFile>
 #include <tsre/Game.h>
+#include <algorithm>
+#include <vector>
 
 int TexLib::jesttextur = 0;
+long long TexLib::ResidentBytes = 0;
+int TexLib::KeepFrames = 300;
 std::unordered_map<int, Texture*> TexLib::mtex;
 QHash<int, int> TexLib::disabledTextures;
+QHash<QString, int> TexLib::pathIndex;
+float TexLib::viewPoint[3] = {0, 0, 0};
 
 void TexLib::reset() {
+    TexLoader::cancelAll();
+    for(auto it = mtex.begin(); it != mtex.end(); ++it)
+        if(it->second != NULL)
+            ResidentBytes -= it->second->gpuBytes;
     jesttextur = 0;
     mtex.clear();
+    pathIndex.clear();
 }
 
 void TexLib::enableTexture(int id){
@@ -40,17 +53,17 @@ void TexLib::disableTexture(int id){
         disabledTextures[tex->tex[0]] = 1;
 }
 
+/*
+ * Textures stay in mtex at zero references,
+ * unloadUnused() frees them later if memory is needed.
+ */
 void TexLib::delRef(int texx) {
     try {
         Texture* t = mtex.at(texx);
+        if(t == NULL)
+            return;
         t->ref--;
-        if (t->ref <= 0) {
-            //System.out.println("--refs: "+mtex.get(texx).ref);
-            if (t->glLoaded) {
-                t->delVBO();
-                mtex.erase(texx);
-            }
-        }
+        t->lastUsed = TexLoader::Frame;
     } catch (const std::out_of_range& oor) {
             
     }
@@ -74,35 +87,36 @@ int TexLib::addTex(QString path, QString name, bool reload) {
     return addTex(pathid, reload);
 }
 
-int TexLib::getTex(QString pathid) {
-    for ( auto it = mtex.begin(); it != mtex.end(); ++it ){
-        if(it->second == NULL) continue;
-        for(int i = 0; i < ((Texture*) it->second)->hashid.size(); i++)
-            if (((Texture*) it->second)->hashid[i].length() == pathid.length()) 
-                if (((Texture*) it->second)->hashid[i] == pathid) {
-                    ((Texture*) it->second)->ref++;
-                    return (int)it->first;
-                }
+int TexLib::findTex(const QString &pathid) {
+    auto it = pathIndex.find(pathid);
+    if(it == pathIndex.end())
+        return -1;
+    auto tit = mtex.find(it.value());
+    if(tit == mtex.end() || tit->second == NULL){
+        pathIndex.erase(it);
+        return -1;
     }
-    return -1;
+    return it.value();
+}
+
+int TexLib::getTex(QString pathid) {
+    int id = findTex(pathid);
+    if(id >= 0)
+        mtex[id]->ref++;
+    return id;
 }
 
 int TexLib::addTex(QString pathid, bool reload) {
     
     Texture* newFile = NULL;
-    for ( auto it = mtex.begin(); it != mtex.end(); ++it ){
-        if(it->second == NULL) continue;
-        for(int i = 0; i < ((Texture*) it->second)->hashid.size(); i++)
-            if (((Texture*) it->second)->hashid[i].length() == pathid.length()) 
-                if (((Texture*) it->second)->hashid[i] == pathid) {
-                    if(!reload){
-                        ((Texture*) it->second)->ref++;
-                        return (int)it->first;
-                    } else {
-                        newFile = ((Texture*) it->second);
-                        break;
-                    }
-                }
+    int existingId = findTex(pathid);
+    if(existingId >= 0){
+        if(!reload){
+            mtex[existingId]->ref++;
+            return existingId;
+        } else {
+            newFile = mtex[existingId];
+        }
     }
     //qDebug() << "Nowa " << jesttextur << " textura: " << pathid;
     
@@ -123,6 +137,9 @@ int TexLib::addTex(QString pathid, bool reload) {
         newFile = new Texture(pathid);
         newFile->ref++;
         mtex[jesttextur] = newFile;
+        for(int i = 0; i < newFile->hashid.size(); i++)
+            if(!pathIndex.contains(newFile->hashid[i]))
+                pathIndex[newFile->hashid[i]] = jesttextur;
         texId = jesttextur;
         jesttextur++;
     } else {
@@ -130,49 +147,139 @@ int TexLib::addTex(QString pathid, bool reload) {
     }
     //qDebug() << pathid.toLower();
     //qDebug() << tType;
-        
-    if(tType == "ace"){
-        AceLib* t = new AceLib();
-        t->texture = newFile;
-        if(AceLib::IsThread && !reload)
-            t->start();
-        else
-            t->run();
-    } else if(tType == "dds"){
-        DdsLib* t = new DdsLib();
-        t->texture = newFile;
-        if(DdsLib::IsThread && !reload)
-            t->start();
-        else
-            t->run();
-    } else if(tType == "png"||tType == "bmp"||tType == "jpg"/*||tType == "dds"*/||tType == "tga"){
-        ImageLib* t = new ImageLib();
-        t->texture = newFile;
-        if(ImageLib::IsThread && !reload)
-            t->start();
-        else
-            t->run();
-    } else if(tType == ":painttex"){
+    
+    if(tType == ":painttex"){
         PaintTexLib* t = new PaintTexLib();
         t->texture = newFile;
-        //t->start();
         t->run();
-    } else if(tType == ":maptex"){
-        MapLib* t = new MapLib();
-        t->texture = newFile;
-        t->start();
+        delete t;
+        return texId;
+    }
+    
+    TexDecoder* t = createDecoder(newFile);
+    if(t == NULL)
+        return texId;
+    if(isThreaded(newFile) && !reload){
+        TexLoader::enqueue(t);
+    } else {
+        t->run();
+        delete t;
     }
     //AceLib::LoadACE(newFile);
     //tConcurrent::run();
     return texId;
 }
 
+TexDecoder* TexLib::createDecoder(Texture* texture){
+    QString tType = texture->pathid.toLower().split(".").last();
+    TexDecoder* t = NULL;
+    if(tType == "ace"){
+        t = new AceLib();
+    } else if(tType == "dds"){
+        t = new DdsLib();
+    } else if(tType == "png"||tType == "bmp"||tType == "jpg"/*||tType == "dds"*/||tType == "tga"){
+        t = new ImageLib();
+    } else if(tType == ":maptex"){
+        t = new MapLib();
+    }
+    if(t != NULL)
+        t->texture = texture;
+    return t;
+}
+
+/*
+ * Only textures the decoders can read again from disk may be unloaded.
+ */
+bool TexLib::isReloadable(Texture* texture){
+    if(texture->editable || !isThreaded(texture))
+        return false;
+    QString tType = texture->pathid.toLower().split(".").last();
+    return tType == "ace" || tType == "dds" || tType == "png" || tType == "bmp"
+            || tType == "jpg" || tType == "tga";
+}
+
+bool TexLib::isThreaded(Texture* texture){
+    QString tType = texture->pathid.toLower().split(".").last();
+    if(tType == "ace")
+        return AceLib::IsThread;
+    if(tType == "dds")
+        return DdsLib::IsThread;
+    if(tType == ":maptex")
+        return true;
+    return ImageLib::IsThread;
+}
+
+void TexLib::touchTex(int id){
+    auto it = mtex.find(id);
+    if(it == mtex.end() || it->second == NULL)
+        return;
+    Texture* t = it->second;
+    if(t->loaded || t->missing || t->error)
+        return;
+    if(!isThreaded(t))
+        return;
+    float distance = 0;
+    if(Game::currentRenderer != NULL && Game::currentRenderer->mvMatrix != NULL){
+        float* m = Game::currentRenderer->mvMatrix;
+        distance = (m[12] - viewPoint[0])*(m[12] - viewPoint[0])
+                + (m[13] - viewPoint[1])*(m[13] - viewPoint[1])
+                + (m[14] - viewPoint[2])*(m[14] - viewPoint[2]);
+    }
+    if(TexLoader::touch(t, distance))
+        return;
+    TexDecoder* decoder = createDecoder(t);
+    if(decoder != NULL)
+        TexLoader::enqueue(decoder, distance);
+}
+
+void TexLib::nextFrame(float* cameraPos){
+    if(cameraPos != NULL){
+        viewPoint[0] = cameraPos[0];
+        viewPoint[1] = cameraPos[1];
+        viewPoint[2] = cameraPos[2];
+    }
+    TexLoader::nextFrame();
+}
+
+/*
+ * Unloads textures no shape or object references and not used for
+ * KeepFrames frames, least recently used first, while uploaded textures
+ * use more than Game::textureMemoryLimit megabytes.
+ */
+void TexLib::unloadUnused(){
+    long long limit = (long long)Game::textureMemoryLimit*1024*1024;
+    if(Game::textureMemoryLimit <= 0 || ResidentBytes <= limit)
+        return;
+    std::vector<std::pair<int, Texture*>> unused;
+    for(auto it = mtex.begin(); it != mtex.end(); ++it){
+        Texture* t = it->second;
+        if(t == NULL || t->ref > 0 || !t->glLoaded || t->loadQueued)
+            continue;
+        if(TexLoader::Frame - t->lastUsed < KeepFrames || !isReloadable(t))
+            continue;
+        unused.push_back(std::make_pair(t->lastUsed, t));
+    }
+    std::sort(unused.begin(), unused.end(), [](const std::pair<int, Texture*>& a, const std::pair<int, Texture*>& b){
+        return a.first < b.first;
+    });
+    int count = 0;
+    for(unsigned int i = 0; i < unused.size() && ResidentBytes > limit; i++){
+        unused[i].second->unload();
+        count++;
+    }
+    if(count > 0)
+        qDebug() << "TexLib: unloaded" << count << "textures," << ResidentBytes/(1024*1024) << "MB resident";
+}
+
 int TexLib::cloneTex(int id) {
     Texture* t = mtex[id];
     if(t == NULL) {
         qDebug() << "null texture " << id;
         return -2;
     }
+    // DXT data not uploaded yet has no GL texture to copy from.
+    if(!t->editable && !t->glLoaded)
+        t->setEditable();
     Texture* newFile = new Texture(t);
     newFile->ref++;
     mtex[jesttextur] = newFile;
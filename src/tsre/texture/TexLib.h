@@ -13,6 +13,8 @@
 #include <QHash>
 #include <tsre/texture/Texture.h>
 
+class TexDecoder;
+
 #ifndef TEXLIB_H
 #define	TEXLIB_H
 
@@ -22,8 +24,11 @@ public:
     TexLib(const TexLib& orig);
     virtual ~TexLib();
     static int jesttextur;
+    static long long ResidentBytes;
+    static int KeepFrames;
     static std::unordered_map<int, Texture*> mtex;
     static QHash<int, int> disabledTextures;
+    static QHash<QString, int> pathIndex;
     static void reset();
     static void enableTexture(int id);
     static void disableTexture(int id);
@@ -32,9 +37,17 @@ public:
     static int addTex(QString path, QString name, bool reload = false);
     static int addTex(QString pathid, bool reload = false);
     static int getTex(QString pathid);
+    static int findTex(const QString &pathid);
     static int cloneTex(int id);
     static void save(QString type, QString path, int id);
+    static void touchTex(int id);
+    static void nextFrame(float* cameraPos = NULL);
+    static void unloadUnused();
 private:
+    static float viewPoint[3];
+    static TexDecoder* createDecoder(Texture* texture);
+    static bool isThreaded(Texture* texture);
+    static bool isReloadable(Texture* texture);
 
 };
 
@@ -0,0 +1,156 @@
+/*  This file is part of TSRE5.
+ *
+ *  TSRE5 - train sim game engine and MSTS/OR Editors.
+ *  Copyright (C) 2016 Piotr Gadecki <pgadecki@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *
+ *  See LICENSE.md or https://www.gnu.org/licenses/gpl.html
+ */
+
+#include <tsre/texture/TexLoader.h>
+#include <tsre/texture/Texture.h>
+#include <tsre/Game.h>
+#include <QMutexLocker>
+#include <QDebug>
+#include <algorithm>
+
+int TexLoader::CancelFrames = 60;
+int TexLoader::Frame = 0;
+
+QMutex TexLoader::mutex;
+QWaitCondition TexLoader::jobAdded;
+std::vector<TexLoader::Job> TexLoader::jobs;
+QVector<TexLoader*> TexLoader::workers;
+bool TexLoader::jobsDirty = false;
+unsigned int TexLoader::jobSeq = 0;
+int TexLoader::uploadedBytes = 0;
+
+bool TexLoader::jobLess(const Job& a, const Job& b){
+    Texture* ta = a.decoder->texture;
+    Texture* tb = b.decoder->texture;
+    if(ta->loadFrame != tb->loadFrame)
+        return ta->loadFrame < tb->loadFrame;
+    if(ta->loadDistance != tb->loadDistance)
+        return ta->loadDistance > tb->loadDistance;
+    return a.seq > b.seq;
+}
+
+void TexLoader::startWorkers(){
+    int count = Game::textureLoaderThreads;
+    if(count <= 0)
+        count = QThread::idealThreadCount() - 1;
+    if(count < 1)
+        count = 1;
+    for(int i = 0; i < count; i++){
+        TexLoader* worker = new TexLoader();
+        workers.push_back(worker);
+        worker->start(QThread::LowPriority);
+    }
+    qDebug() << "TexLoader: threads" << count;
+}
+
+void TexLoader::enqueue(TexDecoder* job, float distance){
+    if(job == NULL || job->texture == NULL)
+        return;
+    QMutexLocker locker(&mutex);
+    if(workers.size() == 0)
+        startWorkers();
+    job->texture->loadQueued = true;
+    job->texture->loadDistance = distance;
+    if(job->texture->loadFrame < 0)
+        job->texture->loadFrame = Frame;
+    jobs.push_back({job, jobSeq++});
+    if(jobsDirty)
+        std::make_heap(jobs.begin(), jobs.end(), jobLess);
+    else
+        std::push_heap(jobs.begin(), jobs.end(), jobLess);
+    jobsDirty = false;
+    jobAdded.wakeOne();
+}
+
+bool TexLoader::touch(Texture* texture, float distance){
+    QMutexLocker locker(&mutex);
+    texture->loadTouched = true;
+    // Decode may have finished since the caller checked.
+    if(texture->loaded || texture->missing || texture->error)
+        return true;
+    if(!texture->loadQueued){
+        texture->loadFrame = Frame;
+        texture->loadDistance = distance;
+        return false;
+    }
+    if(texture->loadFrame != Frame || texture->loadDistance > distance){
+        texture->loadFrame = Frame;
+        texture->loadDistance = distance;
+        jobsDirty = true;
+    }
+    return true;
+}
+
+void TexLoader::cancelAll(){
+    QMutexLocker locker(&mutex);
+    for(unsigned int i = 0; i < jobs.size(); i++){
+        jobs[i].decoder->texture->loadQueued = false;
+        delete jobs[i].decoder;
+    }
+    jobs.clear();
+    jobsDirty = false;
+}
+
+void TexLoader::nextFrame(){
+    QMutexLocker locker(&mutex);
+    Frame++;
+    uploadedBytes = 0;
+}
+
+bool TexLoader::allowUpload(int bytes){
+    if(Game::textureUploadBudget <= 0 || Game::ignoreLoadLimits)
+        return true;
+    // Always let the first texture of a frame through, so big textures still load.
+    if(uploadedBytes > 0 && uploadedBytes + bytes > Game::textureUploadBudget*1024)
+        return false;
+    uploadedBytes += bytes;
+    return true;
+}
+
+int TexLoader::pendingCount(){
+    QMutexLocker locker(&mutex);
+    return jobs.size();
+}
+
+void TexLoader::run(){
+    TexDecoder* job;
+    for(;;){
+        mutex.lock();
+        job = NULL;
+        while(job == NULL){
+            while(jobs.size() == 0)
+                jobAdded.wait(&mutex);
+            if(jobsDirty){
+                std::make_heap(jobs.begin(), jobs.end(), jobLess);
+                jobsDirty = false;
+            }
+            std::pop_heap(jobs.begin(), jobs.end(), jobLess);
+            job = jobs.back().decoder;
+            jobs.pop_back();
+            // Camera moved away before decode started.
+            if(CancelFrames > 0 && job->texture->loadTouched
+                    && Frame - job->texture->loadFrame > CancelFrames){
+                job->texture->loadQueued = false;
+                delete job;
+                job = NULL;
+            }
+        }
+        mutex.unlock();
+
+        job->run();
+
+        mutex.lock();
+        if(!job->texture->loaded && !job->texture->missing)
+            job->texture->error = true;
+        job->texture->loadQueued = false;
+        mutex.unlock();
+        delete job;
+    }
+}
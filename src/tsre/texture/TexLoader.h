@@ -0,0 +1,75 @@
+/*  This file is part of TSRE5.
+ *
+ *  TSRE5 - train sim game engine and MSTS/OR Editors.
+ *  Copyright (C) 2016 Piotr Gadecki <pgadecki@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *
+ *  See LICENSE.md or https://www.gnu.org/licenses/gpl.html
+ */
+
+#ifndef TEXLOADER_H
+#define	TEXLOADER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QVector>
+#include <vector>
+
+class Texture;
+
+/*
+ * Single decode job, AceLib, DdsLib, ImageLib and MapLib derive from it.
+ * run() fills texture->imageData and sets texture->loaded.
+ */
+class TexDecoder {
+public:
+    Texture* texture = nullptr;
+    virtual ~TexDecoder() {};
+    virtual void run() = 0;
+};
+
+/*
+ * Shared, bounded pool of texture decode threads.
+ * Jobs are ordered by the frame the renderer last asked for the texture
+ * and then by distance to the camera, so visible and near textures go first.
+ * Jobs not asked for during CancelFrames frames are dropped and queued
+ * again by TexLib::touchTex when the texture is needed.
+ * GL upload is done on the main thread and limited to
+ * Game::textureUploadBudget kilobytes per frame and by FrameScheduler.
+ */
+class TexLoader : public QThread {
+    Q_OBJECT
+public:
+    static int CancelFrames;
+    static int Frame;
+
+    static void enqueue(TexDecoder* job, float distance = 0);
+    static bool touch(Texture* texture, float distance);
+    static void cancelAll();
+    static void nextFrame();
+    static bool allowUpload(int bytes);
+    static int pendingCount();
+
+protected:
+    void run();
+
+private:
+    struct Job {
+        TexDecoder* decoder;
+        unsigned int seq;
+    };
+    static QMutex mutex;
+    static QWaitCondition jobAdded;
+    static std::vector<Job> jobs;
+    static QVector<TexLoader*> workers;
+    static bool jobsDirty;
+    static unsigned int jobSeq;
+    static int uploadedBytes;
+    static bool jobLess(const Job& a, const Job& b);
+    static void startWorkers();
+};
+
+#endif	/* TEXLOADER_H */
+
@@ -10,6 +10,10 @@
 
 #include <tsre/texture/Texture.h>
 #include <tsre/texture/Brush.h>
+#include <tsre/texture/TexLoader.h>
+#include <tsre/texture/TexLib.h>
+#include <tsre/texture/S3tc.h>
+#include <tsre/renderer/FrameScheduler.h>
 #include <tsre/Undo.h>
 #include <QOpenGLShaderProgram>
 #include <QString>
@@ -79,6 +83,8 @@ Texture::Texture(const Texture* orig) {
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     //delete imageData;
     glLoaded = true;
+    gpuBytes = bytesPerPixel*width*height;
+    TexLib::ResidentBytes += gpuBytes;
 
     /*unsigned int* pex = new unsigned int[1];
     f->glGenBuffers(1, pex);
@@ -96,11 +102,18 @@ Texture::Texture(const Texture* orig) {
 }
 
 void Texture::setEditable(){
+    // DXT data not uploaded yet is decoded on the CPU.
+    if(!glLoaded && compressedFormat != 0){
+        S3tc::decompress(this);
+        return;
+    }
     imageData = new unsigned char[bytesPerPixel*width*height];
 
     //QOpenGLFunctions_3_2_Core *f = QOpenGLContext::currentContext()-> functions();
     glBindTexture(GL_TEXTURE_2D, tex[0]);
     glGetTexImage(GL_TEXTURE_2D, 0, type, GL_UNSIGNED_BYTE, imageData);
+    compressedFormat = 0;
+    mipLevels = 1;
     this->editable = true;
 }
 
@@ -350,8 +363,19 @@ Texture::~Texture() {
 
 bool Texture::GLTextures(bool mipmaps) {
     if(!loaded) return false;
+    qint64 uploadStart = FrameScheduler::begin(FrameScheduler::Upload, this);
+    if(uploadStart < 0) return false;
+    // Mipmaps of DXT data without a mip chain are generated from pixels.
+    // Decoded inside the Upload budget, the pixels are kept if the upload
+    // has to wait for another frame.
+    if(compressedFormat != 0 && (!S3tc::Supported() || (mipmaps && mipLevels < 2)))
+        S3tc::decompress(this);
+    if(!TexLoader::allowUpload(compressedFormat != 0 ? imageSize : width*height*bytesPerPixel)){
+        FrameScheduler::end(FrameScheduler::Upload, uploadStart);
+        return false;
+    }
     
-    if(Game::AASamples > 0 && Game::AARemoveBorder)
+    if(compressedFormat == 0 && Game::AASamples > 0 && Game::AARemoveBorder)
         if(type == GL_RGBA){
             for (int i = 0; i < height; i++)
                 imageData[i*width*bytesPerPixel + (width-1)*bytesPerPixel + 3] = 0;
@@ -368,15 +392,24 @@ bool Texture::GLTextures(bool mipmaps) {
     
     glGenTextures(1, tex);
     glBindTexture(GL_TEXTURE_2D, tex[0]);
-    glTexImage2D(GL_TEXTURE_2D, 0, type, width, height, 0, type, GL_UNSIGNED_BYTE, imageData);
-    
-    //f->glTexStorage2D(GL_TEXTURE_2D, 4, GL_RGBA8, width, height);
-    //f->glTexSubImage2D(GL_TEXTURE_2D, 0​, 0, 0, width​, height​, GL_BGRA, GL_UNSIGNED_BYTE, pixels);
-    if(mipmaps){
-        f->glGenerateMipmap(GL_TEXTURE_2D);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,  GL_LINEAR_MIPMAP_LINEAR );
+    // Reloaded textures replace the previous upload.
+    TexLib::ResidentBytes -= gpuBytes;
+    if(compressedFormat != 0){
+        S3tc::upload(this);
+        gpuBytes = imageSize;
     } else {
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,  GL_LINEAR );
+        glTexImage2D(GL_TEXTURE_2D, 0, type, width, height, 0, type, GL_UNSIGNED_BYTE, imageData);
+
+        //f->glTexStorage2D(GL_TEXTURE_2D, 4, GL_RGBA8, width, height);
+        //f->glTexSubImage2D(GL_TEXTURE_2D, 0​, 0, 0, width​, height​, GL_BGRA, GL_UNSIGNED_BYTE, pixels);
+        gpuBytes = width*height*bytesPerPixel;
+        if(mipmaps){
+            gpuBytes += gpuBytes/3;
+            f->glGenerateMipmap(GL_TEXTURE_2D);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,  GL_LINEAR_MIPMAP_LINEAR );
+        } else {
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,  GL_LINEAR );
+        }
     }
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -385,6 +418,9 @@ bool Texture::GLTextures(bool mipmaps) {
     imageData = NULL;
     this->editable = false;
     glLoaded = true;
+    lastUsed = TexLoader::Frame;
+    TexLib::ResidentBytes += gpuBytes;
+    FrameScheduler::end(FrameScheduler::Upload, uploadStart);
     return true;
 }
 
@@ -396,6 +432,30 @@ void Texture::delVBO() {
     editable = false;
     missing = false;
     error = false;
+    compressedFormat = 0;
+    mipLevels = 1;
     //gl.glDeleteTextures(1, tex, 0);
 }
 
+/*
+ * Frees the GL texture and decoded data, touchTex() decodes it again.
+ * Only for textures nothing holds the GL name of, see TexLib::unloadUnused().
+ */
+void Texture::unload() {
+    if(glLoaded){
+        glDeleteTextures(1, tex);
+        delete[] tex;
+        tex = NULL;
+    }
+    TexLib::ResidentBytes -= gpuBytes;
+    gpuBytes = 0;
+    delete[] imageData;
+    imageData = NULL;
+    compressedFormat = 0;
+    mipLevels = 1;
+    glLoaded = false;
+    loaded = false;
+    loadTouched = false;
+    loadFrame = -1;
+}
+
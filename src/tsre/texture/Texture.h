@@ -43,6 +43,18 @@ public:
     bool editable = false;
     bool missing = false;
     bool error = false;
+    // TexLoader queue state
+    bool loadQueued = false;
+    bool loadTouched = false;
+    int loadFrame = -1;
+    float loadDistance = 0;
+    // TexLoader::Frame of the last upload or release.
+    int lastUsed = 0;
+    // Counted in TexLib::ResidentBytes while glLoaded.
+    int gpuBytes = 0;
+    // S3tc format of imageData, all mip levels back to back, 0 for pixels.
+    unsigned int compressedFormat = 0;
+    int mipLevels = 1;
 
     void setEditable();
     bool GLTextures(bool mipmaps = false);
@@ -54,6 +66,7 @@ public:
     void fillData(unsigned char* data);
     unsigned char * getImageData(int width, int height);
     void delVBO();
+    void unload();
 private:
 
 };
@@ -0,0 +1,167 @@
+/*  This file is part of TSRE5.
+ *
+ *  TSRE5 - train sim game engine and MSTS/OR Editors.
+ *  Copyright (C) 2016 Piotr Gadecki <pgadecki@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *
+ *  See LICENSE.md or https://www.gnu.org/licenses/gpl.html
+ */
+
+#include <tsre/texture/TextureCache.h>
+#include <tsre/texture/Texture.h>
+#include <tsre/texture/S3tc.h>
+#include <tsre/fileFunctions/FileBuffer.h>
+#include <tsre/fileFunctions/ReadFile.h>
+#include <tsre/Game.h>
+#include <QOpenGLShaderProgram>
+#include <QCryptographicHash>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QDir>
+#include <QDebug>
+#include <string.h>
+
+static const char CacheMagic[8] = { 'T', 'S', 'R', 'E', '_', 'T', 'C', 0 };
+
+QMutex TextureCache::mutex;
+QWaitCondition TextureCache::jobAdded;
+QQueue<TextureCache::Job> TextureCache::jobs;
+TextureCache* TextureCache::worker = NULL;
+
+bool TextureCache::enabled(){
+    return Game::useTextureCache && Game::route.length() > 0 && S3tc::keepCompressed();
+}
+
+QString TextureCache::getPath(const QString &pathid){
+    QString name = QCryptographicHash::hash(pathid.toLower().toUtf8(), QCryptographicHash::Sha1).toHex();
+    QString path = Game::root + "/routes/" + Game::route + "/tsre_cache/textures/" + name;
+    path.replace("//", "/");
+    return path;
+}
+
+bool TextureCache::read(Texture* texture){
+    QFileInfo source(texture->pathid);
+    if(!source.exists())
+        return false;
+    QFile file(getPath(texture->pathid));
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    FileBuffer* data = FileBuffer::map(&file);
+    if(data == NULL)
+        data = ReadFile::readRAW(&file);
+    file.close();
+
+    unsigned int format = 0;
+    int width = 0, height = 0, levels = 0;
+    bool valid = data->length >= HeaderLength
+            && memcmp(data->data, CacheMagic, 8) == 0;
+    if(valid){
+        data->off = 8;
+        valid = data->getUint() == Version
+                && data->getInt() == data->length - HeaderLength
+                && *(qint64*)&data->data[16] == source.size()
+                && *(qint64*)&data->data[24] == source.lastModified().toMSecsSinceEpoch();
+    }
+    if(valid){
+        data->off = 32;
+        format = data->getUint();
+        width = data->getInt();
+        height = data->getInt();
+        levels = data->getInt();
+        valid = (format == S3tc::DXT1 || format == S3tc::DXT5) && width > 0 && height > 0 && levels > 0
+                && S3tc::chainSize(format, width, height, levels) == data->length - HeaderLength;
+    }
+    if(!valid){
+        delete data;
+        return false;
+    }
+
+    texture->imageSize = data->length - HeaderLength;
+    texture->imageData = new unsigned char[texture->imageSize];
+    memcpy(texture->imageData, data->data + HeaderLength, texture->imageSize);
+    texture->compressedFormat = format;
+    texture->mipLevels = levels;
+    texture->width = width;
+    texture->height = height;
+    if(format == S3tc::DXT1){
+        texture->bytesPerPixel = 3;
+        texture->type = GL_RGB;
+    } else {
+        texture->bytesPerPixel = 4;
+        texture->type = GL_RGBA;
+    }
+    texture->bpp = texture->bytesPerPixel*8;
+    texture->loaded = true;
+    delete data;
+    return true;
+}
+
+void TextureCache::write(Texture* texture){
+    if(texture->imageData == NULL || texture->compressedFormat != 0)
+        return;
+    QFileInfo source(texture->pathid);
+    if(!source.exists())
+        return;
+
+    QMutexLocker locker(&mutex);
+    if(jobs.size() >= MaxJobs)
+        return;
+    if(worker == NULL){
+        worker = new TextureCache();
+        worker->start(QThread::LowPriority);
+    }
+    Job job;
+    job.path = getPath(texture->pathid);
+    job.size = source.size();
+    job.modified = source.lastModified().toMSecsSinceEpoch();
+    job.width = texture->width;
+    job.height = texture->height;
+    job.bytesPerPixel = texture->bytesPerPixel;
+    job.pixels = QByteArray((const char*)texture->imageData, texture->width*texture->height*texture->bytesPerPixel);
+    jobs.enqueue(job);
+    jobAdded.wakeOne();
+}
+
+void TextureCache::run(){
+    Job job;
+    for(;;){
+        mutex.lock();
+        while(jobs.size() == 0)
+            jobAdded.wait(&mutex);
+        job = jobs.dequeue();
+        mutex.unlock();
+
+        unsigned int format;
+        int levels, length;
+        unsigned char* blocks = S3tc::compress((const unsigned char*)job.pixels.constData(),
+                job.width, job.height, job.bytesPerPixel, format, levels, length);
+
+        QByteArray out;
+        out.reserve(HeaderLength + length);
+        out.append(CacheMagic, 8);
+        unsigned int version = Version;
+        out.append((const char*)&version, 4);
+        out.append((const char*)&length, 4);
+        out.append((const char*)&job.size, 8);
+        out.append((const char*)&job.modified, 8);
+        out.append((const char*)&format, 4);
+        out.append((const char*)&job.width, 4);
+        out.append((const char*)&job.height, 4);
+        out.append((const char*)&levels, 4);
+        out.append((const char*)blocks, length);
+        delete[] blocks;
+
+        QDir().mkpath(QFileInfo(job.path).path());
+        QSaveFile file(job.path);
+        if (!file.open(QIODevice::WriteOnly)){
+            qDebug() << "TextureCache: can't write" << job.path;
+            continue;
+        }
+        file.write(out);
+        if(!file.commit())
+            qDebug() << "TextureCache: can't write" << job.path;
+    }
+}
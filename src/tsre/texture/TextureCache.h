@@ -0,0 +1,64 @@
+/*  This file is part of TSRE5.
+ *
+ *  TSRE5 - train sim game engine and MSTS/OR Editors.
+ *  Copyright (C) 2016 Piotr Gadecki <pgadecki@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *
+ *  See LICENSE.md or https://www.gnu.org/licenses/gpl.html
+ */
+
+#ifndef TEXTURECACHE_H
+#define	TEXTURECACHE_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QByteArray>
+
+class Texture;
+
+/*
+ * Cache of uncompressed ACE and image textures transcoded to DXT,
+ * in routes/<route>/tsre_cache/textures, named by the SHA1 of the texture
+ * path. The header keeps the version and the size and modification time
+ * of the source file, followed by the S3tc format, width, height, mip
+ * level count and the levels. A decoder that misses the cache decodes the
+ * source on the CPU as before and hands the pixels to write(); the
+ * encoding and writing are done by a background thread.
+ */
+class TextureCache : public QThread {
+    Q_OBJECT
+public:
+    static const unsigned int Version = 1;
+    static const int HeaderLength = 48;
+    // Textures waiting for encoding, later ones are cached on a next load.
+    static const int MaxJobs = 16;
+
+    static bool enabled();
+    static bool read(Texture* texture);
+    static void write(Texture* texture);
+
+protected:
+    void run();
+
+private:
+    struct Job {
+        QString path;
+        qint64 size;
+        qint64 modified;
+        int width;
+        int height;
+        int bytesPerPixel;
+        QByteArray pixels;
+    };
+    static QMutex mutex;
+    static QWaitCondition jobAdded;
+    static QQueue<Job> jobs;
+    static TextureCache* worker;
+    static QString getPath(const QString &pathid);
+};
+
+#endif	/* TEXTURECACHE_H */
+
@@ -129,7 +129,7 @@ void Eng::load(){
     filePaths.clear();
     QString mstsincpath = path.toLower();
     QString incpath = orpath.toLower();
-    QString sh;
+    ParserX::Token sh;
     QFile *file = new QFile(orpathid);
     if (!file->open(QIODevice::ReadOnly)){
         incpath = path.toLower();
@@ -152,7 +152,7 @@ void Eng::load(){
     data->skipBOM();
     QString loadedPath;
     
-    while (!((sh = ParserX::NextTokenInside(data).toLower()) == "")) {
+    while (!((sh = ParserX::NextTokenView(data)).isEmpty())) {
         //qDebug() << sh;
         if (sh == ("simisa@@@@@@@@@@jinx0d0t______")) {
             continue;
@@ -169,7 +169,7 @@ void Eng::load(){
                 engName = ParserX::GetString(data).trimmed();
                 displayName = engName;
             }
-            while (!((sh = ParserX::NextTokenInside(data).toLower()) == "")) {
+            while (!((sh = ParserX::NextTokenView(data)).isEmpty())) {
                 //qDebug() << sh;
                 if (sh == ("include")) {
                     QString incPath = ParserX::GetStringInside(data).toLower();
@@ -219,7 +219,7 @@ void Eng::load(){
                 }
                 if (sh == ("coupling")) {
                     coupling.push_back(Coupling());
-                    while (!((sh = ParserX::NextTokenInside(data).toLower()) == "")) {
+                    while (!((sh = ParserX::NextTokenView(data)).isEmpty())) {
                         if (sh == ("type")) {
                             coupling.back().type = ParserX::GetString(data);
                             //qDebug() << "c: "<< coupling.back().type;
@@ -232,7 +232,7 @@ void Eng::load(){
                             continue;
                         }
                         if (sh == ("spring")) {
-                            while (!((sh = ParserX::NextTokenInside(data).toLower()) == "")) {
+                            while (!((sh = ParserX::NextTokenView(data)).isEmpty())) {
                                 if (sh == ("r0")) {
                                     coupling.back().r0[0] = ParserX::GetNumberInside(data);
                                     coupling.back().r0[1] = ParserX::GetNumberInside(data);
@@ -252,7 +252,7 @@ void Eng::load(){
                     continue;
                 }
                 if (sh == ("ortsfreightanims")) {
-                    while (!((sh = ParserX::NextTokenInside(data).toLower()) == "")) {
+                    while (!((sh = ParserX::NextTokenView(data)).isEmpty())) {
                         //qDebug() << "orts " << sh;
                         if (sh == ("mstsfreightanimenabled")) {
                             int val = ParserX::GetNumber(data);
@@ -264,7 +264,7 @@ void Eng::load(){
                         }
                         if (sh == ("freightanimstatic")) {
                             freightanimShape.push_back(EngShape());
-                            while (!((sh = ParserX::NextTokenInside(data).toLower()) == "")) {
+                            while (!((sh = ParserX::NextTokenView(data)).isEmpty())) {
                                 //qDebug() << "orts " << sh;
                                 if (sh == ("subtype")) {
                                     ParserX::SkipToken(data);
@@ -325,7 +325,7 @@ void Eng::load(){
         }
         if(sh == "engine"){
             ParserX::GetString(data);
-            while (!((sh = ParserX::NextTokenInside(data).toLower()) == "")) {
+            while (!((sh = ParserX::NextTokenView(data)).isEmpty())) {
                 //qDebug() << sh;
                 if (sh == ("include")) {
                     QString incPath = ParserX::GetStringInside(data).toLower();
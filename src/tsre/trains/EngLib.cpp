@@ -42,18 +42,16 @@ int EngLib::addEng(QString path, QString name) {
     pathid.replace("\\", "/");
     pathid.replace("//", "/");
     //qDebug() << pathid;
-    for ( auto it = eng.begin(); it != eng.end(); ++it ){
-        if(it->second == NULL) continue;
-        if (((Eng*) it->second)->pathid.length() == pathid.length())
-            if (((Eng*) it->second)->pathid == pathid) {
-                ((Eng*) it->second)->ref++;
-                //qDebug() <<"engid "<< pathid;
-                return (int)it->first;
-            }
+    int id = getEngByPathid(pathid);
+    if(id >= 0){
+        eng[id]->ref++;
+        //qDebug() <<"engid "<< pathid;
+        return id;
     }
     //qDebug() << "Nowy " << jesteng << " eng: " << pathid;
 
     eng[jesteng] = new Eng(pathid, path, name);
+    pathIndex[eng[jesteng]->pathid] = jesteng;
 
     return jesteng++;
 }
@@ -61,26 +59,28 @@ int EngLib::addEng(QString path, QString name) {
 int EngLib::removeBroken() {
     for (int i = 0; i < jesteng; i++){
         if(eng[i] == NULL) continue;
-        if (eng[i]->loaded != 1)
+        if (eng[i]->loaded != 1){
+            pathIndex.remove(eng[i]->pathid);
             eng[i] = NULL;
+        }
     }
     return 0;
 }
 
 void EngLib::removeAll(){
     eng.clear();
+    pathIndex.clear();
     jesteng = 0;
 }
 
 int EngLib::getEngByPathid(QString pathid) {
-    for ( auto it = eng.begin(); it != eng.end(); ++it ){
-        if(it->second == NULL) continue;
-        if (((Eng*) it->second)->pathid.length() == pathid.length())
-            if (((Eng*) it->second)->pathid == pathid) {
-                return (int)it->first;
-            }
-    }
-    return -1;
+    auto it = pathIndex.find(pathid);
+    if(it == pathIndex.end())
+        return -1;
+    auto eit = eng.find(it.value());
+    if(eit == eng.end() || eit->second == NULL)
+        return -1;
+    return it.value();
 }
 
 int EngLib::loadAll(QString gameRoot, bool gui){
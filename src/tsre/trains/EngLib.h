@@ -13,6 +13,7 @@
 
 #include <unordered_map>
 #include <QString>
+#include <QHash>
 
 class Eng;
 
@@ -20,6 +21,7 @@ class EngLib {
 public:
     int jesteng = 0;
     std::unordered_map<int, Eng*> eng;
+    QHash<QString, int> pathIndex;
     EngLib();
     virtual ~EngLib();
     int addEng(QString path, QString name);
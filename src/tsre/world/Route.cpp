@@ -11,10 +11,13 @@
 #include <QDebug>
 #include <QFile>
 #include <QDir>
+#include <algorithm>
 #include <tsre/world/Route.h>
 #include <tsre/tdb/TSectionDAT.h>
 #include <tsre/ogl/GLUU.h>
 #include <tsre/world/Tile.h>
+#include <tsre/fileFunctions/SaveQueue.h>
+#include <tsre/world/TileStreamer.h>
 #include <tsre/math3d/GLMatrix.h>
 #include <tsre/world/TerrainLib.h>
 #include <tsre/world/TerrainLibSimple.h>
@@ -454,6 +457,7 @@ Route::Route(const Route& orig) {
 }
 
 Route::~Route() {
+    TileStreamer::stop();
 }
 
 void Route::loadAddons(){
@@ -700,6 +704,34 @@ WorldObj* Route::findNearestObj(int x, int z, float* pos){
     return tTile->findNearestObj(pos);
 }
 
+/*
+ * Nearest world object hit by a ray given relative to the playerT tile,
+ * over all loaded tiles in render range.
+ */
+WorldObj* Route::pickObject(float* playerT, float* origin, float* dir, float maxT, float &t){
+    if(!loaded) return NULL;
+    WorldObj* nearest = NULL;
+    float tt;
+    float o[3];
+    Tile *tTile;
+    for (int i = -Game::tileLod; i <= Game::tileLod; i++) {
+        for (int j = -Game::tileLod; j <= Game::tileLod; j++) {
+            tTile = tile.value(((int)playerT[0] + i)*10000 + (int)playerT[1] + j, NULL);
+            if(tTile == NULL)
+                continue;
+            o[0] = origin[0] - 2048*i;
+            o[1] = origin[1];
+            o[2] = origin[2] - 2048*j;
+            WorldObj* obj = tTile->pickObject(o, dir, nearest == NULL ? maxT : t, tt);
+            if(obj != NULL && (nearest == NULL || tt < t)){
+                nearest = obj;
+                t = tt;
+            }
+        }
+    }
+    return nearest;
+}
+
 void Route::transalteObj(int x, int z, float px, float py, float pz, int uid) {
     Tile *tTile;
 
@@ -734,13 +766,13 @@ void Route::updateSim(float *playerT, float deltaTime){
 }
 
 WorldObj* Route::updateWorldObjData(FileBuffer *data){
-    QString sh;
+    ParserX::Token sh;
     int x = 0;
     int z = 0;
     WorldObj *nowy = NULL;
     bool objloaded = true;
     
-    while (!((sh = ParserX::NextTokenInside(data).toLower()) == "")) {
+    while (!((sh = ParserX::NextTokenView(data)).isEmpty())) {
         //qDebug() << sh;
         if (sh == ("x")) {
             x = ParserX::GetNumber(data);
@@ -759,7 +791,7 @@ WorldObj* Route::updateWorldObjData(FileBuffer *data){
         }
         if ((nowy = WorldObj::createObj(sh)) != NULL) {
             //qDebug() << nowy->type;
-            while (!((sh = ParserX::NextTokenInside(data).toLower()) == "")) {
+            while (!((sh = ParserX::NextTokenView(data)).isEmpty())) {
                 nowy->set(sh, data);
                 ParserX::SkipToken(data);
             }
@@ -1614,11 +1646,15 @@ void Route::actNewNewSpeedZone(int x, int z, float* p){
 }
 
 Tile * Route::requestTile(int x, int z, bool allowNew){
-    Tile *tTile = tile[((x)*10000 + z)];
+    Tile *tTile = tile.value((x)*10000 + z, NULL);
     if (tTile == NULL){
+        // Drawing doesn't wait, TileStreamer loads the tile in the background.
+        if(!allowNew && !Game::ignoreLoadLimits && TileStreamer::request(x, z))
+            return NULL;
         tile[(x)*10000 + z] = new Tile(x, z);
         tTile = tile[(x)*10000 + z];
     }
+    tTile->lastUsed = TileStreamer::Frame;
 
     if(!allowNew)
         return tTile;
@@ -1857,6 +1893,7 @@ void Route::replaceWorldObjPointer(WorldObj* o, WorldObj* n){
         if(tTile->obiekty[i] == NULL) continue;
         if(tTile->obiekty[i]->UiD == o->UiD){
             tTile->obiekty[i] = n;
+            Tile::MarkDirty(x, z);
             emit objectSelected((GameObj*)n);
             return;
         }
@@ -2198,7 +2235,10 @@ int Route::getTileHiddenObjCount(int x, int z) {
 void Route::getUnsavedInfo(QVector<QString> &items){
     if (!Game::writeEnabled) return;
     
-    foreach (Tile* tTile, tile){
+    QList<int> dirty = Tile::GetDirty().values();
+    std::sort(dirty.begin(), dirty.end());
+    foreach (int id, dirty){
+        Tile* tTile = tile.value(id, NULL);
         if (tTile == NULL) continue;
         if (tTile->loaded == 1 && tTile->isModified()) {
             items.push_back("[W] "+QString::number(tTile->x)+" "+QString::number(-tTile->z));
@@ -2230,13 +2270,17 @@ void Route::getUnsavedInfo(QVector<QString> &items){
 void Route::save() {
     if (!Game::writeEnabled) return;
     qDebug() << "save";
-    foreach (Tile* tTile, tile){
+    // Only tiles changed since the last save, files are written by SaveQueue.
+    QVector<Tile*> changed;
+    foreach (int id, Tile::TakeDirty()){
+        Tile* tTile = tile.value(id, NULL);
         if (tTile == NULL) continue;
-        if (tTile->loaded == 1 && tTile->isModified()) {
-            tTile->save();
-            tTile->setModified(false);
-        }
+        if (tTile->loaded == 1 && tTile->isModified())
+            changed.push_back(tTile);
     }
+    Tile::SaveAll(changed);
+    for (int i = 0; i < changed.size(); i++)
+        changed[i]->setModified(false);
     Game::terrainLib->save();
     this->trackDB->save();
     this->roadDB->save();
@@ -2369,11 +2413,12 @@ void Route::createNew() {
 }
 
 void Route::reloadTile(int x, int z) {
+    SaveQueue::WaitForDone();
     tile[x * 10000 + z] = new Tile(x, z);
     return;
 }
 
-int Route::newTile(int x, int z, bool forced) {
+int Route::newTile(int x, int z, bool forced, bool geoTerrain) {
     if (!Game::writeEnabled) return 0;
     
     if (tile[x*10000 + z] == NULL)
@@ -2383,13 +2428,14 @@ int Route::newTile(int x, int z, bool forced) {
         if (tile[x*10000 + z]->loaded == 1)
             return 1;
             
+    SaveQueue::WaitForDone();
     Tile::saveEmpty(x, -z);
     //Terrain::saveEmpty(x, -z);
     Game::terrainLib->saveEmpty(x, -z);
     Game::terrainLib->reload(x, z);
     reloadTile(x, z);
 
-    if(Game::autoGeoTerrain){
+    if(Game::autoGeoTerrain && geoTerrain){
         float pos[3];
         Vec3::set(pos, 0, 0, 0);
         Game::terrainLib->setHeightFromGeo(x, z, (float*)&pos);
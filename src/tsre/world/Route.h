@@ -75,6 +75,7 @@ public:
     void mergeRoute(QString route2Name, float offsetX, float offsetY, float offsetZ);
     WorldObj* getObj(int x, int z, int id);
     WorldObj* findNearestObj(int x, int z, float *pos);
+    WorldObj* pickObject(float* playerT, float* origin, float* dir, float maxT, float &t);
     virtual Tile * requestTile(int x, int z, bool allowNew = true);
     void activitySelected(Activity* selected);
     virtual void save();
@@ -91,7 +92,7 @@ public:
     void loadPaths();
     void preloadWFiles(bool gui = false);
     void preloadWFilesInit();
-    int newTile(int x, int z, bool forced = false);
+    int newTile(int x, int z, bool forced = false, bool geoTerrain = true);
     void reloadTile(int x, int z);
     void deleteObj(WorldObj* obj);
     void undoPlaceObj(int x, int y, int UiD);
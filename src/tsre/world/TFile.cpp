@@ -13,6 +13,7 @@
 #include <QFile>
 #include <tsre/fileFunctions/ReadFile.h>
 #include <QDataStream>
+#include <tsre/fileFunctions/SaveQueue.h>
 
 TFile::TFile() {
     loaded = false;
@@ -580,17 +581,13 @@ int TFile::getMatByTexture(QString tname){
 }
 
 void TFile::save(QString name){
-    name.replace("//", "/");
-    QFile *file = new QFile(name);
     qDebug() << "zapis .t "<<name;
-    if (!file->open(QIODevice::WriteOnly))
-        return;
-    QDataStream write(file);
+    QByteArray data;
+    QDataStream write(&data, QIODevice::WriteOnly);
     write.setByteOrder(QDataStream::LittleEndian);
     write.setFloatingPointPrecision(QDataStream::SinglePrecision);
     save(write);
-    write.setDevice(nullptr);
-    file->close();
+    SaveQueue::Write(name, data);
 }
 
 void TFile::save(QDataStream &write){
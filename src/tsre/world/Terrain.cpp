@@ -12,8 +12,11 @@
 #include <QDebug>
 #include <tsre/Game.h>
 #include <QFile>
+#include <QThread>
 #include <tsre/fileFunctions/ReadFile.h>
+#include <tsre/fileFunctions/SaveQueue.h>
 #include <tsre/texture/TexLib.h>
+#include <tsre/texture/TexLoader.h>
 #include <tsre/world/TerrainLib.h>
 #include <tsre/math3d/GLMatrix.h>
 #include <tsre/texture/Brush.h>
@@ -27,10 +30,15 @@
 #include <tsre/renderer/Renderer.h>
 
 QString Terrain::TileDir[2] = {"tiles", "lo_tiles"};
+QSet<Terrain*> Terrain::Dirty;
+QMutex Terrain::DirtyMutex;
 Brush* Terrain::DefaultBrush = NULL;
 
 Terrain::Terrain(){
-
+    for (int i = 0; i < 256; i++) {
+        texid[i] = -1;
+        texid2[i] = -1;
+    }
 }
 
 Terrain::Terrain(TerrainInfo *ti){
@@ -131,12 +139,28 @@ void Terrain::load(){
     //save();
 }
 
+// Terrain loaded on a worker thread belongs to the thread that draws it.
+void Terrain::setThread(QThread* thread){
+    moveToThread(thread);
+    VAO->moveToThread(thread);
+}
+
 bool Terrain::isModified() {
     return this->modified;
 }
 
 void Terrain::setModified(bool value) {
     this->modified = value;
+    QMutexLocker locker(&DirtyMutex);
+    if(value)
+        Dirty.insert(this);
+    else
+        Dirty.remove(this);
+}
+
+QSet<Terrain*> Terrain::GetDirty() {
+    QMutexLocker locker(&DirtyMutex);
+    return Dirty;
 }
 
 float Terrain::setHeight(int x, int z, float posx, float posz, float val, bool add){
@@ -254,6 +278,10 @@ void Terrain::setFixedHeight(float val){
 }
 
 Terrain::Terrain(const Terrain& orig) {
+    for (int i = 0; i < 256; i++) {
+        texid[i] = -1;
+        texid2[i] = -1;
+    }
 }
 
 void Terrain::saveTfileToStream(QDataStream &out){
@@ -278,7 +306,9 @@ void Terrain::loadTFile(FileBuffer *data){
     //this->tfile = new TFile();
     this->tfile->load(data);
     for (int i = 0; i < 256; i++) {
-        texid[i] = -1;
+        setTexId(i, -1);
+        if (texid2[i] >= 0)
+            TexLib::delRef(texid2[i]);
         texid2[i] = -1;
         hidden[i] = false;
         texModified[i] = false;
@@ -301,6 +331,16 @@ void Terrain::loadFFile(FileBuffer *data){
 
 Terrain::~Terrain() {
     long timeNow1 = QDateTime::currentMSecsSinceEpoch();
+    {
+        QMutexLocker locker(&DirtyMutex);
+        Dirty.remove(this);
+    }
+    for (int i = 0; i < 256; i++) {
+        if (texid[i] >= 0)
+            TexLib::delRef(texid[i]);
+        if (texid2[i] >= 0)
+            TexLib::delRef(texid2[i]);
+    }
     if (this->loaded) {
         for (int i = 0; i < 257; i++) {
             delete[] terrainData[i];
@@ -437,6 +477,16 @@ QString Terrain::getTileName(int x, int y) {
     return "-" + name;
 }
 
+/*
+ * The caller gives the reference to the new texture,
+ * the one used before is released.
+ */
+void Terrain::setTexId(int idx, int id) {
+    if (texid[idx] >= 0)
+        TexLib::delRef(texid[idx]);
+    texid[idx] = id;
+}
+
 void Terrain::refresh() {
     if (!loaded) return;
     isOgl = false;
@@ -468,7 +518,7 @@ void Terrain::toggleGaps(int x, int z, float posx, float posz, float direction){
             }
     }
     modifiedF = true;
-    modified = true;
+    setModified(true);
     refresh();
 }
 
@@ -542,7 +592,7 @@ void Terrain::resetPatchTexCoords(int uu){
             }
         }
     }
-    modified = true;
+    setModified(true);
     this->refresh();
 }
 
@@ -608,7 +658,7 @@ void Terrain::mirrorXTex(int idx){
     tfile->tdata[(idx)*13 + 2 + 6] = y21;
     tfile->tdata[(idx)*13 + 3 + 6] = -tfile->tdata[(idx)*13 + 3 + 6];
     tfile->tdata[(idx)*13 + 5 + 6] = -tfile->tdata[(idx)*13 + 5 + 6];
-    modified = true;
+    setModified(true);
     this->refresh();
 }
 
@@ -619,7 +669,7 @@ void Terrain::mirrorYTex(int idx){
     tfile->tdata[(idx)*13 + 2 + 6] = y12;
     tfile->tdata[(idx)*13 + 4 + 6] = -tfile->tdata[(idx)*13 + 4 + 6];
     tfile->tdata[(idx)*13 + 6 + 6] = -tfile->tdata[(idx)*13 + 6 + 6];
-    modified = true;
+    setModified(true);
     this->refresh();
 }
 
@@ -644,7 +694,7 @@ void Terrain::scaleTex(int idx, float val){
     val1 = val/s;
     tfile->tdata[(idx)*13 + 5 + 6] *= val1;
     tfile->tdata[(idx)*13 + 6 + 6] *= val1;
-    modified = true;
+    setModified(true);
     this->refresh();
 }
 
@@ -653,7 +703,7 @@ void Terrain::scaleTexX(int idx, float val){
     val = val/s;
     tfile->tdata[(idx)*13 + 3 + 6] *= val;
     tfile->tdata[(idx)*13 + 4 + 6] *= val;
-    modified = true;
+    setModified(true);
     this->refresh();
 }
 
@@ -662,7 +712,7 @@ void Terrain::scaleTexY(int idx, float val){
     val = val/s;
     tfile->tdata[(idx)*13 + 5 + 6] *= val;
     tfile->tdata[(idx)*13 + 6 + 6] *= val;
-    modified = true;
+    setModified(true);
     this->refresh();
 }
 
@@ -724,7 +774,8 @@ void Terrain::makeTextureFromMap(){
     float texstep = 1.0/patches;
     for(int i = 0; i < patches; i++)
         for(int j = 0; j < patches; j++){
-            texid[j * patches + i] = newTexture;
+            TexLib::addRef(newTexture);
+            setTexId(j * patches + i, newTexture);
             tfile->tdata[(j * patches + i)*13 + 0 + 6] = newMat;
             tfile->tdata[(j * patches + i)*13 + 1 + 6] = texstep*i;
             tfile->tdata[(j * patches + i)*13 + 2 + 6] = texstep*j;
@@ -734,9 +785,10 @@ void Terrain::makeTextureFromMap(){
             tfile->tdata[(j * patches + i)*13 + 6 + 6] = texstep/patches;
             //TexLib::mtex[texid[j * 16 + i]]->pathid = name;
         }
+    TexLib::delRef(newTexture);
 
     refresh();
-    this->modified = true;
+    setModified(true);
 }
 
 void Terrain::removeTextureFromMap(){
@@ -747,10 +799,10 @@ void Terrain::removeTextureFromMap(){
     }
     tfile->removeMat(newMat);
     for (int i = 0; i < 256; i++) {
-        texid[i] = -1;
+        setTexId(i, -1);
     }    
     refresh();
-    this->modified = true;
+    setModified(true);
 }
 
 void Terrain::setWaterDraw() {
@@ -971,7 +1023,7 @@ void Terrain::setPatchTexTransform(QString val){
                 tfile->tdata[(uu)*13 + i + 1 + 6] = t[i];
         }
     }
-    modified = true;
+    setModified(true);
     this->refresh();
 }
 
@@ -991,7 +1043,7 @@ void Terrain::setPatchTexTransform(QString val, int u){
     for (int i = 0; i < 6; i++)
         tfile->tdata[(u)*13 + i + 1 + 6] = t[i];
 
-    modified = true;
+    setModified(true);
 }
     
 void Terrain::removeAllGaps(){
@@ -1007,7 +1059,7 @@ void Terrain::removeAllGaps(){
                 for(int j = 0; j < 16; j++)
                     fData[u*16+i][y*16+j] &= ~(0x04);
             modifiedF = true;
-            modified = true;
+            setModified(true);
         }
     }
     refresh();
@@ -1264,6 +1316,53 @@ float Terrain::getHeight(int x, int z, float posx, float posz, bool addR){
             + fabs(roznica));
 }
 
+/*
+ * getHeight for points ids[0..count), all inside this terrain.
+ * Results go to heights[id] and normals[id*3] if normals is not NULL.
+ */
+void Terrain::getHeights(int count, const int *ids, const int *tileX, const int *tileZ, const float *posX, const float *posZ, float *heights, float *normals, bool addR){
+    int samples = *tfile->nsamples;
+    int sampleSize = *tfile->sampleSize;
+    float tileSize = sampleSize*samples;
+    
+    for(int k = 0; k < count; k++){
+        int id = ids[k];
+        float posx = posX[id] - (2048 * (mojex-tileX[id]) - 1024);
+        float posz = posZ[id] - (2048 * (mojez-tileZ[id]) + 1024);
+        posz = tileSize + posz;
+
+        float tx = (posx / sampleSize) - (float) floor(posx / sampleSize);
+        float tz = (posz / sampleSize) - (float) floor(posz / sampleSize);
+        if((int)(posz / sampleSize) >= samples )
+            posz = posz - 1;
+        if((int)(posx / sampleSize) >= samples )
+            posx = posx - 1;
+        
+        int ix = (int) (posx) / sampleSize;
+        int iz = (int) (posz) / sampleSize;
+        float h00 = terrainData[iz][ix];
+        float h10 = terrainData[iz][ix + 1];
+        float h01 = terrainData[iz + 1][ix];
+        float h11 = terrainData[iz + 1][ix + 1];
+        
+        float roznica = 0;
+        if (addR)
+            roznica = 0.25 * (h00 + h11 + h01 + h10) - 0.5f * (h00 + h11);
+        heights[id] = h00*(1.0 - tx)*(1.0 - tz) + h10*(tx)*(1.0 - tz) + h01*(1.0 - tx)*(tz) + h11*(tx)*(tz) + fabs(roznica);
+        
+        if(normals == NULL)
+            continue;
+        float *n = &normals[id*3];
+        n[0] = -((h10 - h00)*(1.0 - tz) + (h11 - h01)*tz)/sampleSize;
+        n[1] = 1;
+        n[2] = -((h01 - h00)*(1.0 - tx) + (h11 - h10)*tx)/sampleSize;
+        float l = sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+        n[0] /= l;
+        n[1] /= l;
+        n[2] /= l;
+    }
+}
+
 void Terrain::refreshWaterShapes(){
     for (WaterTile* wt : water){
         if(wt == NULL)
@@ -1382,20 +1481,23 @@ void Terrain::setTexture(Brush* brush, int u) {
         qDebug() << path;
         if (!QFile::exists(path)){
             int newTidx = TexLib::getTex(path);
-            if(newTidx >= 0){
-                qDebug() << "ref tex";
-                texid[u] = newTidx;
-            } else {
+            if(newTidx < 0){
                 qDebug() << "new tex";
-                texid[u] = TexLib::cloneTex(brush->texId);
+                newTidx = TexLib::cloneTex(brush->texId);
                 path = path.section(".", 0, -2) + ".ace";
-                TexLib::mtex[texid[u]]->pathid = path;
+                TexLib::mtex[newTidx]->pathid = path;
                 texModified[u] = true;
+            } else {
+                qDebug() << "ref tex";
             }
-            brush->texId = texid[u];
-            brush->tex = TexLib::mtex[texid[u]];
+            // The brush keeps a reference like in TerrainTools.
+            TexLib::addRef(newTidx);
+            brush->texId = newTidx;
+            brush->tex = TexLib::mtex[newTidx];
+        } else {
+            TexLib::addRef(brush->texId);
         }
-        texid[u] = brush->texId;
+        setTexId(u, brush->texId);
         uniqueTex[u] = false;
         QString tname = TexLib::mtex[brush->texId]->pathid.section("/", -1);
         qDebug() << TexLib::mtex[brush->texId]->pathid;
@@ -1443,7 +1545,7 @@ void Terrain::setTexture(Brush* brush, int u) {
         //TexLib::mtex[texid[y * 16 + u]]->GLTextures();
     }*/
 
-    this->modified = true;
+    setModified(true);
 }
 
 void Terrain::paintTexture(Brush* brush, int x, int z, float posx, float posz) {
@@ -1504,7 +1606,7 @@ void Terrain::paintTextureOnTile(Brush* brush, int y, int u, float x, float z) {
         *tfile->materials[(int) tfile->tdata[(y * patches + u)*13 + 0 + 6]].tex[0] = name;
         *tfile->amaterials[(int) tfile->tdata[(y * patches + u)*13 + 0 + 6]].tex[0] = name;
         qDebug() << *tfile->materials[(int) tfile->tdata[(y * patches + u)*13 + 0 + 6]].tex[0];
-        texid[y * patches + u] = TexLib::cloneTex(texid[y * patches + u]);
+        setTexId(y * patches + u, TexLib::cloneTex(texid[y * patches + u]));
         TexLib::mtex[texid[y * patches + u]]->pathid = texturepath + name;
         uniqueTex[y * patches + u] = true;
         reloadLines();
@@ -1517,7 +1619,7 @@ void Terrain::paintTextureOnTile(Brush* brush, int y, int u, float x, float z) {
     TexLib::mtex[texid[y * patches + u]]->paint(brush, z, x);
     TexLib::mtex[texid[y * patches + u]]->update();
     this->texModified[y * patches + u] = true;
-    this->modified = true;
+    setModified(true);
 }
 
 void Terrain::pushRenderItem(float lodx, float lodz, int tileX, int tileY, float* playerW, float* target, float fov, int selectionColor){
@@ -1609,11 +1711,13 @@ void Terrain::pushRenderItem(float lodx, float lodz, int tileX, int tileY, float
                             //texid = TexLib.addTex(texturepath,"nasyp-k.ace", gl);
                             //    gl.glDisable(GL2.GL_TEXTURE_2D);
                         }
-                        if (TexLib::mtex[texid[yy * patches + uu]]->loaded) {
-                            if (!TexLib::mtex[texid[yy * patches + uu]]->glLoaded)
-                                TexLib::mtex[texid[yy * patches + uu]]->GLTextures();
+                        if (TexLib::mtex[texid[yy * patches + uu]]->loaded && !TexLib::mtex[texid[yy * patches + uu]]->glLoaded)
+                            TexLib::mtex[texid[yy * patches + uu]]->GLTextures();
+                        if (TexLib::mtex[texid[yy * patches + uu]]->glLoaded) {
                             r->enableTextures(TexLib::mtex[texid[yy * patches + uu]]->tex[0]);
+                            TexLib::mtex[texid[yy * patches + uu]]->lastUsed = TexLoader::Frame;
                         } else {
+                            TexLib::touchTex(texid[yy * patches + uu]);
                         }
                     }
                     /*if (texid2[yy * patches + uu] == -2) {
@@ -1630,6 +1734,7 @@ void Terrain::pushRenderItem(float lodx, float lodz, int tileX, int tileY, float
                             if (!TexLib::mtex[texid2[yy * patches + uu]]->glLoaded)
                                 TexLib::mtex[texid2[yy * patches + uu]]->GLTextures(true);
                             r->enableTextures(TexLib::mtex[texid2[yy * patches + uu]]->tex[0]);
+                            TexLib::mtex[texid2[yy * patches + uu]]->lastUsed = TexLoader::Frame;
                             if(shaderSecondTexUV != *(float*)&tfile->materials[(int) tfile->tdata[(yy * patches + uu)*13 + 0 + 6]].itex[1][3]){
                                 shaderSecondTexUV = *(float*)&tfile->materials[(int) tfile->tdata[(yy * patches + uu)*13 + 0 + 6]].itex[1][3];
                                 gluu->currentShader->setUniformValue(gluu->currentShader->shaderSecondTexEnabled, shaderSecondTexUV);
@@ -1912,13 +2017,15 @@ void Terrain::render(float lodx, float lodz, int tileX, int tileY, float* player
                             //texid = TexLib.addTex(texturepath,"nasyp-k.ace", gl);
                             //    gl.glDisable(GL2.GL_TEXTURE_2D);
                         }
-                        if (TexLib::mtex[texid[yy * patches + uu]]->loaded) {
-                            if (!TexLib::mtex[texid[yy * patches + uu]]->glLoaded)
-                                TexLib::mtex[texid[yy * patches + uu]]->GLTextures();
+                        if (TexLib::mtex[texid[yy * patches + uu]]->loaded && !TexLib::mtex[texid[yy * patches + uu]]->glLoaded)
+                            TexLib::mtex[texid[yy * patches + uu]]->GLTextures();
+                        if (TexLib::mtex[texid[yy * patches + uu]]->glLoaded) {
                             f->glActiveTexture(GL_TEXTURE0);
                             //f->glBindTexture(GL_TEXTURE_2D, TexLib::mtex[texid[yy * 16 + uu]]->tex[0]);
                             gluu->bindTexture(f, TexLib::mtex[texid[yy * patches + uu]]->tex[0]);
+                            TexLib::mtex[texid[yy * patches + uu]]->lastUsed = TexLoader::Frame;
                         } else {
+                            TexLib::touchTex(texid[yy * patches + uu]);
                         }
                     }
                     if (texid2[yy * patches + uu] == -2) {
@@ -1931,11 +2038,12 @@ void Terrain::render(float lodx, float lodz, int tileX, int tileY, float* player
                             else
                                 texid2[yy * patches + uu] = TexLib::addTex(texturepath, *tfile->materials[(int) tfile->tdata[(yy * patches + uu)*13 + 0 + 6]].tex[1]);
                         }
-                        if (TexLib::mtex[texid2[yy * patches + uu]]->loaded) {
-                            if (!TexLib::mtex[texid2[yy * patches + uu]]->glLoaded)
-                                TexLib::mtex[texid2[yy * patches + uu]]->GLTextures(true);
+                        if (TexLib::mtex[texid2[yy * patches + uu]]->loaded && !TexLib::mtex[texid2[yy * patches + uu]]->glLoaded)
+                            TexLib::mtex[texid2[yy * patches + uu]]->GLTextures(true);
+                        if (TexLib::mtex[texid2[yy * patches + uu]]->glLoaded) {
                             f->glActiveTexture(GL_TEXTURE1);
                             f->glBindTexture(GL_TEXTURE_2D, TexLib::mtex[texid2[yy * patches + uu]]->tex[0]);
+                            TexLib::mtex[texid2[yy * patches + uu]]->lastUsed = TexLoader::Frame;
                             if(shaderSecondTexUV != *(float*)&tfile->materials[(int) tfile->tdata[(yy * patches + uu)*13 + 0 + 6]].itex[1][3]){
                                 shaderSecondTexUV = *(float*)&tfile->materials[(int) tfile->tdata[(yy * patches + uu)*13 + 0 + 6]].itex[1][3];
                                 gluu->currentShader->setUniformValue(gluu->currentShader->shaderSecondTexEnabled, shaderSecondTexUV);
@@ -2870,6 +2978,28 @@ void Terrain::fillHeightMap(float* data){
 }
 
 void Terrain::save() {
+    saveData();
+    saveTextures();
+}
+
+/*
+ * Heights, flags and .t files of the tiles are built in parallel by
+ * SaveQueue::Serialize(), textures are saved after it on this thread.
+ */
+void Terrain::SaveAll(const QVector<Terrain*> &tiles) {
+    QVector<std::function<void()>> jobs;
+    for(int i = 0; i < tiles.size(); i++){
+        Terrain* tTile = tiles[i];
+        jobs.push_back([tTile](){ tTile->saveData(); });
+    }
+    SaveQueue::Serialize(jobs);
+    for(int i = 0; i < tiles.size(); i++){
+        tiles[i]->saveTextures();
+        tiles[i]->setModified(false);
+    }
+}
+
+void Terrain::saveData() {
     QString path = Game::root + "/routes/" + Game::route + "/" + TileDir[(int)lowTile] + "/";
     QString filename = name;
     if(this->tfile->sampleYbuffer == NULL)
@@ -2883,6 +3013,9 @@ void Terrain::save() {
     qDebug() << "writing t start";
     this->tfile->save(path + filename + ".t");
     qDebug() << "writing t end";
+}
+
+void Terrain::saveTextures() {
     int patches = tfile->patchsetNpatches;
     for (int u = 0; u < patches; u++)
         for (int y = 0; y < patches; y++) {
@@ -2894,17 +3027,12 @@ void Terrain::save() {
 }
 
 void Terrain::saveRAW(QString name) {
-    name.replace("//", "/");
-    QFile *file = new QFile(name);
     qDebug() << "zapis " << name;
-    if (!file->open(QIODevice::WriteOnly))
-        return;
-    qDebug() << "w";
-    QDataStream write(file);
+    QByteArray data;
+    QDataStream write(&data, QIODevice::WriteOnly);
     write.setByteOrder(QDataStream::LittleEndian);
     saveRAW(write);
-    file->close();
-    return;
+    SaveQueue::Write(name, data);
 }
 
 void Terrain::saveRAW(QDataStream &write){
@@ -2956,7 +3084,7 @@ void Terrain::newF(){
     }
     jestF = true;
     modifiedF = true;
-    modified = true;
+    setModified(true);
 }
 
 bool Terrain::readF(QString fSfile) {
@@ -2989,18 +3117,13 @@ void Terrain::readF(FileBuffer *data){
 } 
 
 void Terrain::saveF(QString name) {
-    name.replace("//", "/");
-    QFile *file = new QFile(name);
     qDebug() << "zapis " << name;
-    if (!file->open(QIODevice::WriteOnly))
-        return;
-    qDebug() << "w";
-    QDataStream write(file);
+    QByteArray data;
+    QDataStream write(&data, QIODevice::WriteOnly);
     write.setByteOrder(QDataStream::LittleEndian);
     saveF(write);
     modifiedF = false;
-    file->close();
-    return;
+    SaveQueue::Write(name, data);
 }
 
 void Terrain::saveF(QDataStream &write) {
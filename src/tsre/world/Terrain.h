@@ -11,6 +11,8 @@
 #ifndef TERRAIN_H
 #define	TERRAIN_H
 #include <QString>
+#include <QSet>
+#include <QMutex>
 #include <tsre/ogl/GLUU.h>
 #include <tsre/world/TFile.h>
 #include <tsre/math3d/Vector3f.h>
@@ -19,6 +21,7 @@
 
 class Brush;
 class TerrainInfo;
+class QThread;
 class FileBuffer;
 class QDataStream;
 
@@ -63,9 +66,12 @@ public:
     void fillTerrainDataY(Terrain* adjacent);
     void fillTerrainDataXY(Terrain* adjacent);
     void save();
+    static void SaveAll(const QVector<Terrain*> &tiles);
     void refresh();
+    void setThread(QThread* thread);
     bool isModified();
     void setModified(bool value = true);
+    static QSet<Terrain*> GetDirty();
     void getLowCornerTileXY(int &X, int &Y);
     int getSampleCount();
     float setHeight(int x, int z, float posx, float posz, float val, bool add = false);
@@ -144,6 +150,7 @@ public:
     void refreshWaterShapes();
     void getRotation(float *rot, int x, int z, int posx, int posz);
     float getHeight(int x, int z, float posx, float posz, bool addR);
+    void getHeights(int count, const int *ids, const int *tileX, const int *tileZ, const float *posX, const float *posZ, float *heights, float *normals, bool addR);
     
 public slots:
     void menuToggleWater();
@@ -153,6 +160,9 @@ public slots:
     
 protected:
     static QString TileDir[2];
+    // Terrain tiles changed since the last save.
+    static QSet<Terrain*> Dirty;
+    static QMutex DirtyMutex;
     
     unsigned char **fData;
     bool jestF = false;
@@ -195,6 +205,8 @@ protected:
     TFile* tfile;
     //int selectedPathId = -1;
     
+    void saveData();
+    void saveTextures();
     void saveRAW(QString name);
     void saveRAW(QDataStream &write);
     void saveRAWFloat(QDataStream &write);
@@ -222,6 +234,7 @@ protected:
     void convertTexToDefaultCoords(int idx);
     void paintTextureOnTile(Brush* brush, int y, int u, float x, float z);
     void reloadLines();
+    void setTexId(int idx, int id);
     
     virtual void load();
 };
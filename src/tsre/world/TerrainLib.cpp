@@ -13,6 +13,7 @@
 #include <tsre/math3d/GLMatrix.h>
 #include <QOpenGLShaderProgram>
 #include <set>
+#include <algorithm>
 #include <math.h>
 #include <tsre/Game.h>
 #include <tsre/texture/Brush.h>
@@ -103,6 +104,10 @@ bool TerrainLib::load(int x, int z) {
     return false;
 }
 
+bool TerrainLib::addStreamedTerrain(Terrain* t) {
+    return false;
+}
+
 void TerrainLib::getUnsavedInfo(QVector<QString> &items){
 
 }
@@ -139,6 +144,59 @@ float TerrainLib::getHeight(int x, int z, float posx, float posz, bool addR) {
     return 0;
 }
 
+/*
+ * getHeight for many points at once. Points are sorted by tile, so every
+ * terrain is looked up once and sampled in one pass. Points without
+ * a loaded terrain get -1 and an up normal. normals is 3 floats per point.
+ */
+void TerrainLib::getHeights(int count, const int* tileX, const int* tileZ, const float* posX, const float* posZ, float* heights, float* normals, bool addR){
+    std::vector<int> tx(tileX, tileX + count);
+    std::vector<int> tz(tileZ, tileZ + count);
+    std::vector<float> px(posX, posX + count);
+    std::vector<float> pz(posZ, posZ + count);
+    std::vector<int> order(count);
+    for(int i = 0; i < count; i++){
+        Game::check_coords(tx[i], tz[i], px[i], pz[i]);
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&tx, &tz](int a, int b){
+        if(tx[a] != tx[b])
+            return tx[a] < tx[b];
+        return tz[a] < tz[b];
+    });
+    
+    int first = 0;
+    while(first < count){
+        int x = tx[order[first]];
+        int z = tz[order[first]];
+        int last = first + 1;
+        while(last < count && tx[order[last]] == x && tz[order[last]] == z)
+            last++;
+        
+        Terrain *terr = getTerrainByXY(x, z, false);
+        if(terr != NULL && terr->loaded){
+            terr->getHeights(last - first, &order[first], tx.data(), tz.data(), px.data(), pz.data(), heights, normals, addR);
+        } else {
+            for(int i = first; i < last; i++){
+                heights[order[i]] = -1;
+                if(normals == NULL)
+                    continue;
+                normals[order[i]*3] = 0;
+                normals[order[i]*3+1] = 1;
+                normals[order[i]*3+2] = 0;
+            }
+        }
+        first = last;
+    }
+}
+
+void TerrainLib::getHeights(int x, int z, const std::vector<float> &posX, const std::vector<float> &posZ, std::vector<float> &heights, bool addR){
+    std::vector<int> tileX(posX.size(), x);
+    std::vector<int> tileZ(posX.size(), z);
+    heights.resize(posX.size());
+    getHeights(posX.size(), tileX.data(), tileZ.data(), posX.data(), posZ.data(), heights.data(), NULL, addR);
+}
+
 void TerrainLib::fillHeightMap(int x, int z, float* data){
 
 }
@@ -155,6 +213,12 @@ void TerrainLib::setHeightFromGeo(int x, int z, float* p){
 
 }
 
+void TerrainLib::setHeightFromGeo(const QVector<QPair<int, int>> &tiles, bool gui){
+    float pos[3] = {0, 0, 0};
+    for(int i = 0; i < tiles.size(); i++)
+        setHeightFromGeo(tiles[i].first, tiles[i].second, (float*)&pos);
+}
+
 void TerrainLib::setDetailedTerrainAsCurrent(){
     
 }
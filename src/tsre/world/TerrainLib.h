@@ -12,7 +12,10 @@
 #define	TERRAINLIB_H
 
 #include <unordered_map>
+#include <vector>
 #include <QString>
+#include <QVector>
+#include <QPair>
 #include <tsre/ogl/GLUU.h>
 
 class Terrain;
@@ -40,6 +43,8 @@ public:
     virtual void fillRaw(Terrain *cTerr, int mojex, int mojez);
     virtual float getHeight(int x, int z, float posx, float posz);
     virtual float getHeight(int x, int z, float posx, float posz, bool addR);
+    virtual void getHeights(int count, const int* tileX, const int* tileZ, const float* posX, const float* posZ, float* heights, float* normals = NULL, bool addR = false);
+    void getHeights(int x, int z, const std::vector<float> &posX, const std::vector<float> &posZ, std::vector<float> &heights, bool addR = false);
     virtual void getRotation(float *rot, int x, int z, float posx, float posz);
     virtual void setHeight(int x, int z, float posx, float posz, float h);
     virtual void fillHeightMap(int x, int z, float *data);
@@ -49,6 +54,7 @@ public:
     virtual Terrain* setHeight256(int x, int z, int posx, int posz, float h, float diffC, float diffE);
     virtual void setHeightFromGeoGui(int x, int z, float* p);
     virtual void setHeightFromGeo(int x, int z, float* p);
+    virtual void setHeightFromGeo(const QVector<QPair<int, int>> &tiles, bool gui = true);
     virtual void setDetailedTerrainAsCurrent();
     virtual void setLowTerrainAsCurrent();
     virtual bool isLoaded(int x, int z);
@@ -68,6 +74,7 @@ public:
     virtual void setTerrainToTrackObj(Brush* brush, float* punkty, int length, int x, int z, float* matrix, float offsetY = 0);
     virtual int getTexture(int x, int z, float* p);
     virtual bool load(int x, int z);
+    virtual bool addStreamedTerrain(Terrain* t);
     virtual void getUnsavedInfo(QVector<QString> &items);
     virtual void save();
     virtual void refresh(int x, int z);
@@ -17,6 +17,7 @@
 #include <tsre/Game.h>
 #include <tsre/texture/Brush.h>
 #include <tsre/geo/HeightWindow.h>
+#include <tsre/geo/GeoHeightSampler.h>
 #include <tsre/world/QuadTree.h>
 #include <tsre/Undo.h>
 #include <tsre/world/Route.h>
@@ -24,6 +25,10 @@
 #include <tsre/world/TerrainInfo.h>
 #include <tsre/renderer/Renderer.h>
 #include <tsre/texture/TexLib.h>
+#include <QProgressDialog>
+#include <QCoreApplication>
+#include <QSet>
+#include <tsre/fileFunctions/SaveQueue.h>
 
 TerrainLibQt::TerrainLibQt() {
 }
@@ -152,22 +157,7 @@ bool TerrainLibQt::load(int x, int z) {
 
 void TerrainLibQt::getUnsavedInfo(QVector<QString> &items) {
     if (!Game::writeEnabled) return;
-    QHashIterator<unsigned int, TerrainInfo*> i(terrainQt);
-    while (i.hasNext()) {
-        i.next();
-        if (i.value() == NULL) continue;
-        Terrain* tTile = (Terrain*) i.value()->t;
-        if (tTile == NULL) continue;
-        if (tTile->loaded && tTile->isModified()) {
-            items.push_back("[T] "+QString::number(tTile->mojex)+" "+QString::number(-tTile->mojez));
-        }
-    }
-    QHashIterator<unsigned int, TerrainInfo*> i2(terrainQtLo);
-    while (i2.hasNext()) {
-        i2.next();
-        if (i2.value() == NULL) continue;
-        Terrain* tTile = (Terrain*) i2.value()->t;
-        if (tTile == NULL) continue;
+    foreach (Terrain* tTile, Terrain::GetDirty()) {
         if (tTile->loaded && tTile->isModified()) {
             items.push_back("[T] "+QString::number(tTile->mojex)+" "+QString::number(-tTile->mojez));
         }
@@ -177,32 +167,17 @@ void TerrainLibQt::getUnsavedInfo(QVector<QString> &items) {
 void TerrainLibQt::save() {
     if (!Game::writeEnabled) return;
     qDebug() << "save terrain";
-    QHashIterator<unsigned int, TerrainInfo*> i(terrainQt);
-    while (i.hasNext()) {
-        i.next();
-        if (i.value() == NULL) continue;
-        Terrain* tTile = (Terrain*) i.value()->t;
-        if (tTile == NULL) continue;
-        if (tTile->loaded && tTile->isModified()) {
-            tTile->save();
-            tTile->setModified(false);
-        }
-    }
-    qDebug() << "save lo terrain";
-    QHashIterator<unsigned int, TerrainInfo*> i2(terrainQtLo);
-    while (i2.hasNext()) {
-        i2.next();
-        if (i2.value() == NULL) continue;
-        Terrain* tTile = (Terrain*) i2.value()->t;
-        if (tTile == NULL) continue;
-        if (tTile->loaded && tTile->isModified()) {
-            tTile->save();
-            tTile->setModified(false);
-        }
+    // Only changed tiles, both hi and lo; files are written by SaveQueue.
+    QVector<Terrain*> changed;
+    foreach (Terrain* tTile, Terrain::GetDirty()) {
+        if (tTile->loaded && tTile->isModified())
+            changed.push_back(tTile);
     }
+    Terrain::SaveAll(changed);
 }
 
 bool TerrainLibQt::reload(int x, int z) {
+    SaveQueue::WaitForDone();
     unsigned int terrainNameId = currentQuadTree->getMyNameId((int) x, -z);
     if (terrainNameId == 0)
         return false;
@@ -343,55 +318,89 @@ void TerrainLibQt::setHeightFromGeoGui(int x, int z, float* p) {
 }
 
 void TerrainLibQt::setHeightFromGeo(int x, int z, float* p) {
-    if(heightWindow == NULL)
-        heightWindow = new HeightWindow();
-    
     float posx = p[0];
     float posz = p[2];
     Game::check_coords(x, z, posx, posz);
     qDebug() << x << " " << z << " " << posx << " " << posz;
     
-    Terrain *terr = getTerrainByXY(x, z);
-    if (terr == NULL) return;
-    if (terr->loaded == false) return;
-    int X, Y;
-    terr->getLowCornerTileXY(X, Y);
-    heightWindow->tileX = X;
-    heightWindow->tileZ = -Y;
-    heightWindow->ok = false;
-    int samples = terr->getSampleCount();
-    heightWindow->terrainResolution = samples;
-    heightWindow->terrainSize = terr->getSampleCount()*terr->getSampleSize();
-    heightWindow->load(false);
-    if(heightWindow->ok){
-        qDebug() << "ok";
+    QVector<QPair<int, int>> tiles;
+    tiles.push_back(QPair<int, int>(x, z));
+    setHeightFromGeo(tiles, false);
+}
+
+void TerrainLibQt::setHeightFromGeo(const QVector<QPair<int, int>> &tileList, bool gui) {
+    QVector<Terrain*> terrains;
+    QVector<GeoHeightSampler::Tile> tiles;
+    for(int i = 0; i < tileList.size(); i++){
+        Terrain *terr = getTerrainByXY(tileList[i].first, tileList[i].second);
+        if (terr == NULL) continue;
+        if (terr->loaded == false) continue;
+        int X, Y;
+        terr->getLowCornerTileXY(X, Y);
+        GeoHeightSampler::Tile tile;
+        tile.tileX = X;
+        tile.tileZ = -Y;
+        tile.resolution = terr->getSampleCount();
+        tile.size = terr->getSampleCount()*terr->getSampleSize();
+        terrains.push_back(terr);
+        tiles.push_back(tile);
+    }
+    if(tiles.size() == 0)
+        return;
+    
+    QProgressDialog *progress = NULL;
+    if(gui && tiles.size() > 1){
+        progress = new QProgressDialog("Loading terrain heights...", "Cancel", 0, 1);
+        progress->setWindowModality(Qt::WindowModal);
+    }
+    GeoHeightSampler sampler;
+    sampler.run(tiles, [progress](int done, int total){
+        if(progress == NULL)
+            return true;
+        progress->setMaximum(total);
+        progress->setValue(done);
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 50);
+        return !progress->wasCanceled();
+    });
+    delete progress;
+    
+    QSet<Terrain*> changed;
+    for(int t = 0; t < tiles.size(); t++){
+        if(!tiles[t].ok){
+            if(tiles[t].missingFile.length() > 0)
+                qDebug() << "DEM missing" << tiles[t].missingFile;
+            continue;
+        }
+        Terrain *terr = terrains[t];
+        int samples = tiles[t].resolution;
         for (int i = 0; i < samples; i++) {
             for (int j = 0; j < samples; j++) {
-                terr->terrainData[i][j] = heightWindow->terrainData[j][i];
+                terr->terrainData[i][j] = tiles[t].heights[j*samples + i];
             }
         }
         terr->setModified(true);
-        //terr->refresh();
+        changed.insert(terr);
+    }
+    
+    QSet<Terrain*> neighbours;
+    foreach(Terrain* terr, changed){
         int X, Y;
-        terr->getCornerCoordsXY(X, Y, 0, 1);
-        Terrain* tterr;
-        tterr = getTerrainByXY(X, Y);
-        if (tterr != NULL) 
-            tterr->refresh();
-        terr->getCornerCoordsXY(X, Y, 0, -1);
-        tterr = getTerrainByXY(X, Y);
-        if (tterr != NULL) 
-            tterr->refresh();
-        terr->getCornerCoordsXY(X, Y, 1, 0);
-        tterr = getTerrainByXY(X, Y);
-        if (tterr != NULL) 
-            tterr->refresh();
-        terr->getCornerCoordsXY(X, Y, -1, 0);
-        tterr = getTerrainByXY(X, Y);
-        if (tterr != NULL) 
-            tterr->refresh();
-        updateTerrainHeightmap(terr);
+        for(int i = -1; i <= 1; i++)
+            for(int j = -1; j <= 1; j++){
+                if(i != 0 && j != 0)
+                    continue;
+                if(i == 0 && j == 0)
+                    continue;
+                terr->getCornerCoordsXY(X, Y, i, j);
+                Terrain* tterr = getTerrainByXY(X, Y);
+                if (tterr != NULL) 
+                    neighbours.insert(tterr);
+            }
     }
+    foreach(Terrain* terr, neighbours)
+        terr->refresh();
+    foreach(Terrain* terr, changed)
+        updateTerrainHeightmap(terr);
 }
 
 void TerrainLibQt::setTextureToTrackObj(Brush* brush, float* punkty, int length, int tx, int tz) {
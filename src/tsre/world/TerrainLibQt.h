@@ -44,6 +44,7 @@ public:
     Terrain* setHeight256(int x, int z, int posx, int posz, float h, float diffC, float diffE);
     void setHeightFromGeoGui(int x, int z, float* p);
     void setHeightFromGeo(int x, int z, float* p);
+    void setHeightFromGeo(const QVector<QPair<int, int>> &tiles, bool gui = true);
     bool isLoaded(int x, int z);
     QSet<Terrain*> paintHeightMap(Brush* brush, int x, int z, float* p);
     void paintTexture(Brush* brush, int x, int z, float* p);
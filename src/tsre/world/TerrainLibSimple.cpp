@@ -10,9 +10,11 @@
 
 #include <tsre/world/TerrainLibSimple.h>
 #include <tsre/world/Terrain.h>
+#include <tsre/world/TileStreamer.h>
 #include <tsre/math3d/GLMatrix.h>
 #include <QOpenGLShaderProgram>
 #include <set>
+#include <algorithm>
 #include <math.h>
 #include <tsre/Game.h>
 #include <tsre/texture/Brush.h>
@@ -22,6 +24,7 @@
 #include <tsre/world/Route.h>
 #include <tsre/world/Environment.h>
 #include <tsre/world/TerrainInfo.h>
+#include <tsre/fileFunctions/SaveQueue.h>
 
 TerrainLibSimple::TerrainLibSimple() {
 }
@@ -68,6 +71,18 @@ bool TerrainLibSimple::isLoaded(int x, int z) {
     return false;
 }
 
+/*
+ * Takes a tile loaded by TileStreamer, false if the tile
+ * was loaded here in the meantime.
+ */
+bool TerrainLibSimple::addStreamedTerrain(Terrain* t) {
+    Terrain* &tTile = terrain[(int)t->mojex*10000 + (int)t->mojez];
+    if (tTile != NULL)
+        return false;
+    tTile = t;
+    return true;
+}
+
 bool TerrainLibSimple::load(int x, int z) {
     Terrain* tTile = terrain[x*10000 + z];
     if (tTile == NULL) {
@@ -84,10 +99,7 @@ bool TerrainLibSimple::load(int x, int z) {
 
 void TerrainLibSimple::getUnsavedInfo(QVector<QString> &items){
     if (!Game::writeEnabled) return;
-    for (auto it = terrain.begin(); it != terrain.end(); ++it) {
-        //console.log(obj.type);
-        Terrain* tTile = (Terrain*) it->second;
-        if (tTile == NULL) continue;
+    foreach (Terrain* tTile, Terrain::GetDirty()) {
         if (tTile->loaded && tTile->isModified()) {
             items.push_back("[T] "+QString::number(tTile->mojex)+" "+QString::number(-tTile->mojez));
         }
@@ -97,18 +109,16 @@ void TerrainLibSimple::getUnsavedInfo(QVector<QString> &items){
 void TerrainLibSimple::save(){
     if (!Game::writeEnabled) return;
     qDebug() << "save terrain";
-    for (auto it = terrain.begin(); it != terrain.end(); ++it) {
-        //console.log(obj.type);
-        Terrain* tTile = (Terrain*) it->second;
-        if (tTile == NULL) continue;
-        if (tTile->loaded && tTile->isModified()) {
-            tTile->save();
-            tTile->setModified(false);
-        }
+    QVector<Terrain*> changed;
+    foreach (Terrain* tTile, Terrain::GetDirty()) {
+        if (tTile->loaded && tTile->isModified())
+            changed.push_back(tTile);
     }
+    Terrain::SaveAll(changed);
 }
 
 bool TerrainLibSimple::reload(int x, int z) {
+    SaveQueue::WaitForDone();
     Terrain* tTile;// = terrain[x*10000 + z];
     //if (tTile == NULL) {
     terrain[x*10000 + z] = new Terrain(x, z);
@@ -929,6 +939,8 @@ void TerrainLibSimple::render(GLUU *gluu, float * playerT, float* playerW, float
             tTile = terrain[(((int)playerT[0] + i)*10000 + (int)playerT[1] + j)];
             
             if (tTile == NULL) {
+                if (TileStreamer::requestTerrain((int)playerT[0] + i, (int)playerT[1] + j))
+                    continue;
                 terrain[((int)playerT[0] + i)*10000 + (int)playerT[1] + j] = new Terrain((int)playerT[0] + i, (int)playerT[1] + j);
             }
 
@@ -957,13 +969,16 @@ void TerrainLibSimple::render(GLUU *gluu, float * playerT, float* playerW, float
     if(renderMode == gluu->RENDER_SELECTION)
         return;
     
-    mintile = -3;
-    maxtile = 3;
+    // Tiles just outside the drawn area are kept, and streamed in before they are drawn.
+    maxtile = std::max(3, Game::tileLod + 1);
+    mintile = -maxtile;
     for (int i = mintile; i <= maxtile; i++) {
         for (int j = maxtile; j >= mintile; j--) {
             tTile = terrain[(((int)playerT[0] + i)*10000 + (int)playerT[1] + j)];
             if (tTile != NULL)
                 tTile->inUse = true;
+            else
+                TileStreamer::requestTerrain((int)playerT[0] + i, (int)playerT[1] + j);
         }
     }
     
@@ -1034,6 +1049,8 @@ void TerrainLibSimple::renderShadowMap(GLUU *gluu, float * playerT, float* playe
             tTile = terrain[(((int)playerT[0] + i)*10000 + (int)playerT[1] + j)];
             
             if (tTile == NULL) {
+                if (TileStreamer::requestTerrain((int)playerT[0] + i, (int)playerT[1] + j))
+                    continue;
                 terrain[((int)playerT[0] + i)*10000 + (int)playerT[1] + j] = new Terrain((int)playerT[0] + i, (int)playerT[1] + j);
             }
 
@@ -1063,6 +1080,8 @@ void TerrainLibSimple::renderEmpty(GLUU *gluu, float * playerT, float* playerW,
         for (int j = maxtile; j >= mintile; j--) {
             tTile = terrain[(((int)playerT[0] + i)*10000 + (int)playerT[1] + j)];
             if (tTile == NULL) {
+                if (TileStreamer::requestTerrain((int)playerT[0] + i, (int)playerT[1] + j))
+                    continue;
                 terrain[((int)playerT[0] + i)*10000 + (int)playerT[1] + j] = new Terrain((int)playerT[0] + i, (int)playerT[1] + j);
             }
      }
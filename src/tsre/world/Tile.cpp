@@ -31,15 +31,25 @@
 #include <QFile>
 #include <tsre/ogl/GLUU.h>
 #include <tsre/math3d/GLMatrix.h>
+#include <tsre/math3d/Frustum.h>
 #include <tsre/fileFunctions/TS.h>
 #include <tsre/geo/GeoCoordinates.h>
 #include <tsre/world/objects/GroupObj.h>
+#include <tsre/shape/SFile.h>
 #include <tsre/ErrorMessagesLib.h>
 #include <tsre/ErrorMessage.h>
 #include <tsre/renderer/Renderer.h>
 #include <tsre/world/Trk.h>
+#include <tsre/world/TileCache.h>
+#include <tsre/fileFunctions/TokenWriter.h>
+#include <tsre/fileFunctions/SaveQueue.h>
+#include <QFileInfo>
 #include <tsre/world/Route.h>
 
+QSet<int> Tile::DirtyTiles;
+QSet<int> Tile::PickDirtyTiles;
+QMutex Tile::DirtyMutex;
+
 Tile::Tile() {
     modified = false;
     loaded = -2;
@@ -141,6 +151,7 @@ void Tile::checkForErrors(){
                     e->action += "\nAutoFix: Object removed by TSRE.";
                     obj->loaded = false;
                     obj->modified = true;
+                    MarkDirty(x, z);
                 }
             }
         
@@ -149,7 +160,7 @@ void Tile::checkForErrors(){
             foreach (QString val, Game::objectsToRemove){
                 if(obj->type == val){
                     obj->loaded = false;
-                    modified = true;
+                    setModified(true);
                 }
             }
         }
@@ -190,7 +201,7 @@ void Tile::updateTrackSectionInfo(QHash<unsigned int, unsigned int> shapes, QHas
         count += obj->updateTrackSectionInfo(shapes, sect);
     }
     if(count > 0)
-        modified = true;
+        setModified(true);
 }
 
 void Tile::replaceWorldObj(WorldObj *nowy){
@@ -221,18 +232,38 @@ void Tile::replaceWorldObj(WorldObj *nowy){
 }
 
 void Tile::load() {
+    loadData();
+    if(loaded == 0)
+        finishLoad();
+}
 
-    QString sh;
+/*
+ * Reads and parses the .w and .ws files, without loading the objects.
+ * Touches only this tile, so TileStreamer runs it on worker threads.
+ * loaded is 0 after it when the tile exists.
+ */
+void Tile::loadData() {
+    ParserX::Token sh;
     QString path;
     path = Game::root + "/routes/" + Game::route + "/world/w" + getNameXY(x) + "" + getNameXY(-z) + ".w";
     path.replace("//", "/");
     
+    QFileInfo info(path);
+    FileBuffer* data = NULL;
+    if(Game::useTileCache)
+        data = TileCache::read(info);
+    
+    bool cached = data != NULL;
+    
     QFile *file = new QFile(path);
-    if (!file->open(QIODevice::ReadOnly)){
-        qDebug() << "W file: not exist " << path;
-        return;
+    if(!cached){
+        if (!file->open(QIODevice::ReadOnly)){
+            qDebug() << "W file: not exist " << path;
+            delete file;
+            return;
+        }
+        data = ReadFile::read(file);
     }
-    FileBuffer* data = ReadFile::read(file);
 
     data->setTokenOffset(261844);
     data->off = 32;
@@ -240,7 +271,7 @@ void Tile::load() {
         qDebug() << "w file uncompressed " << path;
         data->off = 0;
         ParserX::NextLine(data);
-        while (!((sh = ParserX::NextTokenInside(data).toLower()) == "")) {
+        while (!((sh = ParserX::NextTokenView(data)).isEmpty())) {
             if(sh == "tr_worldfile"){
                 loadUtf16Data(data);
                 ParserX::SkipToken(data);
@@ -249,8 +280,13 @@ void Tile::load() {
             qDebug() << "#Tile - undefined token" << sh;
             ParserX::SkipToken(data);
         }
+        if(Game::useTileCache)
+            saveCache(info);
     } else {
-        qDebug() << "w file compressed   " << path;
+        if(cached)
+            qDebug() << "w file cached       " << path;
+        else
+            qDebug() << "w file compressed   " << path;
         data->off+=5;
         int offset, offsetO;
         int idx, idxO;
@@ -300,17 +336,65 @@ void Tile::load() {
     }
     qDebug() << obiekty.size();
     loaded = 0;
-    wczytajObiekty();
-    checkForErrors();
-    loadWS();
+    dataSize = data->length;
     file->close();
+    delete file;
     delete data;
+    loadWS();
+}
+
+/*
+ * Loads the parsed objects, main thread only.
+ */
+void Tile::finishLoad(bool checkErrors) {
+    wczytajObiekty();
+    if(checkErrors)
+        this->checkForErrors();
+    for(unsigned int i = 0; i < soundObjects.size(); i++){
+        WorldObj* nowy = soundObjects[i];
+        nowy->load(x, z);
+        if(nowy->UiD < 1000000)
+            if(nowy->UiD > maxUiDWS) maxUiDWS = nowy->UiD;
+        obiekty[jestObiektow++] = nowy;
+    }
+    soundObjects.clear();
+    qDebug() <<"WS size: "<< obiekty.size();
+}
+
+/*
+ * Deletes the objects, before the tile itself is deleted by TileStreamer.
+ */
+void Tile::release() {
+    for (auto it = obiekty.begin(); it != obiekty.end(); ++it)
+        delete it->second;
+    obiekty.clear();
+    for(unsigned int i = 0; i < soundObjects.size(); i++)
+        delete soundObjects[i];
+    soundObjects.clear();
+    jestObiektow = 0;
+    loaded = -2;
+}
+
+/*
+ * False if something may still point to objects of this tile.
+ */
+bool Tile::canRelease() {
+    if(loaded != 1)
+        return loaded == -2;
+    if(isModified())
+        return false;
+    for (auto it = obiekty.begin(); it != obiekty.end(); ++it) {
+        if(it->second == NULL) continue;
+        if(it->second->isSelected())
+            return false;
+    }
+    return true;
 }
 
 void Tile::loadUtf16Data(FileBuffer *data){
-    QString sh = "";
+    ParserX::Token sh;
     WorldObj* nowy;
-                while (!((sh = ParserX::NextTokenInside(data).toLower()) == "")) {
+                while (!((sh = ParserX::NextTokenView(data)).isEmpty())) {
                     //qDebug() << sh;
                     if (sh == "tr_watermark") {
                         nowy = (WorldObj*)(new TrWatermarkObj((int)ParserX::GetNumber(data)));
@@ -326,7 +410,7 @@ void Tile::loadUtf16Data(FileBuffer *data){
                     }
                     if (sh == "viewdbsphere") {
                         viewDbSphere.push_back(ViewDbSphere());
-                        while (!((sh = ParserX::NextTokenInside(data).toLower()) == "")) {
+                        while (!((sh = ParserX::NextTokenView(data)).isEmpty())) {
                             viewDbSphere.back().set(sh, data);
                             ParserX::SkipToken(data);
                         }
@@ -335,7 +419,7 @@ void Tile::loadUtf16Data(FileBuffer *data){
                     }
                     if ((nowy = WorldObj::createObj(sh)) != NULL) {
                         //qDebug() << nowy->type;
-                        while (!((sh = ParserX::NextTokenInside(data).toLower()) == "")) {
+                        while (!((sh = ParserX::NextTokenView(data)).isEmpty())) {
                             nowy->set(sh, data);
                             ParserX::SkipToken(data);
                         }
@@ -349,6 +433,9 @@ void Tile::loadUtf16Data(FileBuffer *data){
     return;
 }
 
+/*
+ * Parses the .ws file into soundObjects, finishLoad() loads them.
+ */
 void Tile::loadWS() {
 
     QString sh;
@@ -374,21 +461,18 @@ void Tile::loadWS() {
         qDebug() << "ws file uncompressed " << path;
         ParserX::NextLine(data);
     
-        QString sh = "";
-        while (!((sh = ParserX::NextTokenInside(data).toLower()) == "")) {
+        ParserX::Token sh;
+        while (!((sh = ParserX::NextTokenView(data)).isEmpty())) {
             if(sh == "tr_worldsoundfile"){
                 WorldObj* nowy;
-                while (!((sh = ParserX::NextTokenInside(data).toLower()) == "")) {
+                while (!((sh = ParserX::NextTokenView(data)).isEmpty())) {
                     if ((nowy = WorldObj::createObj(sh)) != NULL) {
                         //qDebug() << nowy->type;
-                        while (!((sh = ParserX::NextTokenInside(data).toLower()) == "")) {
+                        while (!((sh = ParserX::NextTokenView(data)).isEmpty())) {
                             nowy->set(sh, data);
                             ParserX::SkipToken(data);
                         }
-                        nowy->load(x, z);
-                        if(nowy->UiD < 1000000)
-                            if(nowy->UiD > maxUiDWS) maxUiDWS = nowy->UiD;
-                        obiekty[jestObiektow++] = nowy;
+                        soundObjects.push_back(nowy);
                         ParserX::SkipToken(data);
                         continue;
                     }
@@ -423,14 +507,12 @@ void Tile::loadWS() {
                 nowy->set(idxO, data);
                 data->off = offsetO;
             }
-            nowy->load(x, z);
-            if(nowy->UiD < 1000000)
-                if(nowy->UiD > maxUiDWS) maxUiDWS = nowy->UiD;
-            obiekty[jestObiektow++] = nowy;
+            soundObjects.push_back(nowy);
             data->off = offset;
        }
     }
-    qDebug() <<"WS size: "<< obiekty.size();
+    dataSize += data->length;
+    delete data;
 }
 
 WorldObj* Tile::getObj(int id) {
@@ -459,7 +541,7 @@ WorldObj* Tile::findNearestObj(float* pos) {
     return obj;
 }
 
-void Tile::ViewDbSphere::set(QString sh, FileBuffer* data){
+void Tile::ViewDbSphere::set(ParserX::Token sh, FileBuffer* data){
     if (sh == ("vdbid")) {
         vDbId = ParserX::GetUInt(data);
         return;
@@ -476,7 +558,7 @@ void Tile::ViewDbSphere::set(QString sh, FileBuffer* data){
     }
     if (sh == ("viewdbsphere")) {
         viewDbSphere.push_back(ViewDbSphere());
-        while (!((sh = ParserX::NextTokenInside(data).toLower()) == "")) {
+        while (!((sh = ParserX::NextTokenView(data)).isEmpty())) {
             viewDbSphere.back().set(sh, data);
             ParserX::SkipToken(data);
             }
@@ -510,6 +592,20 @@ void Tile::ViewDbSphere::set(int sh, FileBuffer* data){
     data->off = offset;
 }
 
+void Tile::ViewDbSphere::saveTokens(TokenWriter* out){
+    out->begin(TS::ViewDbSphere);
+    out->putUint(TS::VDbId, vDbId);
+    out->begin(TS::Position);
+    out->putFloat(position[0]);
+    out->putFloat(position[1]);
+    out->putFloat(position[2]);
+    out->end();
+    out->putFloat(TS::Radius, radius);
+    for(int i = 0; i < viewDbSphere.size(); i++)
+        viewDbSphere[i].saveTokens(out);
+    out->end();
+}
+
 void Tile::ViewDbSphere::save(QTextStream* out, const QString offset){
 *(out) << offset+"ViewDbSphere (\n";
 *(out) << offset+"	VDbId ( "<<this->vDbId<<" )\n";
@@ -528,7 +624,7 @@ void Tile::transalteObj(float px, float py, float pz, int uid) {
             obiekty[i]->translate(px, py, pz);
         }
     }
-    modified = true;
+    setModified(true);
 }
 
 void Tile::deleteObject(WorldObj* obj){
@@ -536,6 +632,7 @@ void Tile::deleteObject(WorldObj* obj){
         if(obiekty[i] == NULL) continue;
         if(obiekty[i] == obj){
             obiekty[i] = NULL;
+            pickDirty = true;
             if(i == jestObiektow - 1)
                 jestObiektow--;
             if(obj->UiD == maxUiD )
@@ -555,7 +652,7 @@ WorldObj* Tile::placeObject(WorldObj* obj){
         obj->UiD = ++maxUiDWS;
     else
         obj->UiD = ++maxUiD;
-    modified = true;
+    setModified(true);
     obj->setModified();
     obj->setMartix();
     return obj;
@@ -618,11 +715,29 @@ WorldObj* Tile::placeObject(float* p, float* q, Ref::RefItem* itemData, float* t
     obiekty[jestObiektow++] = nowy;
     //qDebug() << obiekty[jestObiektow-1]->qDirection[3];
 
-    modified = true;
+    setModified(true);
     nowy->setModified();
     return nowy;
 }
 
+void Tile::MarkDirty(int x, int z){
+    QMutexLocker locker(&DirtyMutex);
+    DirtyTiles.insert(x*10000 + z);
+    PickDirtyTiles.insert(x*10000 + z);
+}
+
+QSet<int> Tile::GetDirty(){
+    QMutexLocker locker(&DirtyMutex);
+    return DirtyTiles;
+}
+
+QSet<int> Tile::TakeDirty(){
+    QMutexLocker locker(&DirtyMutex);
+    QSet<int> dirty = DirtyTiles;
+    DirtyTiles.clear();
+    return dirty;
+}
+
 void Tile::saveEmpty(int nx, int nz) {
     QString sh;
     QString path;
@@ -665,13 +780,9 @@ void Tile::save() {
     path = Game::root + "/routes/" + Game::route + "/world/w" + getNameXY(x) + "" + getNameXY(-z) + ".w";
     path.replace("//", "/");
     qDebug() << path;
-    QFile file(path);
     
-    if(!file.open(QIODevice::WriteOnly | QIODevice::Text)){
-        qDebug() << "Error saving W file " << path;
-        return;
-    }
-    QTextStream out(&file);
+    QByteArray data;
+    QTextStream out(&data, QIODevice::WriteOnly | QIODevice::Text);
     out.setEncoding(QStringConverter::Utf16);
     out.setGenerateByteOrderMark(true);
     out << "SIMISA@@@@@@@@@@JINX0w0t______\n";
@@ -718,19 +829,94 @@ void Tile::save() {
         }
     }
     out << ")";
- 
-    // optional, as QFile destructor will already do it:
-    file.close(); 
+    out.flush();
+    QByteArray binary;
+    if(Game::saveBinaryWorld && saveBinary(data, binary))
+        SaveQueue::Write(path, binary);
+    else
+        SaveQueue::Write(path, data);
     saveWS();
 }
 
+/*
+ * save() of many tiles, run in parallel by SaveQueue::Serialize().
+ * Each job reads only its own tile and the files are the same as from
+ * save() called in turn.
+ */
+void Tile::SaveAll(const QVector<Tile*> &tiles) {
+    QVector<std::function<void()>> jobs;
+    for(int i = 0; i < tiles.size(); i++){
+        Tile* tile = tiles[i];
+        jobs.push_back([tile](){ tile->save(); });
+    }
+    SaveQueue::Serialize(jobs);
+}
+
+/*
+ * Parsed objects, before load() is called on them, for TileCache.
+ * Tiles with objects that have no binary form are not cached.
+ */
+void Tile::saveCache(const QFileInfo &source) {
+    TokenWriter out(261844);
+    saveTokens(&out);
+    if(out.ok)
+        TileCache::write(source, out.data);
+}
+
+void Tile::saveTokens(TokenWriter* out) {
+    out->begin(TS::Tr_Worldfile);
+    out->begin(TS::VDbIdCount);
+    out->putInt(vDbIdCount);
+    out->end();
+    for(int i = 0; i < viewDbSphere.size(); i++)
+        viewDbSphere[i].saveTokens(out);
+    for(int i = 0; i < jestObiektow; i++){
+        if(obiekty[i] == NULL) continue;
+        obiekty[i]->saveTokens(out);
+    }
+    out->end();
+}
+
+/*
+ * Compressed binary .w, as read by load().
+ * The text written by save() is parsed again into unloaded objects,
+ * so the binary file holds exactly what loading the text file would give.
+ * False if some object has no binary form or needs TSRE's own tokens,
+ * like a shape template or ORTS names, text is saved then.
+ */
+bool Tile::saveBinary(const QByteArray &text, QByteArray &binary) {
+    unsigned char* raw = new unsigned char[text.size()];
+    memcpy(raw, text.constData(), text.size());
+    FileBuffer data(raw, text.size());
+    
+    Tile parsed;
+    parsed.x = x;
+    parsed.z = z;
+    ParserX::Token sh;
+    ParserX::NextLine(&data);
+    while (!((sh = ParserX::NextTokenView(&data)).isEmpty())) {
+        if(sh == "tr_worldfile")
+            parsed.loadUtf16Data(&data);
+        ParserX::SkipToken(&data);
+    }
+    
+    TokenWriter out(261844);
+    out.stockTokensOnly = true;
+    parsed.saveTokens(&out);
+    for(int i = 0; i < parsed.jestObiektow; i++)
+        delete parsed.obiekty[i];
+    if(!out.ok)
+        return false;
+    binary = out.compressed("JINX0w0b______\r\n");
+    return binary.size() > 0;
+}
+
 void Tile::saveWS() {
     QString path;
     
     path = Game::root + "/routes/" + Game::route + "/world/w" + getNameXY(x) + "" + getNameXY(-z) + ".ws";
     path.replace("//", "/");
     qDebug() << path;
-    QFile file(path);
     
     int countWS = 0;
     for(int i = 0; i < this->jestObiektow; i++){
@@ -740,15 +926,12 @@ void Tile::saveWS() {
     qDebug() << countWS;
     if(countWS == 0){
         qDebug() << "delete ws file if exist";
-        file.remove();
+        SaveQueue::Remove(path);
         return;
     }
     
-    if(!file.open(QIODevice::WriteOnly | QIODevice::Text)){
-        qDebug() << "Error saving WS file " << path;
-        return;
-    }   
-    QTextStream out(&file);
+    QByteArray data;
+    QTextStream out(&data, QIODevice::WriteOnly | QIODevice::Text);
     out.setEncoding(QStringConverter::Utf16);
     out.setGenerateByteOrderMark(true);
     out << "SIMISA@@@@@@@@@@JINX0W0t______\n";
@@ -760,9 +943,8 @@ void Tile::saveWS() {
             this->obiekty[i]->save(&out);
     }
     out << ")";
- 
-    file.close(); 
-    
+    out.flush();
+    SaveQueue::Write(path, data);
 }
 
 bool Tile::isModified(){
@@ -782,6 +964,8 @@ bool Tile::isModified(){
 void Tile::setModified(bool value){
     this->modified = value;
     
+    if(value)
+        MarkDirty(x, z);
     if(value == false){
         for (int i = 0; i < jestObiektow; i++) {
             if(obiekty[i] == NULL) continue;
@@ -883,13 +1067,132 @@ void Tile::updateSim(float deltaTime){
     }
 }
 
+/*
+ * Boxes around the cached bounding spheres, updated only after objects of
+ * the tile were added, moved or deleted. The tree is refitted when only
+ * positions changed and built again otherwise. Objects whose shapes are
+ * still loading have no sphere yet, the tree is updated when one has.
+ */
+void Tile::updatePickBVH(){
+    {
+        QMutexLocker locker(&DirtyMutex);
+        if(PickDirtyTiles.remove(x*10000 + z))
+            pickDirty = true;
+    }
+    for (unsigned int i = 0; i < pickPending.size() && !pickDirty; i++) {
+        WorldObj* obj = obiekty[pickPending[i]];
+        if(obj != NULL && obj->getBoundingSphere() != NULL)
+            pickDirty = true;
+    }
+    if(!pickDirty)
+        return;
+    pickDirty = false;
+    pickPending.clear();
+    std::vector<int> ids;
+    pickBoxes.clear();
+    for (int i = 0; i < jestObiektow; i++) {
+        if(obiekty[i] == NULL) continue;
+        if(!obiekty[i]->loaded) continue;
+        float* s = obiekty[i]->getBoundingSphere();
+        if(s == NULL){
+            SFile* shape = obiekty[i]->shapePointer;
+            if(shape != NULL && shape->loaded == 0)
+                pickPending.push_back(i);
+            continue;
+        }
+        ids.push_back(i);
+        pickBoxes.push_back(s[0] - s[3]);
+        pickBoxes.push_back(s[1] - s[3]);
+        pickBoxes.push_back(s[2] - s[3]);
+        pickBoxes.push_back(s[0] + s[3]);
+        pickBoxes.push_back(s[1] + s[3]);
+        pickBoxes.push_back(s[2] + s[3]);
+    }
+    if(ids == pickIds && pickBVH.size() == (int)ids.size()){
+        pickBVH.refit(pickBoxes.data());
+        return;
+    }
+    pickIds.swap(ids);
+    pickBVH.build(pickBoxes.data(), pickIds.size());
+}
+
+/*
+ * Nearest object hit by a tile space ray, checked against shape triangles.
+ * Objects without CPU side geometry are skipped.
+ */
+WorldObj* Tile::pickObject(float* origin, float* dir, float maxT, float &t){
+    if (loaded != 1) return NULL;
+    updatePickBVH();
+    std::vector<BVH::Hit> hits;
+    pickBVH.intersectRay(origin, dir, maxT, hits);
+    WorldObj* nearest = NULL;
+    float tt;
+    for (unsigned int i = 0; i < hits.size(); i++) {
+        if (nearest != NULL && hits[i].t > t)
+            break;
+        WorldObj* obj = obiekty[pickIds[hits[i].id]];
+        if (!obj->getRayIntersection(origin, dir, tt))
+            continue;
+        if (tt > maxT)
+            continue;
+        if (nearest == NULL || tt < t) {
+            nearest = obj;
+            t = tt;
+        }
+    }
+    return nearest;
+}
+
+/*
+ * Tests the cached bounding spheres of all objects against the view frustum.
+ * mvMatrix has to be the tile model-view matrix, the projection is taken from GLUU.
+ * Returns one byte per object, or NULL if everything should be drawn.
+ */
+unsigned char* Tile::cullObjects(float* mvMatrix, int renderMode){
+    if (!Game::frustumCulling || renderMode == GLUU::RENDER_SHADOWMAP)
+        return NULL;
+    if (jestObiektow == 0)
+        return NULL;
+    float clip[16];
+    Mat4::multiply(clip, GLUU::get()->pMatrix, mvMatrix);
+    Frustum frustum;
+    frustum.set(clip);
+
+    cullSpheres.resize(jestObiektow*4);
+    cullVisible.resize(jestObiektow);
+    float* cx = cullSpheres.data();
+    float* cy = cx + jestObiektow;
+    float* cz = cy + jestObiektow;
+    float* cr = cz + jestObiektow;
+    float* sphere;
+    for (int i = 0; i < jestObiektow; i++) {
+        sphere = NULL;
+        if (obiekty[i] != NULL && obiekty[i]->loaded && !obiekty[i]->drawsOutsideBound())
+            sphere = obiekty[i]->getBoundingSphere();
+        if (sphere == NULL) {
+            // No bound yet, or more than the bound is drawn, always drawn.
+            cx[i] = cy[i] = cz[i] = 0;
+            cr[i] = 1.0e30f;
+            continue;
+        }
+        cx[i] = sphere[0];
+        cy[i] = sphere[1];
+        cz[i] = sphere[2];
+        cr[i] = sphere[3];
+    }
+    frustum.spheresVisible(cx, cy, cz, cr, jestObiektow, cullVisible.data());
+    return cullVisible.data();
+}
+
 void Tile::pushRenderItems(float* playerT, float* playerW, float* target, float fov, int renderMode){
     if (loaded != 1) return;
     int selectionColor = 0;
     float lodx, lodz, lod;
+    unsigned char* visible = cullObjects(Game::currentRenderer->mvMatrix, renderMode);
 
     for (int i = 0; i < jestObiektow; i++) {
         if(obiekty[i] == NULL) continue;
+        if(visible != NULL && !visible[i]) continue;
        
         if (obiekty[i]->loaded) {
             lodx = (x - playerT[0])*2048 + obiekty[i]->position[0] - playerW[0];
@@ -928,8 +1231,10 @@ void Tile::render(float * playerT, float* playerW, float* target, float fov, int
     //this.obiekty.forEach(function(obj) {
     int selectionColor = 0;
     float lodx, lodz, lod;
+    unsigned char* visible = cullObjects(gluu->mvMatrix, renderMode);
     for (int i = 0; i < jestObiektow; i++) {
         if(obiekty[i] == NULL) continue;
+        if(visible != NULL && !visible[i]) continue;
         if (obiekty[i]->loaded) {
             lodx = (x - playerT[0])*2048 + obiekty[i]->position[0] - playerW[0];
             lodz = (z - playerT[1])*2048 + obiekty[i]->position[2] - playerW[2];
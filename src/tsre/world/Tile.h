@@ -12,11 +12,17 @@
 #define	TILE_H
 
 #include <QString>
+#include <QSet>
+#include <QMutex>
 #include <unordered_map>
+#include <vector>
 #include <tsre/world/objects/WorldObj.h>
 #include <tsre/world/Ref.h>
+#include <tsre/math3d/BVH.h>
 
 class GroupObj;
+class TokenWriter;
+class QFileInfo;
 
 class Tile {
 public:
@@ -26,8 +32,9 @@ public:
 	float radius;
         QVector<ViewDbSphere> viewDbSphere;
         void set(int sh, FileBuffer* data);
-        void set(QString sh, FileBuffer* data);
+        void set(ParserX::Token sh, FileBuffer* data);
         void save(QTextStream* out, const QString offset);
+        void saveTokens(TokenWriter* out);
     };
     int vDbIdCount;
     QVector<ViewDbSphere> viewDbSphere;
@@ -48,8 +55,20 @@ public:
     Tile(const Tile& orig);
     virtual ~Tile();
     static void saveEmpty(int x, int z);
+    static void MarkDirty(int x, int z);
+    static void SaveAll(const QVector<Tile*> &tiles);
+    static QSet<int> GetDirty();
+    static QSet<int> TakeDirty();
     static QString getNameXY(int e);
+    // Last TileStreamer frame the tile was asked for, for LRU eviction.
+    unsigned int lastUsed = 0;
+    // Bytes of .w and .ws data read, memory estimate for TileStreamer.
+    int dataSize = 0;
     void load();
+    void loadData();
+    void finishLoad(bool checkErrors = true);
+    void release();
+    bool canRelease();
     void loadUtf16Data(FileBuffer *data);
     void loadInit();
     void replaceWorldObj(WorldObj *nowy);
@@ -60,6 +79,7 @@ public:
     void setModified(bool value);
     WorldObj* getObj(int id);
     WorldObj* findNearestObj(float *pos);
+    WorldObj* pickObject(float* origin, float* dir, float maxT, float &t);
     void deleteObject(WorldObj* obj);
     WorldObj* placeObject(WorldObj* obj);
     WorldObj* placeObject(float* p, Ref::RefItem* itemData);
@@ -81,12 +101,30 @@ public:
     void saveToStream(QTextStream &out);
     
 private:
+    // Ids (x*10000 + z) of tiles changed since the last save.
+    static QSet<int> DirtyTiles;
+    // Tiles with objects changed since their pick BVH was updated.
+    static QSet<int> PickDirtyTiles;
+    static QMutex DirtyMutex;
     int maxUiD = 0;
     int maxUiDWS = 100000;    
     bool modified;
     QString* viewDbSphereRaw = NULL;
+    std::vector<WorldObj*> soundObjects;
     void wczytajObiekty();
     void saveWS();
+    void saveCache(const QFileInfo &source);
+    bool saveBinary(const QByteArray &text, QByteArray &binary);
+    void saveTokens(TokenWriter* out);
+    std::vector<float> cullSpheres;
+    std::vector<unsigned char> cullVisible;
+    unsigned char* cullObjects(float* mvMatrix, int renderMode);
+    BVH pickBVH;
+    std::vector<float> pickBoxes;
+    std::vector<int> pickIds;
+    std::vector<int> pickPending;
+    bool pickDirty = true;
+    void updatePickBVH();
 };
 
 #endif	/* TILE_H */
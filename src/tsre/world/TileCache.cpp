@@ -0,0 +1,108 @@
+/*  This file is part of TSRE5.
+ *
+ *  TSRE5 - train sim game engine and MSTS/OR Editors. 
+ *  Copyright (C) 2016 Piotr Gadecki <pgadecki@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later. 
+ *
+ *  See LICENSE.md or https://www.gnu.org/licenses/gpl.html
+ */
+
+#include <tsre/world/TileCache.h>
+#include <tsre/fileFunctions/FileBuffer.h>
+#include <tsre/fileFunctions/ReadFile.h>
+#include <tsre/Game.h>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QDateTime>
+#include <QDir>
+#include <QDebug>
+#include <string.h>
+
+static const char CacheMagic[8] = { 'T', 'S', 'R', 'E', '_', 'W', 'C', 0 };
+
+QMutex TileCache::mutex;
+QWaitCondition TileCache::jobAdded;
+QQueue<TileCache::Job> TileCache::jobs;
+TileCache* TileCache::worker = NULL;
+
+QString TileCache::getPath(const QFileInfo &source){
+    QString path = Game::root + "/routes/" + Game::route + "/tsre_cache/world/" + source.fileName();
+    path.replace("//", "/");
+    return path;
+}
+
+FileBuffer* TileCache::read(const QFileInfo &source){
+    if(!source.exists())
+        return NULL;
+    QFile file(getPath(source));
+    if (!file.open(QIODevice::ReadOnly))
+        return NULL;
+    FileBuffer* data = FileBuffer::map(&file);
+    if(data == NULL)
+        data = ReadFile::readRAW(&file);
+    file.close();
+
+    bool valid = data->length >= HeaderLength + 4
+            && memcmp(data->data, CacheMagic, 8) == 0;
+    if(valid){
+        data->off = 8;
+        qint64 size, modified;
+        memcpy(&size, &data->data[16], 8);
+        memcpy(&modified, &data->data[24], 8);
+        valid = data->getUint() == Version
+                && data->getInt() == data->length - HeaderLength
+                && size == source.size()
+                && modified == source.lastModified().toMSecsSinceEpoch();
+    }
+    if(!valid){
+        delete data;
+        return NULL;
+    }
+    data->off = 0;
+    return data;
+}
+
+void TileCache::write(const QFileInfo &source, const QByteArray &data){
+    QByteArray out;
+    out.reserve(HeaderLength + data.size());
+    out.append(CacheMagic, 8);
+    unsigned int version = Version;
+    int length = data.size();
+    qint64 size = source.size();
+    qint64 modified = source.lastModified().toMSecsSinceEpoch();
+    out.append((const char*)&version, 4);
+    out.append((const char*)&length, 4);
+    out.append((const char*)&size, 8);
+    out.append((const char*)&modified, 8);
+    out.append(data);
+
+    QMutexLocker locker(&mutex);
+    if(worker == NULL){
+        worker = new TileCache();
+        worker->start(QThread::LowPriority);
+    }
+    jobs.enqueue({getPath(source), out});
+    jobAdded.wakeOne();
+}
+
+void TileCache::run(){
+    Job job;
+    for(;;){
+        mutex.lock();
+        while(jobs.size() == 0)
+            jobAdded.wait(&mutex);
+        job = jobs.dequeue();
+        mutex.unlock();
+
+        QDir().mkpath(QFileInfo(job.path).path());
+        QSaveFile file(job.path);
+        if (!file.open(QIODevice::WriteOnly)){
+            qDebug() << "TileCache: can't write" << job.path;
+            continue;
+        }
+        file.write(job.data);
+        if(!file.commit())
+            qDebug() << "TileCache: can't write" << job.path;
+    }
+}
@@ -0,0 +1,56 @@
+/*  This file is part of TSRE5.
+ *
+ *  TSRE5 - train sim game engine and MSTS/OR Editors. 
+ *  Copyright (C) 2016 Piotr Gadecki <pgadecki@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later. 
+ *
+ *  See LICENSE.md or https://www.gnu.org/licenses/gpl.html
+ */
+
+#ifndef TILECACHE_H
+#define	TILECACHE_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QByteArray>
+#include <QFileInfo>
+
+class FileBuffer;
+
+/*
+ * Cache of parsed text .w files in routes/<route>/tsre_cache/world.
+ * Data is in the binary .w token layout, so Tile::load reads it like
+ * a compressed .w file. The header keeps the version and the size and
+ * modification time of the source file; a changed source makes the cache
+ * invalid. Cache files are mapped when read and written by a background
+ * thread.
+ */
+class TileCache : public QThread {
+    Q_OBJECT
+public:
+    static const unsigned int Version = 1;
+    static const int HeaderLength = 32;
+
+    static FileBuffer* read(const QFileInfo &source);
+    static void write(const QFileInfo &source, const QByteArray &data);
+
+protected:
+    void run();
+
+private:
+    struct Job {
+        QString path;
+        QByteArray data;
+    };
+    static QMutex mutex;
+    static QWaitCondition jobAdded;
+    static QQueue<Job> jobs;
+    static TileCache* worker;
+    static QString getPath(const QFileInfo &source);
+};
+
+#endif	/* TILECACHE_H */
+
@@ -0,0 +1,391 @@
+/*  This file is part of TSRE5.
+ *
+ *  TSRE5 - train sim game engine and MSTS/OR Editors.
+ *  Copyright (C) 2016 Piotr Gadecki <pgadecki@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *
+ *  See LICENSE.md or https://www.gnu.org/licenses/gpl.html
+ */
+
+#include <tsre/world/TileStreamer.h>
+#include <tsre/world/Route.h>
+#include <tsre/world/Tile.h>
+#include <tsre/world/Terrain.h>
+#include <tsre/world/TerrainLib.h>
+#include <tsre/world/objects/GroupObj.h>
+#include <tsre/Game.h>
+#include <tsre/Undo.h>
+#include <tsre/ErrorMessagesLib.h>
+#include <tsre/renderer/FrameScheduler.h>
+#include <QMutexLocker>
+#include <QDebug>
+#include <algorithm>
+#include <math.h>
+#include <stdlib.h>
+
+unsigned int TileStreamer::Frame = 0;
+
+QMutex TileStreamer::mutex;
+QWaitCondition TileStreamer::jobAdded;
+std::vector<TileStreamer::Job> TileStreamer::jobs;
+QVector<Tile*> TileStreamer::done;
+QVector<Terrain*> TileStreamer::doneTerrain;
+QSet<int> TileStreamer::pending;
+QSet<int> TileStreamer::pendingTerrain;
+QSet<int> TileStreamer::released;
+QSet<int> TileStreamer::pinned[2];
+QVector<TileStreamer*> TileStreamer::workers;
+QThread* TileStreamer::mainThread = NULL;
+bool TileStreamer::stopping = false;
+int TileStreamer::cameraX = 0;
+int TileStreamer::cameraZ = 0;
+float TileStreamer::lastPos[2] = {0, 0};
+float TileStreamer::motion[2] = {0, 0};
+bool TileStreamer::hasLastPos = false;
+
+int TileStreamer::keepRadius(){
+    if(Game::tileKeepRadius > 0)
+        return Game::tileKeepRadius;
+    return Game::tileLod + 2;
+}
+
+// Mutex must be locked.
+bool TileStreamer::inRange(int x, int z){
+    return std::max(abs(x - cameraX), abs(z - cameraZ)) <= keepRadius();
+}
+
+void TileStreamer::startWorkers(){
+    int count = Game::tileLoaderThreads;
+    if(count < 1)
+        count = 1;
+    // Terrain tiles made by the workers are QObjects, they are handed to this thread.
+    mainThread = QThread::currentThread();
+    for(int i = 0; i < count; i++){
+        TileStreamer* worker = new TileStreamer();
+        workers.push_back(worker);
+        worker->start(QThread::LowPriority);
+    }
+    qDebug() << "TileStreamer: threads" << count;
+}
+
+// Mutex must be locked.
+void TileStreamer::enqueue(int x, int z, bool ahead, bool terrain){
+    int id = x*10000 + z;
+    QSet<int> &ids = terrain ? pendingTerrain : pending;
+    if(ids.contains(id))
+        return;
+    if(workers.size() == 0)
+        startWorkers();
+    ids.insert(id);
+    jobs.push_back({x, z, ahead, terrain});
+    jobAdded.wakeOne();
+}
+
+/*
+ * True if the tile is loaded in the background,
+ * false if the caller has to load it itself.
+ */
+bool TileStreamer::request(int x, int z){
+    if(!Game::tileStreaming || Game::serverClient != NULL)
+        return false;
+    QMutexLocker locker(&mutex);
+    enqueue(x, z, false);
+    return true;
+}
+
+/*
+ * Same as request() for the terrain tile at x, z.
+ */
+bool TileStreamer::requestTerrain(int x, int z){
+    if(!Game::tileStreaming || Game::serverClient != NULL)
+        return false;
+    QMutexLocker locker(&mutex);
+    enqueue(x, z, false, true);
+    return true;
+}
+
+void TileStreamer::update(Route* route, float* playerT, float* playerPos){
+    if(!Game::tileStreaming || Game::serverClient != NULL)
+        return;
+    if(route == NULL || !route->loaded)
+        return;
+    Frame++;
+    
+    // Smoothed camera movement, in meters per update.
+    float pos[2];
+    pos[0] = playerT[0]*2048 + playerPos[0];
+    pos[1] = playerT[1]*2048 + playerPos[2];
+    if(hasLastPos && fabs(pos[0] - lastPos[0]) + fabs(pos[1] - lastPos[1]) < 2048){
+        motion[0] = motion[0]*0.9 + (pos[0] - lastPos[0])*0.1;
+        motion[1] = motion[1]*0.9 + (pos[1] - lastPos[1])*0.1;
+    } else {
+        motion[0] = motion[1] = 0;
+    }
+    lastPos[0] = pos[0];
+    lastPos[1] = pos[1];
+    hasLastPos = true;
+    
+    {
+        QMutexLocker locker(&mutex);
+        cameraX = (int)playerT[0];
+        cameraZ = (int)playerT[1];
+    }
+    
+    finishLoaded(route);
+    prefetch(route);
+    if(Frame % 60 == 0)
+        evict(route);
+}
+
+/*
+ * Loads objects of parsed tiles while FrameScheduler allows it.
+ * If the tile was loaded by Route in the meantime, or the camera went
+ * out of range while it was parsed, the copy is dropped.
+ */
+void TileStreamer::finishLoaded(Route* route){
+    for(;;){
+        Terrain* terrain = NULL;
+        bool far = false;
+        {
+            QMutexLocker locker(&mutex);
+            if(doneTerrain.size() == 0)
+                break;
+            terrain = doneTerrain[0];
+            doneTerrain.remove(0);
+            pendingTerrain.remove((int)terrain->mojex*10000 + (int)terrain->mojez);
+            far = !inRange(terrain->mojex, terrain->mojez);
+        }
+        // Nothing to build, the TerrainLib uploads it when it is drawn.
+        if(far || route->terrainLib == NULL || !route->terrainLib->addStreamedTerrain(terrain))
+            delete terrain;
+    }
+    
+    for(;;){
+        Tile* tile = NULL;
+        {
+            QMutexLocker locker(&mutex);
+            if(done.size() == 0)
+                return;
+            tile = done[0];
+        }
+        qint64 start = FrameScheduler::begin(FrameScheduler::Build, tile);
+        if(start < 0)
+            return;
+        bool far = false;
+        {
+            QMutexLocker locker(&mutex);
+            done.remove(0);
+            pending.remove(tile->x*10000 + tile->z);
+            far = !inRange(tile->x, tile->z);
+        }
+        int id = tile->x*10000 + tile->z;
+        if(far || route->tile.value(id, NULL) != NULL){
+            tile->release();
+            delete tile;
+        } else {
+            // Errors were already reported when the tile was loaded first.
+            if(tile->loaded == 0)
+                tile->finishLoad(!released.contains(id));
+            tile->lastUsed = Frame;
+            route->tile[id] = tile;
+        }
+        FrameScheduler::end(FrameScheduler::Build, start);
+    }
+}
+
+/*
+ * Requests the ring of tiles just outside the drawn area,
+ * and one more ring in the direction the camera is moving.
+ */
+void TileStreamer::prefetch(Route* route){
+    int r = Game::tileLod + 1;
+    bool moving = fabs(motion[0]) + fabs(motion[1]) > 0.1;
+    QMutexLocker locker(&mutex);
+    for(int i = -r - 1; i <= r + 1; i++){
+        for(int j = -r - 1; j <= r + 1; j++){
+            int distance = std::max(abs(i), abs(j));
+            if(distance < r)
+                continue;
+            bool ahead = moving && i*motion[0] + j*motion[1] > 0;
+            if(distance > r && !ahead)
+                continue;
+            if(route->tile.value((cameraX + i)*10000 + cameraZ + j, NULL) != NULL)
+                continue;
+            enqueue(cameraX + i, cameraZ + j, ahead);
+        }
+    }
+}
+
+/*
+ * Releases tiles outside keepRadius(), least recently used first,
+ * until loaded tiles fit in Game::tileMemoryLimit.
+ */
+void TileStreamer::evict(Route* route){
+    if(Game::loadAllWFiles)
+        return;
+    int keep = keepRadius();
+    long long int memory = 0;
+    QVector<Tile*> candidates;
+    for(auto it = route->tile.begin(); it != route->tile.end(); ){
+        Tile* tile = it.value();
+        if(tile == NULL){
+            it = route->tile.erase(it);
+            continue;
+        }
+        if(tile->loaded == 1)
+            memory += tile->dataSize;
+        bool far = std::max(abs(tile->x - cameraX), abs(tile->z - cameraZ)) > keep;
+        if(far && tile->loaded == -2){
+            it = route->tile.erase(it);
+            delete tile;
+            continue;
+        }
+        if(far && tile->canRelease() && !pinned[CopyBuffer].contains(it.key())
+                && !pinned[LastSelected].contains(it.key()))
+            candidates.push_back(tile);
+        ++it;
+    }
+    
+    long long int limit = (long long int)Game::tileMemoryLimit*1024*1024;
+    if(memory <= limit)
+        return;
+    std::sort(candidates.begin(), candidates.end(), [](Tile* a, Tile* b){
+        return a->lastUsed < b->lastUsed;
+    });
+    int count = 0;
+    for(int i = 0; i < candidates.size() && memory > limit; i++){
+        Tile* tile = candidates[i];
+        if(Undo::ReferencesTile(tile->x, tile->z))
+            continue;
+        QSet<GameObj*> objects;
+        for(auto it = tile->obiekty.begin(); it != tile->obiekty.end(); ++it)
+            if(it->second != NULL)
+                objects.insert((GameObj*)it->second);
+        ErrorMessagesLib::ForgetObjects(objects);
+        memory -= tile->dataSize;
+        int id = tile->x*10000 + tile->z;
+        released.insert(id);
+        route->tile.remove(id);
+        tile->release();
+        delete tile;
+        count++;
+    }
+    qDebug() << "TileStreamer: released" << count << "tiles," << memory/1024/1024 << "MB left";
+}
+
+/*
+ * Keeps tiles of the copied objects, pasting reads them later,
+ * and the tile of the last selected object used by some tools.
+ */
+void TileStreamer::pinObjectTiles(WorldObj* obj, Pin pin){
+    pinned[pin].clear();
+    if(obj == NULL)
+        return;
+    if(obj->typeID == WorldObj::groupobject){
+        GroupObj* group = (GroupObj*)obj;
+        for(int i = 0; i < group->objects.size(); i++)
+            if(group->objects[i] != NULL)
+                pinned[pin].insert(group->objects[i]->x*10000 + group->objects[i]->y);
+        return;
+    }
+    pinned[pin].insert(obj->x*10000 + obj->y);
+}
+
+int TileStreamer::pendingCount(){
+    QMutexLocker locker(&mutex);
+    return pending.size() + pendingTerrain.size();
+}
+
+/*
+ * Stops and joins the workers, queued and parsed tiles are dropped.
+ * Called when the route is unloaded, the next request starts new workers.
+ */
+void TileStreamer::stop(){
+    {
+        QMutexLocker locker(&mutex);
+        if(workers.size() == 0)
+            return;
+        stopping = true;
+        jobs.clear();
+        jobAdded.wakeAll();
+    }
+    for(int i = 0; i < workers.size(); i++){
+        workers[i]->quit();
+        workers[i]->wait();
+        delete workers[i];
+    }
+    
+    QMutexLocker locker(&mutex);
+    workers.clear();
+    stopping = false;
+    for(int i = 0; i < done.size(); i++){
+        done[i]->release();
+        delete done[i];
+    }
+    for(int i = 0; i < doneTerrain.size(); i++)
+        delete doneTerrain[i];
+    done.clear();
+    doneTerrain.clear();
+    pending.clear();
+    pendingTerrain.clear();
+    released.clear();
+    pinned[CopyBuffer].clear();
+    pinned[LastSelected].clear();
+    hasLastPos = false;
+}
+
+void TileStreamer::run(){
+    Job job;
+    for(;;){
+        mutex.lock();
+        int best = -1;
+        while(best < 0){
+            while(jobs.size() == 0 && !stopping)
+                jobAdded.wait(&mutex);
+            if(stopping){
+                mutex.unlock();
+                return;
+            }
+            // Nearest to the camera first, tiles out of range are dropped.
+            float bestDistance = 0;
+            for(unsigned int i = 0; i < jobs.size(); ){
+                float distance = std::max(abs(jobs[i].x - cameraX), abs(jobs[i].z - cameraZ));
+                if(distance > keepRadius()){
+                    (jobs[i].terrain ? pendingTerrain : pending).remove(jobs[i].x*10000 + jobs[i].z);
+                    jobs[i] = jobs.back();
+                    jobs.pop_back();
+                    continue;
+                }
+                if(jobs[i].ahead)
+                    distance -= 0.5;
+                if(best < 0 || distance < bestDistance){
+                    best = i;
+                    bestDistance = distance;
+                }
+                i++;
+            }
+        }
+        job = jobs[best];
+        jobs[best] = jobs.back();
+        jobs.pop_back();
+        mutex.unlock();
+
+        if(job.terrain){
+            Terrain* terrain = new Terrain(job.x, job.z);
+            terrain->setThread(mainThread);
+            mutex.lock();
+            doneTerrain.push_back(terrain);
+            mutex.unlock();
+            continue;
+        }
+        Tile* tile = new Tile();
+        tile->x = job.x;
+        tile->z = job.z;
+        tile->loadData();
+
+        mutex.lock();
+        done.push_back(tile);
+        mutex.unlock();
+    }
+}
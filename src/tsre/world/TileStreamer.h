@@ -0,0 +1,91 @@
+/*  This file is part of TSRE5.
+ *
+ *  TSRE5 - train sim game engine and MSTS/OR Editors.
+ *  Copyright (C) 2016 Piotr Gadecki <pgadecki@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *
+ *  See LICENSE.md or https://www.gnu.org/licenses/gpl.html
+ */
+
+#ifndef TILESTREAMER_H
+#define	TILESTREAMER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QVector>
+#include <QSet>
+#include <vector>
+
+class Route;
+class Tile;
+class Terrain;
+class WorldObj;
+
+/*
+ * Loads world and terrain tiles around the camera on worker threads.
+ * Workers read and parse .w/.ws files into new Tile objects and .t/.raw
+ * files into new Terrain objects. update() loads the objects of the tiles
+ * on the main thread and puts them into Route::tile, terrain goes to the
+ * TerrainLib of the route. Tiles that are out of range by the time they
+ * are parsed are dropped.
+ * Tiles ahead of the camera movement are requested before they are drawn.
+ * Tiles outside Game::tileKeepRadius are released in LRU order while
+ * loaded tiles use more than Game::tileMemoryLimit megabytes of file data.
+ * Modified tiles, tiles with selected objects and tiles referenced by undo,
+ * the copy buffer or the last selected object are kept.
+ */
+class TileStreamer : public QThread {
+    Q_OBJECT
+public:
+    enum Pin {
+        CopyBuffer = 0,
+        LastSelected = 1
+    };
+    static unsigned int Frame;
+
+    static void update(Route* route, float* playerT, float* playerPos);
+    static bool request(int x, int z);
+    static bool requestTerrain(int x, int z);
+    static void pinObjectTiles(WorldObj* obj, Pin pin = CopyBuffer);
+    static int pendingCount();
+    static void stop();
+
+protected:
+    void run();
+
+private:
+    struct Job {
+        int x;
+        int z;
+        bool ahead;
+        bool terrain;
+    };
+    static QMutex mutex;
+    static QWaitCondition jobAdded;
+    static std::vector<Job> jobs;
+    static QVector<Tile*> done;
+    static QVector<Terrain*> doneTerrain;
+    static QSet<int> pending;
+    static QSet<int> pendingTerrain;
+    static QSet<int> released;
+    static QSet<int> pinned[2];
+    static QVector<TileStreamer*> workers;
+    static QThread* mainThread;
+    static bool stopping;
+    static int cameraX;
+    static int cameraZ;
+    static float lastPos[2];
+    static float motion[2];
+    static bool hasLastPos;
+    static int keepRadius();
+    static bool inRange(int x, int z);
+    static void enqueue(int x, int z, bool ahead, bool terrain = false);
+    static void finishLoaded(Route* route);
+    static void prefetch(Route* route);
+    static void evict(Route* route);
+    static void startWorkers();
+};
+
+#endif	/* TILESTREAMER_H */
@@ -21,6 +21,7 @@
 #include <tsre/ogl/TrackItemObj.h>
 #include <tsre/ogl/OglObj.h>
 #include <tsre/fileFunctions/TS.h>
+#include <tsre/fileFunctions/TokenWriter.h>
 #include <math.h>
 #include <QFile>
 #include <tsre/fileFunctions/FileBuffer.h>
@@ -268,11 +269,34 @@ void CarSpawnerObj::set(int sh, FileBuffer* data) {
         trItemId[trItemIdCount++] = data->getUint();
         return;
     }
+    if (sh == TS::TSRE_ORTSListName) {
+        data->off++;
+        int slen = data->getShort()*2;
+        carspawnerListName = *data->getString(data->off, data->off + slen);
+        data->off += slen;
+        return;
+    }
     WorldObj::set(sh, data);
     return;
 }
 
-void CarSpawnerObj::set(QString sh, FileBuffer* data) {
+void CarSpawnerObj::saveTokens(TokenWriter* out) {
+    out->begin(TS::CarSpawner2);
+    out->putFloat(TS::CarFrequency, carFrequency);
+    out->putFloat(TS::CarAvSpeed, carAvSpeed);
+    for(int i = 0; i + 1 < trItemIdCount; i += 2){
+        out->begin(TS::TrItemId);
+        out->putUint(trItemId[i]);
+        out->putUint(trItemId[i+1]);
+        out->end();
+    }
+    if(carspawnerListName.length() > 0)
+        out->putString(TS::TSRE_ORTSListName, carspawnerListName);
+    saveCommonTokens(out);
+    out->end();
+}
+
+void CarSpawnerObj::set(ParserX::Token sh, FileBuffer* data) {
     if (sh == ("carfrequency")) {
         carFrequency = ParserX::GetNumber(data);
         return;
@@ -741,6 +765,18 @@ void CarSpawnerObj::makelineShape(){
         delete[] punkty;
 }
 
+/*
+ * shapePointer is the car shape, cars are drawn along the road and not
+ * at the matrix of the spawner. No bound, so it is never culled.
+ */
+bool CarSpawnerObj::getLocalBound(float* bound){
+    return false;
+}
+
+bool CarSpawnerObj::getLocalRayIntersection(float* origin, float* dir, float &t){
+    return false;
+}
+
 int CarSpawnerObj::getDefaultDetailLevel(){
     return -7;
 }
@@ -61,7 +61,8 @@ public:
     void load(int x, int y);
     bool allowNew();
     void set(int sh, FileBuffer* val);
-    void set(QString sh, FileBuffer* data);
+    void saveTokens(TokenWriter* out);
+    void set(ParserX::Token sh, FileBuffer* data);
     void save(QTextStream* out);
     bool select(int value);
     bool isTrackItem();
@@ -103,6 +104,8 @@ private:
     QVector<SimpleCar> cars;
     void renderTritems(GLUU* gluu, int selectionColor);
     void makelineShape();
+    bool getLocalBound(float* bound);
+    bool getLocalRayIntersection(float* origin, float* dir, float &t);
     static void parseCarList(FileBuffer* data);
 };
 
@@ -19,6 +19,7 @@
 #include <QOpenGLShaderProgram>
 #include <tsre/ogl/GLUU.h>
 #include <tsre/fileFunctions/TS.h>
+#include <tsre/fileFunctions/TokenWriter.h>
 #include <tsre/ogl/TrackItemObj.h>
 #include <tsre/Game.h>
 #include <tsre/procedural/ProceduralMstsDyntrack.h>
@@ -26,6 +27,7 @@
 #include <tsre/tdb/TSection.h>
 #include <tsre/tdb/TDB.h>
 #include <tsre/tdb/TSectionDAT.h>
+#include <tsre/renderer/FrameScheduler.h>
 #include <math.h>
 
 #ifndef M_PI
@@ -127,6 +129,7 @@ void DynTrackObj::rotate(float x, float y, float z){
 void DynTrackObj::deleteVBO(){
     //this->shape.deleteVBO();
     this->init = false;
+    this->boundingSphereValid = false;
     for(int i = 0; i < shape.size(); i++){
         shape[i]->deleteVBO();
         delete shape[i];
@@ -290,7 +293,35 @@ void DynTrackObj::set(int sh, FileBuffer* data) {
     return;
 }
 
-void DynTrackObj::set(QString sh, FileBuffer* data) {
+void DynTrackObj::saveTokens(TokenWriter* out) {
+    out->begin(TS::DynTrack2);
+    out->putUint(TS::SectionIdx, sectionIdx);
+    out->putFloat(TS::Elevation, elevation);
+    if(sections != NULL){
+        out->begin(TS::TrackSections);
+        for (int i = 0; i < 5; i++) {
+            out->begin(TS::TrackSection);
+            out->begin(TS::SectionCurve);
+            out->putUint(sections[i].type);
+            out->end();
+            out->putUint(sections[i].sectIdx);
+            out->putFloat(sections[i].a);
+            out->putFloat(sections[i].r);
+            out->end();
+        }
+        out->end();
+    }
+    if(jNodePosn != NULL){
+        out->begin(TS::JNodePosn);
+        for (int i = 0; i < 5; i++)
+            out->putFloat(jNodePosn[i]);
+        out->end();
+    }
+    saveCommonTokens(out);
+    out->end();
+}
+
+void DynTrackObj::set(ParserX::Token sh, FileBuffer* data) {
     if (sh == ("sectionidx")) {
         //qDebug() << ParserX::GetNumber(data);
         sectionIdx = ParserX::GetNumber(data);
@@ -367,6 +398,9 @@ void DynTrackObj::render(GLUU* gluu, float lod, float posx, float posz, float* p
     }
 
     if (!init) {
+        qint64 buildStart = FrameScheduler::begin(FrameScheduler::Build, this);
+        if(buildStart < 0)
+            return;
         QVector<TSection> tsections;
         for(int i = 0; i < 5; i++){
             if(sections[i].sectIdx > 100000000)
@@ -395,6 +429,7 @@ void DynTrackObj::render(GLUU* gluu, float lod, float posx, float posz, float* p
             ProceduralMstsDyntrack::GenShape(shape, tsections);
         }
         init = true;
+        FrameScheduler::end(FrameScheduler::Build, buildStart);
     } else {
         for(int i = 0; i < shape.size(); i++){
             shape[i]->render(selectionColor);
@@ -414,6 +449,24 @@ bool DynTrackObj::getSimpleBorder(float* border){
     return false;
 }
 
+// Box of all generated parts, none until the shape is built.
+bool DynTrackObj::getLocalBound(float* bound){
+    if(!init || shape.size() == 0)
+        return false;
+    float b[6];
+    for(int i = 0; i < shape.size(); i++){
+        if(shape[i] == NULL || !shape[i]->getSimpleBorder(i == 0 ? bound : b))
+            return false;
+        if(i == 0)
+            continue;
+        for(int j = 0; j < 6; j += 2){
+            if(b[j] > bound[j]) bound[j] = b[j];
+            if(b[j+1] < bound[j+1]) bound[j+1] = b[j+1];
+        }
+    }
+    return true;
+}
+
 bool DynTrackObj::getBoxPoints(QVector<float>& points){
         float bound[6];
         if (!getSimpleBorder((float*)&bound)) return false;
@@ -37,7 +37,8 @@ public:
     void setElevation(float prom);
     void rotate(float x, float y, float z);
     void set(int sh, FileBuffer* val);
-    void set(QString sh, FileBuffer* data);
+    void saveTokens(TokenWriter* out);
+    void set(ParserX::Token sh, FileBuffer* data);
     void set(QString sh, float* val);
     void save(QTextStream* out);
     void resize(float x, float y, float z);
@@ -55,6 +56,7 @@ private:
     int sidxSelected = 0;
     bool getSimpleBorder(float* border);
     bool getBoxPoints(QVector<float> &points);
+    bool getLocalBound(float* bound);
 };
 
 #endif	/* DYNTRACKOBJ_H */
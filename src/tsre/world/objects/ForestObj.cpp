@@ -14,6 +14,7 @@
 #include <math.h>
 #include <tsre/fileFunctions/ParserX.h>
 #include <QDebug>
+#include <vector>
 #include <QOpenGLShaderProgram>
 #include <cstdlib>
 #include <tsre/texture/TexLib.h>
@@ -21,11 +22,13 @@
 
 #include <tsre/world/TerrainLib.h>
 #include <tsre/fileFunctions/TS.h>
+#include <tsre/fileFunctions/TokenWriter.h>
 #include <tsre/Game.h>
 #include <tsre/fileFunctions/FileFunctions.h>
 #include <tsre/fileFunctions/ReadFile.h>
 #include <tsre/tdb/TDB.h>
 #include <tsre/math3d/Vector4f.h>
+#include <tsre/renderer/FrameScheduler.h>
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -201,7 +204,27 @@ void ForestObj::set(int sh, FileBuffer* data) {
     return;
 }
 
-void ForestObj::set(QString sh, FileBuffer* data) {
+void ForestObj::saveTokens(TokenWriter* out) {
+    out->begin(TS::Forest);
+    out->putString(TS::TreeTexture, treeTexture);
+    out->begin(TS::ScaleRange);
+    out->putFloat(scaleRangeX);
+    out->putFloat(scaleRangeZ);
+    out->end();
+    out->begin(TS::Area);
+    out->putFloat(areaX);
+    out->putFloat(areaZ);
+    out->end();
+    out->begin(TS::TreeSize);
+    out->putFloat(treeSizeX);
+    out->putFloat(treeSizeZ);
+    out->end();
+    out->putUint(TS::Population, population);
+    saveCommonTokens(out);
+    out->end();
+}
+
+void ForestObj::set(ParserX::Token sh, FileBuffer* data) {
     if (sh == ("treetexture")) {
         treeTexture = ParserX::GetString(data);
         return;
@@ -338,10 +361,8 @@ void ForestObj::drawShape(){
     }*/
 
     if (!init) {
-        if(!Game::ignoreLoadLimits){
-            if(Game::allowObjLag < 1)  return;
-            Game::allowObjLag-=2;
-        }
+        qint64 buildStart = FrameScheduler::begin(FrameScheduler::Build, this);
+        if(buildStart < 0)  return;
         
         //qint64 timeNow = QDateTime::currentMSecsSinceEpoch();
             
@@ -406,13 +427,20 @@ void ForestObj::drawShape(){
                 if(Game::roadDB != NULL)
                     Game::roadDB->fillNearestSquaredDistanceToTDBXZ(posT, fpoints, bBox);
             }
+            std::vector<float> fx(population), fz(population), fh;
+            for(int uu = 0; uu < population; uu++){
+                fx[uu] = fpoints[uu].x;
+                fz[uu] = fpoints[uu].z;
+            }
+            Game::terrainLib->getHeights(x, y, fx, fz, fh);
+            
             for(int uu = 0; uu < population; uu++){
                 if(ForestClearDistance > 0){
                     if(fpoints[uu].c < ForestClearDistance*ForestClearDistance)
                         continue;
                 }
 
-                float wysokosc = Game::terrainLib->getHeight(x, y, fpoints[uu].x, fpoints[uu].z);
+                float wysokosc = fh[uu];
                 
                 tposx = fpoints[uu].x - position[0];
                 tposz = fpoints[uu].z - position[2];
@@ -483,6 +511,7 @@ void ForestObj::drawShape(){
         //qDebug() << "forest gen time: " << (timeNow2 - timeNow);
         delete[] punkty;
         init = true;
+        FrameScheduler::end(FrameScheduler::Build, buildStart);
     }
     shape.render();
     if(selected){
@@ -503,42 +532,54 @@ bool ForestObj::getBoxPoints(QVector<float>& points){
             Vector2f x12y1 = x2y1.subv(x1y1);
             float x1y12d = x1y12.getDlugosc();
             float x12y1d = x12y1.getDlugosc();
-            float wysokosc = 0;
             float step = 2;
             
+            std::vector<float> px, pz, tx, tz, h;
+            auto addPoint = [&](float i, float j){
+                px.push_back(x1y1.x + x1y12.divf(x1y12d/i).x + x12y1.divf(x12y1d/j).x);
+                pz.push_back(x1y1.y + x1y12.divf(x1y12d/i).y + x12y1.divf(x12y1d/j).y);
+                tx.push_back(px.back() + position[0]);
+                tz.push_back(pz.back() + position[2]);
+            };
             for(float i = 0; i <= x1y12d; i+=x1y12d){
                 for(float j = 0; j < x12y1d; j+=step){
                     float jj = j+step;
                     if(jj>x12y1d) jj = x12y1d;          
-
-                    wysokosc = Game::terrainLib->getHeight(x, y, x1y1.x + x1y12.divf(x1y12d/i).x + x12y1.divf(x12y1d/j).x + position[0], ( x1y1.y + x1y12.divf(x1y12d/i).y + x12y1.divf(x12y1d/j).y + position[2]));
-                    points << x1y1.x + x1y12.divf(x1y12d/i).x + x12y1.divf(x12y1d/j).x;
-                    points << wysokosc+0.5f;
-                    points << x1y1.y + x1y12.divf(x1y12d/i).y + x12y1.divf(x12y1d/j).y;
-                    wysokosc = Game::terrainLib->getHeight(x, y, x1y1.x + x1y12.divf(x1y12d/i).x + x12y1.divf(x12y1d/jj).x + position[0], ( x1y1.y + x1y12.divf(x1y12d/i).y + x12y1.divf(x12y1d/jj).y + position[2]));
-                    points << x1y1.x + x1y12.divf(x1y12d/i).x + x12y1.divf(x12y1d/jj).x;
-                    points << wysokosc+0.5f;
-                    points << x1y1.y + x1y12.divf(x1y12d/i).y + x12y1.divf(x12y1d/jj).y;
+                    addPoint(i, j);
+                    addPoint(i, jj);
                 }
             }
             for(float j = 0; j <= x12y1d; j+=x12y1d){
                 for(float i = 0; i < x1y12d; i+=step){
                     float ii = i+step;
                     if(ii>x1y12d) ii = x1y12d;          
-
-                    wysokosc = Game::terrainLib->getHeight(x, y, x1y1.x + x1y12.divf(x1y12d/i).x + x12y1.divf(x12y1d/j).x + position[0], ( x1y1.y + x1y12.divf(x1y12d/i).y + x12y1.divf(x12y1d/j).y + position[2]));
-                    points << x1y1.x + x1y12.divf(x1y12d/i).x + x12y1.divf(x12y1d/j).x;
-                    points << wysokosc+0.5f;
-                    points << x1y1.y + x1y12.divf(x1y12d/i).y + x12y1.divf(x12y1d/j).y;
-                    wysokosc = Game::terrainLib->getHeight(x, y, x1y1.x + x1y12.divf(x1y12d/ii).x + x12y1.divf(x12y1d/j).x + position[0], ( x1y1.y + x1y12.divf(x1y12d/ii).y + x12y1.divf(x12y1d/j).y + position[2]));
-                    points << x1y1.x + x1y12.divf(x1y12d/ii).x + x12y1.divf(x12y1d/j).x;
-                    points << wysokosc+0.5f;
-                    points << x1y1.y + x1y12.divf(x1y12d/ii).y + x12y1.divf(x12y1d/j).y;
+                    addPoint(i, j);
+                    addPoint(ii, j);
                 }
             }
+            
+            Game::terrainLib->getHeights(x, y, tx, tz, h);
+            for(unsigned int i = 0; i < h.size(); i++){
+                points << px[i];
+                points << h[i]+0.5f;
+                points << pz[i];
+            }
             return true;
 }
 
+// Trees are built in tile space around position, drawn with a translation only.
+bool ForestObj::getLocalBound(float* bound){
+    if(!init)
+        return false;
+    return shape.getSimpleBorder(bound);
+}
+
+float* ForestObj::getBoundMatrix(){
+    Mat4::identity(boundMatrix);
+    Mat4::translate(boundMatrix, boundMatrix, position[0], 0, position[2]);
+    return boundMatrix;
+}
+
 int ForestObj::getDefaultDetailLevel(){
     return -11;
 }
@@ -572,5 +613,6 @@ bool ForestObj::allowNew(){
 void ForestObj::deleteVBO(){
     //this->shape.deleteVBO();
     this->init = false;
+    this->boundingSphereValid = false;
     this->box.deleteVBO();
 }
\ No newline at end of file
@@ -49,10 +49,11 @@ public:
     bool allowNew();
     void load(int x, int y);
     void set(int sh, FileBuffer* data);
+    void saveTokens(TokenWriter* out);
     void set(QString sh, long long int val);
     void set(QString sh, float val);
     void set(QString sh, QString val);
-    void set(QString sh, FileBuffer* data);
+    void set(ParserX::Token sh, FileBuffer* data);
     Ref::RefItem* getRefInfo();
     void save(QTextStream* out);
     void deleteVBO();
@@ -67,10 +68,13 @@ public:
 private:
     void drawShape();
     bool getBoxPoints(QVector<float>& points);
+    bool getLocalBound(float* bound);
+    float* getBoundMatrix();
     int tex;
     bool init;
     OglObj shape;
     QString * texturePath = NULL;
+    float boundMatrix[16];
 };
 
 #endif	/* FORESTOBJ_H */
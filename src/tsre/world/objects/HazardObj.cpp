@@ -19,6 +19,7 @@
 #include <tsre/tdb/TDB.h>
 #include <tsre/tdb/TRitem.h>
 #include <tsre/fileFunctions/TS.h>
+#include <tsre/fileFunctions/TokenWriter.h>
 #include <tsre/ogl/TrackItemObj.h>
 #include <tsre/ErrorMessage.h>
 #include <tsre/ErrorMessagesLib.h>
@@ -83,7 +84,7 @@ void HazardObj::getTrackItemIds(QVector<int> &ids, int tdbId){
 }
 
 void HazardObj::load(int x, int y) {
-    this->shape = Game::currentShapeLib->addShape(resPath +"/"+ fileName);
+    loadShape(resPath +"/"+ fileName);
     this->x = x;
     this->y = y;
     this->position[2] = -this->position[2];
@@ -198,7 +199,20 @@ void HazardObj::set(int sh, FileBuffer* data) {
     return;
 }
 
-void HazardObj::set(QString sh, FileBuffer* data) {
+void HazardObj::saveTokens(TokenWriter* out) {
+    out->begin(TS::Hazard);
+    out->putString(TS::FileName, fileName);
+    if(trItemId != NULL){
+        out->begin(TS::TrItemId);
+        out->putUint(trItemId[0]);
+        out->putUint(trItemId[1]);
+        out->end();
+    }
+    saveCommonTokens(out);
+    out->end();
+}
+
+void HazardObj::set(ParserX::Token sh, FileBuffer* data) {
     if (sh == ("filename")) {
         fileName = ParserX::GetString(data);
         return;
@@ -305,6 +319,10 @@ void HazardObj::renderTritems(GLUU* gluu, int selectionColor){
 
 };
 
+bool HazardObj::drawsOutsideBound(){
+    return Game::viewInteractives;
+}
+
 bool HazardObj::getSimpleBorder(float* border){
     if (shape < 0) return false;
     if (!Game::currentShapeLib->shape[shape]->loaded)
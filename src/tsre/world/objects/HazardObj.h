@@ -34,10 +34,12 @@ public:
     void load(int x, int y);
     void set(QString sh, QString val);
     void set(int sh, FileBuffer* data);
-    void set(QString sh, FileBuffer* data);
+    void saveTokens(TokenWriter* out);
+    void set(ParserX::Token sh, FileBuffer* data);
     void save(QTextStream* out);
     int getDefaultDetailLevel();
     void render(GLUU* gluu, float lod, float posx, float posz, float* playerW, float* target, float fov, int selectionColor, int renderMode);
+    bool drawsOutsideBound();
 
 private:
     int trItemIdCount = 0;
@@ -19,6 +19,7 @@
 #include <tsre/Game.h>
 #include <tsre/ogl/TrackItemObj.h>
 #include <tsre/fileFunctions/TS.h>
+#include <tsre/fileFunctions/TokenWriter.h>
 #include <QDebug>
 #include <tsre/ErrorMessagesLib.h>
 #include <tsre/ErrorMessage.h>
@@ -82,7 +83,7 @@ void LevelCrObj::loadingFixes(){
 }
 
 void LevelCrObj::load(int x, int y) {
-    this->shape = Game::currentShapeLib->addShape(resPath +"/"+ fileName);
+    loadShape(resPath +"/"+ fileName);
     this->x = x;
     this->y = y;
     this->position[2] = -this->position[2];
@@ -281,11 +282,47 @@ void LevelCrObj::set(int sh, FileBuffer* data) {
         data->off += slen;
         return;
     }
+    if (sh == TS::TSRE_ORTSSoundFileName) {
+        data->off++;
+        int slen = data->getShort()*2;
+        ORTSSoundFileName = *data->getString(data->off, data->off + slen);
+        data->off += slen;
+        return;
+    }
     WorldObj::set(sh, data);
     return;
 }
 
-void LevelCrObj::set(QString sh, FileBuffer* data) {
+void LevelCrObj::saveTokens(TokenWriter* out) {
+    out->begin(TS::LevelCr);
+    out->begin(TS::LevelCrParameters);
+    out->putFloat(levelCrParameters[0]);
+    out->putFloat(levelCrParameters[1]);
+    out->end();
+    out->putFloat(TS::CrashProbability, crashProbability);
+    out->begin(TS::LevelCrData);
+    out->putUint(levelCrData[0]);
+    out->putUint(levelCrData[1]);
+    out->end();
+    out->begin(TS::LevelCrTiming);
+    out->putFloat(levelCrTiming[0]);
+    out->putFloat(levelCrTiming[1]);
+    out->putFloat(levelCrTiming[2]);
+    out->end();
+    for(int i = 0; i + 1 < trItemIdCount; i += 2){
+        out->begin(TS::TrItemId);
+        out->putUint(trItemId[i]);
+        out->putUint(trItemId[i+1]);
+        out->end();
+    }
+    out->putString(TS::FileName, fileName);
+    if(ORTSSoundFileName.length() > 0)
+        out->putString(TS::TSRE_ORTSSoundFileName, ORTSSoundFileName);
+    saveCommonTokens(out);
+    out->end();
+}
+
+void LevelCrObj::set(ParserX::Token sh, FileBuffer* data) {
     if (sh == ("levelcrparameters")) {
         levelCrParameters[0] = ParserX::GetNumber(data);
         levelCrParameters[1] = ParserX::GetNumber(data);
@@ -478,6 +515,10 @@ void LevelCrObj::deleteSelectedTrItem(){
     }
 }
 
+bool LevelCrObj::drawsOutsideBound(){
+    return Game::viewInteractives;
+}
+
 bool LevelCrObj::getSimpleBorder(float* border){
     if (shape < 0) return false;
     if (!Game::currentShapeLib->shape[shape]->loaded)
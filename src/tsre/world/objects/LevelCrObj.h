@@ -32,7 +32,8 @@ public:
     void load(int x, int y);
     void set(QString sh, QString val);
     void set(int sh, FileBuffer* data);
-    void set(QString sh, FileBuffer* data);
+    void saveTokens(TokenWriter* out);
+    void set(ParserX::Token sh, FileBuffer* data);
     void save(QTextStream* out);
     void setSensitivityActivateLevel(float val);
     void setSensitivityMinimunDistance(float val);
@@ -62,6 +63,7 @@ public:
     void deleteSelectedTrItem();
     void translate(float px, float py, float pz);
     void render(GLUU* gluu, float lod, float posx, float posz, float* playerW, float* target, float fov, int selectionColor, int renderMode);
+    bool drawsOutsideBound();
 private:
     int selectionValue = 0;
     int levelCrParameters[2];
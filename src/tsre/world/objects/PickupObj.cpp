@@ -20,6 +20,7 @@
 #include <tsre/tdb/TRitem.h>
 #include <tsre/ogl/TrackItemObj.h>
 #include <tsre/fileFunctions/TS.h>
+#include <tsre/fileFunctions/TokenWriter.h>
 #include <tsre/ErrorMessagesLib.h>
 #include <tsre/ErrorMessage.h>
 
@@ -56,7 +57,7 @@ PickupObj::~PickupObj() {
 }
 
 void PickupObj::load(int x, int y) {
-    this->shape = Game::currentShapeLib->addShape(resPath +"/"+ fileName);
+    loadShape(resPath +"/"+ fileName);
     this->x = x;
     this->y = y;
     this->position[2] = -this->position[2];
@@ -239,7 +240,38 @@ void PickupObj::set(int sh, FileBuffer* data) {
     return;
 }
 
-void PickupObj::set(QString sh, FileBuffer* data) {
+void PickupObj::saveTokens(TokenWriter* out) {
+    out->begin(TS::Pickup2);
+    out->begin(TS::SpeedRange);
+    out->putFloat(speedRange[0]);
+    out->putFloat(speedRange[1]);
+    out->end();
+    out->begin(TS::PickupType);
+    out->putUint(pickupType[0]);
+    out->putUint(pickupType[1]);
+    out->end();
+    out->begin(TS::PickupAnimData);
+    out->putUint(pickupAnimData1);
+    out->putFloat(pickupAnimData2);
+    out->end();
+    out->begin(TS::PickupCapacity);
+    out->putFloat(pickupCapacity1);
+    out->putFloat(pickupCapacity2);
+    out->end();
+    if(trItemId != NULL && trItemIdCount == 2){
+        out->begin(TS::TrItemId);
+        out->putUint(trItemId[0]);
+        out->putUint(trItemId[1]);
+        out->end();
+    } else if(trItemIdCount != 0) {
+        out->fail("pickup tritemid");
+    }
+    out->putString(TS::FileName, fileName);
+    saveCommonTokens(out);
+    out->end();
+}
+
+void PickupObj::set(ParserX::Token sh, FileBuffer* data) {
     if (sh == ("speedrange")) {
         speedRange[0] = ParserX::GetNumber(data);
         speedRange[1] = ParserX::GetNumber(data);
@@ -368,6 +400,10 @@ void PickupObj::renderTritems(GLUU* gluu, int selectionColor){
 
 };
 
+bool PickupObj::drawsOutsideBound(){
+    return Game::viewInteractives;
+}
+
 bool PickupObj::getSimpleBorder(float* border){
     if (shape < 0) return false;
     if (!Game::currentShapeLib->shape[shape]->loaded)
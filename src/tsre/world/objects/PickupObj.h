@@ -33,8 +33,9 @@ public:
     void initTrItems(float* tpos);
     void load(int x, int y);
     void set(int sh, FileBuffer* data);
+    void saveTokens(TokenWriter* out);
     void set(QString sh, QString val);
-    void set(QString sh, FileBuffer* data);
+    void set(ParserX::Token sh, FileBuffer* data);
     void save(QTextStream* out);
     void setTypeId(int val);
     void setCapacity(float val);
@@ -58,6 +59,7 @@ public:
     bool isBroken();
     int getDefaultDetailLevel();
     void render(GLUU* gluu, float lod, float posx, float posz, float* playerW, float* target, float fov, int selectionColor, int renderMode);
+    bool drawsOutsideBound();
 
 private:
     float speedRange[2];
@@ -21,6 +21,7 @@
 #include <tsre/ogl/TrackItemObj.h>
 #include <tsre/ogl/OglObj.h>
 #include <tsre/fileFunctions/TS.h>
+#include <tsre/fileFunctions/TokenWriter.h>
 #include <math.h>
 #include <QFile>
 #include <tsre/fileFunctions/FileBuffer.h>
@@ -92,7 +93,25 @@ void PlatformObj::set(int sh, FileBuffer* data) {
     return;
 }
 
-void PlatformObj::set(QString sh, FileBuffer* data) {
+void PlatformObj::saveTokens(TokenWriter* out) {
+    if(typeID == siding){
+        out->begin(TS::Siding2);
+        out->putUint(TS::SidingData, platformData);
+    } else {
+        out->begin(TS::Platform);
+        out->putUint(TS::PlatformData, platformData);
+    }
+    for(int i = 0; i + 1 < trItemIdCount; i += 2){
+        out->begin(TS::TrItemId);
+        out->putUint(trItemId[i]);
+        out->putUint(trItemId[i+1]);
+        out->end();
+    }
+    saveCommonTokens(out);
+    out->end();
+}
+
+void PlatformObj::set(ParserX::Token sh, FileBuffer* data) {
     if (sh == ("sidingdata") || sh == ("platformdata")) {
         platformData = ParserX::GetHex(data);
         return;
@@ -28,7 +28,8 @@ public:
     ErrorMessage* checkForErrors();
     bool allowNew();
     void set(int sh, FileBuffer* val);
-    void set(QString sh, FileBuffer* data);
+    void saveTokens(TokenWriter* out);
+    void set(ParserX::Token sh, FileBuffer* data);
     void save(QTextStream* out);
     bool select(int value);
     bool isTrackItem();
@@ -95,7 +95,7 @@ void RulerObj::set(QString sh, QString val){
     return;
 }
 
-void RulerObj::set(QString sh, FileBuffer* data) {
+void RulerObj::set(ParserX::Token sh, FileBuffer* data) {
     if (sh == ("points")) {
         int pointCount = ParserX::GetNumber(data);
         for(int i=0; i< pointCount; i++){
@@ -32,7 +32,7 @@ public:
     void setTemplate(QString name);
     void load(int x, int y);
     void set(QString sh, QString val);
-    void set(QString sh, FileBuffer* data);
+    void set(ParserX::Token sh, FileBuffer* data);
     void setPosition(int x, int z, float* p);
     bool select(int value);
     void save(QTextStream* out);
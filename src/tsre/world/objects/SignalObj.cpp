@@ -22,6 +22,7 @@
 #include <tsre/tdb/SignalShape.h>
 #include <tsre/Game.h>
 #include <tsre/fileFunctions/TS.h>
+#include <tsre/fileFunctions/TokenWriter.h>
 #include <tsre/tdb/TRnode.h>
 #include <tsre/ErrorMessagesLib.h>
 #include <tsre/ErrorMessage.h>
@@ -77,8 +78,7 @@ SignalObj::~SignalObj() {
 }
 
 void SignalObj::load(int x, int y) {
-    this->shape = Game::currentShapeLib->addShape(resPath +"/"+ fileName);
-    this->shapePointer = Game::currentShapeLib->shape[this->shape];
+    loadShape(resPath +"/"+ fileName);
         
     this->x = x;
     this->y = y;
@@ -382,7 +382,33 @@ void SignalObj::set(int sh, FileBuffer* data) {
     return;
 }
 
-void SignalObj::set(QString sh, FileBuffer* data) {
+void SignalObj::saveTokens(TokenWriter* out) {
+    out->begin(TS::Signal);
+    out->putString(TS::FileName, fileName);
+    out->putUint(TS::SignalSubObj, signalSubObj);
+    out->begin(TS::SignalUnits);
+    out->putUint(signalUnits);
+    int count = 0;
+    for(int i = 0; i < 32; i++){
+        if(!signalUnit[i].head)
+            continue;
+        out->begin(TS::SignalUnit);
+        out->putInt(i);
+        out->begin(TS::TrItemId);
+        out->putUint(signalUnit[i].tdbId);
+        out->putUint(signalUnit[i].itemId);
+        out->end();
+        out->end();
+        count++;
+    }
+    out->end();
+    if(count != signalUnits)
+        out->fail("signal units");
+    saveCommonTokens(out);
+    out->end();
+}
+
+void SignalObj::set(ParserX::Token sh, FileBuffer* data) {
     if (sh == ("filename")) {
         fileName = ParserX::GetString(data);
         return;
@@ -837,6 +863,10 @@ bool SignalObj::select(int value){
     return true;
 }
 
+bool SignalObj::drawsOutsideBound(){
+    return Game::viewInteractives;
+}
+
 bool SignalObj::getSimpleBorder(float* border){
     if (shape < 0) return false;
     if (!Game::currentShapeLib->shape[shape]->loaded)
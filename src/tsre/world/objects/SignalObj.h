@@ -36,8 +36,9 @@ public:
     void loadInit();
     void set(QString sh, long long int val);
     void set(int sh, FileBuffer* val);
+    void saveTokens(TokenWriter* out);
     void set(QString sh, QString val);
-    void set(QString sh, FileBuffer* data);
+    void set(ParserX::Token sh, FileBuffer* data);
     void save(QTextStream* out);
     bool select(int value);
     int getTrItemId();
@@ -66,6 +67,7 @@ public:
     void fixFlags();
     bool isSimilar(WorldObj* obj);
     void render(GLUU* gluu, float lod, float posx, float posz, float* playerW, float* target, float fov, int selectionColor, int renderMode);
+    bool drawsOutsideBound();
     int subObjSelected = 0;
 private:
     unsigned int signalSubObj;
@@ -328,7 +328,7 @@ void SoundRegionObj::set(int sh, FileBuffer* data) {
     return;
 }
 
-void SoundRegionObj::set(QString sh, FileBuffer* data) {
+void SoundRegionObj::set(ParserX::Token sh, FileBuffer* data) {
     if (sh == ("filename")) {
         fileName = ParserX::GetString(data);
         return;
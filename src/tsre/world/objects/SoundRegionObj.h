@@ -38,7 +38,7 @@ public:
     void set(QString sh, long long int val);
     void set(int sh, FileBuffer* val);
     void set(QString sh, QString val);
-    void set(QString sh, FileBuffer* data);
+    void set(ParserX::Token sh, FileBuffer* data);
     void save(QTextStream* out);
     void flip(bool flipShape = true);
     bool select(int value);
@@ -103,7 +103,7 @@ void SoundSourceObj::set(int sh, FileBuffer* data) {
     return;
 }
 
-void SoundSourceObj::set(QString sh, FileBuffer* data) {
+void SoundSourceObj::set(ParserX::Token sh, FileBuffer* data) {
     if (sh == ("filename")) {
         fileName = ParserX::GetString(data);
         return;
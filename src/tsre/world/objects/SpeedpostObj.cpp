@@ -19,6 +19,7 @@
 #include <tsre/Game.h>
 #include <tsre/ogl/TrackItemObj.h>
 #include <tsre/fileFunctions/TS.h>
+#include <tsre/fileFunctions/TokenWriter.h>
 #include <tsre/tdb/SpeedPostDAT.h>
 #include <tsre/tdb/SpeedPost.h>
 #include <QDebug>
@@ -112,7 +113,7 @@ void SpeedpostObj::getTrackItemIds(QVector<int> &ids, int tdbId){
 }
 
 void SpeedpostObj::load(int x, int y) {
-    this->shape = Game::currentShapeLib->addShape(resPath +"/"+ fileName);
+    loadShape(resPath +"/"+ fileName);
     this->x = x;
     this->y = y;
     this->position[2] = -this->position[2];
@@ -648,7 +649,33 @@ void SpeedpostObj::set(int sh, FileBuffer* data) {
     return;
 }
 
-void SpeedpostObj::set(QString sh, FileBuffer* data) {
+void SpeedpostObj::saveTokens(TokenWriter* out) {
+    out->begin(TS::Speedpost);
+    out->putString(TS::FileName, fileName);
+    out->putString(TS::Speed_Digit_Tex, speedDigitTex);
+    if(speedSignShape != NULL){
+        out->begin(TS::Speed_Sign_Shape);
+        out->putUint(speedSignShape[0]);
+        for(int i = 0; i < speedSignShape[0]*4; i++)
+            out->putFloat(speedSignShape[i+1]);
+        out->end();
+    }
+    out->begin(TS::Speed_Text_Size);
+    out->putFloat(speedTextSize[0]);
+    out->putFloat(speedTextSize[1]);
+    out->putFloat(speedTextSize[2]);
+    out->end();
+    for(int i = 0; i + 1 < trItemId.size(); i += 2){
+        out->begin(TS::TrItemId);
+        out->putUint(trItemId[i]);
+        out->putUint(trItemId[i+1]);
+        out->end();
+    }
+    saveCommonTokens(out);
+    out->end();
+}
+
+void SpeedpostObj::set(ParserX::Token sh, FileBuffer* data) {
     if (sh == ("filename")) {
         fileName = ParserX::GetString(data);
         return;
@@ -852,6 +879,10 @@ void SpeedpostObj::renderTritems(GLUU* gluu, int selectionColor){
     }
 };
 
+bool SpeedpostObj::drawsOutsideBound(){
+    return Game::viewInteractives;
+}
+
 bool SpeedpostObj::getSimpleBorder(float* border){
     if (shape < 0) return false;
     if (!Game::currentShapeLib->shape[shape]->loaded)
@@ -30,8 +30,9 @@ public:
     void load(int x, int y);
     void set(QString sh, long long int val);
     void set(int sh, FileBuffer* val);
+    void saveTokens(TokenWriter* out);
     void set(QString sh, QString val);
-    void set(QString sh, FileBuffer* data);
+    void set(ParserX::Token sh, FileBuffer* data);
     bool allowNew();
     bool isTrackItem();
     bool containsTrackItem(int tdbId, int id);
@@ -63,6 +64,7 @@ public:
     bool isNumberDot();
     void setNumberDot(bool val);
     void render(GLUU* gluu, float lod, float posx, float posz, float* playerW, float* target, float fov, int selectionColor, int renderMode);
+    bool drawsOutsideBound();
 private:
     int speedPostId = -1;
     int speedPostType = -1;
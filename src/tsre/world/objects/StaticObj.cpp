@@ -15,6 +15,7 @@
 #include <math.h>
 #include <tsre/fileFunctions/ParserX.h>
 #include <tsre/fileFunctions/TS.h>
+#include <tsre/fileFunctions/TokenWriter.h>
 #include <tsre/ogl/TrackItemObj.h>
 #include <QDebug>
 #include <tsre/Game.h>
@@ -79,8 +80,7 @@ ErrorMessage* StaticObj::checkForErrors(){
 }
 
 void StaticObj::load(int x, int y) {
-    this->shape = Game::currentShapeLib->addShape(resPath +"/"+ fileName);
-    this->shapePointer = Game::currentShapeLib->shape[this->shape];
+    loadShape(resPath +"/"+ fileName);
     this->shapeState = shapePointer->newState();
     shapePointer->setAnimated(shapeState, isAnimated());
     this->x = x;
@@ -124,7 +124,19 @@ void StaticObj::set(int sh, FileBuffer* data) {
     return;
 }
 
-void StaticObj::set(QString sh, FileBuffer* data) {
+void StaticObj::saveTokens(TokenWriter* out) {
+    if(typeID == gantry)
+        out->begin(TS::Gantry2);
+    else if(typeID == collideobject)
+        out->begin(TS::CollideObject);
+    else
+        out->begin(TS::Static);
+    out->putString(TS::FileName, fileName);
+    saveCommonTokens(out);
+    out->end();
+}
+
+void StaticObj::set(ParserX::Token sh, FileBuffer* data) {
     if (sh == ("filename")) {
         fileName = ParserX::GetString(data);
         return;
@@ -154,7 +166,8 @@ void StaticObj::pushRenderItems(float lod, float posx, float posz, float* player
     //if((this.position===undefined)||this.qDirection===undefined) return;
     
     if (size > 0) {
-        if ((lod > size + 150)) {
+        // Otherwise Tile skips objects outside the view frustum.
+        if (!Game::frustumCulling && lod > size + 150) {
             float v1[2];
             v1[0] = playerW[0] - (target[0]);
             v1[1] = playerW[2] - (target[2]);
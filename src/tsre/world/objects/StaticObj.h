@@ -25,8 +25,9 @@ public:
     bool allowNew();
     void load(int x, int y);
     void set(int sh, FileBuffer* val);
+    void saveTokens(TokenWriter* out);
     void set(QString sh, QString val);
-    void set(QString sh, FileBuffer* data);
+    void set(ParserX::Token sh, FileBuffer* data);
     void save(QTextStream* out);
     QString getShapePath();
     int getDefaultDetailLevel();
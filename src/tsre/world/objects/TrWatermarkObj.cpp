@@ -14,6 +14,8 @@
 #include <tsre/math3d/GLMatrix.h>
 #include <math.h>
 #include <tsre/fileFunctions/ParserX.h>
+#include <tsre/fileFunctions/TS.h>
+#include <tsre/fileFunctions/TokenWriter.h>
 #include <tsre/Game.h>
 #include <QDebug>
 
@@ -53,10 +55,16 @@ void TrWatermarkObj::load(int x, int y) {
     this->skipLevel = 1;
 }
 
-void TrWatermarkObj::set(QString sh, FileBuffer* data) {
+void TrWatermarkObj::set(ParserX::Token sh, FileBuffer* data) {
     return;
 }
 
+void TrWatermarkObj::saveTokens(TokenWriter* out) {
+    out->begin(TS::Tr_Watermark);
+    out->putInt(dstLevel);
+    out->end();
+}
+
 void TrWatermarkObj::render(GLUU* gluu, float lod, float posx, float posz, float* pos, float* target, float fov, int selectionColor, int renderMode) {
     return;
 };
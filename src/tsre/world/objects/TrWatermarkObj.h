@@ -23,7 +23,8 @@ public:
     WorldObj* clone();
     virtual ~TrWatermarkObj();
     void load(int x, int y);
-    void set(QString sh, FileBuffer* data);
+    void set(ParserX::Token sh, FileBuffer* data);
+    void saveTokens(TokenWriter* out);
     void save(QTextStream* out);
     int getDefaultDetailLevel();
     void render(GLUU* gluu, float lod, float posx, float posz, float* playerW, float* target, float fov, int selectionColor, int renderMode);
@@ -15,6 +15,7 @@
 #include <math.h>
 #include <tsre/fileFunctions/ParserX.h>
 #include <tsre/fileFunctions/TS.h>
+#include <tsre/fileFunctions/TokenWriter.h>
 #include <QDebug>
 #include <tsre/Game.h>
 #include <tsre/tdb/TDB.h>
@@ -83,8 +84,7 @@ void TrackObj::loadingFixes(){
 }
 
 void TrackObj::load(int x, int y) {
-    this->shape = Game::currentShapeLib->addShape(resPath +"/"+ fileName);
-    this->shapePointer = Game::currentShapeLib->shape[this->shape];
+    loadShape(resPath +"/"+ fileName);
     this->x = x;
     this->y = y;
     this->position[2] = -this->position[2];
@@ -247,7 +247,25 @@ void TrackObj::set(int sh, FileBuffer* data) {
     return;
 }
 
-void TrackObj::set(QString sh, FileBuffer* data) {
+void TrackObj::saveTokens(TokenWriter* out) {
+    out->begin(TS::TrackObj);
+    out->putString(TS::FileName, fileName);
+    out->putUint(TS::SectionIdx, sectionIdx);
+    out->putFloat(TS::Elevation, elevation);
+    for(int i = 0; i < jNodePosn.size(); i++){
+        out->begin(TS::JNodePosn);
+        out->putInt(jNodePosn[i][0]);
+        out->putInt(jNodePosn[i][1]);
+        out->putFloat(jNodePosn[i][2]);
+        out->putFloat(jNodePosn[i][3]);
+        out->putFloat(jNodePosn[i][4]);
+        out->end();
+    }
+    saveCommonTokens(out);
+    out->end();
+}
+
+void TrackObj::set(ParserX::Token sh, FileBuffer* data) {
     if (sh == ("filename")) {
         fileName = ParserX::GetString(data);
         return;
@@ -300,7 +318,8 @@ void TrackObj::pushRenderItems(float lod, float posx, float posz, float* playerW
     //if((this.position===undefined)||this.qDirection===undefined) return;
     
     if (size > 0) {
-        if ((lod > size + 150)) {
+        // Otherwise Tile skips objects outside the view frustum.
+        if (!Game::frustumCulling && lod > size + 150) {
             float v1[2];
             v1[0] = playerW[0] - (target[0]);
             v1[1] = playerW[2] - (target[2]);
@@ -31,8 +31,9 @@ public:
     void load(int x, int y);
     void loadInit();
     void set(int sh, FileBuffer* val);
+    void saveTokens(TokenWriter* out);
     void set(QString sh, QString val);
-    void set(QString sh, FileBuffer* data);
+    void set(ParserX::Token sh, FileBuffer* data);
     void set(QString sh, long long int val);
     void rotate(float x, float y, float z);
     Ref::RefItem* getRefInfo();
@@ -14,6 +14,8 @@
 #include <math.h>
 #include <tsre/fileFunctions/ParserX.h>
 #include <QDebug>
+#include <algorithm>
+#include <vector>
 #include <cstdlib>
 #include <tsre/texture/TexLib.h>
 #include <tsre/math3d/Vector2f.h>
@@ -22,7 +24,9 @@
 #include <QOpenGLShaderProgram>
 #include <tsre/Game.h>
 #include <tsre/fileFunctions/TS.h>
+#include <tsre/fileFunctions/TokenWriter.h>
 #include <tsre/world/Ref.h>
+#include <tsre/renderer/FrameScheduler.h>
 
 TransferObj::TransferObj() {
     this->width = 10;
@@ -131,7 +135,16 @@ void TransferObj::set(int sh, FileBuffer* data) {
     return;
 }
 
-void TransferObj::set(QString sh, FileBuffer* data) {
+void TransferObj::saveTokens(TokenWriter* out) {
+    out->begin(TS::Transfer2);
+    out->putString(TS::FileName, texture);
+    out->putFloat(TS::Width, width);
+    out->putFloat(TS::Height, height);
+    saveCommonTokens(out);
+    out->end();
+}
+
+void TransferObj::set(ParserX::Token sh, FileBuffer* data) {
     if (sh == ("filename")) {
         texture = ParserX::GetString(data);
         return;
@@ -162,6 +175,7 @@ Ref::RefItem* TransferObj::getRefInfo(){
 void TransferObj::deleteVBO(){
     //this->shape.deleteVBO();
     this->init = false;
+    this->boundingSphereValid = false;
     this->box.deleteVBO();
 }
 
@@ -249,10 +263,8 @@ void TransferObj::render(GLUU* gluu, float lod, float posx, float posz, float* p
 void TransferObj::drawShape(int selectionColor){
 
     if (!init) {
-        if(!Game::ignoreLoadLimits){
-            if(Game::allowObjLag < 1)  return;
-            Game::allowObjLag-=2;
-        }
+        qint64 buildStart = FrameScheduler::begin(FrameScheduler::Build, this);
+        if(buildStart < 0)  return;
         
             GLUU* gluu = GLUU::get();
             float alpha = -gluu->alphaTest;
@@ -278,69 +290,47 @@ void TransferObj::drawShape(int selectionColor){
             int iloscv = (int)((x12y1d/step)+1)*(int)((x1y12d/step)+1);
             float* punkty = new float[iloscv*54];
             
+            // Cell corners, same float steps as the cells use.
+            std::vector<float> ci, rj;
+            for(float i = 0; i < x1y12d; i+=step)
+                ci.push_back(i);
+            for(float j = 0; j < x12y1d; j+=step)
+                rj.push_back(j);
+            if(ci.size() > 0)
+                ci.push_back(std::min(ci.back()+step, x1y12d));
+            if(rj.size() > 0)
+                rj.push_back(std::min(rj.back()+step, x12y1d));
+            
+            // Every corner is shared by up to six vertices, sample it once.
+            int nc = ci.size();
+            std::vector<float> gx, gz, tx, tz, gh;
+            for(unsigned int b = 0; b < rj.size(); b++)
+                for(int a = 0; a < nc; a++){
+                    gx.push_back(x1y1.x + x1y12.divf(x1y12d/ci[a]).x + x12y1.divf(x12y1d/rj[b]).x);
+                    gz.push_back(x1y1.y + x1y12.divf(x1y12d/ci[a]).y + x12y1.divf(x12y1d/rj[b]).y);
+                    tx.push_back(gx.back() + position[0]);
+                    tz.push_back(gz.back() + position[2]);
+                }
+            Game::terrainLib->getHeights(x, y, tx, tz, gh, addR);
+            
             int ptr = 0;
-            float wysokosc = 0;
-            for(float j = 0; j < x12y1d; j+=step){
-                float jj = j+step;
-                if(jj>x12y1d) jj = x12y1d;
-                for(float i = 0; i < x1y12d; i+=step){
-
-                        float ii = i+step;
-                        if(ii>x1y12d) ii = x1y12d;
-                        
-                        wysokosc = Game::terrainLib->getHeight(x, y, x1y1.x + x1y12.divf(x1y12d/i).x + x12y1.divf(x12y1d/j).x + position[0], ( x1y1.y + x1y12.divf(x1y12d/i).y + x12y1.divf(x12y1d/j).y + position[2]), addR);
-                        punkty[ptr++] = x1y1.x + x1y12.divf(x1y12d/i).x + x12y1.divf(x12y1d/j).x;
-                        punkty[ptr++] = wysokosc+0.05f;
-                        punkty[ptr++] = x1y1.y + x1y12.divf(x1y12d/i).y + x12y1.divf(x12y1d/j).y;
-                        punkty[ptr++] = 0; punkty[ptr++] = 1; punkty[ptr++] = 0;
-                        punkty[ptr++] = j/x12y1d;
-                        punkty[ptr++] = i/x1y12d;
-                        punkty[ptr++] = alpha;
-
-                        wysokosc = Game::terrainLib->getHeight(x, y, x1y1.x + x1y12.divf(x1y12d/ii).x + x12y1.divf(x12y1d/j).x + position[0], ( x1y1.y + x1y12.divf(x1y12d/ii).y + x12y1.divf(x12y1d/j).y + position[2]), addR);
-                        punkty[ptr++] = x1y1.x + x1y12.divf(x1y12d/ii).x + x12y1.divf(x12y1d/j).x;
-                        punkty[ptr++] = wysokosc+0.05f;
-                        punkty[ptr++] = x1y1.y + x1y12.divf(x1y12d/ii).y + x12y1.divf(x12y1d/j).y;
-                        punkty[ptr++] = 0; punkty[ptr++] = 1; punkty[ptr++] = 0;
-                        punkty[ptr++] = j/x12y1d;
-                        punkty[ptr++] = ii/x1y12d;
-                        punkty[ptr++] = alpha;
-                        
-                        wysokosc = Game::terrainLib->getHeight(x, y, x1y1.x + x1y12.divf(x1y12d/ii).x + x12y1.divf(x12y1d/jj).x + position[0], ( x1y1.y + x1y12.divf(x1y12d/ii).y + x12y1.divf(x12y1d/jj).y + position[2]), addR);
-                        punkty[ptr++] = x1y1.x + x1y12.divf(x1y12d/ii).x + x12y1.divf(x12y1d/jj).x;
-                        punkty[ptr++] = wysokosc+0.05f;
-                        punkty[ptr++] = x1y1.y + x1y12.divf(x1y12d/ii).y + x12y1.divf(x12y1d/jj).y;
-                        punkty[ptr++] = 0; punkty[ptr++] = 1; punkty[ptr++] = 0;
-                        punkty[ptr++] = jj/x12y1d;
-                        punkty[ptr++] = ii/x1y12d;
-                        punkty[ptr++] = alpha;
-
-                        wysokosc = Game::terrainLib->getHeight(x, y, x1y1.x + x1y12.divf(x1y12d/i).x + x12y1.divf(x12y1d/j).x + position[0], ( x1y1.y + x1y12.divf(x1y12d/i).y + x12y1.divf(x12y1d/j).y + position[2]), addR);
-                        punkty[ptr++] = x1y1.x + x1y12.divf(x1y12d/i).x + x12y1.divf(x12y1d/j).x;
-                        punkty[ptr++] = wysokosc+0.05f;
-                        punkty[ptr++] = x1y1.y + x1y12.divf(x1y12d/i).y + x12y1.divf(x12y1d/j).y;
-                        punkty[ptr++] = 0; punkty[ptr++] = 1; punkty[ptr++] = 0;
-                        punkty[ptr++] = j/x12y1d;
-                        punkty[ptr++] = i/x1y12d;
-                        punkty[ptr++] = alpha;
-
-                        wysokosc = Game::terrainLib->getHeight(x, y, x1y1.x + x1y12.divf(x1y12d/ii).x + x12y1.divf(x12y1d/jj).x + position[0], ( x1y1.y + x1y12.divf(x1y12d/ii).y + x12y1.divf(x12y1d/jj).y + position[2]), addR);
-                        punkty[ptr++] = x1y1.x + x1y12.divf(x1y12d/ii).x + x12y1.divf(x12y1d/jj).x;
-                        punkty[ptr++] = wysokosc+0.05f;
-                        punkty[ptr++] = x1y1.y + x1y12.divf(x1y12d/ii).y + x12y1.divf(x12y1d/jj).y;
-                        punkty[ptr++] = 0; punkty[ptr++] = 1; punkty[ptr++] = 0;
-                        punkty[ptr++] = jj/x12y1d;
-                        punkty[ptr++] = ii/x1y12d;
-                        punkty[ptr++] = alpha;
-                        
-                        wysokosc = Game::terrainLib->getHeight(x, y, x1y1.x + x1y12.divf(x1y12d/i).x + x12y1.divf(x12y1d/jj).x + position[0], ( x1y1.y + x1y12.divf(x1y12d/i).y + x12y1.divf(x12y1d/jj).y + position[2]), addR);
-                        punkty[ptr++] = x1y1.x + x1y12.divf(x1y12d/i).x + x12y1.divf(x12y1d/jj).x;
-                        punkty[ptr++] = wysokosc+0.05f;
-                        punkty[ptr++] = x1y1.y + x1y12.divf(x1y12d/i).y + x12y1.divf(x12y1d/jj).y;
-                        punkty[ptr++] = 0; punkty[ptr++] = 1; punkty[ptr++] = 0;
-                        punkty[ptr++] = jj/x12y1d;
-                        punkty[ptr++] = i/x1y12d;
-                        punkty[ptr++] = alpha;
+            auto vertex = [&](int a, int b){
+                punkty[ptr++] = gx[b*nc + a];
+                punkty[ptr++] = gh[b*nc + a]+0.05f;
+                punkty[ptr++] = gz[b*nc + a];
+                punkty[ptr++] = 0; punkty[ptr++] = 1; punkty[ptr++] = 0;
+                punkty[ptr++] = rj[b]/x12y1d;
+                punkty[ptr++] = ci[a]/x1y12d;
+                punkty[ptr++] = alpha;
+            };
+            for(int b = 0; b + 1 < (int)rj.size(); b++){
+                for(int a = 0; a + 1 < nc; a++){
+                    vertex(a, b);
+                    vertex(a+1, b);
+                    vertex(a+1, b+1);
+                    vertex(a, b);
+                    vertex(a+1, b+1);
+                    vertex(a, b+1);
                 }
             }
             
@@ -361,6 +351,7 @@ void TransferObj::drawShape(int selectionColor){
         shape.init(punkty, ptr, RenderItem::VNTA, GL_TRIANGLES);
         delete[] punkty;
         init = true;
+        FrameScheduler::end(FrameScheduler::Build, buildStart);
     }
     
     shape.render(selectionColor);
@@ -379,39 +370,38 @@ bool TransferObj::getBoxPoints(QVector<float>& points){
             Vector2f x12y1 = x2y1.subv(x1y1);
             float x1y12d = x1y12.getDlugosc();
             float x12y1d = x12y1.getDlugosc();
-            float wysokosc = 0;
             float step = 2;
             
+            std::vector<float> px, pz, tx, tz, h;
+            auto addPoint = [&](float i, float j){
+                px.push_back(x1y1.x + x1y12.divf(x1y12d/i).x + x12y1.divf(x12y1d/j).x);
+                pz.push_back(x1y1.y + x1y12.divf(x1y12d/i).y + x12y1.divf(x12y1d/j).y);
+                tx.push_back(px.back() + position[0]);
+                tz.push_back(pz.back() + position[2]);
+            };
             for(float i = 0; i <= x1y12d; i+=x1y12d){
                 for(float j = 0; j < x12y1d; j+=step){
                     float jj = j+step;
                     if(jj>x12y1d) jj = x12y1d;          
-
-                    wysokosc = Game::terrainLib->getHeight(x, y, x1y1.x + x1y12.divf(x1y12d/i).x + x12y1.divf(x12y1d/j).x + position[0], ( x1y1.y + x1y12.divf(x1y12d/i).y + x12y1.divf(x12y1d/j).y + position[2]));
-                    points << x1y1.x + x1y12.divf(x1y12d/i).x + x12y1.divf(x12y1d/j).x;
-                    points << wysokosc+0.5f;
-                    points << x1y1.y + x1y12.divf(x1y12d/i).y + x12y1.divf(x12y1d/j).y;
-                    wysokosc = Game::terrainLib->getHeight(x, y, x1y1.x + x1y12.divf(x1y12d/i).x + x12y1.divf(x12y1d/jj).x + position[0], ( x1y1.y + x1y12.divf(x1y12d/i).y + x12y1.divf(x12y1d/jj).y + position[2]));
-                    points << x1y1.x + x1y12.divf(x1y12d/i).x + x12y1.divf(x12y1d/jj).x;
-                    points << wysokosc+0.5f;
-                    points << x1y1.y + x1y12.divf(x1y12d/i).y + x12y1.divf(x12y1d/jj).y;
+                    addPoint(i, j);
+                    addPoint(i, jj);
                 }
             }
             for(float j = 0; j <= x12y1d; j+=x12y1d){
                 for(float i = 0; i < x1y12d; i+=step){
                     float ii = i+step;
                     if(ii>x1y12d) ii = x1y12d;          
-
-                    wysokosc = Game::terrainLib->getHeight(x, y, x1y1.x + x1y12.divf(x1y12d/i).x + x12y1.divf(x12y1d/j).x + position[0], ( x1y1.y + x1y12.divf(x1y12d/i).y + x12y1.divf(x12y1d/j).y + position[2]));
-                    points << x1y1.x + x1y12.divf(x1y12d/i).x + x12y1.divf(x12y1d/j).x;
-                    points << wysokosc+0.5f;
-                    points << x1y1.y + x1y12.divf(x1y12d/i).y + x12y1.divf(x12y1d/j).y;
-                    wysokosc = Game::terrainLib->getHeight(x, y, x1y1.x + x1y12.divf(x1y12d/ii).x + x12y1.divf(x12y1d/j).x + position[0], ( x1y1.y + x1y12.divf(x1y12d/ii).y + x12y1.divf(x12y1d/j).y + position[2]));
-                    points << x1y1.x + x1y12.divf(x1y12d/ii).x + x12y1.divf(x12y1d/j).x;
-                    points << wysokosc+0.5f;
-                    points << x1y1.y + x1y12.divf(x1y12d/ii).y + x12y1.divf(x12y1d/j).y;
+                    addPoint(i, j);
+                    addPoint(ii, j);
                 }
             }
+            
+            Game::terrainLib->getHeights(x, y, tx, tz, h);
+            for(unsigned int i = 0; i < h.size(); i++){
+                points << px[i];
+                points << h[i]+0.5f;
+                points << pz[i];
+            }
             return true;
 }
 
@@ -419,6 +409,19 @@ int TransferObj::getTexId(){
     return this->shape.getTexId();
 }
 
+// The transfer is built in tile space around position, drawn with a translation only.
+bool TransferObj::getLocalBound(float* bound){
+    if(!init)
+        return false;
+    return shape.getSimpleBorder(bound);
+}
+
+float* TransferObj::getBoundMatrix(){
+    Mat4::identity(boundMatrix);
+    Mat4::translate(boundMatrix, boundMatrix, position[0], 0, position[2]);
+    return boundMatrix;
+}
+
 int TransferObj::getDefaultDetailLevel(){
     return -1;
 }
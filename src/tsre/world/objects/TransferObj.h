@@ -35,10 +35,11 @@ public:
     bool allowNew();
     void load(int x, int y);
     void set(int sh, FileBuffer* val);
+    void saveTokens(TokenWriter* out);
     void set(QString sh, QString val);
     void set(QString sh, float val);
     void set(QString sh, long long int val);
-    void set(QString sh, FileBuffer* data);
+    void set(ParserX::Token sh, FileBuffer* data);
     void save(QTextStream* out);
     void deleteVBO();
     int getTexId();
@@ -55,6 +56,9 @@ private:
     float bound[6];
     QString *texturePath;
     bool getBoxPoints(QVector<float> &points);
+    bool getLocalBound(float* bound);
+    float* getBoundMatrix();
+    float boundMatrix[16];
 };
 
 #endif	/* TRANSFEROBJ_H */
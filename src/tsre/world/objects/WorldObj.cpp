@@ -33,10 +33,12 @@
 #include <tsre/world/objects/CarSpawnerObj.h>
 #include <tsre/Game.h>
 #include <tsre/fileFunctions/TS.h>
+#include <tsre/fileFunctions/TokenWriter.h>
 #include <tsre/world/TerrainLib.h>
 #include <routeEditor/RouteEditorClient.h>
 #include <tsre/world/Route.h>
 #include <tsre/world/Trk.h>
+#include <tsre/world/Tile.h>
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -50,6 +52,8 @@ void WorldObj::loadingFixes(){
 
 void WorldObj::setModified(bool val){
     modified = val;
+    if(val)
+        Tile::MarkDirty(x, y);
     
     if(Game::serverClient != NULL){
         if(val){
@@ -177,90 +181,132 @@ WorldObj* WorldObj::createObj(int sh) {
     return nowy;
 }
 
-WorldObj* WorldObj::createObj(QString sh) {
+WorldObj* WorldObj::createObj(ParserX::Token sh) {
+    // Same order as the cases below.
+    enum {
+        Static, Signal, Speedpost, Trackobj, Gantry, Collideobject,
+        Dyntrack, Forest, Transfer, Platform, Siding, Carspawner,
+        Levelcr, Pickup, Hazard, Soundsource, Soundregion, Ruler
+    };
+    static ParserX::Keywords types({
+        "static", "signal", "speedpost", "trackobj", "gantry", "collideobject",
+        "dyntrack", "forest", "transfer", "platform", "siding", "carspawner",
+        "levelcr", "pickup", "hazard", "soundsource", "soundregion", "ruler"
+    });
     WorldObj* nowy;
-    if (sh == "static") {
-        nowy = (WorldObj*) (new StaticObj());
-        (nowy)->resPath = Game::root + "/routes/" + Game::route + "/shapes";
-        (nowy)->typeID = (nowy)->sstatic;
-    } else if (sh == "signal") {
-        nowy = (WorldObj*) (new SignalObj());
-        (nowy)->resPath = Game::root + "/routes/" + Game::route + "/shapes";
-        (nowy)->typeID = (nowy)->signal;
-    } else if (sh == "speedpost") {
-        nowy = (WorldObj*) (new SpeedpostObj());
-        (nowy)->resPath = Game::root + "/routes/" + Game::route + "/shapes";
-        (nowy)->typeID = (nowy)->speedpost;
-    } else if (sh == "trackobj") {
-        nowy = (WorldObj*) (new TrackObj());
-        (nowy)->resPath = Game::root + "/global/shapes";
-        (nowy)->typeID = (nowy)->trackobj;
-    } else if (sh == "gantry") {
-        nowy = (WorldObj*) (new StaticObj());
-        (nowy)->resPath = Game::root + "/routes/" + Game::route + "/shapes";
-        (nowy)->typeID = (nowy)->gantry;
-    } else if (sh == "collideobject") {
-        nowy = (WorldObj*) (new StaticObj());
-        (nowy)->resPath = Game::root + "/routes/" + Game::route + "/shapes";    
-        (nowy)->typeID = (nowy)->collideobject;
-    } else if (sh == "dyntrack") {
-        nowy = (WorldObj*) (new DynTrackObj());
-        (nowy)->resPath = Game::root + "/routes/" + Game::route + "/textures";
-        (nowy)->typeID = (nowy)->dyntrack;
-    } else if (sh == "forest") {
-        nowy = (WorldObj*) (new ForestObj());
-        (nowy)->resPath = Game::root + "/routes/" + Game::route + "/textures";
-        (nowy)->typeID = (nowy)->forest;
-    } else if (sh == "transfer") {
-        nowy = (WorldObj*) (new TransferObj());
-        (nowy)->resPath = Game::root + "/routes/" + Game::route + "/textures";
-        (nowy)->typeID = (nowy)->transfer;
-    } else if (sh == "platform") {
-        nowy = (WorldObj*) (new PlatformObj());
-        (nowy)->resPath = Game::root + "/routes/" + Game::route + "/shapes";
-        (nowy)->typeID = (nowy)->platform;
-    } else if (sh == "siding") {
-        nowy = (WorldObj*) (new PlatformObj());
-        (nowy)->resPath = Game::root + "/routes/" + Game::route + "/shapes";       
-        (nowy)->typeID = (nowy)->siding;
-    } else if (sh == "carspawner") {
-        nowy = (WorldObj*) (new CarSpawnerObj());
-        (nowy)->resPath = Game::root + "/routes/" + Game::route + "/shapes";     
-        (nowy)->typeID = (nowy)->carspawner;
-    } else if (sh == "levelcr") {
-        nowy = (WorldObj*) (new LevelCrObj());
-        (nowy)->resPath = Game::root + "/routes/" + Game::route + "/shapes";   
-        (nowy)->typeID = (nowy)->levelcr;
-    } else if (sh == "pickup") {
-        nowy = (WorldObj*) (new PickupObj());
-        (nowy)->resPath = Game::root + "/routes/" + Game::route + "/shapes";       
-        (nowy)->typeID = (nowy)->pickup;
-    } else if (sh == "hazard") {
-        nowy = (WorldObj*) (new HazardObj());
-        (nowy)->resPath = Game::root + "/routes/" + Game::route + "/shapes";    
-        (nowy)->typeID = (nowy)->hazard;
-    } else if (sh == "soundsource") {
-        nowy = (WorldObj*) (new SoundSourceObj());
-        (nowy)->resPath = Game::root + "/routes/" + Game::route + "/shapes";    
-        (nowy)->typeID = (nowy)->soundsource;
-    } else if (sh == "soundregion") {
-        nowy = (WorldObj*) (new SoundRegionObj());
-        (nowy)->resPath = Game::root + "/routes/" + Game::route + "/shapes";    
-        (nowy)->typeID = (nowy)->soundregion;
-    } else if (sh == "ruler") {
-        nowy = (WorldObj*) (new RulerObj());
-        (nowy)->resPath = Game::root + "/routes/" + Game::route + "/shapes";    
-        (nowy)->typeID = (nowy)->ruler;
-    } else {
-        qDebug() << " Unsupported WorldObj !!! " + sh;
-        //(*nowy) = new WorldObj();
-        return NULL;
-        //
+    switch (types.find(sh)) {
+        case Static:
+            nowy = (WorldObj*) (new StaticObj());
+            (nowy)->resPath = Game::root + "/routes/" + Game::route + "/shapes";
+            (nowy)->typeID = (nowy)->sstatic;
+            break;
+        case Signal:
+            nowy = (WorldObj*) (new SignalObj());
+            (nowy)->resPath = Game::root + "/routes/" + Game::route + "/shapes";
+            (nowy)->typeID = (nowy)->signal;
+            break;
+        case Speedpost:
+            nowy = (WorldObj*) (new SpeedpostObj());
+            (nowy)->resPath = Game::root + "/routes/" + Game::route + "/shapes";
+            (nowy)->typeID = (nowy)->speedpost;
+            break;
+        case Trackobj:
+            nowy = (WorldObj*) (new TrackObj());
+            (nowy)->resPath = Game::root + "/global/shapes";
+            (nowy)->typeID = (nowy)->trackobj;
+            break;
+        case Gantry:
+            nowy = (WorldObj*) (new StaticObj());
+            (nowy)->resPath = Game::root + "/routes/" + Game::route + "/shapes";
+            (nowy)->typeID = (nowy)->gantry;
+            break;
+        case Collideobject:
+            nowy = (WorldObj*) (new StaticObj());
+            (nowy)->resPath = Game::root + "/routes/" + Game::route + "/shapes";
+            (nowy)->typeID = (nowy)->collideobject;
+            break;
+        case Dyntrack:
+            nowy = (WorldObj*) (new DynTrackObj());
+            (nowy)->resPath = Game::root + "/routes/" + Game::route + "/textures";
+            (nowy)->typeID = (nowy)->dyntrack;
+            break;
+        case Forest:
+            nowy = (WorldObj*) (new ForestObj());
+            (nowy)->resPath = Game::root + "/routes/" + Game::route + "/textures";
+            (nowy)->typeID = (nowy)->forest;
+            break;
+        case Transfer:
+            nowy = (WorldObj*) (new TransferObj());
+            (nowy)->resPath = Game::root + "/routes/" + Game::route + "/textures";
+            (nowy)->typeID = (nowy)->transfer;
+            break;
+        case Platform:
+            nowy = (WorldObj*) (new PlatformObj());
+            (nowy)->resPath = Game::root + "/routes/" + Game::route + "/shapes";
+            (nowy)->typeID = (nowy)->platform;
+            break;
+        case Siding:
+            nowy = (WorldObj*) (new PlatformObj());
+            (nowy)->resPath = Game::root + "/routes/" + Game::route + "/shapes";
+            (nowy)->typeID = (nowy)->siding;
+            break;
+        case Carspawner:
+            nowy = (WorldObj*) (new CarSpawnerObj());
+            (nowy)->resPath = Game::root + "/routes/" + Game::route + "/shapes";
+            (nowy)->typeID = (nowy)->carspawner;
+            break;
+        case Levelcr:
+            nowy = (WorldObj*) (new LevelCrObj());
+            (nowy)->resPath = Game::root + "/routes/" + Game::route + "/shapes";
+            (nowy)->typeID = (nowy)->levelcr;
+            break;
+        case Pickup:
+            nowy = (WorldObj*) (new PickupObj());
+            (nowy)->resPath = Game::root + "/routes/" + Game::route + "/shapes";
+            (nowy)->typeID = (nowy)->pickup;
+            break;
+        case Hazard:
+            nowy = (WorldObj*) (new HazardObj());
+            (nowy)->resPath = Game::root + "/routes/" + Game::route + "/shapes";
+            (nowy)->typeID = (nowy)->hazard;
+            break;
+        case Soundsource:
+            nowy = (WorldObj*) (new SoundSourceObj());
+            (nowy)->resPath = Game::root + "/routes/" + Game::route + "/shapes";
+            (nowy)->typeID = (nowy)->soundsource;
+            break;
+        case Soundregion:
+            nowy = (WorldObj*) (new SoundRegionObj());
+            (nowy)->resPath = Game::root + "/routes/" + Game::route + "/shapes";
+            (nowy)->typeID = (nowy)->soundregion;
+            break;
+        case Ruler:
+            nowy = (WorldObj*) (new RulerObj());
+            (nowy)->resPath = Game::root + "/routes/" + Game::route + "/shapes";
+            (nowy)->typeID = (nowy)->ruler;
+            break;
+        default:
+            qDebug() << " Unsupported WorldObj !!! " << sh;
+            return NULL;
     }
-    (nowy)->type = sh;
+    (nowy)->type = sh.toString();
     return nowy;
 }
 
+WorldObj* WorldObj::createObj(QString sh) {
+    // Names are matched exactly here, only the Token version ignores case.
+    for (int i = 0; i < sh.length(); i++) {
+        if (sh[i].isUpper()) {
+            qDebug() << " Unsupported WorldObj !!! " + sh;
+            return NULL;
+        }
+    }
+    ParserX::Token token;
+    token.text = (const unsigned short*)sh.utf16();
+    token.length = sh.length();
+    return createObj(token);
+}
+
 QString WorldObj::getResPath(Ref::RefItem* sh) {
     if (sh->type == "static") {
         return Game::root + "/routes/" + Game::route + "/shapes/"+sh->getShapeName();
@@ -312,6 +358,7 @@ WorldObj::WorldObj(const WorldObj& o) {
     y = o.y;
     shape = o.shape;
     shapePointer = o.shapePointer;
+    ShapeLib::addRef(shapePointer);
     loaded = o.loaded;
     size = o.size;
     jestPQ = o.jestPQ;
@@ -337,6 +384,18 @@ WorldObj* WorldObj::clone(){
 }
 
 WorldObj::~WorldObj() {
+    ShapeLib::delRef(shapePointer);
+}
+
+/*
+ * Keeps the reference ShapeLib::addShape adds for this object,
+ * the shape loaded before is released.
+ */
+void WorldObj::loadShape(QString path){
+    SFile* old = shapePointer;
+    shape = Game::currentShapeLib->addShape(path);
+    shapePointer = Game::currentShapeLib->shape[shape];
+    ShapeLib::delRef(old);
 }
 
 bool WorldObj::allowNew(){
@@ -494,11 +553,18 @@ void WorldObj::set(int sh, FileBuffer* data) {
         // 4byte undefined data
         return;
     }
+    if (sh == TS::TSRE_ShapeTemplate) {
+        data->off++;
+        int slen = data->getShort()*2;
+        templateName = *data->getString(data->off, data->off + slen);
+        data->off += slen;
+        return;
+    }
     qDebug() << "worldObj "<<this->type<<" unknown: " << sh;
     return;
 }
 
-void WorldObj::set(QString sh, FileBuffer* data) {
+void WorldObj::set(ParserX::Token sh, FileBuffer* data) {
     if (sh == ("uid")) {
         UiD = ParserX::GetUInt(data);
         return;
@@ -613,6 +679,81 @@ void WorldObj::loadSnapablePoints(){
 void WorldObj::setMartix(){
     Mat4::fromRotationTranslation(this->matrix, qDirection, position);
     Mat4::rotate(this->matrix, this->matrix, M_PI, 0, -1, 0);
+    boundingSphereValid = false;
+}
+
+/*
+ * Box in SFile::bound order: max x, min x, max y, min y, max z, min z,
+ * in the space of getBoundMatrix(). By default the box of the shape.
+ * Objects that draw their shape away from the matrix, or have no box,
+ * return false and are never frustum culled.
+ */
+bool WorldObj::getLocalBound(float* bound){
+    if (shapePointer == NULL) return false;
+    return shapePointer->getBound(bound);
+}
+
+bool WorldObj::getLocalRayIntersection(float* origin, float* dir, float &t){
+    if (shapePointer == NULL) return false;
+    return shapePointer->intersectRay(origin, dir, t);
+}
+
+/*
+ * Matrix the geometry is drawn with. Objects that draw with their own
+ * transform instead of matrix return it here.
+ */
+float* WorldObj::getBoundMatrix(){
+    return matrix;
+}
+
+/*
+ * True if the object draws something outside of getLocalBound(),
+ * such objects are drawn even if the bounding sphere is not visible.
+ */
+bool WorldObj::drawsOutsideBound(){
+    return false;
+}
+
+/*
+ * Ray in tile space against the object geometry.
+ * t is in units of dir, false if the object has no CPU side geometry.
+ */
+bool WorldObj::getRayIntersection(float* origin, float* dir, float &t){
+    float inv[16];
+    if(Mat4::invert(inv, getBoundMatrix()) == NULL)
+        return false;
+    float o[3], d[3];
+    Vec3::transformMat4(o, origin, inv);
+    for(int i = 0; i < 3; i++)
+        d[i] = inv[i]*dir[0] + inv[4+i]*dir[1] + inv[8+i]*dir[2];
+    return getLocalRayIntersection(o, d, t);
+}
+
+float* WorldObj::getBoundingSphere(){
+    if(boundingSphereValid && boundingSphereShape == shape)
+        return boundingSphere;
+    float bound[6];
+    if(!getLocalBound(bound))
+        return NULL;
+    float* m = getBoundMatrix();
+    float center[3];
+    center[0] = (bound[0] + bound[1])*0.5;
+    center[1] = (bound[2] + bound[3])*0.5;
+    center[2] = (bound[4] + bound[5])*0.5;
+    Vec3::transformMat4(boundingSphere, center, m);
+    float scale = 0;
+    for(int i = 0; i < 3; i++){
+        float s = sqrt(m[i*4]*m[i*4] + m[i*4+1]*m[i*4+1] + m[i*4+2]*m[i*4+2]);
+        if(s > scale)
+            scale = s;
+    }
+    float dx = bound[0] - bound[1];
+    float dy = bound[2] - bound[3];
+    float dz = bound[4] - bound[5];
+    boundingSphere[3] = 0.5*sqrt(dx*dx + dy*dy + dz*dz)*scale;
+    boundingSphereValid = true;
+    boundingSphereShape = shape;
+    return boundingSphere;
 }
 
 void WorldObj::flip(bool flipShape){
@@ -743,6 +884,45 @@ void WorldObj::save(QTextStream* out){
     
 }
 
+/*
+ * Object as read by set(), in binary .w token layout.
+ */
+void WorldObj::saveTokens(TokenWriter* out){
+    out->fail(type);
+}
+
+void WorldObj::saveCommonTokens(TokenWriter* out){
+    out->putUint(TS::UiD, UiD);
+    if(staticFlags != 0)
+        out->putUint(TS::StaticFlags, staticFlags);
+    out->begin(TS::Position);
+    out->putFloat(position[0]);
+    out->putFloat(position[1]);
+    out->putFloat(position[2]);
+    out->end();
+    if(matrix3x3 != NULL){
+        out->begin(TS::Matrix3x3);
+        for(int i = 0; i < 9; i++)
+            out->putFloat(matrix3x3[i]);
+        out->end();
+    }
+    out->begin(TS::QDirection);
+    out->putFloat(qDirection[0]);
+    out->putFloat(qDirection[1]);
+    out->putFloat(qDirection[2]);
+    out->putFloat(qDirection[3]);
+    out->end();
+    out->putUint(TS::VDbId, vDbId);
+    if(staticDetailLevel != -1)
+        out->putUint(TS::StaticDetailLevel, staticDetailLevel);
+    if(collideFlags != 0)
+        out->putUint(TS::CollideFlags, collideFlags);
+    if(collideFunction != 0)
+        out->putUint(TS::CollideFunction, collideFunction);
+    if(templateName != "DEFAULT")
+        out->putString(TS::TSRE_ShapeTemplate, templateName);
+}
+
 Ref::RefItem* WorldObj::getRefInfo(){
     Ref::RefItem* r = new Ref::RefItem();
     r->type = this->type;
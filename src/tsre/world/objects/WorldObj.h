@@ -15,6 +15,7 @@
 #include <QString>
 #include <tsre/ogl/GLUU.h>
 #include <tsre/fileFunctions/FileBuffer.h>
+#include <tsre/fileFunctions/ParserX.h>
 #include <tsre/ogl/OglObj.h>
 #include <tsre/world/Ref.h>
 #include <QHash>
@@ -22,6 +23,7 @@
 class SFile;
 class TrackItemObj;
 class ErrorMessage;
+class TokenWriter;
 
 class WorldObj : public GameObj {
 public:
@@ -59,6 +61,7 @@ public:
     
     static WorldObj* createObj(int sh);
     static WorldObj* createObj(QString sh);
+    static WorldObj* createObj(ParserX::Token sh);
     static QString getResPath(Ref::RefItem* sh);
     static int isTrackObj(QString sh);
     static TrackItemObj* pointer3d;
@@ -104,11 +107,13 @@ public:
     virtual void loadInit();
     virtual ErrorMessage* checkForErrors();
     virtual void set(int sh, FileBuffer* data);
-    virtual void set(QString sh, FileBuffer* data);
+    virtual void set(ParserX::Token sh, FileBuffer* data);
     virtual void set(QString sh, QString val);
     virtual void set(QString sh, float* val);
     virtual void set(QString sh, long long int val);
     virtual void save(QTextStream* out);
+    virtual void saveTokens(TokenWriter* out);
+    void saveCommonTokens(TokenWriter* out);
     virtual void setPosition(float* p);
     virtual void setPosition(int x, int z, float* p);
     virtual void initPQ(float* p, float* q);
@@ -173,13 +178,24 @@ public:
     virtual int updateTrackSectionInfo(QHash<unsigned int, unsigned int> shapes, QHash<unsigned int, unsigned int> sections);
     virtual void pushRenderItems(float lod, float posx, float posz, float* playerW, float* target, float fov, int selectionColor);
     virtual void render(GLUU* gluu, float lod, float posx, float posz, float* playerW, float* target, float fov, int selectionColor, int renderMode);
+    float* getBoundingSphere();
+    bool getRayIntersection(float* origin, float* dir, float &t);
+    virtual bool drawsOutsideBound();
 protected:
+    virtual bool getLocalBound(float* bound);
+    virtual bool getLocalRayIntersection(float* origin, float* dir, float &t);
+    virtual float* getBoundMatrix();
     virtual void loadSnapablePoints();
     virtual bool getSimpleBorder(float* border);
     virtual bool getBoxPoints(QVector<float> &points);
+    void loadShape(QString path);
     float* matrix3x3 = NULL;
     QString templateName = "DEFAULT";
     bool internalLodControl = false;
+    // Tile space center and radius, built from getLocalBound and getBoundMatrix.
+    float boundingSphere[4];
+    bool boundingSphereValid = false;
+    int boundingSphereShape = -1;
 };
 
 #endif	/* WORLDOBJ_H */
@@ -0,0 +1,218 @@
+/*  This file is part of TSRE5.
+ *
+ *  TSRE5 - train sim game engine and MSTS/OR Editors.
+ *  Copyright (C) 2016 Piotr Gadecki <pgadecki@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *
+ *  See LICENSE.md or https://www.gnu.org/licenses/gpl.html
+ */
+
+#include <tsre/math3d/BVH.h>
+#include <tsre/math3d/Intersections.h>
+#include <tsre/math3d/GLMatrix.h>
+#include "TestUtil.h"
+#include <vector>
+#include <algorithm>
+#include <math.h>
+
+/*
+ * The math used by CPU picking, without GL: BVH queries against brute
+ * force over the same boxes, before and after refit(), ray-triangle hits
+ * and Mat4::invert().
+ */
+
+static void randomBoxes(std::vector<float> &boxes, int count){
+    boxes.resize(count*6);
+    for(int i = 0; i < count; i++){
+        for(int j = 0; j < 3; j++){
+            float c = TestUtil::randomFloat(-1000, 1000);
+            float r = TestUtil::randomFloat(0.1, 20);
+            boxes[i*6+j] = c - r;
+            boxes[i*6+j+3] = c + r;
+        }
+    }
+}
+
+static void randomRay(float* origin, float* dir){
+    for(int j = 0; j < 3; j++){
+        origin[j] = TestUtil::randomFloat(-1200, 1200);
+        dir[j] = TestUtil::randomFloat(-1, 1);
+    }
+    // Axis aligned rays too, they give infinite inverse directions.
+    if(TestUtil::randomFloat(0, 1) < 0.2){
+        dir[0] = dir[2] = 0;
+        dir[1] = -1;
+    }
+}
+
+static void checkQueries(const BVH &bvh, const std::vector<float> &boxes){
+    int count = boxes.size()/6;
+    for(int r = 0; r < 200; r++){
+        float origin[3], dir[3];
+        randomRay(origin, dir);
+        float invDir[3];
+        for(int j = 0; j < 3; j++)
+            invDir[j] = 1.0/dir[j];
+        float maxT = TestUtil::randomFloat(100, 5000);
+
+        std::vector<int> expected;
+        float t;
+        for(int i = 0; i < count; i++)
+            if(BVH::rayBox(origin, invDir, &boxes[i*6], maxT, t))
+                expected.push_back(i);
+        std::vector<BVH::Hit> hits;
+        bvh.intersectRay(origin, dir, maxT, hits);
+        std::vector<int> found;
+        for(unsigned int i = 0; i < hits.size(); i++){
+            found.push_back(hits[i].id);
+            if(i > 0)
+                TestUtil::check(hits[i-1].t <= hits[i].t, "intersectRay order");
+        }
+        std::sort(found.begin(), found.end());
+        TestUtil::check(found == expected, "intersectRay");
+
+        float box[6];
+        for(int j = 0; j < 3; j++){
+            box[j] = origin[j] - 100;
+            box[j+3] = origin[j] + 100;
+        }
+        expected.clear();
+        for(int i = 0; i < count; i++)
+            if(BVH::boxBox(box, &boxes[i*6]))
+                expected.push_back(i);
+        bvh.intersectBox(box, found);
+        std::sort(found.begin(), found.end());
+        TestUtil::check(found == expected, "intersectBox");
+    }
+}
+
+static void checkBVH(){
+    const int counts[] = { 0, 1, 3, 4, 5, 100, 5000 };
+    for(int c = 0; c < 7; c++){
+        std::vector<float> boxes;
+        randomBoxes(boxes, counts[c]);
+        BVH bvh;
+        bvh.build(boxes.data(), counts[c]);
+        TestUtil::check(bvh.size() == counts[c], "size");
+        checkQueries(bvh, boxes);
+
+        for(unsigned int i = 0; i < boxes.size(); i += 6){
+            float d = TestUtil::randomFloat(-50, 50);
+            for(int j = 0; j < 6; j++)
+                boxes[i+j] += d;
+        }
+        bvh.refit(boxes.data());
+        checkQueries(bvh, boxes);
+    }
+
+    // Same centers, the split has to stop.
+    std::vector<float> same(64*6, 1.0);
+    for(unsigned int i = 0; i < same.size(); i += 6)
+        same[i+3] = same[i+4] = same[i+5] = 2.0;
+    BVH bvh;
+    bvh.build(same.data(), 64);
+    checkQueries(bvh, same);
+}
+
+static void checkTriangles(){
+    float v0[3] = { 0, 0, 0 };
+    float v1[3] = { 10, 0, 0 };
+    float v2[3] = { 0, 0, 10 };
+    float origin[3] = { 2, 5, 2 };
+    float down[3] = { 0, -1, 0 };
+    float up[3] = { 0, 1, 0 };
+    float side[3] = { 1, 0, 0 };
+    float t = 0;
+    TestUtil::check(Intersections::rayIntersectsTriangle(origin, down, v0, v1, v2, t) && fabs(t - 5) < 1e-4, "triangle hit");
+    TestUtil::check(!Intersections::rayIntersectsTriangle(origin, up, v0, v1, v2, t), "triangle behind");
+    TestUtil::check(!Intersections::rayIntersectsTriangle(origin, side, v0, v1, v2, t), "triangle parallel");
+    float outside[3] = { 8, 5, 8 };
+    TestUtil::check(!Intersections::rayIntersectsTriangle(outside, down, v0, v1, v2, t), "triangle outside");
+
+    float boxes[6];
+    float vertices[9] = { 1, 2, 3, -4, 5, 0, 2, -1, 7 };
+    BVH::triangleBoxes(vertices, 1, 3, boxes);
+    float expected[6] = { -4, -1, 0, 2, 5, 7 };
+    TestUtil::check(std::equal(boxes, boxes + 6, expected), "triangleBoxes");
+
+    // Nearest triangle through the BVH, the way SFile::intersectRay() does it.
+    const int count = 2000;
+    std::vector<float> tri(count*9);
+    for(int i = 0; i < count; i++){
+        float c[3] = { TestUtil::randomFloat(-100, 100), TestUtil::randomFloat(-100, 100), TestUtil::randomFloat(-100, 100) };
+        for(int k = 0; k < 9; k++)
+            tri[i*9+k] = c[k%3] + TestUtil::randomFloat(-5, 5);
+    }
+    std::vector<float> triBoxes(count*6);
+    BVH::triangleBoxes(tri.data(), count, 3, triBoxes.data());
+    BVH bvh;
+    bvh.build(triBoxes.data(), count);
+    std::vector<BVH::Hit> hits;
+    for(int r = 0; r < 500; r++){
+        float o[3], d[3];
+        randomRay(o, d);
+        for(int j = 0; j < 3; j++)
+            o[j] *= 0.1;
+        bool expectedHit = false;
+        float expectedT = 0, tt;
+        for(int i = 0; i < count; i++)
+            if(Intersections::rayIntersectsTriangle(o, d, &tri[i*9], &tri[i*9+3], &tri[i*9+6], tt)
+                    && (!expectedHit || tt < expectedT)){
+                expectedT = tt;
+                expectedHit = true;
+            }
+        bvh.intersectRay(o, d, 1e30, hits);
+        bool hit = false;
+        float nearest = 0;
+        for(unsigned int i = 0; i < hits.size(); i++){
+            if(hit && hits[i].t > nearest)
+                break;
+            float* v = &tri[hits[i].id*9];
+            if(Intersections::rayIntersectsTriangle(o, d, v, v+3, v+6, tt) && (!hit || tt < nearest)){
+                nearest = tt;
+                hit = true;
+            }
+        }
+        TestUtil::check(hit == expectedHit && (!hit || nearest == expectedT), "nearest triangle");
+    }
+}
+
+static void multiply(float* out, const float* a, const float* b){
+    for(int c = 0; c < 4; c++)
+        for(int r = 0; r < 4; r++){
+            out[c*4+r] = 0;
+            for(int k = 0; k < 4; k++)
+                out[c*4+r] += a[k*4+r]*b[c*4+k];
+        }
+}
+
+static void checkInvert(){
+    for(int i = 0; i < 100; i++){
+        float q[4], axis[3] = { TestUtil::randomFloat(-1, 1), TestUtil::randomFloat(-1, 1), TestUtil::randomFloat(-1, 1) };
+        float len = sqrt(axis[0]*axis[0] + axis[1]*axis[1] + axis[2]*axis[2]);
+        for(int j = 0; j < 3; j++)
+            axis[j] /= len;
+        Quat::setAxisAngle(q, axis, TestUtil::randomFloat(-3, 3));
+        float v[3] = { TestUtil::randomFloat(-2048, 2048), TestUtil::randomFloat(-100, 100), TestUtil::randomFloat(-2048, 2048) };
+        float m[16], inv[16], product[16];
+        Mat4::fromRotationTranslation(m, q, v);
+        TestUtil::check(Mat4::invert(inv, m) != NULL, "invert");
+        multiply(product, m, inv);
+        bool identity = true;
+        for(int j = 0; j < 16; j++)
+            if(fabs(product[j] - (j%5 == 0 ? 1 : 0)) > 1e-3)
+                identity = false;
+        TestUtil::check(identity, "invert identity");
+    }
+    float singular[16] = { 1, 2, 3, 4, 2, 4, 6, 8, 0, 0, 1, 0, 0, 0, 0, 1 };
+    float inv[16];
+    TestUtil::check(Mat4::invert(inv, singular) == NULL, "invert singular");
+}
+
+int main(){
+    checkBVH();
+    checkTriangles();
+    checkInvert();
+    return TestUtil::result("BVHTest");
+}
@@ -0,0 +1,157 @@
+/*  This file is part of TSRE5.
+ *
+ *  TSRE5 - train sim game engine and MSTS/OR Editors.
+ *  Copyright (C) 2016 Piotr Gadecki <pgadecki@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *
+ *  See LICENSE.md or https://www.gnu.org/licenses/gpl.html
+ */
+
+#include <tsre/math3d/Frustum.h>
+#include <tsre/math3d/GLMatrix.h>
+#include "TestUtil.h"
+#include <vector>
+#include <math.h>
+
+/*
+ * Frustum planes of a perspective * lookAt matrix, without GL: spheres
+ * inside, outside and across each plane, the batched sphere test against
+ * the single one and axis aligned boxes against their eight corners.
+ */
+
+// 90 degrees, so the side planes are x = +-z and y = +-z in view space.
+static const float Near = 1;
+static const float Far = 100;
+
+// Camera at eye looking down -z of the world.
+static void makeFrustum(Frustum &frustum, float* eye){
+    float proj[16], view[16], clip[16];
+    float center[3] = { eye[0], eye[1], eye[2] - 1 };
+    float up[3] = { 0, 1, 0 };
+    Mat4::perspective(proj, M_PI/2, 1, Near, Far);
+    Mat4::lookAt(view, eye, center, up);
+    Mat4::multiply(clip, proj, view);
+    frustum.set(clip);
+}
+
+static bool sphere(Frustum &frustum, float* eye, float x, float y, float z, float r){
+    float c[3] = { eye[0] + x, eye[1] + y, eye[2] + z };
+    return frustum.sphereVisible(c, r);
+}
+
+static void checkPlanes(Frustum &frustum){
+    bool normalized = true;
+    for(int i = 0; i < 24; i += 4){
+        float len = sqrt(frustum.planes[i]*frustum.planes[i] + frustum.planes[i+1]*frustum.planes[i+1]
+                + frustum.planes[i+2]*frustum.planes[i+2]);
+        normalized &= fabs(len - 1) < 0.0001;
+    }
+    TestUtil::check(normalized, "plane normals not normalized");
+}
+
+// Positions relative to the eye, so any camera position gives the same answers.
+static void checkSpheres(Frustum &frustum, float* eye){
+    TestUtil::check(sphere(frustum, eye, 0, 0, -10, 1), "sphere ahead");
+    TestUtil::check(!sphere(frustum, eye, 0, 0, 10, 1), "sphere behind");
+    TestUtil::check(!sphere(frustum, eye, 0, 0, -0.5, 0.1), "sphere before near");
+    TestUtil::check(sphere(frustum, eye, 0, 0, -0.5, 1), "sphere across near");
+    TestUtil::check(!sphere(frustum, eye, 0, 0, -150, 10), "sphere past far");
+    TestUtil::check(sphere(frustum, eye, 0, 0, -105, 10), "sphere across far");
+    // The center is 10/sqrt(2) = 7.07 outside of the side plane.
+    const float side[4][2] = { {20, 0}, {-20, 0}, {0, 20}, {0, -20} };
+    for(int i = 0; i < 4; i++){
+        TestUtil::check(!sphere(frustum, eye, side[i][0], side[i][1], -10, 7), QString("sphere outside side %1").arg(i));
+        TestUtil::check(sphere(frustum, eye, side[i][0], side[i][1], -10, 7.2), QString("sphere across side %1").arg(i));
+    }
+}
+
+static void checkBatch(Frustum &frustum, float* eye){
+    const int count = 1003;
+    std::vector<float> x(count), y(count), z(count), r(count);
+    std::vector<unsigned char> out(count);
+    for(int i = 0; i < count; i++){
+        x[i] = eye[0] + TestUtil::randomFloat(-150, 150);
+        y[i] = eye[1] + TestUtil::randomFloat(-150, 150);
+        z[i] = eye[2] + TestUtil::randomFloat(-150, 150);
+        r[i] = TestUtil::randomFloat(0, 30);
+    }
+    frustum.spheresVisible(x.data(), y.data(), z.data(), r.data(), count, out.data());
+    int mismatches = 0, visible = 0;
+    for(int i = 0; i < count; i++){
+        float c[3] = { x[i], y[i], z[i] };
+        if((out[i] != 0) != frustum.sphereVisible(c, r[i]))
+            mismatches++;
+        visible += out[i] != 0;
+    }
+    TestUtil::check(mismatches == 0, QString("spheresVisible differs from sphereVisible %1 times").arg(mismatches));
+    TestUtil::check(visible > 0 && visible < count, "random spheres all in or all out");
+}
+
+// A box is out if all eight corners are behind one plane.
+static bool cornersVisible(Frustum &frustum, float* min, float* max){
+    for(int i = 0; i < 24; i += 4){
+        bool out = true;
+        for(int c = 0; c < 8; c++){
+            float x = c & 1 ? max[0] : min[0];
+            float y = c & 2 ? max[1] : min[1];
+            float z = c & 4 ? max[2] : min[2];
+            out &= frustum.planes[i]*x + frustum.planes[i+1]*y + frustum.planes[i+2]*z + frustum.planes[i+3] < 0;
+        }
+        if(out)
+            return false;
+    }
+    return true;
+}
+
+static bool box(Frustum &frustum, float* eye, float x1, float y1, float z1, float x2, float y2, float z2){
+    float min[3] = { eye[0] + x1, eye[1] + y1, eye[2] + z1 };
+    float max[3] = { eye[0] + x2, eye[1] + y2, eye[2] + z2 };
+    return frustum.boxVisible(min, max);
+}
+
+static void checkBoxes(Frustum &frustum, float* eye){
+    TestUtil::check(box(frustum, eye, -1, -1, -11, 1, 1, -9), "box ahead");
+    TestUtil::check(!box(frustum, eye, -1, -1, 9, 1, 1, 11), "box behind");
+    TestUtil::check(box(frustum, eye, -1000, -1000, -1000, 1000, 1000, 1000), "box around the frustum");
+    TestUtil::check(box(frustum, eye, -1, -1, -1.5, 1, 1, -0.5), "box across near");
+    TestUtil::check(!box(frustum, eye, -1, -1, -0.9, 1, 1, -0.5), "box before near");
+    TestUtil::check(box(frustum, eye, -1, -1, -101, 1, 1, -99), "box across far");
+    TestUtil::check(!box(frustum, eye, -1, -1, -110, 1, 1, -101), "box past far");
+    TestUtil::check(!box(frustum, eye, 11, -1, -10, 13, 1, -8), "box outside right");
+    TestUtil::check(box(frustum, eye, 9, -1, -10, 13, 1, -8), "box across right");
+    TestUtil::check(!box(frustum, eye, -1, -13, -10, 1, -11, -8), "box outside bottom");
+    TestUtil::check(box(frustum, eye, -1, -13, -10, 1, -9, -8), "box across bottom");
+
+    int mismatches = 0, visible = 0;
+    const int count = 1000;
+    for(int i = 0; i < count; i++){
+        float min[3], max[3];
+        for(int j = 0; j < 3; j++){
+            float c = eye[j] + TestUtil::randomFloat(-150, 150);
+            float r = TestUtil::randomFloat(0.1, 30);
+            min[j] = c - r;
+            max[j] = c + r;
+        }
+        bool v = frustum.boxVisible(min, max);
+        if(v != cornersVisible(frustum, min, max))
+            mismatches++;
+        visible += v;
+    }
+    TestUtil::check(mismatches == 0, QString("boxVisible differs from the corner test %1 times").arg(mismatches));
+    TestUtil::check(visible > 0 && visible < count, "random boxes all in or all out");
+}
+
+int main(){
+    TestUtil::seed(9);
+    float eyes[2][3] = { {0, 0, 0}, {1500, 120, -700} };
+    for(int i = 0; i < 2; i++){
+        Frustum frustum;
+        makeFrustum(frustum, eyes[i]);
+        checkPlanes(frustum);
+        checkSpheres(frustum, eyes[i]);
+        checkBatch(frustum, eyes[i]);
+        checkBoxes(frustum, eyes[i]);
+    }
+    return TestUtil::result("FrustumTest");
+}
@@ -0,0 +1,171 @@
+/*  This file is part of TSRE5.
+ *
+ *  TSRE5 - train sim game engine and MSTS/OR Editors.
+ *  Copyright (C) 2016 Piotr Gadecki <pgadecki@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *
+ *  See LICENSE.md or https://www.gnu.org/licenses/gpl.html
+ */
+
+#include <tsre/geo/GeoHeightSampler.h>
+#include <tsre/geo/GeoCoordinates.h>
+#include <tsre/geo/GeoHgtFile.h>
+#include <tsre/Game.h>
+#include "TestUtil.h"
+#include <QTemporaryDir>
+#include <QElapsedTimer>
+#include <QByteArray>
+#include <QFile>
+#include <unordered_map>
+#include <algorithm>
+#include <math.h>
+
+/*
+ * GeoHeightSampler::run() on a synthetic DEM of four small HGT files
+ * meeting at 50N 20E, against the per-point path it replaced: one
+ * ConvertToInternal + ConvertToLatLon and one getHeight() per sample.
+ * Tiles span all four files, with the MSTS and the TSRE projection,
+ * with a DEM cache smaller than the files in use, and a second run from
+ * the cache. A tile without its DEM file fails and names the file.
+ */
+
+static const int RowSize = 121;
+static const int Resolution = 256;
+static const int Size = 2048;
+static const float YOffset = 12.5;
+
+static QString hgtName(int lat, int lon){
+    return QString("%1%2%3%4.hgt").arg(lat < 0 ? "S" : "N").arg(abs(lat), 2, 10, QChar('0'))
+            .arg(lon < 0 ? "W" : "E").arg(abs(lon), 3, 10, QChar('0'));
+}
+
+// Big endian shorts, row 0 at the north edge, with noise so a wrong index shows.
+static void writeHgt(int lat, int lon){
+    QByteArray data;
+    for(int i = 0; i < RowSize; i++)
+        for(int j = 0; j < RowSize; j++){
+            double la = lat + 1.0 - (double)i/(RowSize - 1);
+            double lo = lon + (double)j/(RowSize - 1);
+            short h = 300 + 150*sin(la*40)*cos(lo*30) + (TestUtil::random() >> 16) % 20;
+            data.append(char(h >> 8));
+            data.append(char(h & 0xff));
+        }
+    QFile file(Game::geoPath + "/" + hgtName(lat, lon));
+    file.open(QIODevice::WriteOnly);
+    file.write(data);
+}
+
+// The old HeightWindow::drawTile loop, files kept apart from the sampler cache.
+static std::unordered_map<int, GeoHgtFile*> ReferenceFiles;
+
+static void perPoint(GeoHeightSampler::Tile &tile, std::vector<int> &fileKeys){
+    PreciseTileCoordinate aCoords;
+    IghCoordinate igh;
+    LatitudeLongitudeCoordinate latlon;
+    aCoords.TileX = tile.tileX;
+    aCoords.TileZ = tile.tileZ;
+    int step = tile.size/tile.resolution;
+    tile.heights.assign(tile.resolution*tile.resolution, 0);
+    for(int i = 0; i < tile.resolution; i++)
+        for(int j = 0; j < tile.resolution; j++){
+            aCoords.setWxyzU(i*step, 0, j*step);
+            Game::GeoCoordConverter->ConvertToInternal(&aCoords, &igh);
+            Game::GeoCoordConverter->ConvertToLatLon(&igh, &latlon);
+            int key = (int)floor(latlon.Latitude)*1000 + (int)floor(latlon.Longitude);
+            GeoHgtFile* &file = ReferenceFiles[key];
+            if(file == NULL){
+                file = new GeoHgtFile();
+                file->load((int)floor(latlon.Latitude), (int)floor(latlon.Longitude));
+            }
+            if(std::find(fileKeys.begin(), fileKeys.end(), key) == fileKeys.end())
+                fileKeys.push_back(key);
+            tile.heights[i*tile.resolution + j] = file->getHeight(latlon.Latitude, latlon.Longitude) + tile.yOffset;
+        }
+}
+
+static QVector<GeoHeightSampler::Tile> makeTiles(int tileX, int tileZ){
+    QVector<GeoHeightSampler::Tile> tiles;
+    for(int i = -1; i <= 1; i++){
+        GeoHeightSampler::Tile tile;
+        tile.tileX = tileX + i;
+        tile.tileZ = tileZ + i;
+        tile.resolution = Resolution;
+        tile.size = Size;
+        tile.yOffset = YOffset;
+        tiles.push_back(tile);
+    }
+    return tiles;
+}
+
+static void compare(const QString &name, int tileX, int tileZ){
+    QVector<GeoHeightSampler::Tile> tiles = makeTiles(tileX, tileZ);
+    QVector<GeoHeightSampler::Tile> expected = tiles;
+    std::vector<int> fileKeys;
+    QElapsedTimer timer;
+    timer.start();
+    for(int i = 0; i < expected.size(); i++)
+        perPoint(expected[i], fileKeys);
+    qint64 perPointTime = timer.nsecsElapsed();
+    TestUtil::check(fileKeys.size() == 4, name + QString(": tiles span %1 DEM files, not 4").arg(fileKeys.size()));
+
+    GeoHeightSampler sampler;
+    for(int run = 0; run < 2; run++){
+        timer.start();
+        bool ok = sampler.run(tiles);
+        qint64 batchTime = timer.nsecsElapsed();
+        QString what = name + (run == 0 ? "" : ", from the cache");
+        TestUtil::check(ok, what + ": run() failed");
+        float maxDiff = 0;
+        for(int t = 0; t < tiles.size(); t++){
+            TestUtil::check(tiles[t].ok, what + QString(": tile %1 not ok").arg(t));
+            TestUtil::check(tiles[t].heights.size() == expected[t].heights.size(), what + ": height count");
+            if(tiles[t].heights.size() != expected[t].heights.size())
+                continue;
+            for(unsigned int k = 0; k < tiles[t].heights.size(); k++)
+                maxDiff = std::max(maxDiff, (float)fabs(tiles[t].heights[k] - expected[t].heights[k]));
+        }
+        TestUtil::check(maxDiff < 0.001, what + QString(": heights differ from the per-point path by %1").arg(maxDiff));
+        TestUtil::printTimes(QString("%1 tiles of %2x%2, %3").arg(tiles.size()).arg(Resolution).arg(what), batchTime, perPointTime);
+    }
+}
+
+int main(){
+    QTemporaryDir dir;
+    Game::geoPath = dir.path();
+    // Fewer than the four files a tile needs, so files are evicted and loaded again.
+    Game::geoCacheFiles = 2;
+    TestUtil::seed(17);
+    for(int lat = 49; lat <= 50; lat++)
+        for(int lon = 19; lon <= 20; lon++)
+            writeHgt(lat, lon);
+
+    // Tiles around 50N 20E in each projection.
+    GeoMstsCoordinateConverter msts;
+    Game::GeoCoordConverter = &msts;
+    IghCoordinate igh;
+    PreciseTileCoordinate corner;
+    msts.ConvertToInternal(50.0, 20.0, &igh);
+    msts.ConvertToTile(&igh, &corner);
+    compare("MSTS projection", corner.TileX, corner.TileZ);
+
+    double latLonXY[4] = { 50.0, 20.0, 2048*10.5, 2048*-4.5 };
+    GeoTsreCoordinateConverter tsre(latLonXY);
+    Game::GeoCoordConverter = &tsre;
+    compare("TSRE projection", 10, -5);
+
+    // 10N has no DEM file.
+    double noDemLatLonXY[4] = { 10.5, 20.5, 2048*10.5, 2048*-4.5 };
+    GeoTsreCoordinateConverter noDem(noDemLatLonXY);
+    Game::GeoCoordConverter = &noDem;
+    QVector<GeoHeightSampler::Tile> missing = makeTiles(10, -5);
+    GeoHeightSampler sampler;
+    sampler.run(missing);
+    TestUtil::check(!missing[1].ok, "tile without a DEM file is ok");
+    TestUtil::check(missing[1].missingFile.endsWith(hgtName(10, 20)), "missing file not named: " + missing[1].missingFile);
+
+    Game::GeoCoordConverter = NULL;
+    for(auto it = ReferenceFiles.begin(); it != ReferenceFiles.end(); ++it)
+        delete it->second;
+    return TestUtil::result("GeoHeightSamplerTest");
+}
@@ -0,0 +1,152 @@
+/*  This file is part of TSRE5.
+ *
+ *  TSRE5 - train sim game engine and MSTS/OR Editors.
+ *  Copyright (C) 2016 Piotr Gadecki <pgadecki@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *
+ *  See LICENSE.md or https://www.gnu.org/licenses/gpl.html
+ */
+
+#include <tsre/renderer/OpenGL3Renderer.h>
+#include <tsre/renderer/RenderItem.h>
+#include <tsre/math3d/GLMatrix.h>
+#include "TestUtil.h"
+#include <QElapsedTimer>
+#include <stdint.h>
+#include <vector>
+
+/*
+ * CPU side of a draw list frame with many objects, without GL.
+ * Every object pushes a matrix, moves it and pushes the render items of
+ * its shape with OpenGL3Renderer::pushItemsVNTA(), as the world objects do
+ * in pushRenderItem(). The frame ends with sortDrawList() packing all
+ * matrices for instancing and endFrame(). The packed matrices must be the
+ * ones the objects pushed and the arena must not grow after the first
+ * frame. The time per frame is printed next to the same frame with the
+ * Mat4::clone() and delete at frame end that the arena replaced.
+ * GL state changes and draw calls of renderFrame() are not part of it.
+ */
+
+static const int Objects = 30000;
+static const int Shapes = 500;
+static const int Parts = 3;
+static const int Frames = 50;
+
+struct Frame {
+    int matrices = 0;
+    double sumX = 0;
+    bool frameZ = true;
+};
+
+static std::vector<QVector<RenderItem*>> makeShapes(){
+    std::vector<QVector<RenderItem*>> shapes(Shapes);
+    for(int s = 0; s < Shapes; s++)
+        for(int p = 0; p < Parts; p++){
+            RenderItem* item = new RenderItem();
+            item->texAddr = (s*Parts + p) % 64 + 1;
+            // Only compared by the sort, never bound.
+            item->VAO = (QOpenGLVertexArrayObject*)(intptr_t)(s + 1);
+            item->vertOffset = p*300;
+            item->vertCount = 300;
+            shapes[s].push_back(item);
+        }
+    return shapes;
+}
+
+// Sorts and packs the draw list, then checks the packed matrices.
+static void finish(OpenGL3Renderer &renderer, int f, Frame &frame){
+    renderer.sortDrawList(true);
+    frame.matrices = renderer.instanceData.size()/16;
+    for(int i = 0; i < frame.matrices; i++){
+        frame.sumX += renderer.instanceData[i*16 + 12];
+        frame.frameZ &= renderer.instanceData[i*16 + 14] == f;
+    }
+}
+
+int main(){
+    std::vector<QVector<RenderItem*>> shapes = makeShapes();
+    QVector<RenderItem*> subPart;
+    subPart.push_back(shapes[0][0]);
+    // Objects with a sub part push its item a second time, moved by 0.5.
+    int expectedMatrices = Objects*Parts + (Objects + 3)/4;
+    double expectedX = (double)Objects*(Objects - 1)/2*Parts;
+    for(int i = 0; i < Objects; i += 4)
+        expectedX += i + 0.5;
+
+    OpenGL3Renderer renderer;
+    Mat4::identity(renderer.mvMatrix);
+    QElapsedTimer timer;
+    timer.start();
+    int blocks = 0;
+    bool intact = true;
+    for(int f = 0; f < Frames; f++){
+        Frame frame;
+        for(int i = 0; i < Objects; i++){
+            renderer.mvPushMatrix();
+            float pos[3] = { (float)i, 0, (float)f };
+            Mat4::translate(renderer.mvMatrix, renderer.mvMatrix, pos);
+            renderer.pushItemsVNTA(shapes[i % Shapes], renderer.mvMatrix);
+            if(i % 4 == 0){
+                renderer.mvPushMatrix();
+                float part[3] = { 0.5, 0, 0 };
+                Mat4::translate(renderer.mvMatrix, renderer.mvMatrix, part);
+                renderer.pushItemsVNTA(subPart, renderer.mvMatrix);
+                renderer.mvPopMatrix();
+            }
+            renderer.mvPopMatrix();
+        }
+        finish(renderer, f, frame);
+        intact &= frame.matrices == expectedMatrices && frame.sumX == expectedX && frame.frameZ;
+        if(f == 0)
+            blocks = renderer.matrixArena.blockCount();
+        renderer.endFrame();
+    }
+    qint64 arena = timer.nsecsElapsed();
+    TestUtil::check(intact, "draw list matrices differ from the pushed ones");
+    TestUtil::check(renderer.matrixArena.blockCount() == blocks, "arena grew after the first frame");
+    TestUtil::check(renderer.imvMatrixStack == 0, "unbalanced matrix stack");
+    TestUtil::check(renderer.drawList.isEmpty(), "draw list kept after the frame");
+
+    // The same frame with the stack from before the arena.
+    float* mvMatrix = Mat4::create();
+    Mat4::identity(mvMatrix);
+    float* stack[16];
+    int stackSize = 0;
+    std::vector<float*> deleted;
+    bool heapIntact = true;
+    timer.start();
+    for(int f = 0; f < Frames; f++){
+        Frame frame;
+        for(int i = 0; i < Objects; i++){
+            stack[stackSize++] = mvMatrix;
+            mvMatrix = Mat4::clone(mvMatrix);
+            float pos[3] = { (float)i, 0, (float)f };
+            Mat4::translate(mvMatrix, mvMatrix, pos);
+            renderer.pushItemsVNTA(shapes[i % Shapes], mvMatrix);
+            if(i % 4 == 0){
+                stack[stackSize++] = mvMatrix;
+                mvMatrix = Mat4::clone(mvMatrix);
+                float part[3] = { 0.5, 0, 0 };
+                Mat4::translate(mvMatrix, mvMatrix, part);
+                renderer.pushItemsVNTA(subPart, mvMatrix);
+                deleted.push_back(mvMatrix);
+                mvMatrix = stack[--stackSize];
+            }
+            deleted.push_back(mvMatrix);
+            mvMatrix = stack[--stackSize];
+        }
+        finish(renderer, f, frame);
+        heapIntact &= frame.matrices == expectedMatrices && frame.sumX == expectedX && frame.frameZ;
+        renderer.endFrame();
+        for(unsigned int i = 0; i < deleted.size(); i++)
+            delete[] deleted[i];
+        deleted.clear();
+    }
+    qint64 heap = timer.nsecsElapsed();
+    TestUtil::check(heapIntact, "draw list matrices differ with the old stack");
+
+    TestUtil::printTimes(QString("%1 objects of %2 shapes, draw list frame with %3 arena blocks")
+            .arg(Objects).arg(Shapes).arg(blocks), arena/Frames, heap/Frames);
+    return TestUtil::result("MatrixArenaTest");
+}
@@ -0,0 +1,281 @@
+/*  This file is part of TSRE5.
+ *
+ *  TSRE5 - train sim game engine and MSTS/OR Editors.
+ *  Copyright (C) 2016 Piotr Gadecki <pgadecki@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *
+ *  See LICENSE.md or https://www.gnu.org/licenses/gpl.html
+ */
+
+#include <tsre/geo/OSMStore.h>
+#include <tsre/geo/OSMFeatures.h>
+#include "TestUtil.h"
+#include <QTemporaryDir>
+#include <QByteArray>
+#include <QBuffer>
+#include <QFile>
+#include <QDebug>
+#include <vector>
+#include <algorithm>
+#include <math.h>
+
+/*
+ * OSMStore::loadPbf() on a hand encoded .osm.pbf file: an OSMHeader blob,
+ * a raw OSMData blob with dense nodes and ways and a zlib OSMData blob with
+ * a plain node and a way. Nodes, tags, way refs and query() are checked.
+ * Truncated files and blobs with lengths that don't fit must fail to load.
+ */
+
+// Protobuf writer for the fixture.
+struct Pbf {
+    QByteArray data;
+
+    static uint64_t zigzag(int64_t v){
+        return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+    }
+    void varint(uint64_t v){
+        while(v >= 0x80){
+            data.append(char((v & 0x7f) | 0x80));
+            v >>= 7;
+        }
+        data.append(char(v));
+    }
+    void key(int field, int wire){
+        varint((field << 3) | wire);
+    }
+    void number(int field, uint64_t v){
+        key(field, 0);
+        varint(v);
+    }
+    void snumber(int field, int64_t v){
+        key(field, 0);
+        varint(zigzag(v));
+    }
+    void bytes(int field, const QByteArray &b){
+        key(field, 2);
+        varint(b.size());
+        data.append(b);
+    }
+    void packed(int field, const std::vector<int64_t> &vals, bool sint, bool delta){
+        Pbf p;
+        int64_t last = 0;
+        for(unsigned int i = 0; i < vals.size(); i++){
+            int64_t v = delta ? vals[i] - last : vals[i];
+            last = vals[i];
+            p.varint(sint ? zigzag(v) : (uint64_t)v);
+        }
+        bytes(field, p.data);
+    }
+};
+
+// Coordinates in the default granularity of 100 nanodegrees.
+static int64_t coord(double deg){
+    return (int64_t)(deg*10000000.0 + (deg < 0 ? -0.5 : 0.5));
+}
+
+static QByteArray stringTable(const std::vector<const char*> &strings){
+    Pbf st;
+    for(unsigned int i = 0; i < strings.size(); i++)
+        st.bytes(1, strings[i]);
+    return st.data;
+}
+
+static QByteArray way(int64_t id, int64_t key, int64_t val, const std::vector<int64_t> &refs){
+    Pbf w;
+    w.number(1, id);
+    w.packed(2, { key }, false, false);
+    w.packed(3, { val }, false, false);
+    w.packed(8, refs, true, true);
+    return w.data;
+}
+
+// Strings: 0 "", 1 highway, 2 residential, 3 railway, 4 rail, 5 building, 6 yes.
+static const std::vector<const char*> Strings = { "", "highway", "residential", "railway", "rail", "building", "yes" };
+
+static QByteArray denseBlock(){
+    Pbf dense;
+    dense.packed(1, { 100, 101, 102, 103 }, true, true);
+    dense.packed(8, { coord(52.10), coord(52.11), coord(52.12), coord(52.13) }, true, true);
+    dense.packed(9, { coord(21.00), coord(21.01), coord(21.02), coord(21.03) }, true, true);
+    // Node 102 is railway=rail.
+    dense.packed(10, { 0, 0, 3, 4, 0, 0 }, false, false);
+    Pbf nodes;
+    nodes.bytes(2, dense.data);
+    Pbf ways;
+    ways.bytes(3, way(10, 1, 2, { 100, 101, 102 }));
+    ways.bytes(3, way(11, 5, 6, { 101, 102, 103, 101 }));
+
+    Pbf block;
+    block.bytes(1, stringTable(Strings));
+    block.bytes(2, nodes.data);
+    block.bytes(2, ways.data);
+    block.number(17, 100);
+    return block.data;
+}
+
+static QByteArray plainBlock(){
+    Pbf node;
+    node.snumber(1, 200);
+    node.packed(2, { 3 }, false, false);
+    node.packed(3, { 4 }, false, false);
+    node.snumber(8, coord(52.50));
+    node.snumber(9, coord(21.50));
+    Pbf group;
+    group.bytes(1, node.data);
+    group.bytes(3, way(12, 1, 2, { 103, 200 }));
+
+    Pbf block;
+    block.bytes(1, stringTable(Strings));
+    block.bytes(2, group.data);
+    return block.data;
+}
+
+static QByteArray fileBlob(const char* type, const QByteArray &blob){
+    Pbf header;
+    header.bytes(1, type);
+    header.number(3, blob.size());
+    QByteArray out(4, 0);
+    int size = header.data.size();
+    for(int i = 0; i < 4; i++)
+        out[i] = char(size >> (24 - i*8));
+    return out + header.data + blob;
+}
+
+static QByteArray rawBlob(const QByteArray &block){
+    Pbf blob;
+    blob.bytes(1, block);
+    return blob.data;
+}
+
+// qCompress() puts the length in front of the zlib stream.
+static QByteArray zlibBlob(const QByteArray &block, int rawSize){
+    Pbf blob;
+    blob.number(2, rawSize);
+    blob.bytes(3, qCompress(block).mid(4));
+    return blob.data;
+}
+
+static QByteArray headerBlob(){
+    Pbf header;
+    header.bytes(4, "OsmSchema-V0.6");
+    header.bytes(4, "DenseNodes");
+    return rawBlob(header.data);
+}
+
+static QByteArray fixture(){
+    return fileBlob("OSMHeader", headerBlob())
+            + fileBlob("OSMData", rawBlob(denseBlock()))
+            + fileBlob("OSMData", zlibBlob(plainBlock(), plainBlock().size()));
+}
+
+static bool load(OSMStore &store, QByteArray data){
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::ReadOnly);
+    bool ok = store.loadPbf(&buffer);
+    store.finish();
+    return ok;
+}
+
+static bool near(float a, double b){
+    return fabs(a - b) < 0.00001;
+}
+
+static void checkFixture(OSMStore &store){
+    TestUtil::check(store.nodeId == std::vector<int64_t>({ 100, 101, 102, 103, 200 }), "node ids");
+    if(store.nodeId.size() != 5)
+        return;
+    TestUtil::check(near(store.nodeLat[0], 52.10) && near(store.nodeLon[0], 21.00), "dense node coordinates");
+    TestUtil::check(near(store.nodeLat[3], 52.13) && near(store.nodeLon[3], 21.03), "last dense node coordinates");
+    TestUtil::check(near(store.nodeLat[4], 52.50) && near(store.nodeLon[4], 21.50), "plain node coordinates");
+    int rail = OSMFeatures::LIST["RAILWAY_RAIL"];
+    TestUtil::check(store.nodeType[2] == rail && store.nodeType[4] == rail, "node tags");
+    TestUtil::check(store.nodeType[0] == 0 && store.nodeType[1] == 0 && store.nodeType[3] == 0, "untagged nodes");
+
+    TestUtil::check(store.wayId == std::vector<int64_t>({ 10, 11, 12 }), "way ids");
+    if(store.wayId.size() != 3)
+        return;
+    int residential = OSMFeatures::LIST["HIGHWAY_RESIDENTIAL"];
+    TestUtil::check(store.wayType[0] == residential && store.wayType[2] == residential, "highway tags");
+    TestUtil::check(store.wayType[1] == OSMFeatures::LIST["BUILDING_YES"], "building tag");
+    TestUtil::check(store.wayRefCount(0) == 3 && store.wayRefCount(1) == 4 && store.wayRefCount(2) == 2, "way ref counts");
+    std::vector<int> nodes(store.wayNode.begin(), store.wayNode.end());
+    TestUtil::check(nodes == std::vector<int>({ 0, 1, 2, 1, 2, 3, 1, 3, 4 }), "way refs to node indices");
+
+    std::vector<int> ways;
+    store.query(52.45, 21.45, 52.55, 21.55, ways);
+    TestUtil::check(ways == std::vector<int>({ 2 }), "query around the plain node");
+    store.query(52.095, 20.995, 52.115, 21.015, ways);
+    std::sort(ways.begin(), ways.end());
+    TestUtil::check(ways == std::vector<int>({ 0, 1 }), "query around the first nodes");
+    store.query(10, 10, 11, 11, ways);
+    TestUtil::check(ways.empty(), "query away from the data");
+}
+
+// A file of one raw OSMData blob holding block.
+static QByteArray blockFile(const QByteArray &block){
+    return fileBlob("OSMData", rawBlob(block));
+}
+
+static void checkCorrupt(){
+    QByteArray file = fixture();
+    QByteArray block = denseBlock();
+    Pbf pastEnd;
+    pastEnd.key(1, 2);
+    pastEnd.varint(1000);
+    pastEnd.data.append("abc");
+    Pbf negative;
+    negative.key(2, 2);
+    negative.varint(~(uint64_t)0);
+    negative.data.append(block);
+    Pbf unterminated;
+    unterminated.data = block;
+    unterminated.key(17, 0);
+    unterminated.data.append("\xff\xff");
+    Pbf badWire;
+    badWire.data = block;
+    badWire.key(5, 3);
+
+    struct Corrupt {
+        const char* what;
+        QByteArray data;
+    };
+    Corrupt corrupt[] = {
+        { "truncated blob header", file.left(10) },
+        { "truncated blob", file.left(file.size() - 10) },
+        { "negative blob header size", QByteArray("\xff\xff\xff\xff", 4) + file.mid(4) },
+        { "oversized blob header size", QByteArray("\x00\x10\x00\x00", 4) + file.mid(4) },
+        { "length past the end of the block", blockFile(pastEnd.data) },
+        { "negative length", blockFile(negative.data) },
+        { "unterminated varint", blockFile(unterminated.data) },
+        { "unknown wire type", blockFile(badWire.data) },
+        { "truncated dense nodes", blockFile(block.left(block.size()/2)) },
+        { "wrong raw size", fileBlob("OSMData", zlibBlob(block, block.size() + 1)) },
+        { "corrupt zlib data", fileBlob("OSMData", zlibBlob(block, block.size()).replace(6, 8, QByteArray(8, 'x'))) }
+    };
+    for(unsigned int i = 0; i < sizeof(corrupt)/sizeof(Corrupt); i++){
+        OSMStore store;
+        TestUtil::check(!load(store, corrupt[i].data), QString("loaded a corrupt file: ") + corrupt[i].what);
+    }
+}
+
+int main(){
+    QByteArray file = fixture();
+    OSMStore store;
+    TestUtil::check(load(store, file), "fixture did not load");
+    checkFixture(store);
+
+    // The same through loadFile(), which picks the reader by extension.
+    QTemporaryDir dir;
+    QString path = dir.path() + "/fixture.osm.pbf";
+    QFile out(path);
+    out.open(QIODevice::WriteOnly);
+    out.write(file);
+    out.close();
+    OSMStore fromFile;
+    TestUtil::check(fromFile.loadFile(path), "fixture did not load from file");
+    checkFixture(fromFile);
+
+    checkCorrupt();
+    return TestUtil::result("OSMStoreTest");
+}
@@ -0,0 +1,220 @@
+/*  This file is part of TSRE5.
+ *
+ *  TSRE5 - train sim game engine and MSTS/OR Editors.
+ *  Copyright (C) 2016 Piotr Gadecki <pgadecki@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *
+ *  See LICENSE.md or https://www.gnu.org/licenses/gpl.html
+ */
+
+#include <tsre/fileFunctions/ParserX.h>
+#include <tsre/fileFunctions/FileBuffer.h>
+#include <tsre/world/objects/WorldObj.h>
+#include "TestUtil.h"
+#include <QElapsedTimer>
+#include <QVector>
+#include <QDebug>
+#include <string.h>
+#include <stdlib.h>
+
+/*
+ * Token views of ParserX on a synthetic text world file of 20k objects.
+ * Walking it with NextTokenView(), Keywords and GetNumber() has to see the
+ * same sections as NextTokenInside().toLower() and parse the numbers as
+ * strtod() does. The time of both walks is printed, the old one with the
+ * GetNumber() loop from before ParseNumber(), kept below.
+ * WorldObj::createObj() must ignore case for tokens and not for QStrings.
+ */
+
+static const int Objects = 20000;
+
+static const char* Numbers[] = { "12.5", "101.25", "-640.75", "0.382683", "0.92388", "-1e-3", "2.5E2", "4294967294", "0" };
+static const int NumberCount = sizeof(Numbers)/sizeof(const char*);
+
+static QString worldText(){
+    QString text = "SIMISA@@@@@@@@@@JINX0w0t______\n\nTr_Worldfile (\n";
+    const char* types[] = { "Static", "TrackObj", "Gantry", "static" };
+    for(int i = 0; i < Objects; i++){
+        text += QString("\t%1 (\n\t\tUiD ( %2 )\n\t\tFileName ( object_%2.s )\n").arg(types[i % 4]).arg(i);
+        text += QString("\t\tPosition ( %1 %2 %3 )\n").arg(Numbers[i % NumberCount])
+                .arg(Numbers[(i + 1) % NumberCount]).arg(Numbers[(i + 2) % NumberCount]);
+        text += "\t\tQDirection ( 0 0.382683 0 0.92388 )\n\t\tStaticFlags ( 00100000 )\n\t)\n";
+    }
+    return text + ")";
+}
+
+// UTF-16 with BOM, as FileBuffer::toUtf16() leaves it.
+static FileBuffer* buffer(const QString &text){
+    int length = (text.length() + 1)*2;
+    unsigned char* data = new unsigned char[length];
+    unsigned short bom = 65279;
+    memcpy(data, &bom, 2);
+    memcpy(data + 2, text.utf16(), text.length()*2);
+    FileBuffer* out = new FileBuffer(data, length);
+    out->skipBOM();
+    ParserX::NextLine(out);
+    return out;
+}
+
+namespace Baseline {
+
+// ParserX::GetNumber() before ParseNumber(), without the units.
+static float getNumber(FileBuffer* bufor){
+    unsigned short int b = 0;
+    int j;
+    float x, t;
+    int liczba = 1, ujemna = 0;
+
+    while (b < 45 || (b > 46 && b < 48) || b > 57) {
+        b = bufor->getShort();
+    }
+    x = 0;
+    liczba = 1;
+    ujemna = 0;
+    if (b == 45) {
+        ujemna = 1;
+        b = bufor->getShort();
+    }
+    if (b != 46) {
+        while (b > 47 && b < 58) {
+            x = x * 10.0 + b - 48;
+            b = bufor->getShort();
+        }
+    }
+    if (b == 46 || b == 44) {
+        b = bufor->getShort();
+        while (b > 47 && b < 58) {
+            liczba = liczba * 10;
+            t = b;
+            x = x + (t - 48) / liczba;
+            b = bufor->getShort();
+        }
+    }
+    if (ujemna == 1) x = -x;
+    if (b == 69 || b == 101) {
+        b = bufor->getShort();
+        if (b == 45) {
+            ujemna = 1;
+            b = bufor->getShort();
+        } else ujemna = 0;
+        liczba = 0;
+        while (b > 47 && b < 58) {
+            liczba = liczba * 10.0 + b - 48;
+            b = bufor->getShort();
+        }
+        if (ujemna == 1) {
+            for (j = 0; j < liczba; j++) {
+                x = x / 10.0;
+            }
+        } else {
+            for (j = 0; j < liczba; j++) {
+                x = x * 10.0;
+            }
+        }
+    }
+    bufor->off -= 2;
+    return x;
+}
+
+}
+
+struct Walk {
+    QVector<int> types;
+    QVector<float> positions;
+    double uids = 0;
+};
+
+static const char* TypeNames[] = { "static", "trackobj", "gantry" };
+
+static void walkViews(FileBuffer* data, Walk &walk){
+    static ParserX::Keywords types({ "static", "trackobj", "gantry" });
+    ParserX::Token sh = ParserX::NextTokenView(data);
+    while (!((sh = ParserX::NextTokenView(data)).isEmpty())) {
+        walk.types.push_back(types.find(sh));
+        while (!((sh = ParserX::NextTokenView(data)).isEmpty())) {
+            if (sh == "uid") {
+                walk.uids += ParserX::GetNumber(data);
+            } else if (sh == "position") {
+                for (int i = 0; i < 3; i++)
+                    walk.positions.push_back(ParserX::GetNumber(data));
+            }
+            ParserX::SkipToken(data);
+        }
+        ParserX::SkipToken(data);
+    }
+}
+
+static void walkStrings(FileBuffer* data, Walk &walk){
+    QString sh = ParserX::NextTokenInside(data).toLower();
+    while (!((sh = ParserX::NextTokenInside(data).toLower()).isEmpty())) {
+        int type = -1;
+        for (int i = 0; i < 3; i++)
+            if (sh == TypeNames[i])
+                type = i;
+        walk.types.push_back(type);
+        while (!((sh = ParserX::NextTokenInside(data).toLower()).isEmpty())) {
+            if (sh == "uid") {
+                walk.uids += Baseline::getNumber(data);
+            } else if (sh == "position") {
+                for (int i = 0; i < 3; i++)
+                    walk.positions.push_back(Baseline::getNumber(data));
+            }
+            ParserX::SkipToken(data);
+        }
+        ParserX::SkipToken(data);
+    }
+}
+
+static void checkCreateObj(){
+    WorldObj* obj = WorldObj::createObj(QString("static"));
+    TestUtil::check(obj != NULL && obj->typeID == WorldObj::sstatic && obj->type == "static", "createObj(QString) static");
+    delete obj;
+    obj = WorldObj::createObj(QString("Static"));
+    TestUtil::check(obj == NULL, "createObj(QString) matched Static");
+    delete obj;
+
+    QString text = "TrackObj";
+    ParserX::Token token;
+    token.text = (const unsigned short*)text.utf16();
+    token.length = text.length();
+    obj = WorldObj::createObj(token);
+    TestUtil::check(obj != NULL && obj->typeID == WorldObj::trackobj && obj->type == "trackobj", "createObj(Token) TrackObj");
+    delete obj;
+    text = "TrackObjX";
+    token.text = (const unsigned short*)text.utf16();
+    token.length = text.length();
+    TestUtil::check(WorldObj::createObj(token) == NULL, "createObj(Token) unknown type");
+}
+
+int main(){
+    QString text = worldText();
+    FileBuffer* views = buffer(text);
+    FileBuffer* strings = buffer(text);
+    Walk fast, slow;
+    QElapsedTimer timer;
+    timer.start();
+    walkViews(views, fast);
+    qint64 viewTime = timer.nsecsElapsed();
+    timer.start();
+    walkStrings(strings, slow);
+    qint64 stringTime = timer.nsecsElapsed();
+
+    TestUtil::check(fast.types.size() == Objects, "object count");
+    TestUtil::check(fast.types == slow.types, "object types");
+    TestUtil::check(fast.uids == slow.uids, "UiD values");
+    int wrong = 0;
+    for(int i = 0; i < fast.positions.size(); i++){
+        const char* literal = Numbers[(i/3 + i%3) % NumberCount];
+        if(fast.positions[i] != (float)strtod(literal, NULL))
+            wrong++;
+    }
+    TestUtil::check(fast.positions.size() == Objects*3 && wrong == 0, QString("%1 positions differ from strtod").arg(wrong));
+
+    checkCreateObj();
+
+    TestUtil::printTimes(QString("%1 objects, token views against QString tokens").arg(Objects), viewTime, stringTime);
+    delete views;
+    delete strings;
+    return TestUtil::result("ParserXTest");
+}
@@ -0,0 +1,111 @@
+/*  This file is part of TSRE5.
+ *
+ *  TSRE5 - train sim game engine and MSTS/OR Editors.
+ *  Copyright (C) 2016 Piotr Gadecki <pgadecki@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *
+ *  See LICENSE.md or https://www.gnu.org/licenses/gpl.html
+ */
+
+#include <tsre/shape/ShapeLib.h>
+#include <tsre/shape/SFile.h>
+#include <tsre/texture/TexLib.h>
+#include <tsre/Game.h>
+#include "TestUtil.h"
+#include <QElapsedTimer>
+#include <QDebug>
+
+/*
+ * ShapeLib and TexLib path lookups on synthetic libraries of 100k entries.
+ * Adding a known path has to return its id and count the reference,
+ * also with another case and slashes. The time of the path index is
+ * printed next to the linear scan over the entries it replaced.
+ */
+
+static const int Count = 100000;
+static const int Lookups = 2000;
+
+static QString shapePath(int i){
+    return QString("C:/TS/Routes/Test/Shapes/Object_%1.s").arg(i);
+}
+
+static QString texturePath(int i){
+    return QString("c:/ts/routes/test/textures/texture_%1.raw").arg(i);
+}
+
+int main(){
+    Game::caseInsensitiveFS = true;
+    QElapsedTimer timer;
+
+    ShapeLib shapes;
+    timer.start();
+    for(int i = 0; i < Count; i++)
+        shapes.addShape(shapePath(i), "");
+    qint64 shapeAdd = timer.nsecsElapsed();
+
+    timer.start();
+    bool found = true;
+    for(int i = 0; i < Lookups; i++){
+        int id = (i*7919) % Count;
+        found &= shapes.addShape(shapePath(id), "") == id;
+    }
+    qint64 shapeIndex = timer.nsecsElapsed();
+    TestUtil::check(found, "ShapeLib index lookup");
+    TestUtil::check(shapes.shape[7919]->ref == 2, "ShapeLib reference count");
+    TestUtil::check(shapes.addShape("c:\\ts\\routes\\test\\shapes\\OBJECT_5.s", "") == 5, "ShapeLib path normalization");
+
+    timer.start();
+    found = true;
+    for(int i = 0; i < Lookups; i++){
+        int id = (i*7919) % Count;
+        QString pathid = shapePath(id).toLower();
+        int match = -1;
+        for(auto it = shapes.shape.begin(); it != shapes.shape.end(); ++it)
+            if(it->second != NULL && it->second->pathid == pathid){
+                match = it->first;
+                break;
+            }
+        found &= match == id;
+    }
+    qint64 shapeLinear = timer.nsecsElapsed();
+    TestUtil::check(found, "ShapeLib linear lookup");
+
+    timer.start();
+    for(int i = 0; i < Count; i++)
+        TexLib::addTex(texturePath(i));
+    qint64 texAdd = timer.nsecsElapsed();
+
+    timer.start();
+    found = true;
+    for(int i = 0; i < Lookups; i++){
+        int id = (i*7919) % Count;
+        found &= TexLib::getTex(texturePath(id)) == id;
+    }
+    qint64 texIndex = timer.nsecsElapsed();
+    TestUtil::check(found, "TexLib index lookup");
+    TestUtil::check(TexLib::getTex(texturePath(Count)) == -1, "TexLib missing texture");
+
+    timer.start();
+    found = true;
+    for(int i = 0; i < Lookups; i++){
+        int id = (i*7919) % Count;
+        QString pathid = texturePath(id);
+        int match = -1;
+        for(auto it = TexLib::mtex.begin(); it != TexLib::mtex.end(); ++it)
+            if(it->second != NULL && it->second->pathid == pathid){
+                match = it->first;
+                break;
+            }
+        found &= match == id;
+    }
+    qint64 texLinear = timer.nsecsElapsed();
+    TestUtil::check(found, "TexLib linear lookup");
+
+    qDebug() << Count << "shapes added in" << shapeAdd/1000000 << "ms," << Count << "textures in" << texAdd/1000000 << "ms";
+    TestUtil::printTimes(QString("%1 shape lookups, index against linear scan").arg(Lookups), shapeIndex, shapeLinear);
+    TestUtil::printTimes(QString("%1 texture lookups, index against linear scan").arg(Lookups), texIndex, texLinear);
+    qDebug() << "linear scan estimate for adding all shapes:"
+            << (double)shapeLinear/Lookups*Count/2/1e9 << "s";
+    return TestUtil::result("PathIndexTest");
+}
@@ -0,0 +1,517 @@
+/*  This file is part of TSRE5.
+ *
+ *  TSRE5 - train sim game engine and MSTS/OR Editors.
+ *  Copyright (C) 2016 Piotr Gadecki <pgadecki@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *
+ *  See LICENSE.md or https://www.gnu.org/licenses/gpl.html
+ */
+
+#include <tsre/texture/PixelKernels.h>
+#include <tsre/texture/AceLib.h>
+#include <tsre/texture/DdsLib.h>
+#include <tsre/texture/Texture.h>
+#include <tsre/fileFunctions/ReadFile.h>
+#include <tsre/fileFunctions/FileBuffer.h>
+#include <tsre/Game.h>
+#include "TestUtil.h"
+#include <QTemporaryDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QByteArray>
+#include <QVector>
+#include <QStringList>
+#include <QDebug>
+#include <string.h>
+#include <stdlib.h>
+
+/*
+ * Every kernel level this CPU has, scalar included, must give the same
+ * bytes as the decoder loops from before PixelKernels, kept below. They
+ * are compared on random rows and blocks and on whole ACE and DDS files:
+ * synthetic ones written here and the ones given as arguments. Timings of
+ * each level are printed next to the old loops at the end.
+ */
+
+static void fill(unsigned char* data, int count){
+    for(int i = 0; i < count; i++)
+        data[i] = TestUtil::random8();
+}
+
+static void check(bool ok, const QString &what, int level){
+    if(ok)
+        return;
+    PixelKernels::setLevel(level);
+    TestUtil::fail(what + " " + PixelKernels::levelName());
+    PixelKernels::setLevel(-1);
+}
+
+/*
+ * The loops of AceLib::run(), DdsLib::run() and the S3tc block decoders
+ * before PixelKernels replaced them. Only the three DXT block decoders
+ * are merged into one and the file headers are read from memory.
+ */
+namespace Baseline {
+
+static void interleave(const unsigned char* const* planes, int channels, unsigned char* out, int bytesPerPixel, int count){
+    for(int c = 0; c < channels; c++)
+        for(int iw = 0; iw < count; iw = iw + 1)
+            out[iw * bytesPerPixel + c] = planes[c][iw];
+}
+
+static void expandMask(const unsigned char* bufor, unsigned char* out, int count){
+    unsigned char tempt;
+    int ptr = 0;
+    for(int iw = 0; iw < count; ptr++){
+        for(int ite = 0; ite < 8; ite++){
+            tempt = (unsigned char)(bufor[ptr] << ite);
+            out[iw] = (unsigned char)(tempt >> 7)*255;
+            iw = iw + 1;
+            if(iw == count)
+                break;
+        }
+    }
+}
+
+static void expandBlock(quint32 code, const quint32* palette, unsigned char* rgba, int stride){
+    const unsigned char (*colors)[4] = (const unsigned char (*)[4])palette;
+    for (int j = 0; j < 4; ++j) {
+        for (int i = 0; i < 4; ++i) {
+            const int idx = (code >> (2 * (4 * j + i))) & 0x03;
+            unsigned char *dst = rgba + j * stride + i * 4;
+            dst[0] = colors[idx][0];
+            dst[1] = colors[idx][1];
+            dst[2] = colors[idx][2];
+            dst[3] = colors[idx][3];
+        }
+    }
+}
+
+static void expandBlockAlpha(quint64 alphaBits, const unsigned char* alphaTable, unsigned char* rgba, int stride){
+    for (int j = 0; j < 4; ++j) {
+        for (int i = 0; i < 4; ++i) {
+            const int pixelIndex = 4 * j + i;
+            const int alphaIndex = (alphaBits >> (3 * pixelIndex)) & 0x07;
+            rgba[j * stride + i * 4 + 3] = alphaTable[alphaIndex];
+        }
+    }
+}
+
+static inline void decodeRGB565(quint16 c, unsigned char &r, unsigned char &g, unsigned char &b){
+    r = static_cast<unsigned char>(((c >> 11) & 0x1F) * 255 / 31);
+    g = static_cast<unsigned char>(((c >> 5)  & 0x3F) * 255 / 63);
+    b = static_cast<unsigned char>((c & 0x1F) * 255 / 31);
+}
+
+// DXT1, DXT3 and DXT5 blocks into a 4x4 RGBA tile.
+static void decodeBlock(int blockBytes, bool dxt5, const unsigned char* block, unsigned char* rgba, bool &hasAlpha){
+    const int stride = 16;
+    const unsigned char *colorBlock = blockBytes == 8 ? block : block + 8;
+    quint16 c0 = colorBlock[0] | (colorBlock[1] << 8);
+    quint16 c1 = colorBlock[2] | (colorBlock[3] << 8);
+    unsigned char r0, g0, b0;
+    unsigned char r1, g1, b1;
+    decodeRGB565(c0, r0, g0, b0);
+    decodeRGB565(c1, r1, g1, b1);
+
+    unsigned char colors[4][4];
+    colors[0][0] = r0; colors[0][1] = g0; colors[0][2] = b0; colors[0][3] = 255;
+    colors[1][0] = r1; colors[1][1] = g1; colors[1][2] = b1; colors[1][3] = 255;
+    if (blockBytes == 16 || c0 > c1) {
+        colors[2][0] = (2 * r0 + r1) / 3;
+        colors[2][1] = (2 * g0 + g1) / 3;
+        colors[2][2] = (2 * b0 + b1) / 3;
+        colors[2][3] = 255;
+        colors[3][0] = (r0 + 2 * r1) / 3;
+        colors[3][1] = (g0 + 2 * g1) / 3;
+        colors[3][2] = (b0 + 2 * b1) / 3;
+        colors[3][3] = 255;
+    } else {
+        colors[2][0] = (r0 + r1) / 2;
+        colors[2][1] = (g0 + g1) / 2;
+        colors[2][2] = (b0 + b1) / 2;
+        colors[2][3] = 255;
+        colors[3][0] = 0;
+        colors[3][1] = 0;
+        colors[3][2] = 0;
+        colors[3][3] = 0;
+        hasAlpha = true;
+    }
+    const quint32 code = colorBlock[4] | (colorBlock[5] << 8) | (colorBlock[6] << 16) | ((quint32)colorBlock[7] << 24);
+
+    unsigned char alphaTable[8];
+    quint64 alphaBits = 0;
+    if (dxt5) {
+        const unsigned char alpha0 = block[0];
+        const unsigned char alpha1 = block[1];
+        alphaTable[0] = alpha0;
+        alphaTable[1] = alpha1;
+        if (alpha0 > alpha1) {
+            alphaTable[2] = (6 * alpha0 + 1 * alpha1) / 7;
+            alphaTable[3] = (5 * alpha0 + 2 * alpha1) / 7;
+            alphaTable[4] = (4 * alpha0 + 3 * alpha1) / 7;
+            alphaTable[5] = (3 * alpha0 + 4 * alpha1) / 7;
+            alphaTable[6] = (2 * alpha0 + 5 * alpha1) / 7;
+            alphaTable[7] = (1 * alpha0 + 6 * alpha1) / 7;
+        } else {
+            alphaTable[2] = (4 * alpha0 + 1 * alpha1) / 5;
+            alphaTable[3] = (3 * alpha0 + 2 * alpha1) / 5;
+            alphaTable[4] = (2 * alpha0 + 3 * alpha1) / 5;
+            alphaTable[5] = (1 * alpha0 + 4 * alpha1) / 5;
+            alphaTable[6] = 0;
+            alphaTable[7] = 255;
+        }
+        for (int i = 0; i < 6; ++i)
+            alphaBits |= ((quint64)block[2 + i] << (8 * i));
+    } else if (blockBytes == 16) {
+        for (int i = 0; i < 8; ++i)
+            alphaBits |= ((quint64)block[i] << (8 * i));
+    }
+
+    for (int j = 0; j < 4; ++j) {
+        for (int i = 0; i < 4; ++i) {
+            const int pixelIndex = 4 * j + i;
+            const int colorIndex = (code >> (2 * pixelIndex)) & 0x03;
+            unsigned char *dst = rgba + j * stride + i * 4;
+            dst[0] = colors[colorIndex][0];
+            dst[1] = colors[colorIndex][1];
+            dst[2] = colors[colorIndex][2];
+            if (dxt5)
+                dst[3] = alphaTable[(alphaBits >> (3 * pixelIndex)) & 0x07];
+            else if (blockBytes == 16)
+                dst[3] = ((alphaBits >> (4 * pixelIndex)) & 0x0F) * 17;
+            else
+                dst[3] = colors[colorIndex][3];
+        }
+    }
+}
+
+// Uncompressed ACE as AceLib::run() decoded it, empty for other files.
+static QByteArray decodeAce(const unsigned char* bufor, int length){
+    int typ = -1;
+    if (length < 216) return QByteArray();
+    if (bufor[36] == 3) typ = 0;
+    if (bufor[36] == 4) typ = 2;
+    if (bufor[36] == 5) typ = 1;
+    const int dane = bufor[20];
+    const int width = bufor[25] * 256 + bufor[24];
+    const int height = bufor[29] * 256 + bufor[28];
+    if (typ < 0 || bufor[32] == 18 || width <= 1 || height <= 1) return QByteArray();
+    const int bytesPerPixel = typ == 0 ? 3 : 4;
+    int ptr = 0;
+    if (typ == 0) ptr = 216;
+    if (typ == 1) ptr = 248;
+    if (typ == 2) ptr = 232;
+    if (dane == 0) ptr += height * 4;
+    else if (dane == 1) ptr += height * 8 - 4;
+    else if (dane == 4) ptr += height * 4;
+    else if (dane == 5) ptr += height * 8 - 4;
+    int row = 3 * width + (typ == 1 ? height / 8 + width : typ == 2 ? (width + 7) / 8 : 0);
+    if (ptr + height * row > length) return QByteArray();
+
+    QByteArray image(width * height * bytesPerPixel, 0);
+    unsigned char* out = (unsigned char*)image.data();
+    for (int ih = 0; ih < height; ih++) {
+        unsigned char* line = out + bytesPerPixel * width * ih;
+        const unsigned char* planes[4] = { bufor + ptr, bufor + ptr + width, bufor + ptr + 2 * width, NULL };
+        interleave(planes, 3, line, bytesPerPixel, width);
+        ptr += 3 * width;
+        if (typ == 1) {
+            ptr += height / 8;
+            planes[3] = bufor + ptr;
+            interleave(planes + 3, 1, line + 3, bytesPerPixel, width);
+            ptr += width;
+        }
+        if (typ == 2) {
+            unsigned char* alpha = new unsigned char[width];
+            expandMask(bufor + ptr, alpha, width);
+            const unsigned char* mask = alpha;
+            interleave(&mask, 1, line + 3, bytesPerPixel, width);
+            delete[] alpha;
+            ptr += (width + 7) / 8;
+        }
+    }
+    return image;
+}
+
+// DXT1, DXT3 and DXT5 DDS as DdsLib::run() decoded them, empty for other files.
+static QByteArray decodeDds(const unsigned char* data, int length){
+    if (length < 128 || memcmp(data, "DDS ", 4) != 0) return QByteArray();
+    quint32 header[32];
+    memcpy(header, data, sizeof(header));
+    const int height = header[3];
+    const int width = header[4];
+    const quint32 flags = header[20];
+    int blockBytes = 0;
+    if (memcmp(&header[21], "DXT1", 4) == 0) blockBytes = 8;
+    if (memcmp(&header[21], "DXT3", 4) == 0 || memcmp(&header[21], "DXT5", 4) == 0) blockBytes = 16;
+    const bool dxt5 = memcmp(&header[21], "DXT5", 4) == 0;
+    const int blocksWide = (width + 3) / 4;
+    const int blocksHigh = (height + 3) / 4;
+    if (!(flags & 0x4) || blockBytes == 0 || width <= 0 || height <= 0
+            || 128 + blocksWide * blocksHigh * blockBytes > length)
+        return QByteArray();
+
+    QByteArray image(width * height * 4, 0);
+    unsigned char* dst = (unsigned char*)image.data();
+    const unsigned char* blockPtr = data + 128;
+    bool hasAlpha = false;
+    for (int by = 0; by < blocksHigh; ++by) {
+        for (int bx = 0; bx < blocksWide; ++bx) {
+            unsigned char tile[4 * 4 * 4];
+            decodeBlock(blockBytes, dxt5, blockPtr, tile, hasAlpha);
+            for (int j = 0; j < 4 && by * 4 + j < height; ++j)
+                for (int i = 0; i < 4 && bx * 4 + i < width; ++i)
+                    memcpy(dst + ((by * 4 + j) * width + bx * 4 + i) * 4, &tile[(j * 4 + i) * 4], 4);
+            blockPtr += blockBytes;
+        }
+    }
+    // DXT1 without alpha was packed to RGB.
+    if (blockBytes == 8 && !hasAlpha && !(flags & 0x1)) {
+        QByteArray rgb(width * height * 3, 0);
+        for (int i = 0; i < width * height; i++)
+            memcpy(rgb.data() + i * 3, dst + i * 4, 3);
+        return rgb;
+    }
+    return image;
+}
+
+static QByteArray decode(const QString &path){
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return QByteArray();
+    if (path.toLower().endsWith(".dds")) {
+        QByteArray data = file.readAll();
+        return decodeDds((const unsigned char*)data.constData(), data.size());
+    }
+    FileBuffer* data = ReadFile::read(&file);
+    QByteArray image = decodeAce(data->data, data->length);
+    delete data;
+    return image;
+}
+
+}
+
+static void checkRows(int level){
+    const int max = 300;
+    unsigned char r[max], g[max], b[max], a[max];
+    unsigned char expected[max*4 + 16];
+    unsigned char out[max*4 + 16];
+    const unsigned char* planes[4] = { r, g, b, a };
+    PixelKernels::setLevel(level);
+    for(int count = 0; count <= max; count++){
+        fill(r, count); fill(g, count); fill(b, count); fill(a, count);
+
+        memset(expected, 7, sizeof(expected));
+        memset(out, 7, sizeof(out));
+        Baseline::interleave(planes, 3, expected, 3, count);
+        PixelKernels::interleaveRGB(r, g, b, out, count);
+        check(memcmp(expected, out, sizeof(out)) == 0, "interleaveRGB", level);
+
+        memset(expected, 7, sizeof(expected));
+        memset(out, 7, sizeof(out));
+        Baseline::interleave(planes, 4, expected, 4, count);
+        PixelKernels::interleaveRGBA(r, g, b, a, out, count);
+        check(memcmp(expected, out, sizeof(out)) == 0, "interleaveRGBA", level);
+
+        memset(expected, 7, sizeof(expected));
+        memset(out, 7, sizeof(out));
+        Baseline::expandMask(r, expected, count);
+        PixelKernels::expandMask(r, out, count);
+        check(memcmp(expected, out, sizeof(out)) == 0, "expandMask", level);
+    }
+}
+
+static void checkBlocks(int level){
+    const int strides[] = { 16, 64, 68 };
+    PixelKernels::setLevel(level);
+    for(int s = 0; s < 3; s++){
+        const int stride = strides[s];
+        unsigned char expected[68*4];
+        unsigned char out[68*4];
+        for(int i = 0; i < 1000; i++){
+            quint32 palette[4];
+            for(int j = 0; j < 4; j++)
+                palette[j] = TestUtil::random32();
+            quint32 code = TestUtil::random32();
+            fill(expected, sizeof(expected));
+            memcpy(out, expected, sizeof(out));
+            Baseline::expandBlock(code, palette, expected, stride);
+            PixelKernels::expandBlock(code, palette, out, stride);
+            check(memcmp(expected, out, sizeof(out)) == 0, "expandBlock", level);
+
+            unsigned char table[8];
+            fill(table, 8);
+            quint64 bits = (quint64)TestUtil::random32() << 32 | TestUtil::random32();
+            bits &= 0xFFFFFFFFFFFFull;
+            Baseline::expandBlockAlpha(bits, table, expected, stride);
+            PixelKernels::expandBlockAlpha(bits, table, out, stride);
+            check(memcmp(expected, out, sizeof(out)) == 0, "expandBlockAlpha", level);
+        }
+    }
+}
+
+/*
+ * Uncompressed ACE, channels is 3 for RGB, 4 for a 1-bit mask
+ * and 5 for 8-bit alpha, see AceLib::run().
+ */
+static void writeAce(const QString &path, int width, int height, int channels){
+    int typ = channels == 3 ? 0 : channels == 5 ? 1 : 2;
+    int header = typ == 0 ? 216 : typ == 1 ? 248 : 232;
+    int row = 3*width;
+    if(typ == 1) row += height/8 + width;
+    if(typ == 2) row += (width + 7)/8;
+    QByteArray data(header + height*4 + height*row, 0);
+    fill((unsigned char*)data.data() + header, data.size() - header);
+    memcpy(data.data(), "SIMISA@@@@@@@@@@", 16);
+    data[20] = 0;
+    data[24] = width & 0xFF;
+    data[25] = width >> 8;
+    data[28] = height & 0xFF;
+    data[29] = height >> 8;
+    data[32] = 0;
+    data[36] = channels;
+    QFile file(path);
+    file.open(QIODevice::WriteOnly);
+    file.write(data);
+}
+
+static void writeDds(const QString &path, int width, int height, const char* fourCC){
+    int blockBytes = strcmp(fourCC, "DXT1") == 0 ? 8 : 16;
+    int size = ((width + 3)/4)*((height + 3)/4)*blockBytes;
+    QByteArray data(4 + 124 + size, 0);
+    unsigned char* d = (unsigned char*)data.data();
+    quint32 header[32];
+    memset(header, 0, sizeof(header));
+    memcpy(header, "DDS ", 4);
+    header[1] = 124;
+    header[2] = 0x81007;
+    header[3] = height;
+    header[4] = width;
+    header[5] = size;
+    header[7] = 1;
+    header[19] = 32;
+    header[20] = 0x4;
+    memcpy(&header[21], fourCC, 4);
+    header[27] = 0x1000;
+    memcpy(d, header, sizeof(header));
+    fill(d + 128, size);
+    QFile file(path);
+    file.open(QIODevice::WriteOnly);
+    file.write(data);
+}
+
+static QByteArray decode(const QString &path){
+    Texture texture(path);
+    TexDecoder* decoder;
+    if(path.toLower().endsWith(".dds"))
+        decoder = new DdsLib();
+    else
+        decoder = new AceLib();
+    decoder->texture = &texture;
+    decoder->run();
+    delete decoder;
+    if(!texture.loaded || texture.imageData == nullptr)
+        return QByteArray();
+    QByteArray out((const char*)texture.imageData, texture.width*texture.height*texture.bytesPerPixel);
+    delete[] texture.imageData;
+    return out;
+}
+
+static void checkFile(const QString &path, const QVector<int> &levels){
+    QByteArray expected = Baseline::decode(path);
+    if(expected.isEmpty()){
+        TestUtil::fail("not an uncompressed ACE or a DXT1/3/5 DDS file " + path);
+        return;
+    }
+    for(int i = 0; i < levels.size(); i++){
+        PixelKernels::setLevel(levels[i]);
+        check(decode(path) == expected, path, levels[i]);
+    }
+}
+
+static void benchmark(const QVector<int> &levels){
+    const int width = 2048;
+    const int height = 2048;
+    QByteArray planes(width*5, 0);
+    fill((unsigned char*)planes.data(), planes.size());
+    const unsigned char* r = (const unsigned char*)planes.constData();
+    const unsigned char* rows[4] = { r, r + width, r + 2*width, r + 3*width };
+    QByteArray pixels(width*height*4, 0);
+    unsigned char* out = (unsigned char*)pixels.data();
+    quint32 palette[4] = { TestUtil::random32(), TestUtil::random32(), TestUtil::random32(), TestUtil::random32() };
+    unsigned char table[8];
+    fill(table, 8);
+    QElapsedTimer timer;
+
+    timer.start();
+    for(int y = 0; y < height; y++)
+        Baseline::interleave(rows, 4, out + y*width*4, 4, width);
+    qint64 baselineRows = timer.nsecsElapsed();
+    timer.start();
+    for(int y = 0; y < height; y += 4)
+        for(int x = 0; x < width; x += 4){
+            Baseline::expandBlock(x*y, palette, out + (y*width + x)*4, width*4);
+            Baseline::expandBlockAlpha((quint64)x*y*2654435761u, table, out + (y*width + x)*4, width*4);
+        }
+    qint64 baselineBlocks = timer.nsecsElapsed();
+
+    for(int i = 0; i < levels.size(); i++){
+        PixelKernels::setLevel(levels[i]);
+        timer.start();
+        for(int y = 0; y < height; y++)
+            PixelKernels::interleaveRGBA(rows[0], rows[1], rows[2], rows[3], out + y*width*4, width);
+        qint64 kernelRows = timer.nsecsElapsed();
+        timer.start();
+        for(int y = 0; y < height; y += 4)
+            for(int x = 0; x < width; x += 4){
+                PixelKernels::expandBlock(x*y, palette, out + (y*width + x)*4, width*4);
+                PixelKernels::expandBlockAlpha((quint64)x*y*2654435761u, table, out + (y*width + x)*4, width*4);
+            }
+        qint64 kernelBlocks = timer.nsecsElapsed();
+        TestUtil::printTimes(QString("%1 %2x%3 ACE rows").arg(PixelKernels::levelName()).arg(width).arg(height),
+                kernelRows, baselineRows);
+        TestUtil::printTimes(QString("%1 %2x%3 DXT5 blocks").arg(PixelKernels::levelName()).arg(width).arg(height),
+                kernelBlocks, baselineBlocks);
+    }
+}
+
+int main(int argc, char** argv){
+    Game::textureCompression = false;
+    Game::useTextureCache = false;
+    AceLib::IsThread = true;
+
+    QVector<int> levels;
+    for(int level = PixelKernels::Scalar; level <= PixelKernels::NEON; level++)
+        if(PixelKernels::supported(level))
+            levels.push_back(level);
+
+    for(int i = 0; i < levels.size(); i++){
+        checkRows(levels[i]);
+        checkBlocks(levels[i]);
+    }
+
+    QTemporaryDir dir;
+    QStringList files;
+    const int channels[] = { 3, 4, 5 };
+    for(int i = 0; i < 3; i++){
+        files.push_back(dir.path() + QString("/test%1.ace").arg(channels[i]));
+        writeAce(files.last(), 262, 130, channels[i]);
+    }
+    const char* formats[] = { "DXT1", "DXT3", "DXT5" };
+    for(int i = 0; i < 3; i++){
+        files.push_back(dir.path() + QString("/test_%1.dds").arg(formats[i]));
+        writeDds(files.last(), 260, 132, formats[i]);
+    }
+    for(int i = 1; i < argc; i++)
+        files.push_back(QString::fromLocal8Bit(argv[i]));
+    for(int i = 0; i < files.size(); i++)
+        checkFile(files[i], levels);
+
+    benchmark(levels);
+    PixelKernels::setLevel(-1);
+
+    qDebug() << files.size() << "files checked";
+    return TestUtil::result("PixelKernelsTest");
+}
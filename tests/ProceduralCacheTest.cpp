@@ -0,0 +1,173 @@
+/*  This file is part of TSRE5.
+ *
+ *  TSRE5 - train sim game engine and MSTS/OR Editors.
+ *  Copyright (C) 2016 Piotr Gadecki <pgadecki@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *
+ *  See LICENSE.md or https://www.gnu.org/licenses/gpl.html
+ */
+
+#include <tsre/procedural/ProceduralCache.h>
+#include <tsre/procedural/ProceduralShape.h>
+#include <tsre/fileFunctions/FileBuffer.h>
+#include <tsre/Game.h>
+#include "TestUtil.h"
+#include <QTemporaryDir>
+#include <QCryptographicHash>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QFileInfo>
+#include <QFile>
+#include <QDir>
+#include <QDebug>
+#include <string.h>
+
+/*
+ * ProceduralCache::open() on files written by ProceduralCache::write().
+ * A written shape is a hit with the same parts. Other shapes, changed
+ * procedural files, another route and damaged files are a miss.
+ */
+
+static const QString Hash = "track;A1t;10;0;0.5";
+
+static QString cachePath(const QString &hash){
+    return Game::root + "/routes/" + Game::route + "/tsre_cache/procedural/"
+            + QCryptographicHash::hash(hash.toUtf8(), QCryptographicHash::Sha1).toHex();
+}
+
+static QVector<ProceduralPart> makeParts(){
+    QVector<ProceduralPart> parts;
+    for(int i = 0; i < 3; i++){
+        ProceduralPart part;
+        part.texture = QString("rails_%1.ace").arg(i);
+        part.minDistance = i*100;
+        part.maxDistance = (i + 1)*500;
+        for(int j = 0; j < 12*30*(i + 1); j++)
+            part.data.push_back(TestUtil::randomFloat(-100, 100));
+        parts.push_back(part);
+    }
+    return parts;
+}
+
+// The cache is written on its own thread and has nothing to wait on.
+static QByteArray waitForFile(const QString &path){
+    for(int i = 0; i < 1000; i++){
+        QFile file(path);
+        if(file.open(QIODevice::ReadOnly))
+            return file.readAll();
+        QThread::msleep(10);
+    }
+    return QByteArray();
+}
+
+static void writeFile(const QString &path, const QByteArray &data){
+    QDir().mkpath(QFileInfo(path).path());
+    QFile file(path);
+    file.open(QIODevice::WriteOnly);
+    file.write(data);
+}
+
+static bool hit(){
+    int partCount;
+    FileBuffer* data = ProceduralCache::open(Hash, partCount);
+    bool found = data != NULL;
+    delete data;
+    return found;
+}
+
+static void checkParts(const QVector<ProceduralPart> &parts){
+    int partCount = 0;
+    FileBuffer* data = ProceduralCache::open(Hash, partCount);
+    TestUtil::check(data != NULL, "written shape missed");
+    if(data == NULL)
+        return;
+    TestUtil::check(partCount == parts.size(), "part count");
+    for(int i = 0; i < partCount && i < parts.size(); i++){
+        int textureLength = data->getInt();
+        QString texture = QString::fromUtf8((const char*)data->data + data->off, textureLength);
+        data->off += textureLength;
+        float minDistance = data->getFloat();
+        float maxDistance = data->getFloat();
+        int count = data->getInt();
+        TestUtil::check(texture == parts[i].texture, "part texture");
+        TestUtil::check(minDistance == parts[i].minDistance && maxDistance == parts[i].maxDistance, "part distances");
+        TestUtil::check(count == parts[i].data.size()
+                && memcmp(data->data + data->off, parts[i].data.constData(), count*4) == 0, "part vertex data");
+        data->off += count*4;
+    }
+    delete data;
+}
+
+// The file with the int at offset replaced by value.
+static QByteArray damaged(QByteArray file, int offset, int value){
+    memcpy(file.data() + offset, &value, 4);
+    return file;
+}
+
+int main(){
+    QTemporaryDir dir;
+    Game::root = dir.path();
+    Game::route = "test";
+    QDir().mkpath(Game::root + "/routes/test");
+    TestUtil::seed(14);
+
+    QVector<ProceduralPart> parts = makeParts();
+    TestUtil::check(!hit(), "hit without a file");
+    ProceduralCache::write(Hash, parts);
+    QByteArray file = waitForFile(cachePath(Hash));
+    TestUtil::check(file.size() > ProceduralCache::HeaderLength, "no cache file");
+    checkParts(parts);
+
+    QElapsedTimer timer;
+    timer.start();
+    bool hits = true;
+    for(int i = 0; i < 1000; i++)
+        hits &= hit();
+    qDebug() << "1000 cache hits in" << timer.nsecsElapsed()/1000 << "us";
+    TestUtil::check(hits, "repeated hits");
+
+    int partCount;
+    TestUtil::check(ProceduralCache::open(Hash + ";1", partCount) == NULL, "hit for another shape");
+    // Same name, another key inside, like a hash collision.
+    writeFile(cachePath(Hash + ";1"), file);
+    TestUtil::check(ProceduralCache::open(Hash + ";1", partCount) == NULL, "hit for another key");
+
+    int keyEnd = ProceduralCache::HeaderLength + Hash.toUtf8().size();
+    struct Damage {
+        const char* what;
+        QByteArray data;
+    };
+    Damage damages[] = {
+        { "empty file", QByteArray() },
+        { "truncated header", file.left(20) },
+        { "truncated parts", file.left(file.size() - 5) },
+        { "magic", damaged(file, 0, 0) },
+        { "version", damaged(file, 8, 99) },
+        { "key length", damaged(file, 12, 1000) },
+        { "stamp", damaged(file, 16, 12345) },
+        { "zero parts", damaged(file, 24, 0) },
+        { "negative parts", damaged(file, 24, -1) },
+        { "too many parts", damaged(file, 24, 4) },
+        { "negative texture length", damaged(file, keyEnd, -8) },
+        { "texture length past the end", damaged(file, keyEnd, file.size()) },
+        { "negative vertex count", damaged(file, keyEnd + 4 + parts[0].texture.size() + 8, -12) },
+        { "vertex count past the end", damaged(file, keyEnd + 4 + parts[0].texture.size() + 8, file.size()) }
+    };
+    for(unsigned int i = 0; i < sizeof(damages)/sizeof(Damage); i++){
+        writeFile(cachePath(Hash), damages[i].data);
+        TestUtil::check(!hit(), QString("hit on a damaged file: ") + damages[i].what);
+    }
+    writeFile(cachePath(Hash), file);
+    TestUtil::check(hit(), "hit after restoring the file");
+
+    // The stamp follows the route, a file stamped for another route misses.
+    Game::route = "other";
+    writeFile(Game::root + "/routes/other/procedural/rails.obj", "v 0 0 0\n");
+    writeFile(cachePath(Hash), file);
+    TestUtil::check(!hit(), "hit with the stamp of another route");
+    Game::route = "test";
+    TestUtil::check(hit(), "miss after going back to the route");
+
+    return TestUtil::result("ProceduralCacheTest");
+}
@@ -0,0 +1,128 @@
+/*  This file is part of TSRE5.
+ *
+ *  TSRE5 - train sim game engine and MSTS/OR Editors.
+ *  Copyright (C) 2016 Piotr Gadecki <pgadecki@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *
+ *  See LICENSE.md or https://www.gnu.org/licenses/gpl.html
+ */
+
+#include <tsre/world/Tile.h>
+#include <tsre/world/Route.h>
+#include <tsre/world/Trk.h>
+#include <tsre/shape/ShapeLib.h>
+#include <tsre/fileFunctions/SaveQueue.h>
+#include <tsre/Game.h>
+#include "TestUtil.h"
+#include <QTemporaryDir>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <QFile>
+#include <QDir>
+#include <QDebug>
+
+/*
+ * Tile::SaveAll() serializes tiles in parallel and must write the same
+ * bytes as Tile::save() called for one tile after another, in text and
+ * in binary. The time the main thread waits for both is printed.
+ */
+
+static const int Tiles = 16;
+static const int Objects = 2000;
+
+static QString worldPath(int x){
+    return Game::root + "/routes/" + Game::route + "/world/w" + Tile::getNameXY(x) + Tile::getNameXY(0) + ".w";
+}
+
+static void writeWorld(int x){
+    QFile file(worldPath(x));
+    file.open(QIODevice::WriteOnly);
+    QTextStream out(&file);
+    out.setEncoding(QStringConverter::Utf16);
+    out.setGenerateByteOrderMark(true);
+    out << "SIMISA@@@@@@@@@@JINX0w0t______\n\nTr_Worldfile (\n";
+    const char* types[] = { "Static", "TrackObj", "Forest", "Gantry" };
+    for(int i = 0; i < Objects; i++){
+        out << "\t" << types[i % 4] << " (\n\t\tUiD ( " << i + 1 << " )\n";
+        if(i % 4 == 1)
+            out << "\t\tSectionIdx ( 31 )\n\t\tElevation ( 0.01 )\n";
+        if(i % 4 == 2)
+            out << "\t\tTreeTexture ( trees.ace )\n\t\tScaleRange ( 0.8 1.2 )\n\t\tArea ( 100 50 )\n"
+                   "\t\tTreeSize ( 6 10 )\n\t\tPopulation ( " << i % 300 << " )\n";
+        else
+            out << "\t\tFileName ( object_" << (x*Objects + i) % 500 << ".s )\n";
+        out << "\t\tPosition ( " << i % 2048 - 1024 << ".5 " << x << ".25 " << (i*7) % 2048 - 1024 << ".75 )\n";
+        out << "\t\tQDirection ( 0 0.382683 0 0.92388 )\n\t\tVDbId ( 4294967294 )\n";
+        out << "\t\tStaticDetailLevel ( " << i % 3 << " )\n\t\tStaticFlags ( 00100000 )\n\t)\n";
+    }
+    out << ")";
+}
+
+static QVector<QByteArray> readAll(){
+    QVector<QByteArray> data;
+    for(int x = 0; x < Tiles; x++){
+        QFile file(worldPath(x));
+        file.open(QIODevice::ReadOnly);
+        data.push_back(file.readAll());
+    }
+    return data;
+}
+
+static void compare(const QString &name, QVector<Tile*> &tiles){
+    QElapsedTimer timer;
+    timer.start();
+    for(int i = 0; i < tiles.size(); i++)
+        tiles[i]->save();
+    qint64 inTurn = timer.nsecsElapsed();
+    SaveQueue::WaitForDone();
+    QVector<QByteArray> expected = readAll();
+
+    timer.start();
+    Tile::SaveAll(tiles);
+    qint64 parallel = timer.nsecsElapsed();
+    SaveQueue::WaitForDone();
+    QVector<QByteArray> saved = readAll();
+
+    for(int x = 0; x < Tiles; x++){
+        TestUtil::check(!expected[x].isEmpty(), name + QString(": tile %1 not saved").arg(x));
+        TestUtil::check(saved[x] == expected[x], name + QString(": tile %1 differs").arg(x));
+    }
+    TestUtil::printTimes(QString("%1 tiles of %2 objects, %3 SaveAll() against save() in turn")
+            .arg(Tiles).arg(Objects).arg(name), parallel, inTurn);
+}
+
+int main(){
+    QTemporaryDir dir;
+    Game::root = dir.path();
+    Game::route = "test";
+    QDir().mkpath(Game::root + "/routes/test/world");
+    Game::currentShapeLib = new ShapeLib();
+    // Tiles are saved sorted by detail level, as in the editor.
+    Route route;
+    route.trk = new Trk();
+    Game::currentRoute = &route;
+
+    QVector<Tile*> tiles;
+    for(int x = 0; x < Tiles; x++){
+        writeWorld(x);
+        Tile* tile = new Tile();
+        tile->x = x;
+        tile->loadData();
+        tile->finishLoad(false);
+        TestUtil::check(tile->jestObiektow == Objects, QString("tile %1 objects").arg(x));
+        tiles.push_back(tile);
+    }
+
+    compare("text", tiles);
+    Game::saveBinaryWorld = true;
+    compare("binary", tiles);
+    Game::saveBinaryWorld = false;
+
+    for(int i = 0; i < tiles.size(); i++){
+        tiles[i]->release();
+        delete tiles[i];
+    }
+    Game::currentRoute = NULL;
+    return TestUtil::result("SaveTest");
+}
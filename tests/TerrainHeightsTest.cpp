@@ -0,0 +1,115 @@
+/*  This file is part of TSRE5.
+ *
+ *  TSRE5 - train sim game engine and MSTS/OR Editors.
+ *  Copyright (C) 2016 Piotr Gadecki <pgadecki@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *
+ *  See LICENSE.md or https://www.gnu.org/licenses/gpl.html
+ */
+
+#include <tsre/world/TerrainLib.h>
+#include <tsre/world/Terrain.h>
+#include <tsre/world/TFile.h>
+#include <tsre/Game.h>
+#include "TestUtil.h"
+#include <QElapsedTimer>
+#include <vector>
+#include <math.h>
+
+/*
+ * TerrainLib::getHeights() on 1M points spread over 4x4 synthetic tiles
+ * has to give the same heights as getHeight() per point, including points
+ * outside their tile. The time of both is printed.
+ */
+
+class TestTerrain : public Terrain {
+public:
+    TestTerrain(int x, int z) {
+        mojex = x;
+        mojez = z;
+        tfile = new TFile();
+        tfile->nsamples = new int(256);
+        tfile->sampleSize = new float(8);
+        terrainData = new float*[257];
+        for(int i = 0; i < 257; i++){
+            terrainData[i] = new float[257];
+            for(int j = 0; j < 257; j++)
+                terrainData[i][j] = 100*sin((x*256 + j)*0.05) + 50*cos((z*256 + i)*0.03) + ((i*31 + j*17) % 7)*0.25;
+        }
+        loaded = true;
+    }
+};
+
+// Same lookup as TerrainLibSimple, which keeps its tiles private.
+class TestTerrainLib : public TerrainLib {
+public:
+    std::unordered_map<int, Terrain*> terrain;
+
+    Terrain* getTerrainByXY(int x, int y, bool load = false){
+        return terrain[x*10000+y];
+    }
+
+    float getHeight(int x, int z, float posx, float posz, bool addR){
+        Game::check_coords(x, z, posx, posz);
+        Terrain *terr = terrain[x*10000+z];
+        if (terr == NULL || !terr->loaded)
+            return -1;
+        return terr->getHeight(x, z, posx, posz, addR);
+    }
+};
+
+int main(){
+    TestTerrainLib lib;
+    for(int x = 0; x < 4; x++)
+        for(int z = 0; z < 4; z++)
+            lib.terrain[x*10000+z] = new TestTerrain(x, z);
+
+    const int count = 1000000;
+    std::vector<int> tileX(count), tileZ(count);
+    std::vector<float> posX(count), posZ(count);
+    for(int i = 0; i < count; i++){
+        tileX[i] = (int)TestUtil::randomFloat(0, 3.99);
+        tileZ[i] = (int)TestUtil::randomFloat(0, 3.99);
+        posX[i] = TestUtil::randomFloat(-1024, 1023);
+        posZ[i] = TestUtil::randomFloat(-1024, 1023);
+        // Some points given relative to a neighbour tile.
+        if(i % 10 == 0 && tileX[i] > 0){
+            tileX[i]--;
+            posX[i] += 2048;
+        }
+    }
+
+    for(int r = 0; r < 2; r++){
+        bool addR = r == 1;
+        QElapsedTimer timer;
+        timer.start();
+        std::vector<float> expected(count);
+        for(int i = 0; i < count; i++)
+            expected[i] = lib.getHeight(tileX[i], tileZ[i], posX[i], posZ[i], addR);
+        qint64 single = timer.nsecsElapsed();
+
+        timer.start();
+        std::vector<float> heights(count);
+        lib.getHeights(count, tileX.data(), tileZ.data(), posX.data(), posZ.data(), heights.data(), NULL, addR);
+        qint64 batch = timer.nsecsElapsed();
+
+        std::vector<float> normals(count*3);
+        timer.start();
+        lib.getHeights(count, tileX.data(), tileZ.data(), posX.data(), posZ.data(), heights.data(), normals.data(), addR);
+        qint64 batchNormals = timer.nsecsElapsed();
+
+        int wrong = 0;
+        for(int i = 0; i < count; i++){
+            if(heights[i] != expected[i])
+                wrong++;
+            float* n = &normals[i*3];
+            if(fabs(n[0]*n[0] + n[1]*n[1] + n[2]*n[2] - 1) > 1e-4 || n[1] <= 0)
+                wrong++;
+        }
+        TestUtil::check(wrong == 0, QString("addR %1: %2 points differ").arg(addR).arg(wrong));
+        TestUtil::printTimes(QString("%1 points addR %2, getHeights").arg(count).arg(addR), batch, single);
+        TestUtil::printTimes(QString("%1 points addR %2, getHeights with normals").arg(count).arg(addR), batchNormals, single);
+    }
+    return TestUtil::result("TerrainHeightsTest");
+}
@@ -0,0 +1,61 @@
+/*  This file is part of TSRE5.
+ *
+ *  TSRE5 - train sim game engine and MSTS/OR Editors.
+ *  Copyright (C) 2016 Piotr Gadecki <pgadecki@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *
+ *  See LICENSE.md or https://www.gnu.org/licenses/gpl.html
+ */
+
+#include "TestUtil.h"
+#include <QDebug>
+
+int TestUtil::failures = 0;
+unsigned int TestUtil::state = 1;
+
+void TestUtil::check(bool ok, const QString &what){
+    if(!ok)
+        fail(what);
+}
+
+void TestUtil::fail(const QString &what){
+    qDebug() << "FAIL:" << qPrintable(what);
+    failures++;
+}
+
+void TestUtil::seed(unsigned int value){
+    state = value;
+}
+
+unsigned int TestUtil::random(){
+    state = state*1103515245 + 12345;
+    return state;
+}
+
+unsigned char TestUtil::random8(){
+    return random() >> 16;
+}
+
+quint32 TestUtil::random32(){
+    return (quint32)random8() | (quint32)random8() << 8 | (quint32)random8() << 16 | (quint32)random8() << 24;
+}
+
+float TestUtil::randomFloat(float min, float max){
+    return min + (max - min)*((random() >> 8) & 0xFFFF)/65535.0f;
+}
+
+// Microseconds, with the speedup over the replaced code.
+void TestUtil::printTimes(const QString &what, qint64 nsecs, qint64 replacedNsecs){
+    qDebug() << qPrintable(what + ":") << nsecs/1000 << "us, replaced code" << replacedNsecs/1000 << "us,"
+            << qPrintable(QString::number((double)replacedNsecs/qMax(nsecs, (qint64)1), 'f', 1) + "x");
+}
+
+int TestUtil::result(const QString &name){
+    if(failures > 0){
+        qDebug() << qPrintable(name + ":") << failures << "failures";
+        return 1;
+    }
+    qDebug() << qPrintable(name + ": passed");
+    return 0;
+}
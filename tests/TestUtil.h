@@ -0,0 +1,41 @@
+/*  This file is part of TSRE5.
+ *
+ *  TSRE5 - train sim game engine and MSTS/OR Editors.
+ *  Copyright (C) 2016 Piotr Gadecki <pgadecki@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *
+ *  See LICENSE.md or https://www.gnu.org/licenses/gpl.html
+ */
+
+#ifndef TESTUTIL_H
+#define	TESTUTIL_H
+
+#include <QString>
+#include <QtGlobal>
+
+/*
+ * Shared by the headless tests: failed checks are printed and counted,
+ * random data comes from one repeatable sequence and benchmarks print
+ * the time of the new code next to the code it replaced.
+ */
+class TestUtil {
+public:
+    static int failures;
+
+    static void check(bool ok, const QString &what);
+    static void fail(const QString &what);
+
+    static void seed(unsigned int value);
+    static unsigned int random();
+    static unsigned char random8();
+    static quint32 random32();
+    static float randomFloat(float min, float max);
+
+    static void printTimes(const QString &what, qint64 nsecs, qint64 replacedNsecs);
+    static int result(const QString &name);
+private:
+    static unsigned int state;
+};
+
+#endif	/* TESTUTIL_H */
@@ -0,0 +1,116 @@
+/*  This file is part of TSRE5.
+ *
+ *  TSRE5 - train sim game engine and MSTS/OR Editors.
+ *  Copyright (C) 2016 Piotr Gadecki <pgadecki@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *
+ *  See LICENSE.md or https://www.gnu.org/licenses/gpl.html
+ */
+
+#include <tsre/world/Tile.h>
+#include <tsre/world/objects/WorldObj.h>
+#include <tsre/fileFunctions/TokenWriter.h>
+#include <tsre/Game.h>
+#include "TestUtil.h"
+#include <QTemporaryDir>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <QThread>
+#include <QFile>
+#include <QDir>
+#include <QDebug>
+
+/*
+ * Reopen time of a large text .w tile with TileCache.
+ * The first load parses the text and queues the cache file, the second
+ * load reads the cache. Both must give the same objects. The cache is
+ * off by default, so loading with it off must not write one.
+ */
+
+static const int Objects = 20000;
+
+static QString worldPath(){
+    return Game::root + "/routes/" + Game::route + "/world/w" + Tile::getNameXY(0) + Tile::getNameXY(0) + ".w";
+}
+
+static QString cachePath(){
+    return Game::root + "/routes/" + Game::route + "/tsre_cache/world/w" + Tile::getNameXY(0) + Tile::getNameXY(0) + ".w";
+}
+
+static void writeWorld(){
+    QFile file(worldPath());
+    file.open(QIODevice::WriteOnly);
+    QTextStream out(&file);
+    out.setEncoding(QStringConverter::Utf16);
+    out.setGenerateByteOrderMark(true);
+    out << "SIMISA@@@@@@@@@@JINX0w0t______\n\nTr_Worldfile (\n";
+    for(int i = 0; i < Objects; i++){
+        out << "\tStatic (\n\t\tUiD ( " << i + 1 << " )\n\t\tFileName ( object_" << i % 100 << ".s )\n";
+        out << "\t\tPosition ( " << i % 2048 - 1024 << ".5 101.25 " << (i*7) % 2048 - 1024 << ".75 )\n";
+        out << "\t\tQDirection ( 0 0.382683 0 0.92388 )\n\t\tVDbId ( 4294967294 )\n\t\tStaticFlags ( 00100000 )\n\t)\n";
+    }
+    out << ")";
+}
+
+static QByteArray tokens(Tile* tile){
+    TokenWriter out(261844);
+    for(int i = 0; i < tile->jestObiektow; i++)
+        if(tile->obiekty[i] != NULL)
+            tile->obiekty[i]->saveTokens(&out);
+    return out.data;
+}
+
+static Tile* load(qint64 &nsecs){
+    QElapsedTimer timer;
+    timer.start();
+    Tile* tile = new Tile();
+    tile->loadData();
+    nsecs = timer.nsecsElapsed();
+    return tile;
+}
+
+// TileCache writes on its own thread and has nothing to wait on.
+static bool waitForCache(){
+    for(int i = 0; i < 1000; i++){
+        if(QFile::exists(cachePath()))
+            return true;
+        QThread::msleep(10);
+    }
+    return false;
+}
+
+int main(){
+    QTemporaryDir dir;
+    Game::root = dir.path();
+    Game::route = "test";
+    QDir().mkpath(Game::root + "/routes/test/world");
+    writeWorld();
+
+    TestUtil::check(!Game::useTileCache, "tile cache is on by default");
+    qint64 plain;
+    Tile* tile = load(plain);
+    QThread::msleep(200);
+    TestUtil::check(!QFile::exists(cachePath()), "cache written while off");
+    tile->release();
+    delete tile;
+
+    Game::useTileCache = true;
+    qint64 parsed;
+    Tile* text = load(parsed);
+    TestUtil::check(text->jestObiektow == Objects, "objects in text");
+    TestUtil::check(waitForCache(), "no cache file");
+
+    qint64 reopened;
+    Tile* cached = load(reopened);
+    TestUtil::check(cached->jestObiektow == text->jestObiektow, "object count from cache");
+    TestUtil::check(tokens(cached) == tokens(text), "objects from cache");
+
+    TestUtil::printTimes(QString("%1 objects, reopen from cache against text parse").arg(Objects), reopened, parsed);
+    qDebug() << "text parse with the cache off:" << plain/1000 << "us";
+    text->release();
+    cached->release();
+    delete text;
+    delete cached;
+    return TestUtil::result("TileCacheTest");
+}
@@ -0,0 +1,182 @@
+/*  This file is part of TSRE5.
+ *
+ *  TSRE5 - train sim game engine and MSTS/OR Editors.
+ *  Copyright (C) 2016 Piotr Gadecki <pgadecki@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *
+ *  See LICENSE.md or https://www.gnu.org/licenses/gpl.html
+ */
+
+#include <tsre/world/TileStreamer.h>
+#include <tsre/world/Tile.h>
+#include <tsre/world/Route.h>
+#include <tsre/world/Trk.h>
+#include <tsre/world/Terrain.h>
+#include <tsre/world/TerrainLibSimple.h>
+#include <tsre/world/objects/WorldObj.h>
+#include <tsre/renderer/FrameScheduler.h>
+#include <tsre/shape/ShapeLib.h>
+#include <tsre/Game.h>
+#include "TestUtil.h"
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QThread>
+#include <QFile>
+#include <QDir>
+#include <QDebug>
+#include <functional>
+
+/*
+ * TileStreamer with two workers on synthetic tiles.
+ * A large tile requested first finishes after small ones requested later,
+ * each tile still has to end up under its own id with its own objects.
+ * A tile the camera leaves while it is parsed is dropped, terrain tiles
+ * are streamed into the TerrainLib of the route, and stop() joins the
+ * workers and drops what is in flight.
+ */
+
+static const int Large = 40000;
+static const int Small = 10;
+
+static int id(int x, int z){
+    return x*10000 + z;
+}
+
+static void writeWorld(int x, int z, int objects){
+    QFile file(Game::root + "/routes/" + Game::route + "/world/w" + Tile::getNameXY(x) + Tile::getNameXY(-z) + ".w");
+    file.open(QIODevice::WriteOnly);
+    QTextStream out(&file);
+    out.setEncoding(QStringConverter::Utf16);
+    out.setGenerateByteOrderMark(true);
+    out << "SIMISA@@@@@@@@@@JINX0w0t______\n\nTr_Worldfile (\n";
+    for(int i = 0; i < objects; i++){
+        out << "\tStatic (\n\t\tUiD ( " << i + 1 << " )\n\t\tFileName ( tile_" << x << "_" << z << ".s )\n";
+        out << "\t\tPosition ( " << i % 2048 - 1024 << ".5 10 " << (i*7) % 2048 - 1024 << ".75 )\n";
+        out << "\t\tQDirection ( 0 0 0 1 )\n\t\tVDbId ( 4294967294 )\n\t\tStaticFlags ( 00100000 )\n\t)\n";
+    }
+    out << ")";
+}
+
+// One frame of the editor with the camera in tile x, z.
+static void frame(Route* route, int x, int z){
+    float playerT[2] = { (float)x, (float)z };
+    float playerPos[3] = { 0, 0, 0 };
+    FrameScheduler::nextFrame();
+    TileStreamer::update(route, playerT, playerPos);
+}
+
+static bool run(Route* route, int x, int z, std::function<bool()> ready){
+    for(int i = 0; i < 3000; i++){
+        frame(route, x, z);
+        if(ready())
+            return true;
+        QThread::msleep(5);
+    }
+    return false;
+}
+
+static void checkTile(Route* route, int x, int z, int objects){
+    Tile* tile = route->tile.value(id(x, z), NULL);
+    QString name = QString("tile %1 %2").arg(x).arg(z);
+    TestUtil::check(tile != NULL, name + " not loaded");
+    if(tile == NULL)
+        return;
+    TestUtil::check(tile->x == x && tile->z == z, name + " under another id");
+    TestUtil::check(tile->jestObiektow == objects, name + " object count");
+    bool own = true;
+    for(auto it = tile->obiekty.begin(); it != tile->obiekty.end(); ++it)
+        if(it->second != NULL)
+            own &= it->second->fileName == QString("tile_%1_%2.s").arg(x).arg(z);
+    TestUtil::check(own, name + " has objects of another tile");
+}
+
+int main(){
+    QTemporaryDir dir;
+    Game::root = dir.path();
+    Game::route = "test";
+    QDir().mkpath(Game::root + "/routes/test/world");
+    QDir().mkpath(Game::root + "/routes/test/tiles");
+    Game::currentShapeLib = new ShapeLib();
+    Game::tileStreaming = true;
+    Game::tileLoaderThreads = 2;
+    Game::tileLod = 1;
+    Route route;
+    route.trk = new Trk();
+    route.terrainLib = new TerrainLibSimple();
+    route.loaded = true;
+    Game::currentRoute = &route;
+    Game::terrainLib = route.terrainLib;
+
+    // Out of order: the large tile is requested first.
+    writeWorld(1, 0, Large);
+    writeWorld(0, 1, Small);
+    writeWorld(-1, 0, Small);
+    writeWorld(0, -1, Small);
+    int requested[4][2] = { {1, 0}, {0, 1}, {-1, 0}, {0, -1} };
+    for(int i = 0; i < 4; i++)
+        TestUtil::check(TileStreamer::request(requested[i][0], requested[i][1]), "request refused");
+    QVector<int> order;
+    bool all = run(&route, 0, 0, [&](){
+        for(int i = 0; i < 4; i++){
+            int tileId = id(requested[i][0], requested[i][1]);
+            if(route.tile.value(tileId, NULL) != NULL && !order.contains(tileId))
+                order.push_back(tileId);
+        }
+        return order.size() == 4;
+    });
+    TestUtil::check(all, "requested tiles not loaded");
+    TestUtil::check(order.size() == 4 && order.back() == id(1, 0), "large tile did not finish last");
+    checkTile(&route, 1, 0, Large);
+    checkTile(&route, 0, 1, Small);
+    checkTile(&route, -1, 0, Small);
+    checkTile(&route, 0, -1, Small);
+
+    // Terrain goes to the TerrainLib of the route.
+    Terrain::SaveEmpty(Terrain::getTileName(1, -1));
+    TestUtil::check(route.terrainLib->getTerrainByXY(1, 1) == NULL, "terrain loaded before the request");
+    TestUtil::check(TileStreamer::requestTerrain(1, 1), "terrain request refused");
+    bool terrain = run(&route, 0, 0, [&](){
+        return route.terrainLib->getTerrainByXY(1, 1) != NULL;
+    });
+    TestUtil::check(terrain && route.terrainLib->getTerrainByXY(1, 1)->loaded, "terrain not streamed");
+    TestUtil::check(route.terrainLib->getTerrainByXY(1, 1) == NULL
+            || route.terrainLib->getTerrainByXY(1, 1)->thread() == QThread::currentThread(), "terrain left on the worker");
+
+    // Cancelled in flight: the camera leaves while the tile is parsed.
+    writeWorld(-1, -1, Large);
+    TileStreamer::request(-1, -1);
+    QThread::msleep(5);
+    bool idle = run(&route, 50, 50, [](){
+        return TileStreamer::pendingCount() == 0;
+    });
+    TestUtil::check(idle, "cancelled tile still pending");
+    TestUtil::check(route.tile.value(id(-1, -1), NULL) == NULL, "tile out of range was added");
+    checkTile(&route, 1, 0, Large);
+
+    // stop() joins the workers with a tile in flight, requests start new ones.
+    frame(&route, 0, 0);
+    TileStreamer::request(-1, -1);
+    QThread::msleep(5);
+    TileStreamer::stop();
+    TestUtil::check(TileStreamer::pendingCount() == 0, "pending tiles after stop");
+    frame(&route, 0, 0);
+    TestUtil::check(route.tile.value(id(-1, -1), NULL) == NULL, "tile added after stop");
+    TileStreamer::request(-1, -1);
+    bool restarted = run(&route, 0, 0, [&](){
+        return route.tile.value(id(-1, -1), NULL) != NULL;
+    });
+    TestUtil::check(restarted, "no tiles after restarting the workers");
+    checkTile(&route, -1, -1, Large);
+    TileStreamer::stop();
+
+    for(auto it = route.tile.begin(); it != route.tile.end(); ++it){
+        if(it.value() == NULL)
+            continue;
+        it.value()->release();
+        delete it.value();
+    }
+    route.tile.clear();
+    Game::currentRoute = NULL;
+    return TestUtil::result("TileStreamerTest");
+}
@@ -0,0 +1,126 @@
+/*  This file is part of TSRE5.
+ *
+ *  TSRE5 - train sim game engine and MSTS/OR Editors.
+ *  Copyright (C) 2016 Piotr Gadecki <pgadecki@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *
+ *  See LICENSE.md or https://www.gnu.org/licenses/gpl.html
+ */
+
+#include <tsre/math3d/Intersections.h>
+#include "TestUtil.h"
+#include <QElapsedTimer>
+#include <vector>
+#include <math.h>
+
+/*
+ * Crossing sleepers of the two paths of a turnout, the check done by
+ * ProceduralShape::GenAdvancedTie(). Intersections::shapeIntersectsShape()
+ * with its triangle BVH has to give the same counts as testing every
+ * triangle pair, the times of both are printed for several turnouts.
+ */
+
+static const int Stride = 9;
+
+// Sleeper as 12 triangles, vertices of 9 floats with the position first.
+static void pushSleeper(std::vector<float> &out, float x, float z, float angle, int detail){
+    const float w = 1.3, h = 0.1, d = 0.125;
+    float c = cos(angle), s = sin(angle);
+    const int faces[12][3] = {
+        {0,1,2},{0,2,3},{4,6,5},{4,7,6},{0,4,5},{0,5,1},
+        {1,5,6},{1,6,2},{2,6,7},{2,7,3},{3,7,4},{3,4,0}
+    };
+    // Longer sleepers are split along x, like the detailed templates.
+    for(int part = 0; part < detail; part++){
+        float x0 = -w + 2*w*part/detail;
+        float x1 = -w + 2*w*(part + 1)/detail;
+        float corners[8][3] = {
+            {x0,-h,-d},{x1,-h,-d},{x1,-h,d},{x0,-h,d},
+            {x0,h,-d},{x1,h,-d},{x1,h,d},{x0,h,d}
+        };
+        for(int f = 0; f < 12; f++)
+            for(int k = 0; k < 3; k++){
+                float* p = corners[faces[f][k]];
+                out.push_back(x + p[0]*c + p[2]*s);
+                out.push_back(p[1]);
+                out.push_back(z - p[0]*s + p[2]*c);
+                for(int j = 3; j < Stride; j++)
+                    out.push_back(0);
+            }
+    }
+}
+
+// Every triangle pair, as shapeIntersectsShape() did before the BVH.
+static int bruteForce(float* shape1, float* shape2, int count1, int count2){
+    int tak = 0;
+    for(int i = 0; i < count1; i += 3*Stride)
+        for(int j = 0; j < count2; j += 3*Stride){
+            float* v0 = &shape1[i];
+            float* v1 = &shape1[i+Stride];
+            float* v2 = &shape1[i+2*Stride];
+            float* p0 = &shape2[j];
+            float* p1 = &shape2[j+Stride];
+            float* p2 = &shape2[j+2*Stride];
+            tak += Intersections::segmentIntersectsTriangle(p0, p1, v0, v1, v2);
+            tak += Intersections::segmentIntersectsTriangle(p0, p2, v0, v1, v2);
+            tak += Intersections::segmentIntersectsTriangle(p1, p2, v0, v1, v2);
+            tak += Intersections::segmentIntersectsTriangle(v0, v1, p0, p1, p2);
+            tak += Intersections::segmentIntersectsTriangle(v0, v2, p0, p1, p2);
+            tak += Intersections::segmentIntersectsTriangle(v1, v2, p0, p1, p2);
+        }
+    return tak;
+}
+
+int main(){
+    struct Turnout {
+        float radius;
+        float length;
+        int detail;
+    };
+    const Turnout turnouts[] = {
+        { 190, 30, 1 },
+        { 300, 40, 1 },
+        { 500, 50, 2 },
+        { 760, 60, 2 },
+        { 1200, 80, 3 }
+    };
+    float pos[3] = { 0, 0, 0 };
+    for(int t = 0; t < 5; t++){
+        const Turnout &turnout = turnouts[t];
+        std::vector<std::vector<float> > paths[2];
+        for(float z = 0; z < turnout.length; z += 0.6){
+            paths[0].push_back(std::vector<float>());
+            pushSleeper(paths[0].back(), 0, z, 0, turnout.detail);
+            float angle = asin(z/turnout.radius);
+            paths[1].push_back(std::vector<float>());
+            pushSleeper(paths[1].back(), turnout.radius*(1 - cos(angle)), turnout.radius*sin(angle), angle, turnout.detail);
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+        std::vector<int> fast;
+        for(unsigned int i = 0; i < paths[0].size(); i++)
+            for(unsigned int j = 0; j < paths[1].size(); j++)
+                fast.push_back(Intersections::shapeIntersectsShape(paths[0][i].data(), paths[1][j].data(),
+                        paths[0][i].size(), paths[1][j].size(), Stride, Stride, pos));
+        qint64 fastTime = timer.nsecsElapsed();
+
+        timer.start();
+        std::vector<int> slow;
+        for(unsigned int i = 0; i < paths[0].size(); i++)
+            for(unsigned int j = 0; j < paths[1].size(); j++)
+                slow.push_back(bruteForce(paths[0][i].data(), paths[1][j].data(),
+                        paths[0][i].size(), paths[1][j].size()));
+        qint64 slowTime = timer.nsecsElapsed();
+
+        int crossing = 0;
+        for(unsigned int i = 0; i < slow.size(); i++)
+            if(slow[i] > 0)
+                crossing++;
+        TestUtil::check(fast == slow, QString("radius %1: counts differ").arg(turnout.radius));
+        TestUtil::printTimes(QString("radius %1, %2 x %3 sleepers, %4 crossing, BVH against all pairs")
+                .arg(turnout.radius).arg(paths[0].size()).arg(paths[1].size()).arg(crossing), fastTime, slowTime);
+    }
+    return TestUtil::result("TurnoutIntersectionTest");
+}
@@ -0,0 +1,266 @@
+/*  This file is part of TSRE5.
+ *
+ *  TSRE5 - train sim game engine and MSTS/OR Editors.
+ *  Copyright (C) 2016 Piotr Gadecki <pgadecki@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *
+ *  See LICENSE.md or https://www.gnu.org/licenses/gpl.html
+ */
+
+#include <tsre/world/Tile.h>
+#include <tsre/world/Route.h>
+#include <tsre/world/Trk.h>
+#include <tsre/world/objects/WorldObj.h>
+#include <tsre/shape/ShapeLib.h>
+#include <tsre/fileFunctions/SaveQueue.h>
+#include <tsre/fileFunctions/TokenWriter.h>
+#include <tsre/Game.h>
+#include "TestUtil.h"
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QStringList>
+#include <QFile>
+#include <QDir>
+#include <QDebug>
+#include <algorithm>
+
+/*
+ * Text and compressed binary .w files of every world object type have to
+ * load into the same objects. A fixture of each type is loaded and saved
+ * by Tile::save(), once as text and once with Game::saveBinaryWorld.
+ * Both files are loaded again and saved as text, which must give the same
+ * bytes. UiD, position, rotation, file name and track items of the loaded
+ * objects are compared with the fixture.
+ * Tiles with rulers or TSRE's own tokens must stay text.
+ */
+
+static const char* Common =
+    "\t\tUiD ( %1 )\n"
+    "\t\tPosition ( 12.5 101.25 -640.75 )\n"
+    "\t\tQDirection ( 0 0.382683 0 0.92388 )\n"
+    "\t\tVDbId ( 4294967294 )\n"
+    "\t\tStaticDetailLevel ( 2 )\n"
+    "\t\tStaticFlags ( 00100000 )\n";
+
+// Position and QDirection of Common after load(), z is negated.
+static const float Position[3] = { 12.5, 101.25, 640.75 };
+static const float QDirection[4] = { 0, 0.382683, 0, 0.92388 };
+
+struct Sample {
+    const char* name;
+    const char* body;
+    // Expected file name, empty if the type keeps none in fileName.
+    const char* fileName;
+    // TrItemId pairs of track and item id.
+    const char* items;
+};
+
+static const Sample Samples[] = {
+    { "Static", "\t\tFileName ( house.s )\n\t\tCollideFlags ( 1 )\n", "house.s", "" },
+    { "Gantry", "\t\tFileName ( gantry.s )\n", "gantry.s", "" },
+    { "CollideObject", "\t\tFileName ( wall.s )\n\t\tCollideFunction ( 2 )\n", "wall.s", "" },
+    { "TrackObj", "\t\tSectionIdx ( 31 )\n\t\tElevation ( 0.01 )\n\t\tFileName ( A1t10mStrt.s )\n"
+        "\t\tJNodePosn ( -5 14725 100.5 -20.25 300.125 )\n", "A1t10mStrt.s", "" },
+    { "Dyntrack", "\t\tSectionIdx ( 40001 )\n\t\tElevation ( 0 )\n"
+        "\t\tTrackSections (\n"
+        "\t\t\tTrackSection ( SectionCurve ( 0 ) 40002 25 0 )\n"
+        "\t\t\tTrackSection ( SectionCurve ( 1 ) 40003 0.2 500 )\n"
+        "\t\t\tTrackSection ( SectionCurve ( 0 ) 4294967295 0 0 )\n"
+        "\t\t\tTrackSection ( SectionCurve ( 1 ) 4294967295 0 0 )\n"
+        "\t\t\tTrackSection ( SectionCurve ( 0 ) 4294967295 0 0 )\n"
+        "\t\t)\n", "", "" },
+    { "Signal", "\t\tFileName ( sig.s )\n\t\tSignalSubObj ( 00000003 )\n"
+        "\t\tSignalUnits ( 2\n"
+        "\t\t\tSignalUnit ( 0\n\t\t\t\tTrItemId ( 0 17 )\n\t\t\t)\n"
+        "\t\t\tSignalUnit ( 1\n\t\t\t\tTrItemId ( 0 18 )\n\t\t\t)\n"
+        "\t\t)\n", "sig.s", "0 17 0 18" },
+    { "Speedpost", "\t\tSpeed_Digit_Tex ( speedpost.ace )\n"
+        "\t\tSpeed_Sign_Shape ( 2 0.1 1.2 -0.05 0 -0.1 1.2 0.05 3.14 )\n"
+        "\t\tSpeed_Text_Size ( 0.2 1 0 )\n"
+        "\t\tTrItemId ( 0 21 )\n\t\tTrItemId ( 0 22 )\n\t\tFileName ( post.s )\n", "post.s", "0 21 0 22" },
+    { "Forest", "\t\tTreeTexture ( trees.ace )\n\t\tScaleRange ( 0.8 1.2 )\n\t\tArea ( 100 50 )\n"
+        "\t\tTreeSize ( 6 10 )\n\t\tPopulation ( 120 )\n", "", "" },
+    { "Transfer", "\t\tWidth ( 4.5 )\n\t\tHeight ( 8 )\n\t\tFileName ( road.ace )\n", "", "" },
+    { "Platform", "\t\tPlatformData ( ffff0000 )\n\t\tTrItemId ( 0 31 )\n\t\tTrItemId ( 0 32 )\n", "", "0 31 0 32" },
+    { "Siding", "\t\tSidingData ( ffff0000 )\n\t\tTrItemId ( 0 33 )\n\t\tTrItemId ( 0 34 )\n", "", "0 33 0 34" },
+    { "CarSpawner", "\t\tCarFrequency ( 5 )\n\t\tCarAvSpeed ( 20 )\n\t\tTrItemId ( 0 41 )\n\t\tTrItemId ( 0 42 )\n", "", "0 41 0 42" },
+    { "LevelCr", "\t\tLevelCrParameters ( 0 0 )\n\t\tCrashProbability ( 0 )\n\t\tLevelCrData ( 00000000 1 )\n"
+        "\t\tLevelCrTiming ( 60 60 60 )\n\t\tTrItemId ( 0 51 )\n\t\tTrItemId ( 1 52 )\n\t\tFileName ( crossing.s )\n",
+        "crossing.s", "0 51 1 52" },
+    { "Pickup", "\t\tSpeedRange ( 0 5 )\n\t\tPickupType ( 5 0 )\n\t\tPickupAnimData ( 1 0 )\n"
+        "\t\tPickupCapacity ( 0 0 )\n\t\tTrItemId ( 0 61 )\n\t\tFileName ( water.s )\n", "water.s", "0 61" },
+    { "Hazard", "\t\tTrItemId ( 0 71 )\n\t\tFileName ( cow.haz )\n", "cow.haz", "0 71" }
+};
+static const int SampleCount = sizeof(Samples)/sizeof(Sample);
+
+static QString object(const char* name, const char* body, int uid, const char* extra = ""){
+    return QString("\t%1 (\n").arg(name) + QString(Common).arg(uid) + body + extra + "\t)\n";
+}
+
+static QByteArray fixture(const QString &objects){
+    QByteArray data;
+    QTextStream out(&data, QIODevice::WriteOnly | QIODevice::Text);
+    out.setEncoding(QStringConverter::Utf16);
+    out.setGenerateByteOrderMark(true);
+    out << "SIMISA@@@@@@@@@@JINX0w0t______\n\nTr_Worldfile (\n";
+    out << "\tVDbIdCount ( 1 )\n";
+    out << "\tViewDbSphere (\n\t\tVDbId ( 0 )\n\t\tPosition ( 0 0 0 )\n\t\tRadius ( 1500 )\n\t)\n";
+    out << objects;
+    out << ")";
+    out.flush();
+    return data;
+}
+
+static QString worldPath(){
+    return Game::root + "/routes/" + Game::route + "/world/w" + Tile::getNameXY(0) + Tile::getNameXY(0) + ".w";
+}
+
+static Tile* load(const QByteArray &data){
+    QFile file(worldPath());
+    file.open(QIODevice::WriteOnly);
+    file.write(data);
+    file.close();
+    Tile* tile = new Tile();
+    tile->loadData();
+    tile->finishLoad(false);
+    return tile;
+}
+
+// The file Tile::save() writes, text or binary as Game::saveBinaryWorld says.
+static QByteArray save(Tile* tile, bool binary){
+    Game::saveBinaryWorld = binary;
+    tile->save();
+    SaveQueue::WaitForDone();
+    Game::saveBinaryWorld = false;
+    QFile file(worldPath());
+    file.open(QIODevice::ReadOnly);
+    return file.readAll();
+}
+
+static void release(Tile* tile){
+    tile->release();
+    delete tile;
+}
+
+static QByteArray tokens(WorldObj* obj){
+    TokenWriter out(261844);
+    obj->saveTokens(&out);
+    return out.data;
+}
+
+static QVector<int> items(WorldObj* obj){
+    QVector<int> out;
+    for(int tdb = 0; tdb < 2; tdb++){
+        QVector<int> ids;
+        obj->getTrackItemIds(ids, tdb);
+        std::sort(ids.begin(), ids.end());
+        for(int i = 0; i < ids.size(); i++)
+            if(ids[i] >= 0){
+                out.push_back(tdb);
+                out.push_back(ids[i]);
+            }
+    }
+    return out;
+}
+
+static QVector<int> items(const char* text){
+    QVector<int> out;
+    QStringList list = QString(text).split(' ', Qt::SkipEmptyParts);
+    for(int i = 0; i < list.size(); i++)
+        out.push_back(list[i].toInt());
+    return out;
+}
+
+static void checkFields(const QString &name, WorldObj* obj, const Sample &sample, int uid, bool quaternion){
+    TestUtil::check(obj->UiD == (unsigned int)uid, name + ": UiD of " + obj->type);
+    for(int i = 0; i < 3; i++)
+        TestUtil::check(obj->position[i] == Position[i], name + ": position of " + obj->type);
+    if(quaternion)
+        for(int i = 0; i < 4; i++)
+            TestUtil::check(obj->qDirection[i] == QDirection[i], name + ": QDirection of " + obj->type);
+    if(sample.fileName[0] != 0)
+        TestUtil::check(obj->fileName == sample.fileName, name + ": file name of " + obj->type);
+    TestUtil::check(items(obj) == items(sample.items), name + ": TrItemId of " + obj->type);
+}
+
+/*
+ * Objects of samples[i] have UiD firstUiD + i. Without quaternion the
+ * rotation is not compared, for objects given by Matrix3x3.
+ */
+static void checkRoundTrip(const QString &name, const QString &objects, const Sample* samples, int count, int firstUiD, bool quaternion = true){
+    Tile* source = load(fixture(objects));
+    QByteArray text = save(source, false);
+    QByteArray binary = save(source, true);
+    release(source);
+    TestUtil::check(!text.startsWith("SIMISA@F"), name + ": text save compressed");
+    TestUtil::check(binary.startsWith("SIMISA@F"), name + ": not written in binary");
+
+    Tile* fromText = load(text);
+    Tile* fromBinary = load(binary);
+    TestUtil::check(fromText->jestObiektow == count, name + ": object count in text");
+    TestUtil::check(fromBinary->jestObiektow == count, name + ": object count in binary");
+    TestUtil::check(fromText->vDbIdCount == fromBinary->vDbIdCount, name + ": VDbIdCount");
+    TestUtil::check(fromText->viewDbSphere.size() == fromBinary->viewDbSphere.size(), name + ": ViewDbSphere");
+    for(int i = 0; i < fromText->jestObiektow && i < fromBinary->jestObiektow; i++){
+        WorldObj* a = fromText->obiekty[i];
+        WorldObj* b = fromBinary->obiekty[i];
+        if(a == NULL || b == NULL){
+            TestUtil::check(a == b, name + ": missing object");
+            continue;
+        }
+        TestUtil::check(a->typeID == b->typeID, name + ": type " + a->type);
+        TestUtil::check(tokens(a) == tokens(b), name + ": fields of " + a->type);
+        int s = b->UiD - firstUiD;
+        if(s < 0 || s >= count){
+            TestUtil::fail(name + ": unknown UiD of " + b->type);
+            continue;
+        }
+        checkFields(name + " text", a, samples[s], firstUiD + s, quaternion);
+        checkFields(name + " binary", b, samples[s], firstUiD + s, quaternion);
+    }
+
+    QByteArray textAgain = save(fromText, false);
+    QByteArray binaryAsText = save(fromBinary, false);
+    TestUtil::check(textAgain == text, name + ": text save not stable");
+    TestUtil::check(binaryAsText == textAgain, name + ": binary file saves other text");
+    release(fromText);
+    release(fromBinary);
+}
+
+static void checkText(const QString &name, const QString &objects){
+    Tile* source = load(fixture(objects));
+    QByteArray data = save(source, true);
+    release(source);
+    TestUtil::check(!data.isEmpty() && !data.startsWith("SIMISA@F"), name + ": written in binary");
+}
+
+int main(){
+    QTemporaryDir dir;
+    Game::root = dir.path();
+    Game::route = "test";
+    QDir().mkpath(Game::root + "/routes/test/world");
+    Game::currentShapeLib = new ShapeLib();
+    Route route;
+    route.trk = new Trk();
+    Game::currentRoute = &route;
+
+    QString all;
+    for(int i = 0; i < SampleCount; i++){
+        QString obj = object(Samples[i].name, Samples[i].body, i + 1);
+        checkRoundTrip(Samples[i].name, obj, &Samples[i], 1, i + 1);
+        all += obj;
+    }
+    checkRoundTrip("all types", all, Samples, SampleCount, 1);
+
+    // Matrix3x3 instead of QDirection.
+    checkRoundTrip("Matrix3x3", object("Static", "\t\tFileName ( house.s )\n"
+            "\t\tMatrix3x3 ( 0 0 1 0 1 0 -1 0 0 )\n", 100), Samples, 1, 100, false);
+
+    checkText("Ruler", all + object("Ruler", "", 200));
+    checkText("ShapeTemplate", all + object("Dyntrack", Samples[4].body, 201, "\t\tShapeTemplate ( \"Rails\" )\n"));
+    checkText("ORTS list name", object("CarSpawner", Samples[11].body, 202, "\t\tORTSListName ( trucks )\n"));
+
+    Game::currentRoute = NULL;
+    return TestUtil::result("WorldFileTest");
+}